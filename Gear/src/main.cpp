@@ -6,6 +6,24 @@
 #include <vector>
 #include <set>
 #include <algorithm>
+#include <sstream>
+#include <chrono>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
 namespace fs = std::filesystem;
 
 void showHelp() {
@@ -16,6 +34,9 @@ void showHelp() {
   std::cout << "    init [name]         Initialize a new Magolor project\n";
   std::cout << "    build               Build the current project\n";
   std::cout << "    run                 Build and run the project\n";
+  std::cout << "    watch               Rebuild and restart on every change\n";
+  std::cout << "    test [filter]       Build and run the tests in parallel\n";
+  std::cout << "    bench [filter]      Build and run the benchmarks\n";
   std::cout << "    clean               Remove build artifacts\n";
   std::cout << "    check               Check code for errors without building\n";
   std::cout << "    add <package>       Add a dependency to the project\n";
@@ -24,7 +45,22 @@ void showHelp() {
   std::cout << "    help                Show this help message\n\n";
   std::cout << "\033[1mOPTIONS:\033[0m\n";
   std::cout << "    --release           Build in release mode (optimized)\n";
+  std::cout << "    --profile <name>    Build with a [profile.<name>] from project.toml\n";
+  std::cout << "    --pgo-train         Build, run a workload, then rebuild with its profile\n";
   std::cout << "    --verbose           Show detailed build information\n";
+  std::cout << "    --timings           Show where the compiler spent its time\n";
+  std::cout << "    --trace-out <file>  Write the compiler's timings as a Chrome trace\n";
+  std::cout << "    --exec <command>    With watch or --pgo-train: run a command instead\n";
+  std::cout << "                        of the binary\n";
+  std::cout << "    --jobs <n>          With test: run up to n tests at once\n";
+  std::cout << "    --timeout <secs>    With test: fail tests running longer (default 60)\n";
+  std::cout << "    --junit <file>      With test: write a JUnit XML report\n";
+  std::cout << "    --json <file>       With test: write a JSON report\n";
+  std::cout << "    --baseline <file>   With bench: compare against saved results\n";
+  std::cout << "    --save-baseline <file>\n";
+  std::cout << "                        With bench: save the results as a baseline\n";
+  std::cout << "    --threshold <pct>   With bench: smallest change reported (default 5)\n";
+  std::cout << "    --time <ms>         With bench: time spent measuring each benchmark\n";
 }
 
 bool is_directory_empty(const fs::path &path) {
@@ -87,8 +123,11 @@ void initProject(std::string name, const std::string& targetDir = ".") {
                             "[dependencies]\n"
                             "# Add dependencies here\n"
                             "# example = \"1.0.0\"\n\n"
-                            "[build]\n"
-                            "optimization = \"2\"\n";
+                            "[profile.dev]\n"
+                            "opt-level = 2\n\n"
+                            "[profile.release]\n"
+                            "opt-level = 3\n"
+                            "# native = true\n";
 
   if (!writeToFile((projDir / "project.toml").string(), tomlContent)) {
     std::cerr << "\033[1;31merror\033[0m: failed to create project.toml\n";
@@ -182,6 +221,19 @@ void initProject(std::string name, const std::string& targetDir = ".") {
   std::cout << "\033[1;36m        Note\033[0m: Multi-file project with module support\n";
 }
 
+std::string readProjectName() {
+  std::ifstream toml("project.toml");
+  std::string line;
+  while (std::getline(toml, line)) {
+    if (line.find("name =") != std::string::npos) {
+      size_t start = line.find('"') + 1;
+      size_t end = line.rfind('"');
+      return line.substr(start, end - start);
+    }
+  }
+  return "";
+}
+
 std::vector<std::string> collectSourceFiles(const std::string& srcDir) {
   std::vector<std::string> files;
   std::set<std::string> uniqueFiles;
@@ -218,25 +270,166 @@ std::vector<std::string> collectSourceFiles(const std::string& srcDir) {
   return files;
 }
 
+// Build fingerprint
+//
+// One line per build input: project.toml and the lock file by content, every
+// source file (the project's and each installed package's) by size and
+// modification time, the magolor and g++ executables found on PATH, and the
+// build flags. The binary's own size and time come last, so deleting or
+// replacing it forces a rebuild too. When the fingerprint stored with the
+// last successful build matches, `gear build` and `gear run` reuse
+// target/<name> without starting the compiler.
+
+const char *const FINGERPRINT_PATH = "target/.fingerprint";
+
+std::string fileStamp(const std::string &path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return "missing";
+  }
+  return std::to_string(st.st_size) + " " + std::to_string(st.st_mtim.tv_sec) +
+         "." + std::to_string(st.st_mtim.tv_nsec);
+}
+
+std::string contentHash(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return "missing";
+  }
+  // FNV-1a
+  unsigned long long hash = 1469598103934665603ull;
+  char buffer[8192];
+  while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+    for (std::streamsize i = 0; i < file.gcount(); i++) {
+      hash ^= static_cast<unsigned char>(buffer[i]);
+      hash *= 1099511628211ull;
+    }
+  }
+  std::ostringstream out;
+  out << std::hex << hash;
+  return out.str();
+}
+
+std::string findOnPath(const std::string &program) {
+  const char *path = std::getenv("PATH");
+  std::stringstream dirs(path ? path : "");
+  std::string dir;
+  while (std::getline(dirs, dir, ':')) {
+    fs::path candidate = fs::path(dir.empty() ? "." : dir) / program;
+    if (access(candidate.c_str(), X_OK) == 0) {
+      return candidate.string();
+    }
+  }
+  return "";
+}
+
+void addSourceStamps(const fs::path &dir, std::vector<std::string> &lines) {
+  std::error_code ec;
+  if (!fs::is_directory(dir, ec)) {
+    return;
+  }
+  std::vector<std::string> files;
+  for (auto it = fs::recursive_directory_iterator(dir, ec);
+       !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    if (it->path().extension() == ".mg" && it->is_regular_file(ec)) {
+      files.push_back(it->path().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  for (const auto &file : files) {
+    lines.push_back("source " + file + " " + fileStamp(file));
+  }
+}
+
+// `target` is the binary's name in target/; harness builds also cover their
+// directory, tests/ or benches/
+std::string buildFingerprint(const std::string &target,
+                             const std::string &flags,
+                             const std::string &harness) {
+  std::vector<std::string> lines;
+  lines.push_back("flags " + flags);
+  lines.push_back("project.toml " + contentHash("project.toml"));
+  lines.push_back("lock " + contentHash(".magolor/lock.toml"));
+  for (const char *var : {"MAGOLOR_CXX", "MAGOLOR_LINKER"}) {
+    const char *value = std::getenv(var);
+    lines.push_back(std::string("env ") + var + "=" + (value ? value : ""));
+  }
+  for (const char *tool : {"magolor", "g++"}) {
+    std::string path = findOnPath(tool);
+    lines.push_back(std::string("tool ") + tool + " " + path + " " +
+                    (path.empty() ? "" : fileStamp(path)));
+  }
+
+  addSourceStamps("src", lines);
+  if (harness == "test") {
+    addSourceStamps("tests", lines);
+  } else if (harness == "bench") {
+    addSourceStamps("benches", lines);
+  }
+  std::error_code ec;
+  // Release builds pick up a trained PGO profile on their own
+  std::vector<std::string> profiles;
+  for (auto it = fs::directory_iterator("target/pgo", ec);
+       !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    profiles.push_back(it->path().string());
+  }
+  std::sort(profiles.begin(), profiles.end());
+  for (const auto &profile : profiles) {
+    lines.push_back("profile " + profile + " " + fileStamp(profile));
+  }
+  ec.clear();
+  std::vector<fs::path> packages;
+  for (auto it = fs::directory_iterator(".magolor/packages", ec);
+       !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    packages.push_back(it->path());
+  }
+  std::sort(packages.begin(), packages.end());
+  for (const auto &package : packages) {
+    addSourceStamps(package / "src", lines);
+  }
+
+  lines.push_back("binary " + fileStamp("target/" + target));
+
+  std::string fingerprint;
+  for (const auto &line : lines) {
+    fingerprint += line + "\n";
+  }
+  return fingerprint;
+}
+
+// First line that differs between two fingerprints, for --verbose
+std::string fingerprintChange(const std::string &before,
+                              const std::string &now) {
+  std::istringstream a(before), b(now);
+  std::string lineA, lineB;
+  while (true) {
+    bool moreA = static_cast<bool>(std::getline(a, lineA));
+    bool moreB = static_cast<bool>(std::getline(b, lineB));
+    if (!moreA && !moreB) {
+      return "";
+    }
+    if (!moreA || !moreB || lineA != lineB) {
+      std::string line = moreB ? lineB : lineA;
+      if (line.rfind("flags ", 0) == 0) {
+        return "flags";
+      }
+      return line.substr(0, line.find(' ', line.find(' ') + 1));
+    }
+  }
+}
 
-int buildProject(bool verbose = false) {
+// With a `harness` ("test" or "bench"), builds target/<name>-<harness>
+// instead, which has its own fingerprint. `rebuilt`, when given, is set
+// only if the build produced a binary that differs from the previous one.
+int buildProject(bool verbose = false, const std::string &flags = "",
+                 const std::string &harness = "", bool *rebuilt = nullptr) {
   if (!fs::exists("project.toml")) {
     std::cerr << "\033[1;31merror\033[0m: could not find project.toml\n";
     std::cerr << "  \033[1;34m= help:\033[0m initialize a project with 'gear init'\n";
     return 1;
   }
 
-  // Parse project name
-  std::ifstream toml("project.toml");
-  std::string line, projectName;
-  while (std::getline(toml, line)) {
-    if (line.find("name =") != std::string::npos) {
-      size_t start = line.find('"') + 1;
-      size_t end = line.rfind('"');
-      projectName = line.substr(start, end - start);
-      break;
-    }
-  }
+  std::string projectName = readProjectName();
 
   if (projectName.empty()) {
     std::cerr << "\033[1;31merror\033[0m: could not determine project name\n";
@@ -250,8 +443,45 @@ int buildProject(bool verbose = false) {
     return 1;
   }
 
+  std::string suffix = harness.empty() ? "" : "-" + harness;
+  std::string target = projectName + suffix;
+  std::string fingerprintPath = std::string(FINGERPRINT_PATH) + suffix;
+
+  auto start = std::chrono::steady_clock::now();
+  std::string fingerprint = buildFingerprint(target, flags, harness);
+  std::string stored;
+  {
+    std::ifstream in(fingerprintPath);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    stored = buffer.str();
+  }
+  // A build asked to report its timings always runs
+  bool profiling = flags.find(" --timings") != std::string::npos ||
+                   flags.find(" --trace-out ") != std::string::npos;
+  if (!profiling && !stored.empty() && stored == fingerprint) {
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    std::ostringstream elapsed;
+    elapsed.precision(2);
+    elapsed << std::fixed << ms / 1000.0;
+    std::cout << "\033[1;32m    Finished\033[0m " << target
+              << " is up to date in " << elapsed.str() << "s\n";
+    return 0;
+  }
+  if (verbose) {
+    std::string change = fingerprintChange(stored, fingerprint);
+    if (!stored.empty() && !change.empty()) {
+      std::cout << "\033[1;32m     Dirty\033[0m " << change << " changed\n";
+    }
+  }
+  // A failed build must never leave a fingerprint that matches
+  std::error_code ec;
+  fs::remove(fingerprintPath, ec);
+
   if (verbose) {
-    std::cout << "\033[1;32m   Building\033[0m " << projectName << "\n";
+    std::cout << "\033[1;32m   Building\033[0m " << target << "\n";
     std::cout << "\033[1;32m   Compiling\033[0m " << sourceFiles.size() << " files\n";
     for (auto& f : sourceFiles) {
       std::cout << "             " << f << "\n";
@@ -265,38 +495,50 @@ int buildProject(bool verbose = false) {
     buildCmd += " " + file;
   }
 
+  buildCmd += flags;
+  if (!harness.empty()) {
+    buildCmd += " --" + harness;
+  }
   if (verbose) {
     buildCmd += " --verbose";
   }
 
+  // Touched or comment-only sources still rebuild, but come out of the
+  // compile cache as the same binary
+  std::string previousBinary = rebuilt ? contentHash("target/" + target) : "";
+
+  std::cout.flush();
   int result = std::system(buildCmd.c_str());
   if (result != 0) {
     std::cerr << "\033[1;31merror\033[0m: build failed\n";
     return 1;
   }
-  
+
+  // Only the binary's stamp may differ from before the build; any other
+  // change (an edit during the build, a freshly written lock file) means the
+  // next build cannot trust this one
+  std::string after = buildFingerprint(target, flags, harness);
+  std::string binaryLine = "binary ";
+  if (after.substr(0, after.rfind(binaryLine)) ==
+      fingerprint.substr(0, fingerprint.rfind(binaryLine))) {
+    writeToFile(fingerprintPath, after);
+  }
+
+  if (rebuilt) {
+    *rebuilt = contentHash("target/" + target) != previousBinary;
+  }
   return 0;
 }
 
 
 
-int runProject(bool verbose = false) {
+int runProject(bool verbose = false, const std::string &flags = "") {
   if (!fs::exists("project.toml")) {
     std::cerr << "\033[1;31merror\033[0m: could not find project.toml\n";
     return 1;
   }
 
-  // Parse project name
-  std::ifstream toml("project.toml");
-  std::string line, projectName;
-  while (std::getline(toml, line)) {
-    if (line.find("name =") != std::string::npos) {
-      size_t start = line.find('"') + 1;
-      size_t end = line.rfind('"');
-      projectName = line.substr(start, end - start);
-      break;
-    }
-  }
+  std::string projectName = readProjectName();
 
   if (projectName.empty()) {
     std::cerr << "\033[1;31merror\033[0m: could not determine project name\n";
@@ -304,7 +546,7 @@ int runProject(bool verbose = false) {
   }
 
   // ALWAYS build - and check for errors
-  int buildResult = buildProject(verbose);
+  int buildResult = buildProject(verbose, flags);
   if (buildResult != 0) {
     return buildResult;  // Don't run if build failed
   }
@@ -325,6 +567,815 @@ int runProject(bool verbose = false) {
   return 0;  // Success
 }
 
+// Profile-guided optimization
+//
+// `gear build --pgo-train` builds an instrumented binary, runs a workload
+// (the program itself, or the --exec command) to record which branches and
+// calls are hot, then rebuilds using that record. The profile stays in
+// target/pgo, and later builds with the same profile keep using it until
+// the next training run. Training uses the release profile unless another
+// one is given.
+int trainProfile(bool verbose, std::string flags, const std::string &command) {
+  if (!fs::exists("project.toml")) {
+    std::cerr << "\033[1;31merror\033[0m: could not find project.toml\n";
+    return 1;
+  }
+  std::string projectName = readProjectName();
+  if (flags.find("--release") == std::string::npos &&
+      flags.find("--profile") == std::string::npos) {
+    flags += " --release";
+  }
+
+  std::error_code ec;
+  fs::remove_all("target/pgo", ec);
+  if (buildProject(verbose, flags + " --pgo-generate") != 0) {
+    return 1;
+  }
+
+  std::string workload = command.empty() ? "./target/" + projectName : command;
+  std::cout << "\033[1;32m    Training\033[0m `" << workload << "`\n";
+  std::cout.flush();
+  int status = std::system(workload.c_str());
+  if (status != 0) {
+    std::cerr << "\033[1;33mwarning\033[0m: training run exited with status "
+              << (WIFEXITED(status) ? WEXITSTATUS(status) : status) << "\n";
+  }
+
+  bool recorded = false;
+  for (auto it = fs::directory_iterator("target/pgo", ec);
+       !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    // .gcda from GCC, .profraw from Clang
+    recorded = recorded || it->path().extension() == ".gcda" ||
+               it->path().extension() == ".profraw";
+  }
+  if (!recorded) {
+    std::cerr << "\033[1;31merror\033[0m: the training run recorded no profile\n";
+    std::cerr << "  \033[1;34m= help:\033[0m the program must exit normally, not crash or be killed\n";
+    return 1;
+  }
+
+  std::cout << "\033[1;32m  Optimizing\033[0m with the recorded profile\n";
+  return buildProject(verbose, flags);
+}
+
+// Watch mode
+//
+// `gear watch` keeps the project built while you edit. inotify watches src/,
+// every installed package's src/ and project.toml. A burst of events (an
+// editor writing a file in several steps, a branch switch) is folded into
+// one rebuild once the tree has been quiet for a moment. The rebuild goes
+// through buildProject, so the fingerprint skips it when nothing that
+// matters changed, and the compiler reuses its precompiled runtime.
+//
+// After a successful build the program is restarted: the old process group
+// gets SIGTERM (SIGKILL if it lingers), then the new binary starts. With
+// --exec, a shell command such as a test script runs instead. A failed
+// build leaves the previous process running.
+
+const int WATCH_QUIET_MS = 100;
+
+volatile sig_atomic_t watchInterrupted = 0;
+
+void onWatchSignal(int) { watchInterrupted = 1; }
+
+void addWatches(int fd, const fs::path &dir,
+                std::map<int, fs::path> &watches) {
+  const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                        IN_CREATE | IN_DELETE | IN_DELETE_SELF;
+  std::error_code ec;
+  if (!fs::is_directory(dir, ec)) {
+    return;
+  }
+  int wd = inotify_add_watch(fd, dir.c_str(), mask);
+  if (wd >= 0) {
+    watches[wd] = dir;
+  }
+  for (auto it = fs::recursive_directory_iterator(dir, ec);
+       !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    if (it->is_directory(ec)) {
+      wd = inotify_add_watch(fd, it->path().c_str(), mask);
+      if (wd >= 0) {
+        watches[wd] = it->path();
+      }
+    }
+  }
+}
+
+void watchProjectTree(int fd, std::map<int, fs::path> &watches) {
+  for (const auto &[wd, path] : watches) {
+    inotify_rm_watch(fd, wd);
+  }
+  watches.clear();
+
+  // project.toml is watched through its directory, since editors often
+  // replace the file rather than write to it
+  int wd = inotify_add_watch(fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (wd >= 0) {
+    watches[wd] = ".";
+  }
+  addWatches(fd, "src", watches);
+  std::error_code ec;
+  for (auto it = fs::directory_iterator(".magolor/packages", ec);
+       !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    addWatches(fd, it->path() / "src", watches);
+  }
+}
+
+// Drains pending events. Returns true if any of them can affect the build;
+// `rescan` is set when directories appeared or went away.
+bool readWatchEvents(int fd, const std::map<int, fs::path> &watches,
+                     bool &rescan) {
+  alignas(struct inotify_event) char buffer[16384];
+  bool relevant = false;
+  while (true) {
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n <= 0) {
+      break;
+    }
+    for (char *p = buffer; p < buffer + n;) {
+      auto *event = reinterpret_cast<struct inotify_event *>(p);
+      p += sizeof(struct inotify_event) + event->len;
+
+      std::string name = event->len ? event->name : "";
+      auto dir = watches.find(event->wd);
+      bool root = dir != watches.end() && dir->second == ".";
+      if (event->mask & (IN_ISDIR | IN_DELETE_SELF | IN_Q_OVERFLOW)) {
+        rescan = rescan || !root;
+        relevant = relevant || !root;
+      } else if (root) {
+        relevant = relevant || name == "project.toml";
+      } else if (fs::path(name).extension() == ".mg") {
+        relevant = true;
+      }
+    }
+  }
+  return relevant;
+}
+
+pid_t startWatchedProcess(const std::string &projectName,
+                          const std::string &command) {
+  std::string exePath = "./target/" + projectName;
+  std::vector<std::string> args;
+  if (command.empty()) {
+    std::cout << "\033[1;32m    Running\033[0m `" << exePath.substr(2)
+              << "`\n";
+    args = {exePath};
+  } else {
+    std::cout << "\033[1;32m    Running\033[0m `" << command << "`\n";
+    args = {"/bin/sh", "-c", command};
+  }
+  std::cout.flush();
+
+  std::vector<char *> argv;
+  for (auto &arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  // Its own process group, so a restart also stops anything it spawned
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+  posix_spawnattr_setpgroup(&attr, 0);
+  pid_t pid = -1;
+  if (posix_spawn(&pid, argv[0], nullptr, &attr, argv.data(), environ) != 0) {
+    std::cerr << "\033[1;31merror\033[0m: could not start " << args[0]
+              << "\n";
+    pid = -1;
+  }
+  posix_spawnattr_destroy(&attr);
+  return pid;
+}
+
+void stopWatchedProcess(pid_t &pid) {
+  if (pid <= 0) {
+    return;
+  }
+  kill(-pid, SIGTERM);
+  for (int i = 0; i < 40; i++) {
+    if (waitpid(pid, nullptr, WNOHANG) == pid) {
+      pid = -1;
+      return;
+    }
+    usleep(50 * 1000);
+  }
+  kill(-pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+  pid = -1;
+}
+
+// Reports the watched process exiting on its own
+void reapWatchedProcess(pid_t &pid) {
+  int status = 0;
+  if (pid > 0 && waitpid(pid, &status, WNOHANG) == pid) {
+    pid = -1;
+    if (WIFEXITED(status)) {
+      std::cout << "\033[1;32m      Exited\033[0m with status "
+                << WEXITSTATUS(status) << "\n";
+    } else if (WIFSIGNALED(status)) {
+      std::cout << "\033[1;33m      Exited\033[0m on signal "
+                << WTERMSIG(status) << "\n";
+    }
+    std::cout << "\033[1;36m    Watching\033[0m for changes\n";
+    std::cout.flush();
+  }
+}
+
+int watchProject(bool verbose, const std::string &flags,
+                 const std::string &command) {
+  if (!fs::exists("project.toml")) {
+    std::cerr << "\033[1;31merror\033[0m: could not find project.toml\n";
+    return 1;
+  }
+  std::string projectName = readProjectName();
+
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    std::cerr << "\033[1;31merror\033[0m: inotify is not available\n";
+    return 1;
+  }
+  std::map<int, fs::path> watches;
+  watchProjectTree(fd, watches);
+
+  struct sigaction action = {};
+  action.sa_handler = onWatchSignal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  pid_t child = -1;
+  bool build = true;
+  while (!watchInterrupted) {
+    if (build) {
+      build = false;
+      auto start = std::chrono::steady_clock::now();
+      bool rebuilt = false;
+      if (buildProject(verbose, flags, "", &rebuilt) != 0) {
+        if (child > 0) {
+          std::cout << "\033[1;33m     Keeping\033[0m the previous build running\n";
+        }
+      } else if (rebuilt || child <= 0) {
+        // A build that left the binary as it was (a touched or unrelated
+        // file) keeps the running process
+        stopWatchedProcess(child);
+        if (verbose && rebuilt) {
+          double ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+          std::cout << "\033[1;32m     Rebuilt\033[0m in "
+                    << static_cast<int>(ms) << "ms\n";
+        }
+        child = startWatchedProcess(projectName, command);
+      }
+      std::cout << "\033[1;36m    Watching\033[0m for changes\n";
+      std::cout.flush();
+    }
+
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, 250) <= 0) {
+      reapWatchedProcess(child);
+      continue;
+    }
+
+    // Collect the whole burst before rebuilding
+    bool rescan = false;
+    bool changed = readWatchEvents(fd, watches, rescan);
+    while (!watchInterrupted && poll(&pfd, 1, WATCH_QUIET_MS) > 0) {
+      changed = readWatchEvents(fd, watches, rescan) || changed;
+    }
+    if (rescan) {
+      watchProjectTree(fd, watches);
+    }
+    build = changed;
+  }
+
+  stopWatchedProcess(child);
+  close(fd);
+  return 0;
+}
+
+// Test runner
+//
+// `gear test` builds the test harness once (every `test fn` in src/ and
+// tests/ in one binary, on the shared precompiled runtime), asks it for the
+// list of tests, and runs each test as its own process, several at a time.
+// A test passes when its process exits with status 0; assertion failures,
+// exit() and crashes fail only that test, and one that outlives --timeout is
+// killed with its process group. Output is captured and shown for failures.
+// --junit and --json write machine-readable reports for CI.
+
+struct TestOptions {
+  std::string filter;  // substring of the test name
+  size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+  int timeout = 60;  // seconds
+  std::string junitPath;
+  std::string jsonPath;
+};
+
+struct TestResult {
+  enum Status { Passed, Failed, TimedOut };
+
+  std::string name;
+  Status status = Failed;
+  int exitCode = -1;
+  double seconds = 0;
+  std::string output;
+};
+
+TestResult runTest(const std::string &binary, const std::string &name,
+                   int timeout) {
+  TestResult result;
+  result.name = name;
+  auto start = std::chrono::steady_clock::now();
+
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0) {
+    result.output = "could not create a pipe\n";
+    return result;
+  }
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                   O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+  posix_spawnattr_setpgroup(&attr, 0);
+
+  std::string program = binary;
+  std::string argument = name;
+  char *argv[] = {program.data(), argument.data(), nullptr};
+  pid_t pid = -1;
+  int err = posix_spawn(&pid, argv[0], &actions, &attr, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+  close(fds[1]);
+  if (err != 0) {
+    close(fds[0]);
+    result.output = "could not start " + binary + "\n";
+    return result;
+  }
+
+  // Read until the test closes its output (it exited) or time runs out
+  auto deadline = start + std::chrono::seconds(timeout);
+  bool timedOut = false;
+  char buffer[4096];
+  while (true) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now())
+                    .count();
+    if (left <= 0) {
+      timedOut = true;
+      break;
+    }
+    struct pollfd pfd = {fds[0], POLLIN, 0};
+    int ready = poll(&pfd, 1, static_cast<int>(left));
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ready <= 0) {
+      continue;
+    }
+    ssize_t n = read(fds[0], buffer, sizeof(buffer));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    result.output.append(buffer, n);
+  }
+  close(fds[0]);
+
+  if (timedOut) {
+    kill(-pid, SIGKILL);
+  }
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  if (timedOut) {
+    result.status = TestResult::TimedOut;
+  } else if (WIFEXITED(status)) {
+    result.exitCode = WEXITSTATUS(status);
+    result.status = result.exitCode == 0 ? TestResult::Passed : TestResult::Failed;
+  } else if (WIFSIGNALED(status)) {
+    result.output += "killed by signal " + std::to_string(WTERMSIG(status)) + "\n";
+  }
+  return result;
+}
+
+std::string escapeXml(const std::string &text) {
+  std::string out;
+  for (unsigned char c : text) {
+    switch (c) {
+    case '&': out += "&amp;"; break;
+    case '<': out += "&lt;"; break;
+    case '>': out += "&gt;"; break;
+    case '"': out += "&quot;"; break;
+    default:
+      // Control characters other than tab and newline are not valid XML
+      if (c >= 0x20 || c == '\t' || c == '\n') {
+        out += static_cast<char>(c);
+      }
+    }
+  }
+  return out;
+}
+
+std::string escapeJson(const std::string &text) {
+  std::string out;
+  for (unsigned char c : text) {
+    switch (c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    case '\t': out += "\\t"; break;
+    default:
+      if (c < 0x20) {
+        char code[8];
+        std::snprintf(code, sizeof(code), "\\u%04x", c);
+        out += code;
+      } else {
+        out += static_cast<char>(c);
+      }
+    }
+  }
+  return out;
+}
+
+std::string testFailure(const TestResult &result, int timeout) {
+  if (result.status == TestResult::TimedOut) {
+    return "timed out after " + std::to_string(timeout) + "s";
+  }
+  if (result.exitCode >= 0) {
+    return "exit status " + std::to_string(result.exitCode);
+  }
+  return "crashed";
+}
+
+void writeJUnitReport(const std::string &path, const std::string &suite,
+                      const std::vector<TestResult> &results, double seconds,
+                      int timeout) {
+  size_t failures = 0;
+  for (const auto &r : results) {
+    failures += r.status != TestResult::Passed;
+  }
+  std::ostringstream xml;
+  xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  xml << "<testsuites tests=\"" << results.size() << "\" failures=\""
+      << failures << "\" time=\"" << seconds << "\">\n";
+  xml << "  <testsuite name=\"" << escapeXml(suite) << "\" tests=\""
+      << results.size() << "\" failures=\"" << failures
+      << "\" errors=\"0\" skipped=\"0\" time=\"" << seconds << "\">\n";
+  for (const auto &r : results) {
+    xml << "    <testcase classname=\"" << escapeXml(suite) << "\" name=\""
+        << escapeXml(r.name) << "\" time=\"" << r.seconds << "\"";
+    if (r.status == TestResult::Passed && r.output.empty()) {
+      xml << "/>\n";
+      continue;
+    }
+    xml << ">\n";
+    if (r.status != TestResult::Passed) {
+      xml << "      <failure message=\"" << escapeXml(testFailure(r, timeout))
+          << "\"/>\n";
+    }
+    if (!r.output.empty()) {
+      xml << "      <system-out>" << escapeXml(r.output) << "</system-out>\n";
+    }
+    xml << "    </testcase>\n";
+  }
+  xml << "  </testsuite>\n</testsuites>\n";
+  writeToFile(path, xml.str());
+}
+
+void writeJsonReport(const std::string &path, const std::string &suite,
+                     const std::vector<TestResult> &results, double seconds) {
+  static const char *const STATUS[] = {"passed", "failed", "timeout"};
+  size_t passed = 0;
+  for (const auto &r : results) {
+    passed += r.status == TestResult::Passed;
+  }
+  std::ostringstream json;
+  json << "{\n  \"suite\": \"" << escapeJson(suite) << "\",\n";
+  json << "  \"passed\": " << passed << ",\n";
+  json << "  \"failed\": " << results.size() - passed << ",\n";
+  json << "  \"duration\": " << seconds << ",\n";
+  json << "  \"tests\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto &r = results[i];
+    json << (i ? "," : "") << "\n    {\"name\": \"" << escapeJson(r.name)
+         << "\", \"status\": \"" << STATUS[r.status]
+         << "\", \"exitCode\": " << r.exitCode
+         << ", \"duration\": " << r.seconds << ", \"output\": \""
+         << escapeJson(r.output) << "\"}";
+  }
+  json << (results.empty() ? "" : "\n  ") << "]\n}\n";
+  writeToFile(path, json.str());
+}
+
+int testProject(bool verbose, const std::string &flags,
+                const TestOptions &options) {
+  if (!fs::exists("project.toml")) {
+    std::cerr << "\033[1;31merror\033[0m: could not find project.toml\n";
+    return 1;
+  }
+  std::string projectName = readProjectName();
+  if (buildProject(verbose, flags, "test") != 0) {
+    return 1;
+  }
+
+  std::string binary = "./target/" + projectName + "-test";
+  std::vector<std::string> names;
+  FILE *list = popen((binary + " --list").c_str(), "r");
+  if (list) {
+    char line[1024];
+    while (fgets(line, sizeof(line), list)) {
+      std::string name = line;
+      name.erase(name.find_last_not_of("\r\n") + 1);
+      if (!name.empty() && name.find(options.filter) != std::string::npos) {
+        names.push_back(name);
+      }
+    }
+    pclose(list);
+  }
+
+  std::cout << "\033[1;32m     Running\033[0m " << names.size() << " tests\n";
+  auto start = std::chrono::steady_clock::now();
+  std::vector<TestResult> results(names.size());
+  std::atomic<size_t> next{0};
+  std::mutex outputMutex;
+  auto work = [&] {
+    for (size_t i; (i = next++) < names.size();) {
+      results[i] = runTest(binary, names[i], options.timeout);
+      const TestResult &r = results[i];
+      std::ostringstream line;
+      line << "test " << r.name << " ... ";
+      if (r.status == TestResult::Passed) {
+        line << "\033[1;32mok\033[0m";
+      } else if (r.status == TestResult::TimedOut) {
+        line << "\033[1;31mtimeout\033[0m";
+      } else {
+        line << "\033[1;31mFAILED\033[0m";
+      }
+      if (verbose) {
+        line << " (" << static_cast<int>(r.seconds * 1000) << "ms)";
+      }
+      std::lock_guard<std::mutex> lock(outputMutex);
+      std::cout << line.str() << "\n";
+      std::cout.flush();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < std::min(options.jobs, names.size()); i++) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  size_t passed = 0;
+  std::vector<const TestResult *> failed;
+  for (const auto &r : results) {
+    if (r.status == TestResult::Passed) {
+      passed++;
+    } else {
+      failed.push_back(&r);
+    }
+  }
+  for (const auto *r : failed) {
+    std::cout << "\n---- " << r->name << " "
+              << testFailure(*r, options.timeout) << " ----\n"
+              << r->output;
+  }
+
+  std::ostringstream elapsed;
+  elapsed.precision(2);
+  elapsed << std::fixed << seconds;
+  std::cout << "\ntest result: "
+            << (failed.empty() ? "\033[1;32mok\033[0m" : "\033[1;31mFAILED\033[0m")
+            << ". " << passed << " passed; " << failed.size() << " failed; finished in "
+            << elapsed.str() << "s\n";
+
+  if (!options.junitPath.empty()) {
+    writeJUnitReport(options.junitPath, projectName, results, seconds,
+                     options.timeout);
+  }
+  if (!options.jsonPath.empty()) {
+    writeJsonReport(options.jsonPath, projectName, results, seconds);
+  }
+  return failed.empty() ? 0 : 1;
+}
+
+// Benchmarks
+//
+// `gear bench` builds target/<name>-bench from the `bench fn`s in src/ and
+// benches/ and runs the benchmarks one after another, since running them
+// side by side would disturb the timings. Std.Bench in the harness does the
+// warmup, calibration and statistics; Gear reports and compares. Every run
+// is saved to target/bench/latest.json. With --baseline FILE, a benchmark
+// counts as changed only when its median moved by more than --threshold
+// percent (default 5) and the 95% confidence intervals do not overlap; any
+// regression fails the command. --save-baseline FILE keeps this run as a
+// baseline, for instance to check in and compare against in CI.
+
+struct BenchOptions {
+  std::vector<std::string> filters;
+  std::string baselinePath;
+  std::string savePath;
+  double threshold = 5;  // percent
+  std::string timeMs;    // measuring time per benchmark, passed to the harness
+};
+
+struct BenchResult {
+  std::string name;
+  double median = 0, mad = 0, low = 0, high = 0;  // ns per call
+  long samples = 0, iterations = 0;
+};
+
+std::string shellQuote(const std::string &text) {
+  std::string quoted = "'";
+  for (char c : text) {
+    quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+  }
+  return quoted + "'";
+}
+
+std::string formatNs(double ns) {
+  static const char *const UNITS[] = {"ns", "us", "ms", "s"};
+  int unit = 0;
+  while (unit < 3 && ns >= 1000) {
+    ns /= 1000;
+    unit++;
+  }
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(ns < 10 ? 3 : ns < 100 ? 2 : 1) << ns
+      << " " << UNITS[unit];
+  return out.str();
+}
+
+void writeBenchReport(const std::string &path, const std::string &project,
+                      const std::vector<BenchResult> &results) {
+  std::ostringstream json;
+  json << "{\n  \"project\": \"" << escapeJson(project) << "\",\n";
+  json << "  \"benches\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto &r = results[i];
+    json << (i ? "," : "") << "\n    {\"name\": \"" << escapeJson(r.name)
+         << "\", \"median\": " << r.median << ", \"mad\": " << r.mad
+         << ", \"low\": " << r.low << ", \"high\": " << r.high
+         << ", \"samples\": " << r.samples
+         << ", \"iterations\": " << r.iterations << "}";
+  }
+  json << (results.empty() ? "" : "\n  ") << "]\n}\n";
+  fs::create_directories(fs::path(path).parent_path().empty()
+                             ? fs::path(".")
+                             : fs::path(path).parent_path());
+  writeToFile(path, json.str());
+}
+
+// Reads a report written by writeBenchReport, one benchmark per line
+std::map<std::string, BenchResult> readBenchReport(const std::string &path) {
+  std::map<std::string, BenchResult> results;
+  std::ifstream file(path);
+  std::string line;
+  auto number = [&](const std::string &key) {
+    size_t pos = line.find("\"" + key + "\": ");
+    return pos == std::string::npos
+               ? 0.0
+               : std::atof(line.c_str() + pos + key.size() + 4);
+  };
+  while (std::getline(file, line)) {
+    size_t pos = line.find("{\"name\": \"");
+    if (pos == std::string::npos) {
+      continue;
+    }
+    pos += 10;
+    BenchResult r;
+    r.name = line.substr(pos, line.find('"', pos) - pos);
+    r.median = number("median");
+    r.mad = number("mad");
+    r.low = number("low");
+    r.high = number("high");
+    r.samples = static_cast<long>(number("samples"));
+    r.iterations = static_cast<long>(number("iterations"));
+    results[r.name] = r;
+  }
+  return results;
+}
+
+int benchProject(bool verbose, const std::string &flags,
+                 const BenchOptions &options) {
+  if (!fs::exists("project.toml")) {
+    std::cerr << "\033[1;31merror\033[0m: could not find project.toml\n";
+    return 1;
+  }
+  std::map<std::string, BenchResult> baseline;
+  if (!options.baselinePath.empty()) {
+    if (!fs::exists(options.baselinePath)) {
+      std::cerr << "\033[1;31merror\033[0m: baseline " << options.baselinePath
+                << " does not exist\n";
+      return 1;
+    }
+    baseline = readBenchReport(options.baselinePath);
+  }
+
+  // Timings of unoptimized code say little, so benchmarks default to the
+  // release profile
+  std::string benchFlags = flags;
+  if (flags.find("--release") == std::string::npos &&
+      flags.find("--profile") == std::string::npos) {
+    benchFlags += " --release";
+  }
+  std::string projectName = readProjectName();
+  if (buildProject(verbose, benchFlags, "bench") != 0) {
+    return 1;
+  }
+
+  std::string command = "./target/" + projectName + "-bench --tsv";
+  if (!options.timeMs.empty()) {
+    command += " --time " + shellQuote(options.timeMs);
+  }
+  for (const auto &filter : options.filters) {
+    command += " " + shellQuote(filter);
+  }
+  FILE *harness = popen(command.c_str(), "r");
+  if (!harness) {
+    std::cerr << "\033[1;31merror\033[0m: could not run the benchmarks\n";
+    return 1;
+  }
+
+  std::cout << "\033[1;32m     Running\033[0m benchmarks\n";
+  std::cout.flush();
+  std::vector<BenchResult> results;
+  size_t regressions = 0;
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), harness)) {
+    std::istringstream fields(buffer);
+    BenchResult r;
+    std::getline(fields, r.name, '\t');
+    fields >> r.median >> r.mad >> r.low >> r.high >> r.samples >> r.iterations;
+    if (!fields) {
+      continue;
+    }
+    results.push_back(r);
+
+    std::cout << std::left << std::setw(24) << r.name << " "
+              << formatNs(r.median) << "/iter  (+/- " << formatNs(r.mad)
+              << ")  95% CI [" << formatNs(r.low) << ", " << formatNs(r.high)
+              << "]";
+    if (verbose) {
+      std::cout << "  " << r.samples << " x " << r.iterations;
+    }
+    std::cout << "\n";
+
+    auto base = baseline.find(r.name);
+    if (base != baseline.end() && base->second.median > 0) {
+      const BenchResult &b = base->second;
+      double change = (r.median - b.median) / b.median * 100;
+      bool overlap = r.low <= b.high && b.low <= r.high;
+      std::ostringstream percent;
+      percent << std::fixed << std::setprecision(1) << std::showpos << change
+              << "%";
+      std::cout << std::string(25, ' ') << "change: " << percent.str() << " ";
+      if (overlap || std::abs(change) <= options.threshold) {
+        std::cout << "(no significant change)\n";
+      } else if (change > 0) {
+        std::cout << "\033[1;31mregressed\033[0m\n";
+        regressions++;
+      } else {
+        std::cout << "\033[1;32mimproved\033[0m\n";
+      }
+    }
+    std::cout.flush();
+  }
+  if (pclose(harness) != 0) {
+    std::cerr << "\033[1;31merror\033[0m: the benchmark harness failed\n";
+    return 1;
+  }
+
+  writeBenchReport("target/bench/latest.json", projectName, results);
+  if (!options.savePath.empty()) {
+    writeBenchReport(options.savePath, projectName, results);
+    std::cout << "\033[1;32m       Saved\033[0m baseline " << options.savePath
+              << "\n";
+  }
+  if (regressions > 0) {
+    std::cerr << "\033[1;31merror\033[0m: " << regressions
+              << " benchmark(s) regressed against " << options.baselinePath
+              << "\n";
+    return 1;
+  }
+  return 0;
+}
 
 void cleanProject() {
   std::cout << "\033[1;32m    Cleaning\033[0m build artifacts\n";
@@ -435,11 +1486,53 @@ int main(int argc, char *argv[]) {
 
   std::string command = argv[1];
   bool verbose = false;
+  // Flags passed on to the compiler, part of the build fingerprint
+  std::string buildFlags;
+  std::string watchCommand;
+  bool pgoTrain = false;
+  TestOptions testOptions;
+  BenchOptions benchOptions;
 
   // Check for flags
   for (int i = 2; i < argc; i++) {
     if (std::string(argv[i]) == "--verbose") {
       verbose = true;
+    } else if (std::string(argv[i]) == "--exec" && i + 1 < argc) {
+      watchCommand = argv[++i];
+    } else if (std::string(argv[i]) == "--pgo-train") {
+      pgoTrain = true;
+    } else if (std::string(argv[i]) == "--trace-out" && i + 1 < argc) {
+      buildFlags += std::string(" --trace-out ") + argv[++i];
+    } else if (command == "test" && std::string(argv[i]) == "--jobs" &&
+               i + 1 < argc) {
+      testOptions.jobs = std::max(1, std::atoi(argv[++i]));
+    } else if (command == "test" && std::string(argv[i]) == "--timeout" &&
+               i + 1 < argc) {
+      testOptions.timeout = std::max(1, std::atoi(argv[++i]));
+    } else if (command == "test" && std::string(argv[i]) == "--junit" &&
+               i + 1 < argc) {
+      testOptions.junitPath = argv[++i];
+    } else if (command == "test" && std::string(argv[i]) == "--json" &&
+               i + 1 < argc) {
+      testOptions.jsonPath = argv[++i];
+    } else if (command == "test" && argv[i][0] != '-') {
+      testOptions.filter = argv[i];
+    } else if (command == "bench" && std::string(argv[i]) == "--baseline" &&
+               i + 1 < argc) {
+      benchOptions.baselinePath = argv[++i];
+    } else if (command == "bench" &&
+               std::string(argv[i]) == "--save-baseline" && i + 1 < argc) {
+      benchOptions.savePath = argv[++i];
+    } else if (command == "bench" && std::string(argv[i]) == "--threshold" &&
+               i + 1 < argc) {
+      benchOptions.threshold = std::atof(argv[++i]);
+    } else if (command == "bench" && std::string(argv[i]) == "--time" &&
+               i + 1 < argc) {
+      benchOptions.timeMs = argv[++i];
+    } else if (command == "bench" && argv[i][0] != '-') {
+      benchOptions.filters.push_back(argv[i]);
+    } else {
+      buildFlags += std::string(" ") + argv[i];
     }
   }
 
@@ -457,10 +1550,18 @@ int main(int argc, char *argv[]) {
     }
     std::string name = argv[2];
     initProject(name, name);
+  } else if (command == "build" && pgoTrain) {
+    return trainProfile(verbose, buildFlags, watchCommand);
   } else if (command == "build") {
-    return buildProject(verbose);
+    return buildProject(verbose, buildFlags);
   } else if (command == "run") {
-    return runProject(verbose);
+    return runProject(verbose, buildFlags);
+  } else if (command == "test") {
+    return testProject(verbose, buildFlags, testOptions);
+  } else if (command == "bench") {
+    return benchProject(verbose, buildFlags, benchOptions);
+  } else if (command == "watch") {
+    return watchProject(verbose, buildFlags, watchCommand);
   } else if (command == "clean") {
     cleanProject();
   } else if (command == "check") {
@@ -0,0 +1,418 @@
+// Generates a large synthetic Magolor project and times the compiler's front
+// end on it: Lexer, Parser, import and name resolution, TypeChecker and
+// CodeGen, each on its own, with the peak RSS reached after each phase.
+// Build it from MagolorCompiler/ with
+//
+//   g++ -std=c++17 -O2 -Iinclude -o frontend_bench bench/frontend_bench.cpp
+//       src/lexer.cpp src/parser.cpp src/typechecker.cpp src/codegen.cpp
+//       src/symbol_table.cpp src/phase_timer.cpp
+//
+// and run it as
+//
+//   ./frontend_bench [-n iterations] [--modules n] [--functions n]
+//                    [--classes n] [--depth n] [--json] [--emit dir]
+//
+// The corpus is a module tree --depth directories deep in which every
+// module imports the one before it and one halfway back, with --functions
+// functions and --classes classes per module. Function bodies cycle through
+// arithmetic with loops and arrays, long string interpolations, lambdas with
+// Option and match, calls into imported modules, and signatures with deeply
+// nested generic types. --emit writes it out as a project instead, so
+// `gear build --timings` can be run on the same code. --json prints one
+// object for CI to compare between commits.
+#include "codegen.hpp"
+#include "error.hpp"
+#include "lexer.hpp"
+#include "module.hpp"
+#include "parser.hpp"
+#include "typechecker.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct Shape {
+  int modules = 200;
+  int functions = 40;
+  int classes = 8;
+  int depth = 6;
+};
+
+struct SourceFile {
+  std::string path; // relative to the project, e.g. src/gen/d1/m3.mg
+  std::string text;
+};
+
+static const char *const PACKAGE = "stress";
+
+static std::string modulePath(int i, const Shape &shape) {
+  std::string path = "gen";
+  for (int d = 0; d < i % shape.depth; d++)
+    path += "/d" + std::to_string(d);
+  return path + "/m" + std::to_string(i);
+}
+
+static std::string moduleName(int i, const Shape &shape) {
+  std::string name = std::string(PACKAGE) + "." + modulePath(i, shape);
+  std::replace(name.begin(), name.end(), '/', '.');
+  return name;
+}
+
+// Map<string, Array<Option<Map<int, Array<...>>>>>, `levels` deep
+static std::string nestedType(int levels) {
+  if (levels == 0)
+    return "string";
+  if (levels % 2 == 0)
+    return "Map<string, Array<Option<" + nestedType(levels - 1) + ">>>";
+  return "Map<int, " + nestedType(levels - 1) + ">";
+}
+
+static std::string function(int m, int k, int imported) {
+  std::string name = "f" + std::to_string(m) + "_" + std::to_string(k);
+  std::ostringstream fn;
+  switch (k % 5) {
+  case 0:
+    fn << "pub fn " << name << "(a: int, b: int) -> int {\n"
+       << "    let mut total = a;\n"
+       << "    let items: Array<int> = [a, b, a + b, a * b, a - b];\n"
+       << "    for (x in items) {\n"
+       << "        total = total + x * 3 - (x / 2);\n"
+       << "    }\n"
+       << "    let mut i = 0;\n"
+       << "    while (i < b) {\n"
+       << "        if (total > 1000 && i % 2 == 0) {\n"
+       << "            total = total - i;\n"
+       << "        } else {\n"
+       << "            total = total + i;\n"
+       << "        }\n"
+       << "        i = i + 1;\n"
+       << "    }\n"
+       << "    return total;\n"
+       << "}\n";
+    break;
+  case 1:
+    fn << "pub fn " << name << "(label: string, count: int) -> string {\n"
+       << "    let ratio = 1.5;\n"
+       << "    return $\"";
+    for (int p = 0; p < 24; p++)
+      fn << "part " << p << " of {label}: {count + " << p
+         << "} at {ratio} ";
+    fn << "\";\n}\n";
+    break;
+  case 2:
+    fn << "pub fn " << name << "(value: int) -> int {\n"
+       << "    let twice = fn(x: int) -> int { return x * 2; };\n"
+       << "    let found: Option<int> = Some(twice(value));\n"
+       << "    let mut result = 0;\n"
+       << "    match found {\n"
+       << "        Some(v) => { result = v + 1; }\n"
+       << "        None => { result = 0; }\n"
+       << "    }\n"
+       << "    return result;\n"
+       << "}\n";
+    break;
+  case 3:
+    fn << "pub fn " << name << "(a: int, b: int) -> int {\n"
+       << "    let node = new C" << m << "_0();\n"
+       << "    node.id = a;\n";
+    if (imported >= 0)
+      fn << "    let other = f" << imported << "_0(a, b) + f" << imported
+         << "_2(b);\n";
+    else
+      fn << "    let other = a + b;\n";
+    fn << "    return other + node.score(b);\n"
+       << "}\n";
+    break;
+  default:
+    fn << "pub fn " << name << "(table: " << nestedType(4)
+       << ", key: string) -> bool {\n"
+       << "    return Std.Map.contains(table, key);\n"
+       << "}\n";
+  }
+  return fn.str();
+}
+
+static std::string classDecl(int m, int k) {
+  std::ostringstream cls;
+  cls << "class C" << m << "_" << k << " {\n"
+      << "    pub id: int;\n"
+      << "    pub label: string;\n"
+      << "    pub weights: Array<float>;\n"
+      << "    pub index: " << nestedType(2) << ";\n\n"
+      << "    pub fn score(scale: int) -> int {\n"
+      << "        return scale * " << k + 2 << " + 1;\n"
+      << "    }\n\n"
+      << "    pub fn describe(count: int) -> string {\n"
+      << "        return $\"C" << m << "_" << k
+      << " with {count} entries, scaled {count * 2}\";\n"
+      << "    }\n"
+      << "}\n\n";
+  return cls.str();
+}
+
+static std::vector<SourceFile> generateCorpus(const Shape &shape) {
+  std::vector<SourceFile> files;
+  for (int m = 0; m < shape.modules; m++) {
+    std::ostringstream text;
+    text << "using Std.IO;\n";
+    if (m > 0)
+      text << "using " << moduleName(m - 1, shape) << ";\n";
+    if (m / 2 > 0 && m / 2 != m - 1)
+      text << "using " << moduleName(m / 2, shape) << ";\n";
+    text << "\n";
+    for (int k = 0; k < std::max(1, shape.classes); k++)
+      text << classDecl(m, k);
+    for (int k = 0; k < shape.functions; k++)
+      text << function(m, k, m > 0 ? m - 1 : -1) << "\n";
+    files.push_back({"src/" + modulePath(m, shape) + ".mg", text.str()});
+  }
+
+  std::ostringstream main;
+  main << "using Std.IO;\nusing " << moduleName(shape.modules - 1, shape)
+       << ";\n\nfn main() {\n"
+       << "    Std.print($\"{f" << shape.modules - 1 << "_0(1, 2)}\\n\");\n"
+       << "}\n";
+  files.push_back({"src/main.mg", main.str()});
+  return files;
+}
+
+static bool emitProject(const std::vector<SourceFile> &files,
+                        const std::string &dir) {
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  std::ofstream(dir + "/project.toml")
+      << "name = \"" << PACKAGE << "\"\nversion = \"0.1.0\"\n";
+  for (const auto &file : files) {
+    fs::path path = fs::path(dir) / file.path;
+    fs::create_directories(path.parent_path(), ec);
+    std::ofstream out(path);
+    out << file.text;
+    if (!out)
+      return false;
+  }
+  return true;
+}
+
+static long peakRssKb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+struct Phase {
+  const char *name;
+  std::vector<double> ms; // one per iteration
+  long rssKb = 0;         // peak RSS after the first iteration's phase
+};
+
+enum { LEX, PARSE, RESOLVE, TYPECHECK, CODEGEN, PHASES };
+
+// One full front-end run. Returns false (after printing diagnostics) if the
+// corpus does not compile, which means the generator has drifted from the
+// language.
+static bool runOnce(const std::vector<SourceFile> &files, Phase *phases,
+                    bool first, size_t &tokenCount, size_t &outputBytes) {
+  ModuleRegistry::instance().clear();
+  auto elapsed = [](Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since)
+        .count();
+  };
+  auto finish = [&](int phase, double ms) {
+    phases[phase].ms.push_back(ms);
+    if (first)
+      phases[phase].rssKb = peakRssKb();
+  };
+
+  // Reporters keep a reference to their file's text
+  std::vector<std::unique_ptr<ErrorReporter>> reporters;
+  std::vector<std::vector<Token>> tokens(files.size());
+  auto start = Clock::now();
+  for (size_t i = 0; i < files.size(); i++) {
+    reporters.push_back(
+        std::make_unique<ErrorReporter>(files[i].path, files[i].text));
+    Lexer lexer(files[i].text, files[i].path, *reporters[i]);
+    tokens[i] = lexer.tokenize();
+  }
+  finish(LEX, elapsed(start));
+  tokenCount = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    tokenCount += tokens[i].size();
+    if (reporters[i]->hasError()) {
+      reporters[i]->printDiagnostics();
+      return false;
+    }
+  }
+
+  std::vector<Program> programs;
+  start = Clock::now();
+  for (size_t i = 0; i < files.size(); i++) {
+    Parser parser(std::move(tokens[i]), files[i].path, *reporters[i]);
+    programs.push_back(parser.parse());
+  }
+  finish(PARSE, elapsed(start));
+  for (size_t i = 0; i < files.size(); i++) {
+    if (reporters[i]->hasError()) {
+      reporters[i]->printDiagnostics();
+      return false;
+    }
+    auto module = std::make_shared<Module>();
+    module->name = ModuleResolver::filePathToModuleName(files[i].path, PACKAGE);
+    module->filepath = files[i].path;
+    module->packageName = PACKAGE;
+    module->ast = programs[i];
+    for (auto &fn : module->ast.functions)
+      fn.isPublic = true;
+    ModuleRegistry::instance().registerModule(module);
+  }
+
+  start = Clock::now();
+  ImportResolver importResolver;
+  NameResolver nameResolver;
+  for (const auto &[name, module] : ModuleRegistry::instance().getModules()) {
+    auto result = importResolver.resolve(module);
+    if (!result.success) {
+      std::cerr << result.error << "\n";
+      return false;
+    }
+  }
+  for (const auto &[name, module] : ModuleRegistry::instance().getModules()) {
+    auto result = nameResolver.resolve(module);
+    if (!result.success) {
+      for (const auto &error : result.errors)
+        std::cerr << error << "\n";
+      return false;
+    }
+  }
+  finish(RESOLVE, elapsed(start));
+
+  std::string noSource;
+  ErrorReporter typeReporter("type-check", noSource);
+  TypeChecker checker(typeReporter, ModuleRegistry::instance());
+  start = Clock::now();
+  for (const auto &[name, module] : ModuleRegistry::instance().getModules()) {
+    if (!checker.checkModule(module)) {
+      typeReporter.printDiagnostics();
+      return false;
+    }
+  }
+  finish(TYPECHECK, elapsed(start));
+
+  // As build-project does: one merged program, runtime from a header
+  Program merged;
+  for (const auto &prog : programs) {
+    merged.usings.insert(merged.usings.end(), prog.usings.begin(),
+                         prog.usings.end());
+    merged.classes.insert(merged.classes.end(), prog.classes.begin(),
+                          prog.classes.end());
+    merged.functions.insert(merged.functions.end(), prog.functions.begin(),
+                            prog.functions.end());
+  }
+  start = Clock::now();
+  CodeGen codegen;
+  std::string cpp = codegen.generate(merged, "magolor_runtime.hpp");
+  finish(CODEGEN, elapsed(start));
+  outputBytes = cpp.size();
+  return true;
+}
+
+static double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+int main(int argc, char **argv) {
+  Shape shape;
+  int iterations = 5;
+  bool json = false;
+  std::string emitDir;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "-n" && hasValue)
+      iterations = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "--modules" && hasValue)
+      shape.modules = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "--functions" && hasValue)
+      shape.functions = std::max(5, std::atoi(argv[++i]));
+    else if (arg == "--classes" && hasValue)
+      shape.classes = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "--depth" && hasValue)
+      shape.depth = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "--json")
+      json = true;
+    else if (arg == "--emit" && hasValue)
+      emitDir = argv[++i];
+    else {
+      std::cerr << "unknown argument " << arg << "\n";
+      return 1;
+    }
+  }
+
+  std::vector<SourceFile> files = generateCorpus(shape);
+  size_t bytes = 0, lines = 0;
+  for (const auto &file : files) {
+    bytes += file.text.size();
+    lines += std::count(file.text.begin(), file.text.end(), '\n');
+  }
+  if (!emitDir.empty()) {
+    if (!emitProject(files, emitDir)) {
+      std::cerr << "cannot write " << emitDir << "\n";
+      return 1;
+    }
+    std::cout << "wrote " << files.size() << " files (" << lines
+              << " lines) to " << emitDir << "\n";
+    return 0;
+  }
+
+  Phase phases[PHASES] = {
+      {"lex", {}, 0},        {"parse", {}, 0},   {"resolve", {}, 0},
+      {"typecheck", {}, 0},  {"codegen", {}, 0},
+  };
+  size_t tokenCount = 0, outputBytes = 0;
+  for (int i = 0; i < iterations; i++) {
+    if (!runOnce(files, phases, i == 0, tokenCount, outputBytes)) {
+      std::cerr << "the generated corpus does not compile\n";
+      return 1;
+    }
+  }
+
+  size_t functions = static_cast<size_t>(shape.modules) * shape.functions;
+  size_t classes = static_cast<size_t>(shape.modules) * shape.classes;
+  if (json) {
+    std::cout << "{\"files\": " << files.size() << ", \"lines\": " << lines
+              << ", \"bytes\": " << bytes << ", \"tokens\": " << tokenCount
+              << ", \"functions\": " << functions
+              << ", \"classes\": " << classes
+              << ", \"iterations\": " << iterations << ", \"phases\": {";
+    for (int p = 0; p < PHASES; p++) {
+      std::cout << (p ? ", " : "") << "\"" << phases[p].name
+                << "\": {\"ms\": " << median(phases[p].ms)
+                << ", \"peak_rss_kb\": " << phases[p].rssKb << "}";
+    }
+    std::cout << "}, \"output_bytes\": " << outputBytes << "}\n";
+    return 0;
+  }
+
+  std::cout << files.size() << " files, " << lines << " lines, "
+            << bytes / 1024 << " KiB, " << tokenCount << " tokens, "
+            << functions << " functions, " << classes << " classes\n";
+  std::cout << "median of " << iterations << " runs\n\n";
+  double total = 0;
+  for (int p = 0; p < PHASES; p++) {
+    double ms = median(phases[p].ms);
+    total += ms;
+    std::printf("  %-10s %9.2f ms  %8.0f lines/ms  peak RSS %6ld MiB\n",
+                phases[p].name, ms, ms > 0 ? lines / ms : 0.0,
+                phases[p].rssKb / 1024);
+  }
+  std::printf("  %-10s %9.2f ms  %8.0f lines/ms\n", "total", total,
+              total > 0 ? lines / total : 0.0);
+  return 0;
+}
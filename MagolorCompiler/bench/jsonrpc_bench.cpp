@@ -0,0 +1,158 @@
+// Replays an LSP session through Transport and times framing, parsing and
+// response serialization.
+//
+//   g++ -std=c++17 -O2 -Iinclude bench/jsonrpc_bench.cpp -o jsonrpc_bench
+//   ./jsonrpc_bench [-n iterations] [session.lsp]
+//
+// A session can be recorded from a real editor by starting the server with
+// MAGOLOR_LSP_RECORD=session.lsp. Without one, a synthetic session is used:
+// a large didOpen, a burst of incremental edits and completion/hover
+// requests.
+#include "jsonrpc.hpp"
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using Clock = std::chrono::steady_clock;
+
+static std::string frame(const std::string &body) {
+  return "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static std::string position(int line, int character) {
+  return "{\"line\":" + std::to_string(line) +
+         ",\"character\":" + std::to_string(character) + "}";
+}
+
+static std::string syntheticSession() {
+  std::string session;
+  session += frame(R"({"jsonrpc":"2.0","id":1,"method":"initialize",)"
+                   R"("params":{"processId":1,"capabilities":{}}})");
+
+  // ~20k lines of source, with quotes and tabs so escapes are exercised
+  std::string text;
+  for (int i = 0; i < 20000; i++) {
+    text += "fn f" + std::to_string(i) +
+            "(a: int) -> string {\\n\\treturn \\\"value \\\" + a;\\n}\\n";
+  }
+  session += frame(R"({"jsonrpc":"2.0","method":"textDocument/didOpen",)"
+                   R"("params":{"textDocument":{"uri":"file:///bench/a.mg",)"
+                   R"("languageId":"magolor","version":1,"text":")" +
+                   text + "\"}}}");
+
+  int id = 2;
+  for (int i = 0; i < 2000; i++) {
+    int line = (i * 37) % 20000;
+    session += frame(
+        R"({"jsonrpc":"2.0","method":"textDocument/didChange","params":)"
+        R"({"textDocument":{"uri":"file:///bench/a.mg","version":)" +
+        std::to_string(i + 2) + R"(},"contentChanges":[{"range":{"start":)" +
+        position(line, 4) + ",\"end\":" + position(line, 4) +
+        R"(},"text":"x"}]}})");
+    if (i % 4 == 0) {
+      session += frame(
+          R"({"jsonrpc":"2.0","id":)" + std::to_string(id++) +
+          R"(,"method":"textDocument/completion","params":{"textDocument":)"
+          R"({"uri":"file:///bench/a.mg"},"position":)" +
+          position(line, 5) + "}}");
+    }
+    if (i % 10 == 0) {
+      session += frame(
+          R"({"jsonrpc":"2.0","id":)" + std::to_string(id++) +
+          R"(,"method":"textDocument/hover","params":{"textDocument":)"
+          R"({"uri":"file:///bench/a.mg"},"position":)" +
+          position(line, 3) + "}}");
+    }
+  }
+  return session;
+}
+
+static JsonValue completionResponse(int items) {
+  JsonValue list = JsonValue::object();
+  list["isIncomplete"] = false;
+  list["items"] = JsonValue::array();
+  for (int i = 0; i < items; i++) {
+    JsonValue item = JsonValue::object();
+    item["label"] = "symbol" + std::to_string(i);
+    item["kind"] = 3;
+    item["detail"] = "(a: int, b: string) -> Array<int>";
+    item["documentation"] = "Line one\nLine \"two\"";
+    item["sortText"] = "1_symbol" + std::to_string(i);
+    list["items"].push(item);
+  }
+  return list;
+}
+
+int main(int argc, char **argv) {
+  int iterations = 20;
+  const char *sessionPath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc)
+      iterations = std::max(1, std::atoi(argv[++i]));
+    else
+      sessionPath = argv[i];
+  }
+
+  std::string session;
+  if (sessionPath) {
+    std::ifstream in(sessionPath, std::ios::binary);
+    if (!in) {
+      std::cerr << "cannot open " << sessionPath << "\n";
+      return 1;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    session = buffer.str();
+  } else {
+    session = syntheticSession();
+  }
+
+  // The session is served from a file so reads behave like a pipe that
+  // always has data ready
+  char path[] = "/tmp/jsonrpc_benchXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0 || write(fd, session.data(), session.size()) !=
+                    static_cast<ssize_t>(session.size())) {
+    std::cerr << "cannot write temporary session file\n";
+    return 1;
+  }
+  int devnull = open("/dev/null", O_WRONLY);
+
+  size_t messages = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    lseek(fd, 0, SEEK_SET);
+    Transport transport(fd, devnull);
+    while (transport.receive())
+      messages++;
+  }
+  double receiveSecs =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  JsonValue response = completionResponse(2000);
+  size_t responseBytes = response.serialize().size();
+  int sends = iterations * 10;
+  start = Clock::now();
+  {
+    Transport transport(fd, devnull);
+    for (int i = 0; i < sends; i++)
+      transport.respond(i, response);
+  }
+  double sendSecs = std::chrono::duration<double>(Clock::now() - start).count();
+
+  close(fd);
+  close(devnull);
+  unlink(path);
+
+  double mb = session.size() * double(iterations) / (1024 * 1024);
+  std::cout << "receive: " << messages << " messages, " << mb << " MB in "
+            << receiveSecs * 1000 << " ms (" << mb / receiveSecs << " MB/s, "
+            << receiveSecs * 1e6 / messages << " us/message)\n";
+  std::cout << "send:    " << sends << " completion responses of "
+            << responseBytes << " bytes in " << sendSecs * 1000 << " ms ("
+            << sendSecs * 1e6 / sends << " us/response)\n";
+  return 0;
+}
@@ -35,20 +35,40 @@ struct Param {
     SourceLoc loc;
 };
 
+// A type parameter of a generic function or class, as in
+// `fn max<T: Comparable>(...)` or `class Stack<T>`. Inside the declaration
+// its name parses as a GENERIC type with no arguments.
+struct TypeParam {
+    std::string name;
+    std::vector<std::string> constraints;  // Numeric, Comparable, Equatable
+    SourceLoc loc;
+};
+
 // Expression nodes
 struct IntLitExpr { int value; };
 struct FloatLitExpr { double value; };
 struct StringLitExpr { std::string value; bool interpolated; };
 struct BoolLitExpr { bool value; };
-struct IdentExpr { std::string name; };
+struct IdentExpr {
+    std::string name;
+    int slot = -1;  // local variable slot in its function, set by the TypeChecker
+};
 struct BinaryExpr { std::string op; ExprPtr left, right; };
 struct UnaryExpr { std::string op; ExprPtr operand; };
-struct CallExpr { ExprPtr callee; std::vector<ExprPtr> args; };
-struct MemberExpr { ExprPtr object; std::string member; };
+struct CallExpr {
+    ExprPtr callee;
+    std::vector<ExprPtr> args;
+    std::vector<TypePtr> typeArgs;  // explicit, as in create<int>()
+};
+struct MemberExpr { ExprPtr object; std::string member; SourceLoc memberLoc; };
 struct IndexExpr { ExprPtr object; ExprPtr index; };
 struct AssignExpr { ExprPtr target; ExprPtr value; };
-struct LambdaExpr { std::vector<Param> params; TypePtr returnType; std::vector<StmtPtr> body; };
-struct NewExpr { std::string className; std::vector<ExprPtr> args; };
+struct LambdaExpr { std::vector<Param> params; TypePtr returnType; std::vector<StmtPtr> body; SourceLoc bodyEnd; };
+struct NewExpr {
+    std::string className;
+    std::vector<ExprPtr> args;
+    std::vector<TypePtr> typeArgs;  // new Stack<int>()
+};
 struct SomeExpr { ExprPtr value; };
 struct NoneExpr {};
 struct ThisExpr {};
@@ -67,13 +87,15 @@ struct Expr {
 };
 
 // Statement nodes
-struct LetStmt { std::string name; TypePtr type; ExprPtr init; bool isMut; };
+// *End locations are the closing '}' of a body; names declared inside are
+// visible up to there.
+struct LetStmt { std::string name; TypePtr type; ExprPtr init; bool isMut; SourceLoc nameLoc; };
 struct ReturnStmt { ExprPtr value; };
 struct ExprStmt { ExprPtr expr; };
-struct IfStmt { ExprPtr cond; std::vector<StmtPtr> thenBody; std::vector<StmtPtr> elseBody; };
-struct WhileStmt { ExprPtr cond; std::vector<StmtPtr> body; };
-struct ForStmt { std::string var; ExprPtr iterable; std::vector<StmtPtr> body; };
-struct MatchArm { std::string pattern; std::string bindVar; std::vector<StmtPtr> body; };
+struct IfStmt { ExprPtr cond; std::vector<StmtPtr> thenBody; std::vector<StmtPtr> elseBody; SourceLoc thenEnd, elseEnd; };
+struct WhileStmt { ExprPtr cond; std::vector<StmtPtr> body; SourceLoc bodyEnd; };
+struct ForStmt { std::string var; ExprPtr iterable; std::vector<StmtPtr> body; SourceLoc varLoc, bodyEnd; };
+struct MatchArm { std::string pattern; std::string bindVar; std::vector<StmtPtr> body; SourceLoc bindLoc, bodyEnd; };
 struct MatchStmt { ExprPtr expr; std::vector<MatchArm> arms; };
 struct BlockStmt { std::vector<StmtPtr> stmts; };
 struct CppStmt { std::string code; };  // Inline C++ code block
@@ -90,12 +112,17 @@ struct Stmt {
 // Top-level declarations
 struct FnDecl {
     std::string name;
+    std::vector<TypeParam> typeParams;
     std::vector<Param> params;
     TypePtr returnType;
     std::vector<StmtPtr> body;
     bool isPublic;  // true if marked with 'pub'
     bool isStatic;  // true if marked with 'static'
-    SourceLoc loc;
+    bool isTest = false;   // declared with 'test fn'
+    bool isBench = false;  // declared with 'bench fn'
+    bool isMut = false;    // struct method declared 'mut fn', may modify the struct
+    SourceLoc loc;     // the name token
+    SourceLoc endLoc;  // closing '}' of the body
 };
 
 struct Field {
@@ -109,11 +136,19 @@ struct Field {
 
 struct ClassDecl {
     std::string name;
+    std::vector<TypeParam> typeParams;
     std::vector<Field> fields;
     std::vector<FnDecl> methods;
     std::string parent;
     bool isPublic;  // classes can be pub (for exporting from modules)
-    SourceLoc loc;
+    // Declared with `struct`: a plain value type whose fields are all
+    // public and laid out in declaration order. `@packed` drops padding and
+    // `@align(N)` raises the alignment (0 keeps the natural one).
+    bool isStruct = false;
+    bool packed = false;
+    int align = 0;
+    SourceLoc loc;     // the name token
+    SourceLoc endLoc;  // closing '}'
 };
 
 struct UsingDecl {
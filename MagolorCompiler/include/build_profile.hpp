@@ -0,0 +1,151 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <filesystem>
+#include "toolchain.hpp"
+
+// How the generated C++ is compiled, chosen per build from the
+// [profile.<name>] sections of project.toml.
+//
+// `dev` is the default and matches what builds always did (-O2). `release`
+// (--release) adds -O3, link-time optimization and, once trained, the
+// recorded execution profile. Every setting can be overridden:
+//
+//     [profile.release]
+//     opt-level = 3          # 0-3, "s", "z" or "fast"
+//     native = true          # -march=native; the binary may not run elsewhere
+//     lto = true             # -flto
+//     debug = false          # -g
+//     strip = true           # -s
+//     pgo = true             # use target/pgo from `gear build --pgo-train`
+//     flags = ["-fno-plt"]   # passed to the compiler as is
+//
+// Any other [profile.<name>] starts from the dev settings and is selected
+// with --profile <name>.
+struct BuildProfile {
+    enum class Pgo { Off, Generate, Use };
+
+    static constexpr const char* PGO_DIR = "target/pgo";
+
+    std::string name = "dev";
+    std::string optLevel = "2";
+    bool native = false;
+    bool lto = false;
+    bool debug = false;
+    bool strip = false;
+    bool pgo = false;
+    std::vector<std::string> flags;
+
+    static BuildProfile defaults(const std::string& name) {
+        BuildProfile profile;
+        profile.name = name;
+        if (name == "release") {
+            profile.optLevel = "3";
+            profile.lto = true;
+            profile.pgo = true;
+        }
+        return profile;
+    }
+
+    // Applies `settings` (a [profile.<name>] section, values unquoted) on
+    // top of the defaults for `name`
+    static bool resolve(const std::string& name, const std::map<std::string, std::string>& settings,
+                        BuildProfile& out, std::string& error) {
+        out = defaults(name);
+        for (const auto& [key, value] : settings) {
+            bool ok = true;
+            if (key == "opt-level") {
+                ok = value == "0" || value == "1" || value == "2" || value == "3" ||
+                     value == "s" || value == "z" || value == "fast";
+                out.optLevel = value;
+            } else if (key == "native") {
+                ok = parseBool(value, out.native);
+            } else if (key == "lto") {
+                ok = parseBool(value, out.lto);
+            } else if (key == "debug") {
+                ok = parseBool(value, out.debug);
+            } else if (key == "strip") {
+                ok = parseBool(value, out.strip);
+            } else if (key == "pgo") {
+                ok = parseBool(value, out.pgo);
+            } else if (key == "flags") {
+                ok = parseList(value, out.flags);
+            } else {
+                error = "unknown setting '" + key + "' in [profile." + name + "]";
+                return false;
+            }
+            if (!ok) {
+                error = "invalid value '" + value + "' for " + key + " in [profile." + name + "]";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Profile data from a finished training run, if this profile uses it
+    Pgo pgoMode(const Toolchain& toolchain) const {
+        if (!pgo) return Pgo::Off;
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(PGO_DIR, ec);
+             !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            if (it->path().extension() == toolchain.profileExtension()) return Pgo::Use;
+        }
+        return Pgo::Off;
+    }
+
+    // The compiler command, without inputs and outputs
+    std::vector<std::string> compilerArgs(const Toolchain& toolchain, Pgo mode = Pgo::Off) const {
+        bool clang = toolchain.family == Toolchain::Family::Clang;
+        std::vector<std::string> args = toolchain.baseArgs();
+        args.push_back("-O" + optLevel);
+        if (native) args.push_back("-march=native");
+        if (lto) args.push_back(clang ? "-flto=thin" : "-flto=auto");
+        if (debug) args.push_back("-g");
+        if (strip) args.push_back("-s");
+
+        // GCC stores counts under the output's path, so training and the
+        // rebuild must compile the same file to the same binary
+        std::string dir = std::filesystem::absolute(PGO_DIR).string();
+        if (mode == Pgo::Generate) {
+            args.push_back("-fprofile-generate=" + dir);
+        } else if (mode == Pgo::Use && clang) {
+            args.insert(args.end(), {"-fprofile-use=" + dir + "/default.profdata",
+                                     "-Wno-profile-instr-out-of-date",
+                                     "-Wno-profile-instr-unprofiled"});
+        } else if (mode == Pgo::Use) {
+            // Functions the workload never reached keep their normal
+            // optimization, and edits since training only cost precision
+            args.insert(args.end(), {"-fprofile-use=" + dir, "-fprofile-partial-training",
+                                     "-Wno-missing-profile", "-Wno-coverage-mismatch"});
+        }
+
+        args.insert(args.end(), flags.begin(), flags.end());
+        return args;
+    }
+
+private:
+    static bool parseBool(const std::string& value, bool& out) {
+        if (value != "true" && value != "false") return false;
+        out = value == "true";
+        return true;
+    }
+
+    // ["a", "b"]
+    static bool parseList(const std::string& value, std::vector<std::string>& out) {
+        if (value.size() < 2 || value.front() != '[' || value.back() != ']') return false;
+        out.clear();
+        std::stringstream items(value.substr(1, value.size() - 2));
+        std::string item;
+        while (std::getline(items, item, ',')) {
+            size_t a = item.find_first_not_of(" \t");
+            if (a == std::string::npos) continue;
+            size_t b = item.find_last_not_of(" \t");
+            item = item.substr(a, b - a + 1);
+            if (item.size() < 2 || item.front() != '"' || item.back() != '"') return false;
+            out.push_back(item.substr(1, item.size() - 2));
+        }
+        return true;
+    }
+};
@@ -5,10 +5,24 @@
 #include <sstream>
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
 
 class CodeGen {
 public:
-    std::string generate(const Program& prog);
+    // What a build produces. A harness keeps the `test fn`s or `bench fn`s
+    // and its main runs them instead of the program's own main; the normal
+    // program leaves both out.
+    //   Tests:   runs the test named by argv[1], or lists them with --list
+    //   Benches: runs every benchmark matching argv (Std::BenchRunner::main)
+    enum class Harness { None, Tests, Benches };
+
+    // With `runtimeHeader`, the program #includes it first (so a precompiled
+    // copy can be used) instead of carrying the runtime prelude inline.
+    std::string generate(const Program& prog, const std::string& runtimeHeader = "",
+                         Harness harness = Harness::None);
+
+    // Standard library and helper wrappers every generated program starts with
+    static std::string runtimePrelude();
     
 private:
     std::stringstream out;
@@ -17,6 +31,9 @@ private:
     std::unordered_set<std::string> capturedVars;
     std::unordered_set<std::string> importedNamespaces;
     std::unordered_set<std::string> knownClassNames; // NEW: Track known class names
+    std::unordered_set<std::string> knownStructNames;
+    // Structs the program uses as SoA<T>; each gets a column layout
+    std::unordered_set<std::string> soaStructs;
       std::string paramTypeToString(const TypePtr &type);
     // Track variables for @cpp block sharing
     struct VarInfo {
@@ -24,6 +41,19 @@ private:
         bool isMutable;
     };
     std::unordered_map<std::string, VarInfo> scopeVars;
+
+    // Std modules the program imports with `using`, and the names a bare
+    // call could mean instead of one of their functions: the program's own
+    // functions, classes and C imports, and the current function's locals.
+    // Locals the TypeChecker resolved carry a slot; localNames covers code
+    // it does not see, such as lambda bodies and unchecked single-file builds.
+    std::vector<std::string> stdImports;
+    std::unordered_set<std::string> programNames;
+    std::unordered_set<std::string> localNames;
+    // The program's global functions, and the fields and methods of the
+    // class being generated, which a bare name inside it means instead
+    std::unordered_set<std::string> programFunctions;
+    std::unordered_set<std::string> memberNames;
     
     void emit(const std::string& s);
     void emitLine(const std::string& s);
@@ -32,15 +62,33 @@ private:
     void genUsing(const UsingDecl& u);
     void genCImports(const std::vector<CImportDecl>& cimports);
     void genClass(const ClassDecl& cls);
+    void genStructBody(const ClassDecl& cls);
+    void genPrintOperator(const ClassDecl& cls, const std::string& selfType);
+    void genSoA(const ClassDecl& cls, const std::string& selfType);
+    void noteSoAUses(const TypePtr& type);
+    void noteSoAUses(const ExprPtr& expr);
+    void noteSoAUses(const std::vector<StmtPtr>& stmts);
+    TypePtr soaElementType(const ExprPtr& expr) const;
     void genFunction(const FnDecl& fn, const std::string& className = "");
     void genStmt(const StmtPtr& stmt);
     void genExpr(const ExprPtr& expr);
     std::string typeToString(const TypePtr& type);
-    void genStdLib();
+    // Generic declarations become C++ templates that the C++ compiler
+    // instantiates per use, with constraints checked by static_assert
+    std::string templateHeader(const std::vector<TypeParam>& params) const;
+    void genConstraintChecks(const std::vector<TypeParam>& params);
+    void genRuntime();
+    std::string stdlibCallee(const IdentExpr& callee) const;
+    bool isProgramFunction(const IdentExpr& callee) const;
+    void genTestMain(const std::vector<FnDecl>& functions);
+    void genBenchMain(const std::vector<FnDecl>& functions);
     void collectCaptures(const std::vector<StmtPtr>& body, const std::vector<Param>& params);
     
     // NEW: Helper to check if a name is a class
     bool isClassName(const std::string& name) const;
+    // Structs are passed to functions by const reference
+    bool isStructType(const TypePtr& type) const;
+    std::string paramDecl(const Param& param);
     
     void enterScope();
     void exitScope();
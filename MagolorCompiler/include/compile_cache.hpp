@@ -0,0 +1,31 @@
+#pragma once
+#include "toolchain.hpp"
+#include <string>
+#include <vector>
+
+// Binaries built from generated C++, reused when the same code is compiled
+// the same way again.
+//
+// The key covers the C++ text, the full compiler command, the compiler
+// binary and the local headers the code includes (listed with -MM), so
+// regenerating identical code (a touched but unchanged source, a fresh CI
+// checkout, switching back to a branch) copies the binary instead of
+// running the compiler. Entries live in $MAGOLOR_HOME/cache/<key> and keep
+// their inputs; a hit compares them in full, so a hash collision can only
+// cost a compile. The least recently used entries go once the cache is
+// larger than MAGOLOR_CACHE_SIZE megabytes (default 1024).
+class CompileCache {
+public:
+    // Compiles `sourcePath` to `output` with `command` (compiler and flags,
+    // no inputs or outputs), through the cache when `useCache` is set.
+    // Compiler output is returned in `diagnostics`.
+    static bool compile(const Toolchain& toolchain, const std::vector<std::string>& command,
+                        const std::string& sourcePath, const std::string& output, bool useCache,
+                        bool verbose, std::string& diagnostics);
+
+    // 64-bit FNV-1a of `text` in hex
+    static std::string hash(const std::string& text);
+
+private:
+    static void trim(const std::string& root);
+};
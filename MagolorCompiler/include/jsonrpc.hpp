@@ -1,164 +1,246 @@
 #pragma once
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
-#include <iostream>
+#include <mutex>
 #include <optional>
-#include <sstream>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+#include <variant>
+#include <vector>
 
 class JsonValue {
 public:
   enum Type { Null, Bool, Int, Float, String, Array, Object };
 
-  JsonValue() : type_(Null) {}
-  JsonValue(bool v) : type_(Bool), boolVal_(v) {}
-  JsonValue(int v) : type_(Int), intVal_(v) {}
-  JsonValue(double v) : type_(Float), floatVal_(v) {}
-  JsonValue(const std::string &v) : type_(String), strVal_(v) {}
-  JsonValue(const char *v) : type_(String), strVal_(v) {}
-
-  Type type() const { return type_; }
-  bool isNull() const { return type_ == Null; }
-
-  bool asBool() const { return boolVal_; }
-  int asInt() const { return intVal_; }
-  double asFloat() const { return floatVal_; }
-  const std::string &asString() const { return strVal_; }
-
-  std::vector<JsonValue> &asArray() { return arrVal_; }
-  const std::vector<JsonValue> &asArray() const { return arrVal_; }
+  using Elements = std::vector<JsonValue>;
+  using Member = std::pair<std::string, JsonValue>;
+  // Objects keep insertion order; LSP objects are small enough that a
+  // linear search beats hashing every key
+  using Members = std::vector<Member>;
+
+  JsonValue() = default;
+  JsonValue(bool v) : value_(v) {}
+  JsonValue(int v) : value_(v) {}
+  JsonValue(double v) : value_(v) {}
+  JsonValue(std::string v) : value_(std::move(v)) {}
+  JsonValue(const char *v) : value_(std::string(v)) {}
+
+  Type type() const { return static_cast<Type>(value_.index()); }
+  bool isNull() const { return type() == Null; }
+
+  bool asBool() const {
+    auto *v = std::get_if<bool>(&value_);
+    return v && *v;
+  }
+  int asInt() const {
+    if (auto *v = std::get_if<int>(&value_))
+      return *v;
+    if (auto *v = std::get_if<double>(&value_))
+      return static_cast<int>(*v);
+    return 0;
+  }
+  double asFloat() const {
+    if (auto *v = std::get_if<double>(&value_))
+      return *v;
+    if (auto *v = std::get_if<int>(&value_))
+      return *v;
+    return 0;
+  }
+  const std::string &asString() const {
+    static const std::string empty;
+    auto *v = std::get_if<std::string>(&value_);
+    return v ? *v : empty;
+  }
 
-  std::unordered_map<std::string, JsonValue> &asObject() { return objVal_; }
-  const std::unordered_map<std::string, JsonValue> &asObject() const {
-    return objVal_;
+  Elements &asArray() {
+    if (type() != Array)
+      value_ = Elements();
+    return std::get<Elements>(value_);
+  }
+  const Elements &asArray() const {
+    static const Elements empty;
+    auto *v = std::get_if<Elements>(&value_);
+    return v ? *v : empty;
   }
 
-  JsonValue &operator[](const std::string &key) {
-    if (type_ != Object) {
-      type_ = Object;
-      objVal_.clear();
-    }
-    return objVal_[key];
+  Members &asObject() {
+    if (type() != Object)
+      value_ = Members();
+    return std::get<Members>(value_);
+  }
+  const Members &asObject() const {
+    static const Members empty;
+    auto *v = std::get_if<Members>(&value_);
+    return v ? *v : empty;
   }
 
-  const JsonValue &operator[](const std::string &key) const {
-    static JsonValue null;
-    if (type_ != Object)
-      return null;
-    auto it = objVal_.find(key);
-    return it != objVal_.end() ? it->second : null;
+  JsonValue &operator[](std::string_view key) {
+    if (JsonValue *v = find(key))
+      return *v;
+    Members &members = asObject();
+    members.emplace_back(std::string(key), JsonValue());
+    return members.back().second;
   }
 
-  bool has(const std::string &key) const {
-    return type_ == Object && objVal_.find(key) != objVal_.end();
+  const JsonValue &operator[](std::string_view key) const {
+    static const JsonValue null;
+    const JsonValue *v = find(key);
+    return v ? *v : null;
   }
 
-  void push(const JsonValue &v) {
-    if (type_ != Array) {
-      type_ = Array;
-      arrVal_.clear();
+  JsonValue *find(std::string_view key) {
+    auto *members = std::get_if<Members>(&value_);
+    if (!members)
+      return nullptr;
+    for (auto &[k, v] : *members) {
+      if (k == key)
+        return &v;
     }
-    arrVal_.push_back(v);
+    return nullptr;
+  }
+  const JsonValue *find(std::string_view key) const {
+    return const_cast<JsonValue *>(this)->find(key);
   }
 
+  bool has(std::string_view key) const { return find(key) != nullptr; }
+
+  void push(JsonValue v) { asArray().push_back(std::move(v)); }
+
   static JsonValue object() {
     JsonValue v;
-    v.type_ = Object;
+    v.value_ = Members();
     return v;
   }
   static JsonValue array() {
     JsonValue v;
-    v.type_ = Array;
+    v.value_ = Elements();
     return v;
   }
 
   std::string serialize() const {
-    std::ostringstream ss;
-    serializeTo(ss);
-    return ss.str();
+    std::string out;
+    serializeTo(out);
+    return out;
   }
 
-private:
-  Type type_;
-  bool boolVal_ = false;
-  int intVal_ = 0;
-  double floatVal_ = 0;
-  std::string strVal_;
-  std::vector<JsonValue> arrVal_;
-  std::unordered_map<std::string, JsonValue> objVal_;
-
-  void serializeTo(std::ostream &os) const {
-    switch (type_) {
+  void serializeTo(std::string &out) const {
+    switch (type()) {
     case Null:
-      os << "null";
+      out += "null";
       break;
     case Bool:
-      os << (boolVal_ ? "true" : "false");
+      out += std::get<bool>(value_) ? "true" : "false";
       break;
     case Int:
-      os << intVal_;
-      break;
-    case Float:
-      os << floatVal_;
+    case Float: {
+      char buf[32];
+      auto res = type() == Int
+                     ? std::to_chars(buf, buf + sizeof buf, std::get<int>(value_))
+                     : std::to_chars(buf, buf + sizeof buf,
+                                     std::get<double>(value_));
+      out.append(buf, res.ptr);
       break;
+    }
     case String:
-      os << '"';
-      for (char c : strVal_) {
-        if (c == '"')
-          os << "\\\"";
-        else if (c == '\\')
-          os << "\\\\";
-        else if (c == '\n')
-          os << "\\n";
-        else if (c == '\r')
-          os << "\\r";
-        else if (c == '\t')
-          os << "\\t";
-        else
-          os << c;
-      }
-      os << '"';
+      appendQuoted(out, std::get<std::string>(value_));
       break;
-    case Array:
-      os << '[';
-      for (size_t i = 0; i < arrVal_.size(); i++) {
-        if (i > 0)
-          os << ',';
-        arrVal_[i].serializeTo(os);
+    case Array: {
+      out += '[';
+      bool first = true;
+      for (const auto &v : std::get<Elements>(value_)) {
+        if (!first)
+          out += ',';
+        first = false;
+        v.serializeTo(out);
       }
-      os << ']';
+      out += ']';
       break;
-    case Object:
-      os << '{';
+    }
+    case Object: {
+      out += '{';
       bool first = true;
-      for (auto &[k, v] : objVal_) {
+      for (const auto &[k, v] : std::get<Members>(value_)) {
         if (!first)
-          os << ',';
+          out += ',';
         first = false;
-        os << '"' << k << "\":";
-        v.serializeTo(os);
+        appendQuoted(out, k);
+        out += ':';
+        v.serializeTo(out);
       }
-      os << '}';
+      out += '}';
       break;
     }
+    }
+  }
+
+private:
+  std::variant<std::monostate, bool, int, double, std::string, Elements,
+               Members>
+      value_;
+
+  static void appendQuoted(std::string &out, std::string_view s) {
+    out += '"';
+    size_t run = 0; // start of the pending run of plain characters
+    for (size_t i = 0; i < s.size(); i++) {
+      unsigned char c = s[i];
+      if (c >= 0x20 && c != '"' && c != '\\')
+        continue;
+      out.append(s.data() + run, i - run);
+      run = i + 1;
+      switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default: {
+        char esc[8];
+        std::snprintf(esc, sizeof esc, "\\u%04x", c);
+        out += esc;
+      }
+      }
+    }
+    out.append(s.data() + run, s.size() - run);
+    out += '"';
   }
 };
 
+// Parses straight out of the caller's buffer; strings without escapes are
+// copied once, in bulk. Malformed input yields a best-effort value rather
+// than an exception.
 class JsonParser {
 public:
-  static JsonValue parse(const std::string &s) {
+  static JsonValue parse(std::string_view s) {
     size_t pos = 0;
     return parseValue(s, pos);
   }
 
 private:
-  static void skipWhitespace(const std::string &s, size_t &pos) {
+  static void skipWhitespace(std::string_view s, size_t &pos) {
     while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' ||
                               s[pos] == '\n' || s[pos] == '\r'))
       pos++;
   }
 
-  static JsonValue parseValue(const std::string &s, size_t &pos) {
+  static JsonValue parseValue(std::string_view s, size_t &pos) {
     skipWhitespace(s, pos);
     if (pos >= s.size())
       return JsonValue();
@@ -169,65 +251,137 @@ private:
     if (c == 't' || c == 'f')
       return parseBool(s, pos);
     if (c == '"')
-      return parseString(s, pos);
+      return JsonValue(parseString(s, pos));
     if (c == '[')
       return parseArray(s, pos);
     if (c == '{')
       return parseObject(s, pos);
     if (c == '-' || (c >= '0' && c <= '9'))
       return parseNumber(s, pos);
+    pos = s.size();
     return JsonValue();
   }
 
-  static JsonValue parseNull(const std::string &s, size_t &pos) {
-    pos += 4;
+  static JsonValue parseNull(std::string_view s, size_t &pos) {
+    pos = std::min(pos + 4, s.size());
     return JsonValue();
   }
 
-  static JsonValue parseBool(const std::string &s, size_t &pos) {
-    if (s[pos] == 't') {
-      pos += 4;
-      return JsonValue(true);
+  static JsonValue parseBool(std::string_view s, size_t &pos) {
+    bool value = s[pos] == 't';
+    pos = std::min(pos + (value ? 4 : 5), s.size());
+    return JsonValue(value);
+  }
+
+  static int hexDigit(char c) {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  static bool parseHex4(std::string_view s, size_t at, unsigned &out) {
+    if (at + 4 > s.size())
+      return false;
+    out = 0;
+    for (size_t i = at; i < at + 4; i++) {
+      int d = hexDigit(s[i]);
+      if (d < 0)
+        return false;
+      out = out << 4 | d;
     }
-    pos += 5;
-    return JsonValue(false);
+    return true;
   }
 
-  static JsonValue parseString(const std::string &s, size_t &pos) {
+  static void appendUtf8(std::string &out, unsigned cp) {
+    if (cp < 0x80) {
+      out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      out += static_cast<char>(0xC0 | cp >> 6);
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      out += static_cast<char>(0xE0 | cp >> 12);
+      out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | cp >> 18);
+      out += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+      out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  static std::string parseString(std::string_view s, size_t &pos) {
     pos++; // skip "
+    const char *data = s.data();
+    auto find = [&](char c, size_t from, size_t to) {
+      const void *hit = std::memchr(data + from, c, to - from);
+      return hit ? static_cast<const char *>(hit) - data : to;
+    };
+
     std::string result;
-    while (pos < s.size() && s[pos] != '"') {
-      if (s[pos] == '\\' && pos + 1 < s.size()) {
-        pos++;
-        switch (s[pos]) {
-        case 'n':
-          result += '\n';
-          break;
-        case 'r':
-          result += '\r';
-          break;
-        case 't':
-          result += '\t';
-          break;
-        case '"':
-          result += '"';
-          break;
-        case '\\':
-          result += '\\';
+    // The first unescaped-looking quote; recomputed whenever an escape
+    // turns out to have consumed it
+    size_t quote = find('"', pos, s.size());
+    while (pos < s.size()) {
+      if (pos > quote)
+        quote = find('"', pos, s.size());
+      // Copy the run up to the next quote or escape in one go
+      size_t stop = find('\\', pos, quote);
+      result.append(data + pos, stop - pos);
+      pos = stop;
+      if (pos >= s.size() || s[pos] == '"')
+        break;
+
+      pos++; // skip backslash
+      if (pos >= s.size())
+        break;
+      char c = s[pos++];
+      switch (c) {
+      case 'n':
+        result += '\n';
+        break;
+      case 'r':
+        result += '\r';
+        break;
+      case 't':
+        result += '\t';
+        break;
+      case 'b':
+        result += '\b';
+        break;
+      case 'f':
+        result += '\f';
+        break;
+      case 'u': {
+        unsigned cp;
+        if (!parseHex4(s, pos, cp)) {
+          result += 'u';
           break;
-        default:
-          result += s[pos];
         }
-      } else {
-        result += s[pos];
+        pos += 4;
+        unsigned low;
+        if (cp >= 0xD800 && cp < 0xDC00 && pos + 1 < s.size() &&
+            s[pos] == '\\' && s[pos + 1] == 'u' &&
+            parseHex4(s, pos + 2, low) && low >= 0xDC00 && low < 0xE000) {
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+          pos += 6;
+        }
+        appendUtf8(result, cp);
+        break;
+      }
+      default:
+        result += c; // \" \\ \/
       }
-      pos++;
     }
     pos++; // skip closing "
-    return JsonValue(result);
+    return result;
   }
 
-  static JsonValue parseNumber(const std::string &s, size_t &pos) {
+  static JsonValue parseNumber(std::string_view s, size_t &pos) {
     size_t start = pos;
     bool isFloat = false;
     if (s[pos] == '-')
@@ -237,57 +391,81 @@ private:
     if (pos < s.size() && s[pos] == '.') {
       isFloat = true;
       pos++;
+      while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9')
+        pos++;
     }
-    while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9')
+    if (pos < s.size() && (s[pos] == 'e' || s[pos] == 'E')) {
+      isFloat = true;
       pos++;
-    std::string num = s.substr(start, pos - start);
-    if (isFloat)
-      return JsonValue(std::stod(num));
-    return JsonValue(std::stoi(num));
+      if (pos < s.size() && (s[pos] == '+' || s[pos] == '-'))
+        pos++;
+      while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9')
+        pos++;
+    }
+
+    const char *first = s.data() + start;
+    const char *last = s.data() + pos;
+    if (!isFloat) {
+      long long v = 0;
+      auto res = std::from_chars(first, last, v);
+      if (res.ec == std::errc() && v >= INT_MIN && v <= INT_MAX)
+        return JsonValue(static_cast<int>(v));
+    }
+    double d = 0;
+    std::from_chars(first, last, d);
+    return JsonValue(d);
   }
 
-  static JsonValue parseArray(const std::string &s, size_t &pos) {
+  static JsonValue parseArray(std::string_view s, size_t &pos) {
     pos++; // skip [
     JsonValue arr = JsonValue::array();
+    auto &elements = arr.asArray();
     skipWhitespace(s, pos);
-    if (s[pos] == ']') {
+    if (pos < s.size() && s[pos] == ']') {
       pos++;
       return arr;
     }
-    while (true) {
-      arr.push(parseValue(s, pos));
+    while (pos < s.size()) {
+      elements.push_back(parseValue(s, pos));
       skipWhitespace(s, pos);
-      if (s[pos] == ']') {
+      if (pos < s.size() && s[pos] == ']') {
         pos++;
-        return arr;
+        break;
       }
-      if (s[pos] == ',')
+      if (pos < s.size() && s[pos] == ',')
         pos++;
     }
+    return arr;
   }
 
-  static JsonValue parseObject(const std::string &s, size_t &pos) {
+  static JsonValue parseObject(std::string_view s, size_t &pos) {
     pos++; // skip {
     JsonValue obj = JsonValue::object();
+    auto &members = obj.asObject();
     skipWhitespace(s, pos);
-    if (s[pos] == '}') {
+    if (pos < s.size() && s[pos] == '}') {
       pos++;
       return obj;
     }
-    while (true) {
+    while (pos < s.size()) {
       skipWhitespace(s, pos);
-      std::string key = parseString(s, pos).asString();
+      if (pos >= s.size() || s[pos] != '"') {
+        pos = s.size();
+        break;
+      }
+      std::string key = parseString(s, pos);
       skipWhitespace(s, pos);
       pos++; // skip :
-      obj[key] = parseValue(s, pos);
+      members.emplace_back(std::move(key), parseValue(s, pos));
       skipWhitespace(s, pos);
-      if (s[pos] == '}') {
+      if (pos < s.size() && s[pos] == '}') {
         pos++;
-        return obj;
+        break;
       }
-      if (s[pos] == ',')
+      if (pos < s.size() && s[pos] == ',')
         pos++;
     }
+    return obj;
   }
 };
 
@@ -304,36 +482,63 @@ struct Message {
   bool isNotification() const { return !id.has_value() && !method.empty(); }
 };
 
+// Content-Length framed JSON-RPC over raw file descriptors. Input is read in
+// large chunks into one buffer and bodies are parsed in place; each outgoing
+// message goes out as a single header+body write.
+//
+// Setting MAGOLOR_LSP_RECORD=<file> appends every received frame to <file>,
+// which bench/jsonrpc_bench.cpp can replay.
 class Transport {
 public:
+  explicit Transport(int inFd = STDIN_FILENO, int outFd = STDOUT_FILENO)
+      : inFd(inFd), outFd(outFd) {
+    if (const char *path = std::getenv("MAGOLOR_LSP_RECORD"))
+      record = std::fopen(path, "ab");
+  }
+
+  ~Transport() {
+    if (record)
+      std::fclose(record);
+  }
+
+  Transport(const Transport &) = delete;
+  Transport &operator=(const Transport &) = delete;
+
   std::optional<Message> receive() {
-    std::string header;
+    // Drop consumed bytes once they dominate the buffer
+    if (inPos > 0 && inPos >= inBuf.size() / 2) {
+      inBuf.erase(0, inPos);
+      inPos = 0;
+    }
+
+    size_t frameStart = inPos;
     int contentLength = -1;
 
-    // Read headers line by line
+    // Headers, one line at a time
     while (true) {
-      if (!std::getline(std::cin, header)) {
-        // EOF or error
-        return std::nullopt;
+      size_t eol;
+      while ((eol = inBuf.find('\n', inPos)) == std::string::npos) {
+        if (!fill())
+          return std::nullopt;
       }
 
-      // Remove trailing \r if present
-      if (!header.empty() && header.back() == '\r') {
-        header.pop_back();
-      }
+      std::string_view header(inBuf.data() + inPos, eol - inPos);
+      inPos = eol + 1;
+      if (!header.empty() && header.back() == '\r')
+        header.remove_suffix(1);
 
       // Empty line means end of headers
-      if (header.empty()) {
+      if (header.empty())
         break;
-      }
 
-      // Parse Content-Length header
-      if (header.find("Content-Length:") == 0) {
-        try {
-          contentLength = std::stoi(header.substr(15));
-        } catch (...) {
+      if (header.substr(0, 15) == "Content-Length:") {
+        std::string_view num = header.substr(15);
+        while (!num.empty() && num.front() == ' ')
+          num.remove_prefix(1);
+        auto res =
+            std::from_chars(num.data(), num.data() + num.size(), contentLength);
+        if (res.ec != std::errc())
           return std::nullopt;
-        }
       }
     }
 
@@ -341,81 +546,153 @@ public:
       return std::nullopt;
     }
 
-    // Read the JSON body
-    std::string body(contentLength, '\0');
-    if (!std::cin.read(&body[0], contentLength)) {
-      return std::nullopt;
+    while (inBuf.size() - inPos < static_cast<size_t>(contentLength)) {
+      if (!fill())
+        return std::nullopt;
+    }
+
+    std::string_view body(inBuf.data() + inPos, contentLength);
+    inPos += contentLength;
+    if (record) {
+      std::fwrite(inBuf.data() + frameStart, 1, inPos - frameStart, record);
+      std::fflush(record);
     }
 
-    // Parse JSON
     JsonValue json = JsonParser::parse(body);
     Message msg;
 
-    if (json.has("id")) {
-      if (json["id"].type() == JsonValue::Int) {
-        msg.id = json["id"].asInt();
+    if (const JsonValue *id = json.find("id")) {
+      if (id->type() == JsonValue::Int) {
+        msg.id = id->asInt();
       }
     }
-    if (json.has("method")) {
-      msg.method = json["method"].asString();
+    if (const JsonValue *method = json.find("method")) {
+      msg.method = method->asString();
     }
-    if (json.has("params")) {
-      msg.params = json["params"];
+    if (JsonValue *params = json.find("params")) {
+      msg.params = std::move(*params);
     }
-    if (json.has("result")) {
-      msg.result = json["result"];
+    if (JsonValue *result = json.find("result")) {
+      msg.result = std::move(*result);
     }
-    if (json.has("error")) {
-      msg.error = json["error"];
+    if (JsonValue *error = json.find("error")) {
+      msg.error = std::move(*error);
     }
 
     return msg;
   }
 
   void send(const Message &msg) {
-    JsonValue json = JsonValue::object();
-    json["jsonrpc"] = "2.0";
+    std::string body = "{\"jsonrpc\":\"2.0\"";
     if (msg.id.has_value()) {
-      json["id"] = msg.id.value();
+      body += ",\"id\":";
+      body += std::to_string(msg.id.value());
     }
     if (!msg.method.empty()) {
-      json["method"] = msg.method;
-    }
-    if (!msg.params.isNull()) {
-      json["params"] = msg.params;
-    }
-    if (!msg.result.isNull()) {
-      json["result"] = msg.result;
-    }
-    if (!msg.error.isNull()) {
-      json["error"] = msg.error;
+      body += ",\"method\":";
+      JsonValue(msg.method).serializeTo(body);
     }
-
-    std::string body = json.serialize();
-    std::cout << "Content-Length: " << body.size() << "\r\n\r\n" << body;
-    std::cout.flush();
+    appendMember(body, "params", msg.params);
+    appendMember(body, "result", msg.result);
+    appendMember(body, "error", msg.error);
+    body += '}';
+    sendBody(body);
   }
 
+  // The helpers below serialize straight from the caller's value instead of
+  // copying it into a Message first
   void respond(int id, const JsonValue &result) {
-    Message msg;
-    msg.id = id;
-    msg.result = result;
-    send(msg);
+    std::string body = "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id);
+    body += ",\"result\":";
+    result.serializeTo(body);
+    body += '}';
+    sendBody(body);
   }
 
   void respondError(int id, int code, const std::string &message) {
-    Message msg;
-    msg.id = id;
-    msg.error = JsonValue::object();
-    msg.error["code"] = code;
-    msg.error["message"] = message;
-    send(msg);
+    JsonValue error = JsonValue::object();
+    error["code"] = code;
+    error["message"] = message;
+    std::string body = "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id);
+    appendMember(body, "error", error);
+    body += '}';
+    sendBody(body);
   }
 
   void notify(const std::string &method, const JsonValue &params) {
-    Message msg;
-    msg.method = method;
-    msg.params = params;
-    send(msg);
+    std::string body = "{\"jsonrpc\":\"2.0\",\"method\":";
+    JsonValue(method).serializeTo(body);
+    appendMember(body, "params", params);
+    body += '}';
+    sendBody(body);
+  }
+
+  // Server-to-client request; the client's response arrives through
+  // receive() like any other message
+  void request(int id, const std::string &method, const JsonValue &params) {
+    std::string body = "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id);
+    body += ",\"method\":";
+    JsonValue(method).serializeTo(body);
+    appendMember(body, "params", params);
+    body += '}';
+    sendBody(body);
+  }
+
+private:
+  int inFd;
+  int outFd;
+  std::string inBuf;
+  size_t inPos = 0;
+  FILE *record = nullptr;
+  // Diagnostics are published from the analysis thread
+  std::mutex writeMutex;
+
+  // Appends at least one byte to inBuf; false on EOF or error
+  bool fill() {
+    char chunk[64 * 1024];
+    while (true) {
+      ssize_t n = ::read(inFd, chunk, sizeof chunk);
+      if (n > 0) {
+        inBuf.append(chunk, n);
+        return true;
+      }
+      if (n < 0 && errno == EINTR)
+        continue;
+      return false;
+    }
+  }
+
+  static void appendMember(std::string &body, const char *key,
+                           const JsonValue &value) {
+    if (value.isNull())
+      return;
+    body += ",\"";
+    body += key;
+    body += "\":";
+    value.serializeTo(body);
+  }
+
+  // Header and body go out in a single write
+  void sendBody(const std::string &body) {
+    std::string frame = "Content-Length: " + std::to_string(body.size()) +
+                        "\r\n\r\n";
+    frame += body;
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    writeAll(frame.data(), frame.size());
+  }
+
+  bool writeAll(const char *data, size_t size) {
+    while (size > 0) {
+      ssize_t n = ::write(outFd, data, size);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      data += n;
+      size -= n;
+    }
+    return true;
   }
 };
@@ -0,0 +1,72 @@
+#pragma once
+#include "position.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TextEdit {
+    Range range;
+    std::string newText;
+};
+
+struct FormatOptions {
+    int tabSize = 4;
+    bool insertSpaces = true;
+};
+
+// Layout formatter for the language server.
+//
+// Indentation follows bracket nesting as seen by a scanner that applies the
+// lexer's rules for strings, `//` comments and @cpp blocks. Lines that begin
+// inside a multi-line string or an @cpp block are left exactly as written.
+// Only whitespace changes, and only where it differs from the expected
+// layout, so a formatted file produces no edits at all.
+//
+// The scanner state at every line start is kept per document. The next
+// request rescans from the first changed line and stops as soon as the state
+// agrees with the previous run again, so formatting after a small edit costs
+// little more than comparing the two buffers.
+class Formatter {
+public:
+    // Edits for lines [firstLine, lastLine] of `content`. lastLine < 0 means
+    // the whole document, which also gets a final newline if it lacks one.
+    std::vector<TextEdit> format(const std::string& uri, const std::string& content,
+                                 const std::vector<size_t>& lineOffsets,
+                                 int firstLine, int lastLine,
+                                 const FormatOptions& options);
+
+    void forget(const std::string& uri);
+
+private:
+    enum class Mode : uint8_t { Code, String, CppHeader, Cpp, CppString, CppComment };
+
+    struct LineState {
+        int32_t depth = 0;     // open brackets at the start of the line
+        int32_t cppDepth = 0;  // brace depth inside an @cpp block
+        Mode mode = Mode::Code;
+        uint16_t closers = 0;  // closing brackets the line starts with
+
+        bool sameEntry(const LineState& o) const {
+            return depth == o.depth && cppDepth == o.cppDepth && mode == o.mode;
+        }
+        // Inside a token whose text must not change
+        bool verbatim() const {
+            return mode != Mode::Code && mode != Mode::CppHeader;
+        }
+    };
+
+    struct Document {
+        std::string content;
+        std::vector<LineState> lines;  // one per line, plus the state at EOF
+    };
+
+    static uint16_t scanLine(const char* p, const char* end, LineState& state);
+    // Brings doc.lines up to date with `content`, then stores `content`
+    static void scan(const std::string& content, const std::vector<size_t>& lineOffsets,
+                     Document& doc);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Document> documents;
+};
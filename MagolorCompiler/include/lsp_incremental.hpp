@@ -0,0 +1,46 @@
+#pragma once
+#include "ast.hpp"
+#include "diagnostics.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Per-document parse and type-check cache for the language server.
+//
+// Each run lexes the whole buffer (cheap) and splits the tokens into
+// top-level declarations. A declaration whose source text is unchanged since
+// the previous run is reused together with its diagnostics, shifted if it
+// moved; only new or edited declarations go through the parser. Type checking
+// is limited to edited declarations and to those that mention a name whose
+// signature changed.
+class IncrementalParser {
+public:
+    struct Result {
+        bool lexed = false;    // false: the lexer failed and program is empty
+        bool checked = false;  // type checking ran (there were no syntax errors)
+        Program program;
+        std::vector<LspDiagnostic> syntaxDiagnostics;
+        std::vector<LspDiagnostic> typeDiagnostics;
+        size_t declarations = 0;
+        size_t reparsed = 0;
+        size_t rechecked = 0;
+    };
+
+    explicit IncrementalParser(std::string uri);
+    ~IncrementalParser();
+
+    // Returns false if `cancelled` fired part-way; the cache is left
+    // consistent either way.
+    bool update(const std::string& content,
+                const std::function<bool()>& cancelled, Result& out);
+
+private:
+    struct Decl;
+    using DeclPtr = std::shared_ptr<Decl>;
+
+    static void describe(Decl& d);
+
+    std::string uri;
+    std::vector<DeclPtr> decls;  // as of the previous run, in source order
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include "symbol_table.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk copy of the language server's workspace index, kept in
+// <project>/.magolor/index so an editor can start without re-parsing the
+// whole project.
+//
+// Each entry describes one source file as it was on disk when indexed. The
+// size and mtime let startup trust unchanged files without reading them; the
+// content hash catches files that were touched but not modified.
+class IndexCache {
+public:
+    struct Entry {
+        std::string uri;
+        uint64_t hash = 0;
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+        std::string module;                // e.g. "MyApp.models.User"
+        std::vector<std::string> imports;  // dotted `using` paths
+        std::vector<SymbolPtr> symbols;
+    };
+
+    static uint64_t hashContent(const std::string& content);
+
+    // Returns false if the file is missing, unreadable or from another version;
+    // `entries` is left untouched then.
+    static bool load(const std::string& path, std::vector<Entry>& entries);
+
+    // Writes to a temporary file and renames it into place
+    static bool save(const std::string& path, const std::vector<Entry>& entries);
+};
@@ -1,11 +1,13 @@
 // lsp_logger.hpp
 #pragma once
 #include <fstream>
+#include <mutex>
 #include <string>
 
 class LSPLogger {
 private:
     std::ofstream logFile;
+    std::mutex mutex;  // analysis runs on a worker thread
 public:
     LSPLogger() {
         logFile.open("/tmp/magolor-lsp.log", std::ios::app);
@@ -16,6 +18,7 @@ public:
         logFile.close();
     }
     void log(const std::string& msg) {
+        std::lock_guard<std::mutex> lock(mutex);
         logFile << msg << std::endl;
         logFile.flush();
     }
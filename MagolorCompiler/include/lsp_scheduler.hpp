@@ -0,0 +1,69 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Runs document analysis on a background thread.
+//
+// Each schedule() call (re)arms a per-document debounce timer; only the most
+// recent version of a document is ever analyzed. A job that is already
+// running can poll its cancellation check between phases and bail out as
+// soon as a newer version has been scheduled or the document was closed.
+class AnalysisScheduler {
+public:
+    using CancelCheck = std::function<bool()>;
+    using Job = std::function<void(const std::string& uri, int version,
+                                   const std::string& content,
+                                   const CancelCheck& cancelled)>;
+
+    explicit AnalysisScheduler(Job job,
+                               std::chrono::milliseconds debounce =
+                                   std::chrono::milliseconds(200));
+    ~AnalysisScheduler();
+
+    AnalysisScheduler(const AnalysisScheduler&) = delete;
+    AnalysisScheduler& operator=(const AnalysisScheduler&) = delete;
+
+    // Queue an analysis of `content`. Supersedes any pending or running
+    // analysis of the same document.
+    void schedule(const std::string& uri, int version,
+                  const std::string& content);
+
+    // Like schedule(), but skips the debounce delay (open/save).
+    void scheduleNow(const std::string& uri, int version,
+                     const std::string& content);
+
+    // Drop pending work for a closed document and cancel a running job.
+    void cancel(const std::string& uri);
+
+    void stop();
+
+private:
+    struct Pending {
+        int version = 0;
+        std::string content;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    Job job;
+    std::chrono::milliseconds debounce;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<std::string, Pending> pending;
+    // Bumped on every schedule/cancel; a running job is stale once the
+    // generation of its document moves past the one it started with.
+    std::unordered_map<std::string, unsigned long> generations;
+    bool stopping = false;
+    std::thread worker;
+
+    void enqueue(const std::string& uri, int version,
+                 const std::string& content,
+                 std::chrono::steady_clock::time_point due);
+    void loop();
+    bool isStale(const std::string& uri, unsigned long generation);
+};
@@ -3,38 +3,17 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 #include "position.hpp"
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include "lsp_index_cache.hpp"
 
-// Forward declarations
-struct Symbol;
 struct Scope;
-using SymbolPtr = std::shared_ptr<Symbol>;
-
-enum class SymbolKind {
-    Function = 12,
-    Variable = 13,
-    Class = 5,
-    Field = 8,
-    Method = 6,
-    Parameter = 25,
-    Module = 2
-};
-
-struct Symbol {
-    std::string name;
-    SymbolKind kind;
-    std::string type;
-    Location definition;
-    std::vector<Location> references;
-    std::string documentation;
-    std::string detail;
-    bool isPublic = true;
-    bool isStatic = false;
-    bool isCallable = false;
-    std::string containerName;
-    std::vector<std::string> paramTypes;
-    std::string returnType;
-};
 
 struct ImportedModule {
     std::string fullPath;  // e.g., "Std.IO" or "MagolorDotDev.models.Package"
@@ -68,20 +47,37 @@ struct Scope {
 
 class SemanticAnalyzer {
 public:
+    ~SemanticAnalyzer();
+
     void analyze(const std::string& uri, const std::string& content);
+    // Index an already parsed (and ideally type-checked) program
+    void analyze(const std::string& uri, const Program& prog);
     std::vector<SymbolPtr> getCallableSymbols(const std::string& uri);
     std::vector<SymbolPtr> getVariablesInScope(const std::string& uri, Position pos);
     SymbolPtr getSymbolAt(const std::string& uri, Position pos);
     std::vector<SymbolPtr> getAllSymbolsInFile(const std::string& uri);
+    // Bumped each time the file is re-analyzed, for caches keyed on it
+    uint64_t getFileGeneration(const std::string& uri) const;
     std::vector<std::string> getImportedModules(const std::string& uri);
     std::vector<SymbolPtr> getSymbolsFromModule(const std::string& modulePath);
     std::vector<SymbolPtr> resolveImportedSymbols(const std::string& uri);
     SymbolPtr findSymbolInImports(const std::string& uri, const std::string& symbolName);
+    // Fuzzy search over every indexed file, for workspace/symbol
+    std::vector<SymbolPtr> searchWorkspace(const std::string& query, size_t limit = 100);
+    std::vector<SymbolPtr> findSymbolsByPrefix(const std::string& prefix, size_t limit = 0);
     
-    // Project-wide loading
+    // Project-wide loading. The first call installs the persisted index, if
+    // any, and validates it against the source tree in the background.
     void loadProject(const std::string& startUri);
-    void scanSourceDirectory(const std::string& srcDir);
     void reloadProject();
+    // The project's own modules by name, mapped to their file URIs
+    std::unordered_map<std::string, std::string> getProjectModules();
+
+    // Background refresh results are only merged by applyRefresh, which
+    // mutates the index and so needs the same exclusion as analyze(). The
+    // listener is called from the refresh thread once results are waiting.
+    void setRefreshListener(std::function<void()> listener);
+    void applyRefresh();
     
     // Import validation
     struct ImportError {
@@ -92,18 +88,42 @@ public:
     std::vector<ImportError> validateImports(const std::string& uri);
 
 private:
-    std::unordered_map<std::string, std::vector<SymbolPtr>> fileSymbols;
+    SymbolTable index;
     std::unordered_map<std::string, std::shared_ptr<Scope>> fileScopes;
     std::unordered_map<std::string, std::vector<SymbolPtr>> moduleSymbols;
     
     // Project state
     bool projectLoaded = false;
     std::string projectRoot;
+    std::string projectName;
+
+    // Project files as last indexed from disk, persisted to .magolor/index
+    std::unordered_map<std::string, IndexCache::Entry> diskIndex;
+    bool diskIndexReady = false;
+    // Files whose symbols come from an editor buffer instead of disk
+    std::unordered_set<std::string> openFiles;
+
+    // Background refresh of diskIndex; results are applied on the next call
+    // into the analyzer
+    struct RefreshedFile {
+        IndexCache::Entry entry;
+        bool reindexed = false;  // false: contents unchanged, only size/mtime
+    };
+    std::thread refreshThread;
+    std::mutex refreshMutex;
+    std::atomic<bool> refreshReady{false};
+    std::atomic<bool> stopRefresh{false};
+    std::vector<RefreshedFile> refreshedFiles;
+    std::vector<std::string> removedFiles;
+
+    std::function<void()> refreshListener;  // guarded by refreshMutex
+
+    void startRefresh();
+    void stopRefreshThread();
+    void installScope(const std::string& uri, const std::vector<std::string>& imports);
+    std::string indexPath() const;
     
     void extractSymbols(const std::string& uri, const std::string& content);
-    SymbolPtr parseFunction(const std::string& line, int lineNum, const std::string& uri);
-    SymbolPtr parseClass(const std::string& line, int lineNum, const std::string& uri);
-    SymbolPtr parseVariable(const std::string& line, int lineNum, const std::string& uri);
-    std::string extractType(const std::string& declaration);
-    void parseImport(const std::string& line, Scope* scope);
+    void indexProgram(const std::string& uri, const Program& prog);
+    ImportedModule resolveImport(const UsingDecl& decl);
 };
@@ -0,0 +1,60 @@
+#pragma once
+#include "lsp_semantic.hpp"
+#include "jsonrpc.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// textDocument/semanticTokens for the language server.
+//
+// Tokens come from the symbol index: every definition and same-file
+// reference recorded when the file was last type-checked. Nothing is lexed or
+// parsed per request. The encoded token array is cached per file until the
+// analyzer re-indexes it, so scrolling through a large file (range requests)
+// and repeated full requests only slice or resend that array. The previous
+// array is kept too, so full/delta can answer with a single edit.
+class SemanticTokensProvider {
+public:
+    explicit SemanticTokensProvider(SemanticAnalyzer& analyzer) : analyzer(analyzer) {}
+
+    // The legend advertised in the server capabilities
+    static JsonValue legend();
+
+    JsonValue full(const std::string& uri);
+    JsonValue delta(const std::string& uri, const std::string& previousResultId);
+    JsonValue range(const std::string& uri, const Range& range);
+
+    void forget(const std::string& uri);
+
+private:
+    struct Token {
+        int line;
+        int character;
+        int length;
+        uint32_t type;
+        uint32_t modifiers;
+    };
+
+    struct FileTokens {
+        uint64_t generation = 0;
+        std::vector<Token> tokens;  // sorted by position
+        std::string resultId;
+        std::vector<uint32_t> data;
+        // What the client held before the last rebuild, for deltas
+        std::string previousResultId;
+        std::vector<uint32_t> previousData;
+    };
+
+    SemanticAnalyzer& analyzer;
+    std::mutex mutex;
+    std::unordered_map<std::string, FileTokens> files;
+    uint64_t lastResultId = 0;
+
+    FileTokens& refresh(const std::string& uri);
+    std::vector<Token> collect(const std::string& uri);
+    static std::vector<uint32_t> encode(std::vector<Token>::const_iterator begin,
+                                        std::vector<Token>::const_iterator end);
+    static JsonValue dataToJson(const std::vector<uint32_t>& data);
+};
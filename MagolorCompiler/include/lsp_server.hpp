@@ -2,6 +2,11 @@
 #include "jsonrpc.hpp"
 #include "lsp_semantic.hpp"
 #include "lsp_completion.hpp"
+#include "lsp_scheduler.hpp"
+#include "lsp_incremental.hpp"
+#include "lsp_thread_pool.hpp"
+#include "lsp_formatter.hpp"
+#include "lsp_semantic_tokens.hpp"
 #include "diagnostics.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
@@ -10,6 +15,13 @@
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
 #include "lsp_logger.hpp"
 struct TextDocument {
     std::string uri;
@@ -18,6 +30,8 @@ struct TextDocument {
     std::string content;
     std::vector<size_t> lineOffsets;
     std::vector<LspDiagnostic> diagnostics;
+    // LSP columns count UTF-16 code units unless the client agreed to UTF-8
+    bool utf16Columns = true;
     
     void updateLineOffsets() {
         lineOffsets.clear();
@@ -31,14 +45,62 @@ struct TextDocument {
     
     Position offsetToPosition(size_t offset) const {
         Position pos;
-        for (size_t i = 0; i < lineOffsets.size(); i++) {
-            if (i + 1 >= lineOffsets.size() || lineOffsets[i + 1] > offset) {
-                pos.line = i;
-                pos.character = offset - lineOffsets[i];
-                break;
+        // lineOffsets is sorted, so the owning line is the last start <= offset
+        auto it = std::upper_bound(lineOffsets.begin(), lineOffsets.end(), offset);
+        size_t line = (it == lineOffsets.begin()) ? 0 : (it - lineOffsets.begin()) - 1;
+        pos.line = line;
+        pos.character = offset - lineOffsets[line];
+        return pos;
+    }
+    
+    size_t positionToOffset(const Position& pos) const {
+        if (pos.line < 0) return 0;
+        if (pos.line >= (int)lineOffsets.size()) return content.size();
+        size_t lineEnd = (pos.line + 1 < (int)lineOffsets.size())
+                         ? lineOffsets[pos.line + 1] - 1 : content.size();
+        size_t offset = lineOffsets[pos.line];
+        if (!utf16Columns)
+            return std::min(offset + std::max(pos.character, 0), lineEnd);
+        
+        // Step over whole code points; those outside the BMP take two units
+        int units = 0;
+        while (offset < lineEnd && units < pos.character) {
+            unsigned char lead = content[offset];
+            size_t bytes = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+            units += bytes == 4 ? 2 : 1;
+            offset = std::min(offset + bytes, lineEnd);
+        }
+        return offset;
+    }
+    
+    // Apply a ranged edit (TextDocumentSyncKind.Incremental). Only the line
+    // starts inside the replaced span are rebuilt; later ones are shifted.
+    void applyEdit(const Range& range, const std::string& text) {
+        size_t start = positionToOffset(range.start);
+        size_t end = std::max(start, positionToOffset(range.end));
+        
+        content.replace(start, end - start, text);
+        
+        // Lines whose start lies in (start, end] were removed by the edit
+        int firstLine = range.start.line < 0 ? 0
+                        : std::min(range.start.line, (int)lineOffsets.size() - 1);
+        auto eraseBegin = lineOffsets.begin() + firstLine + 1;
+        auto eraseEnd = std::upper_bound(eraseBegin, lineOffsets.end(), end);
+        
+        std::vector<size_t> inserted;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '\n') {
+                inserted.push_back(start + i + 1);
             }
         }
-        return pos;
+        
+        long delta = (long)text.size() - (long)(end - start);
+        for (auto it = eraseEnd; it != lineOffsets.end(); ++it) {
+            *it += delta;
+        }
+        
+        auto pos = lineOffsets.erase(eraseBegin, eraseEnd);
+        lineOffsets.insert(pos, inserted.begin(), inserted.end());
     }
     
     std::string getLine(int line) const {
@@ -69,38 +131,94 @@ private:
     }
 };
 
+using DocumentPtr = std::shared_ptr<const TextDocument>;
+
+// The open documents as of one point in the message stream. Snapshots never
+// change, so request handlers on worker threads can keep reading one while
+// the main loop applies later edits.
+class DocumentSnapshot {
+public:
+    DocumentPtr get(const std::string& uri) const {
+        if (!documents) return nullptr;
+        auto it = documents->find(uri);
+        return it != documents->end() ? it->second : nullptr;
+    }
+
+private:
+    friend class DocumentManager;
+    std::shared_ptr<const std::unordered_map<std::string, std::shared_ptr<TextDocument>>> documents;
+};
+
+// Owned by the main loop, which is the only thread that calls it. Edits are
+// copy-on-write: the document table and the edited document are copied only
+// while an outstanding snapshot still refers to them.
 class DocumentManager {
 public:
     void open(const std::string& uri, const std::string& languageId,
               int version, const std::string& content) {
-        TextDocument doc;
-        doc.uri = uri;
-        doc.languageId = languageId;
-        doc.version = version;
-        doc.content = content;
-        doc.updateLineOffsets();
-        documents[uri] = doc;
+        auto doc = std::make_shared<TextDocument>();
+        doc->uri = uri;
+        doc->languageId = languageId;
+        doc->version = version;
+        doc->content = content;
+        doc->utf16Columns = !utf8Positions;
+        doc->updateLineOffsets();
+        mutableTable()[uri] = doc;
     }
     
+    // Called from initialize when the client accepts "utf-8" positions
+    void useUtf8Positions() { utf8Positions = true; }
+    
     void change(const std::string& uri, int version, const std::string& content) {
-        if (documents.find(uri) != documents.end()) {
-            documents[uri].version = version;
-            documents[uri].content = content;
-            documents[uri].updateLineOffsets();
+        if (TextDocument* doc = mutableDocument(uri)) {
+            doc->version = version;
+            doc->content = content;
+            doc->updateLineOffsets();
+        }
+    }
+    
+    void applyEdit(const std::string& uri, int version, const Range& range,
+                   const std::string& text) {
+        if (TextDocument* doc = mutableDocument(uri)) {
+            doc->version = version;
+            doc->applyEdit(range, text);
         }
     }
     
     void close(const std::string& uri) {
-        documents.erase(uri);
+        mutableTable().erase(uri);
     }
     
-    TextDocument* get(const std::string& uri) {
-        auto it = documents.find(uri);
-        return it != documents.end() ? &it->second : nullptr;
+    DocumentPtr get(const std::string& uri) const {
+        auto it = documents->find(uri);
+        return it != documents->end() ? it->second : nullptr;
+    }
+
+    DocumentSnapshot snapshot() const {
+        DocumentSnapshot s;
+        s.documents = documents;
+        return s;
     }
 
 private:
-    std::unordered_map<std::string, TextDocument> documents;
+    using Table = std::unordered_map<std::string, std::shared_ptr<TextDocument>>;
+    std::shared_ptr<Table> documents = std::make_shared<Table>();
+    bool utf8Positions = false;
+
+    Table& mutableTable() {
+        if (documents.use_count() > 1)
+            documents = std::make_shared<Table>(*documents);
+        return *documents;
+    }
+
+    TextDocument* mutableDocument(const std::string& uri) {
+        Table& table = mutableTable();
+        auto it = table.find(uri);
+        if (it == table.end()) return nullptr;
+        if (it->second.use_count() > 1)
+            it->second = std::make_shared<TextDocument>(*it->second);
+        return it->second.get();
+    }
 };
 
 class DiagnosticCollector : public ErrorReporter {
@@ -161,17 +279,59 @@ private:
     DocumentManager documents;
     SemanticAnalyzer analyzer;
     CompletionProvider completion{analyzer};
+    Formatter formatter;
+    SemanticTokensProvider semanticTokens{analyzer};
     bool running = false;
     bool initialized = false;
-       void handleFormatting(const Message& msg);
-    void handleRangeFormatting(const Message& msg);
-    void handleOnTypeFormatting(const Message& msg);
-    void handleCodeAction(const Message &msg);
+    // Set from the client capabilities by the main loop and read by the
+    // analysis worker
+    std::atomic<bool> semanticTokensRefresh{false};
+    int nextRequestId = 0;
+
+    // Guards the analyzer's index: shared by read-only request handlers,
+    // exclusive for the analysis worker and the index refresh while they
+    // swap in new semantic results. The main loop never takes it, and the
+    // compile passes themselves run unlocked.
+    std::shared_mutex analyzerMutex;
+
+    // Messages read off stdin by the reader thread. $/cancelRequest is
+    // handled there so it can overtake the requests it refers to.
+    std::deque<Message> inbox;
+    std::mutex inboxMutex;
+    std::condition_variable inboxReady;
+    bool inputClosed = false;
+    std::unordered_set<int> cancelledRequests;
+
+    // Per-document parse caches; used by the analysis worker, dropped on close
+    std::unordered_map<std::string, std::shared_ptr<IncrementalParser>> parsers;
+    std::mutex parsersMutex;
+
+    // Read-only requests (hover, completion, references, formatting, ...)
+    // run here against the document snapshot taken when they were dequeued
+    ThreadPool requestPool{std::clamp<size_t>(std::thread::hardware_concurrency(), 2, 4)};
+
+    // Declared last so the worker is joined before the state it touches
+    // is destroyed.
+    AnalysisScheduler scheduler{
+        [this](const std::string& uri, int version, const std::string& content,
+               const AnalysisScheduler::CancelCheck& cancelled) {
+            analyzeAndPublishDiagnostics(uri, version, content, cancelled);
+        }};
+
+    void readMessages();
+    std::optional<Message> nextMessage();
+    bool takeCancelled(int id);
+    static bool isReadOnlyRequest(const std::string& method);
+    void runReadOnlyRequest(const Message& msg, const DocumentSnapshot& docs);
+    void handleReadOnlyRequest(const Message& msg, const DocumentSnapshot& docs);
+       void handleFormatting(const Message& msg, const DocumentSnapshot& docs);
+    void handleRangeFormatting(const Message& msg, const DocumentSnapshot& docs);
+    void handleOnTypeFormatting(const Message& msg, const DocumentSnapshot& docs);
+    void handleCodeAction(const Message &msg, const DocumentSnapshot& docs);
 
 void handleRename(const Message &msg);
-	void handleSignatureHelp(const Message &msg); 
-    std::string formatDocument(const std::string& content);
-    std::string formatRange(const std::string& content, Range range);
+	void handleSignatureHelp(const Message &msg, const DocumentSnapshot& docs); 
+    void respondWithEdits(const Message& msg, const std::vector<TextEdit>& edits);
     void handleMessage(const Message& msg);
     void handleInitialize(const Message& msg);
     void handleInitialized(const Message& msg);
@@ -181,16 +341,27 @@ void handleRename(const Message &msg);
     void handleDidChange(const Message& msg);
     void handleDidClose(const Message& msg);
     void handleDidSave(const Message& msg);
-    void handleCompletion(const Message& msg);
-    void handleHover(const Message& msg);
+    void handleCompletion(const Message& msg, const DocumentSnapshot& docs);
+    void handleHover(const Message& msg, const DocumentSnapshot& docs);
     void handleDefinition(const Message& msg);
     void handleReferences(const Message& msg);
     void handleDocumentSymbol(const Message& msg);
+    void handleWorkspaceSymbol(const Message& msg);
+    void handleSemanticTokens(const Message& msg);
+    void handleInlayHint(const Message& msg, const DocumentSnapshot& docs);
     
     // NEW: Diagnostic functions
-    void analyzeAndPublishDiagnostics(const std::string& uri, const std::string& content);
-    void publishDiagnostics(const std::string& uri, const std::vector<LspDiagnostic>& diagnostics);
+    std::vector<LspDiagnostic> collectDiagnostics(const std::string& uri,
+                                                  const std::string& content,
+                                                  const AnalysisScheduler::CancelCheck& cancelled,
+                                                  std::optional<Program>& program);
+    void analyzeAndPublishDiagnostics(const std::string& uri, int version,
+                                      const std::string& content,
+                                      const AnalysisScheduler::CancelCheck& cancelled);
+    void publishDiagnostics(const std::string& uri, const std::vector<LspDiagnostic>& diagnostics,
+                            int version = -1);
     
     JsonValue rangeToJson(const Range& r);
+    Range jsonToRange(const JsonValue& json);
     JsonValue diagnosticToJson(const LspDiagnostic& diag);
 };
@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for the language server's read-only requests.
+// Tasks run in submission order but may finish in any order.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Returns false, dropping the task, once stop() has been called.
+    bool submit(Task task);
+
+    // Block until every submitted task has finished.
+    void wait();
+
+    // Let running tasks finish, drop queued ones and join the workers.
+    void stop();
+
+private:
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable idle;
+    std::deque<Task> tasks;
+    size_t active = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void loop();
+};
@@ -2,6 +2,7 @@
 
 #include <unordered_set>
 #include "ast.hpp"
+#include "stdlib_metadata.hpp"
 #include <string>
 #include <algorithm>
 #include <vector>
@@ -27,6 +28,10 @@ public:
         static ModuleRegistry inst;
         return inst;
     }
+
+    // Standalone registries let the language server type-check a buffer
+    // without disturbing the shared project registry.
+    ModuleRegistry() = default;
     
     void registerModule(ModulePtr module) {
         modules[module->name] = module;
@@ -51,25 +56,13 @@ public:
     
 private:
     std::unordered_map<std::string, ModulePtr> modules;
-    ModuleRegistry() = default;
 };
 
 class ModuleResolver {
 public:
     // Check if this is a built-in standard library module
     static bool isBuiltinModule(const std::string& modulePath) {
-        // List of all built-in Std modules
-        static const std::unordered_set<std::string> builtins = {
-            "Std", "Std.IO", "Std.Parse", "Std.Option", "Std.Math",
-            "Std.String", "Std.Array", "Std.Map", "Std.Set", "Std.File",
-            "Std.Network", "Std.Time", "Std.Random", "Std.System",
-            // Network submodules
-            "Std.Network.HTTP", "Std.Network.WebSocket", "Std.Network.TCP",
-            "Std.Network.UDP", "Std.Network.Security", "Std.Network.JSON",
-            "Std.Network.Routing"
-        };
-        
-        return builtins.count(modulePath) > 0;
+        return StdLib::isModule(modulePath);
     }
     
     // Convert file path to module name
@@ -7,7 +7,7 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
-#include "package_registry.hpp"
+#include "version_solver.hpp"
 
 namespace fs = std::filesystem;
 
@@ -26,6 +26,10 @@ struct Package {
     std::string license;
     std::map<std::string, std::string> dependencies;
     std::vector<std::string> sourceDirs;
+    // [profile.<name>] sections, see BuildProfile
+    std::map<std::string, std::map<std::string, std::string>> profiles;
+    // [toolchain], see Toolchain
+    std::map<std::string, std::string> toolchain;
 };
 
 class PackageManager {
@@ -47,6 +51,16 @@ public:
         return t;
     }
 
+    // Helper: drop a trailing # comment that is not inside a string
+    static inline std::string stripComment(const std::string &s) {
+        bool quoted = false;
+        for (size_t i = 0; i < s.size(); i++) {
+            if (s[i] == '"') quoted = !quoted;
+            else if (s[i] == '#' && !quoted) return trim(s.substr(0, i));
+        }
+        return s;
+    }
+
     // Loads basic fields and dependencies from project.toml
     static Package loadFromToml(const std::string& path) {
         Package pkg;
@@ -107,6 +121,13 @@ public:
                 // dependency lines like: pkg = "1.0.0" or pkg = { version = "1.0" }
                 // We keep it simple and store the right hand side as string
                 pkg.dependencies[key] = v;
+            } else if (section.rfind("profile.", 0) == 0) {
+                pkg.profiles[section.substr(8)][key] = unquote(stripComment(value));
+            } else if (section == "toolchain") {
+                pkg.toolchain[key] = unquote(stripComment(value));
+            } else if (section == "build" && key == "optimization") {
+                // Older projects; [profile.dev] takes precedence
+                pkg.profiles["dev"].emplace("opt-level", v);
             }
         }
 
@@ -195,7 +216,10 @@ public:
         return ordered;
     }
 
-    static DependencyResolver::ResolveResult installDependencies(Package& pkg) {
+    // Versions recorded in the lock file are kept while they still satisfy
+    // project.toml; `update` ignores them and refreshes the store's mirrors
+    static DependencyResolver::ResolveResult installDependencies(
+        Package& pkg, size_t jobs = DependencyResolver::defaultJobs(), bool update = false) {
         std::cout << "\033[1;32m   Installing\033[0m dependencies for " << pkg.name << "\n";
 
         if (pkg.dependencies.empty()) {
@@ -205,7 +229,11 @@ public:
 
         fs::create_directories(".magolor/packages");
 
-        DependencyResolver resolver;
+        PackageRegistry::instance().setUpdate(update);
+        DependencyResolver resolver(jobs);
+        if (!update) {
+            resolver.prefer(loadFromLockFile(false));
+        }
         auto result = resolver.resolveAll(pkg.dependencies);
 
         if (!result.success) {
@@ -221,7 +249,10 @@ public:
         return result;
     }
 
-    static std::vector<ResolvedPackage> loadFromLockFile() {
+    // With `installedOnly`, a lock file whose packages are not all linked
+    // into .magolor/packages (for example after the store was cleared) reads
+    // as empty, so the caller installs again
+    static std::vector<ResolvedPackage> loadFromLockFile(bool installedOnly = true) {
         std::vector<ResolvedPackage> packages;
 
         if (!fs::exists(".magolor/lock.toml")) {
@@ -257,6 +288,8 @@ public:
             if (key == "name") currentPkg.name = value;
             else if (key == "version") currentPkg.version = PackageVersion::parse(value);
             else if (key == "location") currentPkg.location = value;
+            else if (key == "source") currentPkg.spec = value;
+            else if (key == "checksum") currentPkg.checksum = value;
         }
 
         if (inPackage) {
@@ -265,6 +298,9 @@ public:
 
         // Load source dirs for each package (if they have src/)
         for (auto& pkg : packages) {
+            if (installedOnly && !fs::exists(pkg.location)) {
+                return {};
+            }
             fs::path candidate = fs::path(pkg.location) / "src";
             if (fs::exists(candidate) && fs::is_directory(candidate)) {
                 pkg.sourceDirs.push_back(candidate.string());
@@ -275,19 +311,41 @@ public:
     }
 
 private:
+    // Written to a temporary file and renamed into place, so an interrupted
+    // install never leaves a truncated lock file behind
     static void saveLockFile(const Package& pkg, const std::vector<ResolvedPackage>& packages) {
-        std::ofstream file(".magolor/lock.toml");
-        file << "# This file is automatically generated by Gear\n";
-        file << "# Do not edit this file manually\n\n";
-        file << "[root]\n";
-        file << "name = \"" << pkg.name << "\"\n";
-        file << "version = \"" << pkg.version << "\"\n\n";
-
-        for (const auto& p : packages) {
-            file << "[[package]]\n";
-            file << "name = \"" << p.name << "\"\n";
-            file << "version = \"" << p.version.toString() << "\"\n";
-            file << "location = \"" << p.location << "\"\n\n";
+        const std::string path = ".magolor/lock.toml";
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::trunc);
+            file << "# This file is automatically generated by Gear\n";
+            file << "# Do not edit this file manually\n\n";
+            file << "[root]\n";
+            file << "name = \"" << pkg.name << "\"\n";
+            file << "version = \"" << pkg.version << "\"\n\n";
+
+            for (const auto& p : packages) {
+                file << "[[package]]\n";
+                file << "name = \"" << p.name << "\"\n";
+                file << "version = \"" << p.version.toString() << "\"\n";
+                file << "location = \"" << p.location << "\"\n";
+                if (!p.spec.empty()) file << "source = \"" << p.spec << "\"\n";
+                if (!p.checksum.empty()) file << "checksum = \"" << p.checksum << "\"\n";
+                file << "\n";
+            }
+
+            if (!file.flush()) {
+                std::cerr << "\033[1;31m       Error\033[0m: could not write " << tmp << "\n";
+                return;
+            }
+        }
+
+        std::error_code ec;
+        fs::rename(tmp, path, ec);
+        if (ec) {
+            fs::remove(tmp, ec);
+            std::cerr << "\033[1;31m       Error\033[0m: could not replace " << path << "\n";
+            return;
         }
 
         std::cout << "\033[1;32m       Saved\033[0m lock file\n";
@@ -7,6 +7,23 @@
 #include <sstream>
 #include <iostream>
 #include <cstdlib>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
 
 namespace fs = std::filesystem;
 
@@ -21,11 +38,11 @@ struct PackageVersion {
     int major;
     int minor;
     int patch;
-    
+
     static PackageVersion parse(const std::string& ver) {
         PackageVersion v{0, 0, 0};
         if (ver == "*") return v;
-        
+
         std::stringstream ss(ver);
         char dot;
         ss >> v.major;
@@ -34,13 +51,34 @@ struct PackageVersion {
         }
         return v;
     }
-    
+
+    // Strict form used for tags and constraints: "1.2.3", "v1.2", "2".
+    // Returns how many components were given, or 0 if `text` is not a version.
+    static int parsePartial(const std::string& text, PackageVersion& v) {
+        v = {0, 0, 0};
+        size_t i = (!text.empty() && text[0] == 'v') ? 1 : 0;
+        int* parts[] = {&v.major, &v.minor, &v.patch};
+        int count = 0;
+        while (count < 3) {
+            size_t start = i;
+            long value = 0;
+            while (i < text.size() && std::isdigit(static_cast<unsigned char>(text[i])) && value < INT_MAX / 10) {
+                value = value * 10 + (text[i++] - '0');
+            }
+            if (i == start) return 0;
+            *parts[count++] = static_cast<int>(value);
+            if (i == text.size()) return count;
+            if (text[i++] != '.') return 0;
+        }
+        return 0;
+    }
+
     std::string toString() const {
-        return std::to_string(major) + "." + 
-               std::to_string(minor) + "." + 
+        return std::to_string(major) + "." +
+               std::to_string(minor) + "." +
                std::to_string(patch);
     }
-    
+
     bool satisfies(const PackageVersion& required) const {
         if (required.major == 0) return true; // "*" matches any
         if (major != required.major) return false;
@@ -48,6 +86,220 @@ struct PackageVersion {
         if (minor == required.minor && patch < required.patch) return false;
         return true;
     }
+
+    bool operator<(const PackageVersion& o) const {
+        return std::tie(major, minor, patch) < std::tie(o.major, o.minor, o.patch);
+    }
+    bool operator==(const PackageVersion& o) const {
+        return major == o.major && minor == o.minor && patch == o.patch;
+    }
+};
+
+// The versions a constraint accepts, as the half-open interval [min, max).
+// Every accepted form reduces to one interval, so the constraints several
+// dependents place on a package intersect without needing unions:
+//   "1.2", "^1.2"   >=1.2.0 <2.0.0 (for 0.x the minor version is the bound)
+//   "~1.2", "=1.2"  >=1.2.0 <1.3.0
+//   ">=1.2", ">1.2", "<2", "<=2", "*"
+// Terms separated by commas must all hold: ">=1.2, <1.5".
+struct VersionRange {
+    PackageVersion min{0, 0, 0};
+    PackageVersion max{INT_MAX, 0, 0};
+
+    bool contains(const PackageVersion& v) const { return !(v < min) && v < max; }
+    bool empty() const { return !(min < max); }
+
+    VersionRange intersect(const VersionRange& o) const {
+        VersionRange r;
+        r.min = std::max(min, o.min);
+        r.max = std::min(max, o.max);
+        return r;
+    }
+
+    static bool parse(const std::string& spec, VersionRange& range) {
+        range = VersionRange();
+        std::stringstream ss(spec);
+        std::string term;
+        while (std::getline(ss, term, ',')) {
+            term.erase(0, term.find_first_not_of(" \t"));
+            term.erase(term.find_last_not_of(" \t") + 1);
+            if (term.empty() || term == "*") continue;
+
+            std::string op;
+            for (const char* candidate : {">=", "<=", ">", "<", "=", "^", "~"}) {
+                if (term.rfind(candidate, 0) == 0) {
+                    op = candidate;
+                    break;
+                }
+            }
+            std::string text = term.substr(op.size());
+            text.erase(0, text.find_first_not_of(" \t"));
+
+            PackageVersion v;
+            int parts = PackageVersion::parsePartial(text, v);
+            if (parts == 0) return false;
+
+            VersionRange r;
+            if (op == ">=") {
+                r.min = v;
+            } else if (op == ">") {
+                r.min = bump(v, parts);
+            } else if (op == "<") {
+                r.max = v;
+            } else if (op == "<=") {
+                r.max = bump(v, parts);
+            } else if (op == "=") {
+                r.min = v;
+                r.max = bump(v, parts);
+            } else if (op == "~") {
+                r.min = v;
+                r.max = bump(v, std::min(parts, 2));
+            } else {
+                // Caret, also the meaning of a bare version: the leftmost
+                // non-zero component may not change
+                r.min = v;
+                if (v.major > 0 || parts == 1) r.max = bump(v, 1);
+                else if (v.minor > 0 || parts == 2) r.max = bump(v, 2);
+                else r.max = bump(v, 3);
+            }
+            range = range.intersect(r);
+        }
+        return true;
+    }
+
+private:
+    // The first version past `v` when only its first `parts` components count
+    static PackageVersion bump(const PackageVersion& v, int parts) {
+        if (parts == 1) return {v.major + 1, 0, 0};
+        if (parts == 2) return {v.major, v.minor + 1, 0};
+        return {v.major, v.minor, v.patch + 1};
+    }
+};
+
+// Runs a program (looked up on PATH) without a shell and waits for it. Git is
+// never allowed to prompt for credentials, since several may run at once.
+// With `quiet`, the child's stdout and stderr go to /dev/null. With `output`,
+// its stdout is captured there instead.
+inline bool runProcess(const std::vector<std::string>& args, bool quiet = false,
+                       std::string* output = nullptr) {
+    std::vector<char*> argv;
+    for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    std::vector<std::string> env;
+    for (char** e = environ; *e; e++) {
+        if (std::string(*e).rfind("GIT_TERMINAL_PROMPT=", 0) != 0) env.push_back(*e);
+    }
+    env.push_back("GIT_TERMINAL_PROMPT=0");
+    std::vector<char*> envp;
+    for (auto& e : env) envp.push_back(e.data());
+    envp.push_back(nullptr);
+
+    // Close-on-exec, so children spawned by other threads do not inherit the
+    // write end and keep the pipe open
+    int pipeFds[2] = {-1, -1};
+    if (output && pipe2(pipeFds, O_CLOEXEC) != 0) return false;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (output) {
+        posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDOUT_FILENO);
+        if (quiet) {
+            posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+        }
+    } else if (quiet) {
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    }
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    if (output) {
+        close(pipeFds[1]);
+        output->clear();
+        char buffer[4096];
+        ssize_t n;
+        while (err == 0 && (n = read(pipeFds[0], buffer, sizeof(buffer))) != 0) {
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            output->append(buffer, n);
+        }
+        close(pipeFds[0]);
+    }
+    if (err != 0) return false;
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Per-user state shared by all projects: $MAGOLOR_HOME, or ~/.magolor
+inline std::string magolorHome() {
+    if (const char* home = std::getenv("MAGOLOR_HOME")) return home;
+    if (const char* home = std::getenv("HOME")) return std::string(home) + "/.magolor";
+    return ".magolor";
+}
+
+// Fetches run in parallel; each status line is written in one piece
+inline void printStatus(std::ostream& out, const std::string& line) {
+    static std::mutex outputMutex;
+    std::lock_guard<std::mutex> lock(outputMutex);
+    out << line << "\n" << std::flush;
+}
+
+// A dependency as written in project.toml: where the package comes from and
+// which of its versions are acceptable.
+//   name = "^1.2"                       registry package
+//   name = "git+https://host/repo.git"  any version tagged in the repository
+//   name = "git+/srv/repo.git#~1.4"     tagged versions matching ~1.4
+//   name = "path:../name"               a local checkout, used as is
+struct Requirement {
+    std::string name;
+    std::string spec;
+    PackageSource source = PackageSource::REGISTRY;
+    std::string location;  // git URL or local path; empty for the registry
+    std::string constraint;  // the version part of `spec`
+    VersionRange range;
+
+    static bool parse(const std::string& name, const std::string& spec,
+                      Requirement& req, std::string& error) {
+        req = Requirement();
+        req.name = name;
+        req.spec = spec;
+        std::string constraint = spec;
+        if (spec.find("git+") == 0) {
+            req.source = PackageSource::GIT;
+            req.location = spec.substr(4);
+            size_t hash = req.location.rfind('#');
+            constraint = hash == std::string::npos ? "*" : req.location.substr(hash + 1);
+            if (hash != std::string::npos) req.location.erase(hash);
+        } else if (spec.find("path:") == 0) {
+            req.source = PackageSource::LOCAL;
+            req.location = spec.substr(5);
+            constraint = "*";
+        }
+        req.constraint = constraint;
+        if (!VersionRange::parse(constraint, req.range)) {
+            error = "invalid version requirement '" + spec + "' for " + name;
+            return false;
+        }
+        return true;
+    }
+
+    bool sameSource(const Requirement& o) const {
+        return source == o.source && location == o.location;
+    }
+};
+
+// One installable version of a package
+struct Release {
+    PackageVersion version;
+    std::string commit;  // empty for local packages
 };
 
 struct ResolvedPackage {
@@ -57,263 +309,431 @@ struct ResolvedPackage {
     std::string location;      // URL, path, or registry name
     std::vector<std::string> sourceDirs;
     std::map<std::string, std::string> dependencies;
+    std::string spec;          // requirement it was installed for
+    std::string checksum;      // git tree id of the installed files
 };
 
+// Packages live in a store shared by every project on the machine,
+// $MAGOLOR_HOME/store or ~/.magolor/store:
+//   git/<hash of url>.git   a bare mirror of each repository
+//   <tree id>/              the files of one release, named by the git tree
+//                           id of its contents
+// A project's .magolor/packages/<name> is a symlink into the store, so a
+// release some other project already uses costs no download and no disk.
+//
+// Versions are read from the tags of the mirrors. A mirror is fetched again
+// only when none of its tags satisfies a requirement, or on
+// `install-deps --update`. Mirrors are cloned in the background as soon as a
+// package is first named (see prefetch), with at most `jobs` git transfers
+// running at a time.
 class PackageRegistry {
 public:
     static PackageRegistry& instance() {
         static PackageRegistry reg;
         return reg;
     }
-    
-    // Resolve a package dependency
-    ResolvedPackage resolve(const std::string& name, const std::string& versionSpec) {
-        std::cout << "\033[1;32m   Resolving\033[0m " << name << " " << versionSpec << "\n";
-        
-        // Check cache first
-        std::string cacheKey = name + "@" + versionSpec;
-        if (cache.find(cacheKey) != cache.end()) {
-            std::cout << "\033[1;32m      Cached\033[0m " << name << "\n";
-            return cache[cacheKey];
-        }
-        
-        ResolvedPackage pkg;
-        pkg.name = name;
-        
-        // Determine source type
-        if (versionSpec.find("git+") == 0) {
-            pkg.source = PackageSource::GIT;
-            pkg.location = versionSpec.substr(4);
-        } else if (versionSpec.find("path:") == 0) {
-            pkg.source = PackageSource::LOCAL;
-            pkg.location = versionSpec.substr(5);
-        } else {
-            pkg.source = PackageSource::REGISTRY;
-            pkg.version = PackageVersion::parse(versionSpec);
-        }
-        
-        cache[cacheKey] = pkg;
-        return pkg;
-    }
-    
-    // Fetch a package to local cache
-    bool fetch(ResolvedPackage& pkg) {
-        std::string pkgDir = getCacheDir() + "/" + pkg.name;
-        
-        switch (pkg.source) {
-            case PackageSource::GIT:
-                return fetchFromGit(pkg, pkgDir);
-            case PackageSource::LOCAL:
-                return fetchFromLocal(pkg, pkgDir);
-            case PackageSource::REGISTRY:
-                return fetchFromRegistry(pkg, pkgDir);
-            case PackageSource::PATH:
-                pkg.location = pkgDir;
-                return true;
-        }
-        return false;
-    }
-    
-    std::string getCacheDir() {
-        return ".magolor/packages";
+
+    void setJobs(size_t n) {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        slots = std::max<size_t>(n, 1);
     }
-    
-private:
-    std::map<std::string, ResolvedPackage> cache;
-    
-    PackageRegistry() {
-        fs::create_directories(getCacheDir());
+
+    // Fetch mirrors already in the store from their remotes before use
+    void setUpdate(bool value) { update = value; }
+
+    // Start locating and mirroring the package's repository
+    void prefetch(const Requirement& req) {
+        if (req.source != PackageSource::LOCAL) repository(req);
     }
-    
-    bool fetchFromGit(ResolvedPackage& pkg, const std::string& targetDir) {
-        std::cout << "\033[1;32m  Downloading\033[0m " << pkg.name << " from git\n";
-        
-        if (fs::exists(targetDir)) {
-            std::cout << "\033[1;33m     Updating\033[0m " << pkg.name << "\n";
-            std::string cmd = "cd " + targetDir + " && git pull --quiet";
-            if (std::system(cmd.c_str()) != 0) {
-                std::cerr << "\033[1;31m       Error\033[0m: failed to update " << pkg.name << "\n";
-                return false;
-            }
-        } else {
-            std::string cmd = "git clone --quiet " + pkg.location + " " + targetDir;
-            if (std::system(cmd.c_str()) != 0) {
-                std::cerr << "\033[1;31m       Error\033[0m: failed to clone " << pkg.name << "\n";
+
+    // Every release of the package, newest first. If none is in `wanted`,
+    // the mirror is fetched (once per run) before giving up.
+    bool releases(const Requirement& req, const VersionRange& wanted,
+                  std::vector<Release>& out, std::string& error) {
+        out.clear();
+        if (req.source == PackageSource::LOCAL) {
+            if (!fs::exists(req.location)) {
+                error = "path does not exist: " + req.location;
                 return false;
             }
+            Release release;
+            release.version = {0, 0, 0};
+            std::map<std::string, std::string> deps;
+            std::ifstream file(req.location + "/project.toml");
+            parseManifest(file, release.version, deps);
+            out.push_back(release);
+            return true;
         }
-        
-        pkg.location = targetDir;
-        
-        // Load package info
-        if (fs::exists(targetDir + "/project.toml")) {
-            loadPackageInfo(pkg, targetDir + "/project.toml");
+
+        auto repo = repository(req).get();
+        if (repo->mirror.empty()) {
+            error = repo->error;
+            return false;
         }
-        
-        // Add source directories
-        if (fs::exists(targetDir + "/src")) {
-            pkg.sourceDirs.push_back(targetDir + "/src");
+        listReleases(*repo, out);
+        bool any = std::any_of(out.begin(), out.end(),
+                               [&](const Release& r) { return wanted.contains(r.version); });
+        if (!any && !repo->fetched) {
+            fetchMirror(*repo, req.name);
+            listReleases(*repo, out);
         }
-        
-        std::cout << "\033[1;32m   Downloaded\033[0m " << pkg.name << "\n";
         return true;
     }
-    
-    bool fetchFromLocal(ResolvedPackage& pkg, const std::string& targetDir) {
-        std::cout << "\033[1;32m     Linking\033[0m " << pkg.name << " from local path\n";
-        
-        if (!fs::exists(pkg.location)) {
-            std::cerr << "\033[1;31m       Error\033[0m: path does not exist: " << pkg.location << "\n";
+
+    // Dependencies declared by one release
+    bool manifest(const Requirement& req, const Release& release,
+                  std::map<std::string, std::string>& deps, std::string& error) {
+        deps.clear();
+        PackageVersion version{0, 0, 0};
+        if (req.source == PackageSource::LOCAL) {
+            std::ifstream file(req.location + "/project.toml");
+            parseManifest(file, version, deps);
+            return true;
+        }
+
+        auto repo = repository(req).get();
+        if (repo->mirror.empty()) {
+            error = repo->error;
             return false;
         }
-        
-        // Create symlink
-        if (fs::exists(targetDir)) {
-            fs::remove_all(targetDir);
+        std::string key = repo->mirror + "@" + release.commit;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = manifests.find(key);
+            if (it != manifests.end()) {
+                deps = it->second;
+                return true;
+            }
+        }
+        // A release without a project.toml has no dependencies
+        std::string text;
+        if (runProcess({"git", "--git-dir=" + repo->mirror, "show", release.commit + ":project.toml"},
+                       true, &text)) {
+            std::istringstream in(text);
+            parseManifest(in, version, deps);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        manifests[key] = deps;
+        return true;
+    }
+
+    // Makes the release available as .magolor/packages/<name>. Safe to call
+    // from several threads for different packages.
+    bool install(const Requirement& req, const Release& release,
+                 ResolvedPackage& pkg, std::string& error) {
+        pkg = ResolvedPackage();
+        pkg.name = req.name;
+        pkg.version = release.version;
+        pkg.source = req.source;
+        pkg.spec = req.spec;
+        pkg.location = getCacheDir() + "/" + req.name;
+
+        std::string target;
+        if (req.source == PackageSource::LOCAL) {
+            if (!fs::exists(req.location)) {
+                error = "path does not exist: " + req.location;
+                return false;
+            }
+            target = fs::absolute(req.location).string();
+            printStatus(std::cout, "\033[1;32m      Linked\033[0m " + req.name + " from local path");
+        } else {
+            auto repo = repository(req).get();
+            if (repo->mirror.empty()) {
+                error = repo->error;
+                return false;
+            }
+            std::string tree;
+            if (!runProcess({"git", "--git-dir=" + repo->mirror, "rev-parse", release.commit + "^{tree}"},
+                            true, &tree)) {
+                error = "cannot read " + req.name + " " + release.version.toString() + " from its mirror";
+                return false;
+            }
+            tree.erase(tree.find_last_not_of("\n") + 1);
+            pkg.checksum = tree;
+            target = fs::absolute(storeDir() + "/" + tree).string();
+
+            if (fs::exists(target)) {
+                printStatus(std::cout, "\033[1;32m      Cached\033[0m " + req.name + " v" + release.version.toString());
+            } else if (unpack(*repo, release.commit, target)) {
+                printStatus(std::cout, "\033[1;32m    Unpacked\033[0m " + req.name + " v" + release.version.toString());
+            } else {
+                error = "failed to unpack " + req.name + " " + release.version.toString();
+                return false;
+            }
         }
-        
-        fs::create_directory_symlink(fs::absolute(pkg.location), targetDir);
-        pkg.location = targetDir;
-        
-        // Load package info
-        if (fs::exists(pkg.location + "/project.toml")) {
-            loadPackageInfo(pkg, pkg.location + "/project.toml");
+
+        // remove_all on a symlink removes the link, not the store entry
+        std::error_code ec;
+        fs::remove_all(pkg.location, ec);
+        fs::create_directory_symlink(target, pkg.location, ec);
+        if (ec) {
+            error = "cannot link " + pkg.location + ": " + ec.message();
+            return false;
         }
-        
+
+        PackageVersion declared{0, 0, 0};
+        std::ifstream file(pkg.location + "/project.toml");
+        parseManifest(file, declared, pkg.dependencies);
         if (fs::exists(pkg.location + "/src")) {
             pkg.sourceDirs.push_back(pkg.location + "/src");
         }
-        
-        std::cout << "\033[1;32m      Linked\033[0m " << pkg.name << "\n";
         return true;
     }
-    
-    bool fetchFromRegistry(ResolvedPackage& pkg, const std::string& targetDir) {
-        std::cout << "\033[1;32m    Fetching\033[0m " << pkg.name << " v" << pkg.version.toString() << "\n";
-        
-        // Check official registry first
-        std::string registryUrl = getRegistryUrl() + "/" + pkg.name;
-        
-        // For now, fall back to common git repos
-        std::string commonRepos[] = {
-            "https://github.com/magolor-lang/" + pkg.name,
-            "https://github.com/magolor/" + pkg.name,
-        };
-        
-        for (const auto& repo : commonRepos) {
-            std::string testCmd = "git ls-remote " + repo + " > /dev/null 2>&1";
-            if (std::system(testCmd.c_str()) == 0) {
-                pkg.location = repo;
-                pkg.source = PackageSource::GIT;
-                return fetchFromGit(pkg, targetDir);
-            }
-        }
-        
-        std::cerr << "\033[1;31m       Error\033[0m: package '" << pkg.name << "' not found in registry\n";
-        std::cerr << "  \033[1;34m= help:\033[0m check package name or use git+https://... for custom repos\n";
-        return false;
+
+    std::string getCacheDir() {
+        return ".magolor/packages";
+    }
+
+    static std::string storeDir() {
+        return magolorHome() + "/store";
     }
-    
-    void loadPackageInfo(ResolvedPackage& pkg, const std::string& tomlPath) {
-        std::ifstream file(tomlPath);
-        if (!file) return;
-        
+
+    static void parseManifest(std::istream& file, PackageVersion& version,
+                              std::map<std::string, std::string>& dependencies) {
         std::string line, section;
         while (std::getline(file, line)) {
             line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
             if (line.empty() || line[0] == '#') continue;
-            
+
             if (line[0] == '[' && line.back() == ']') {
                 section = line.substr(1, line.size() - 2);
                 continue;
             }
-            
+
             size_t eq = line.find('=');
             if (eq == std::string::npos) continue;
-            
+
             std::string key = line.substr(0, eq);
             std::string value = line.substr(eq + 1);
-            
+
             key.erase(0, key.find_first_not_of(" \t"));
             key.erase(key.find_last_not_of(" \t") + 1);
             value.erase(0, value.find_first_not_of(" \t"));
             value.erase(value.find_last_not_of(" \t") + 1);
-            
+
             if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
                 value = value.substr(1, value.size() - 2);
             }
-            
+
             if (section.empty() || section == "project") {
                 if (key == "version") {
-                    pkg.version = PackageVersion::parse(value);
+                    version = PackageVersion::parse(value);
                 }
             } else if (section == "dependencies") {
-                pkg.dependencies[key] = value;
+                dependencies[key] = value;
             }
         }
     }
-    
-    std::string getRegistryUrl() {
-        // Could be configurable via environment variable or config file
-        const char* envUrl = std::getenv("MAGOLOR_REGISTRY");
-        if (envUrl) return envUrl;
-        return "https://registry.magolor-lang.org";
-    }
-};
 
-class DependencyResolver {
-public:
-    struct ResolveResult {
-        std::vector<ResolvedPackage> packages;
-        bool success;
+private:
+    struct Repository {
+        std::string url;
+        std::string mirror;    // bare clone in the store; empty on failure
         std::string error;
+        bool fetched = false;  // already fetched from the remote in this run
+    };
+
+    std::mutex mutex;
+    std::map<std::string, std::shared_future<std::shared_ptr<Repository>>> repositories;
+    std::map<std::string, std::map<std::string, std::string>> manifests;
+    bool update = false;
+
+    // Bounds concurrent git transfers
+    std::mutex slotMutex;
+    std::condition_variable slotFree;
+    size_t slots = 8;
+    size_t busy = 0;
+
+    struct Slot {
+        PackageRegistry& reg;
+        explicit Slot(PackageRegistry& reg) : reg(reg) {
+            std::unique_lock<std::mutex> lock(reg.slotMutex);
+            reg.slotFree.wait(lock, [&] { return reg.busy < reg.slots; });
+            reg.busy++;
+        }
+        ~Slot() {
+            std::lock_guard<std::mutex> lock(reg.slotMutex);
+            reg.busy--;
+            reg.slotFree.notify_one();
+        }
     };
-    
-    ResolveResult resolveAll(const std::map<std::string, std::string>& dependencies) {
-        ResolveResult result;
-        result.success = true;
-        
-        std::cout << "\033[1;32m   Resolving\033[0m dependencies...\n";
-        
-        for (const auto& [name, version] : dependencies) {
-            if (!resolveDependency(name, version, result)) {
-                result.success = false;
-                return result;
+
+    PackageRegistry() {
+        fs::create_directories(getCacheDir());
+    }
+
+    std::shared_future<std::shared_ptr<Repository>> repository(const Requirement& req) {
+        std::string key = req.source == PackageSource::REGISTRY ? "registry:" + req.name
+                                                                : "git:" + req.location;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = repositories.find(key);
+        if (it != repositories.end()) return it->second;
+        auto future = std::async(std::launch::async, [this, req] { return openRepository(req); }).share();
+        repositories.emplace(key, future);
+        return future;
+    }
+
+    std::shared_ptr<Repository> openRepository(const Requirement& req) {
+        auto repo = std::make_shared<Repository>();
+        repo->url = req.source == PackageSource::REGISTRY ? lookupRegistry(req.name) : req.location;
+        if (repo->url.empty()) {
+            repo->error = "package '" + req.name + "' not found in registry\n"
+                          "  \033[1;34m= help:\033[0m check package name or use git+https://... for custom repos";
+            return repo;
+        }
+
+        std::string mirror = mirrorPath(repo->url);
+        if (fs::exists(mirror)) {
+            repo->mirror = mirror;
+            if (update) fetchMirror(*repo, req.name);
+            return repo;
+        }
+
+        printStatus(std::cout, "\033[1;32m    Fetching\033[0m " + req.name + " from " + repo->url);
+        std::string tmp = mirror + ".tmp-" + std::to_string(getpid());
+        std::error_code ec;
+        fs::create_directories(fs::path(mirror).parent_path(), ec);
+        fs::remove_all(tmp, ec);
+        {
+            Slot slot(*this);
+            if (!runProcess({"git", "clone", "--quiet", "--mirror", repo->url, tmp})) {
+                fs::remove_all(tmp, ec);
+                repo->error = "failed to clone " + req.name + " from " + repo->url;
+                return repo;
             }
         }
-        
-        std::cout << "\033[1;32m    Resolved\033[0m " << result.packages.size() << " packages\n";
-        return result;
+        // Another install may have created the same mirror meanwhile
+        fs::rename(tmp, mirror, ec);
+        if (ec) fs::remove_all(tmp, ec);
+        repo->mirror = mirror;
+        repo->fetched = true;
+        return repo;
     }
-    
-private:
-    std::map<std::string, ResolvedPackage> resolved;
-    
-    bool resolveDependency(const std::string& name, const std::string& version, ResolveResult& result) {
-        // Check if already resolved
-        std::string key = name + "@" + version;
-        if (resolved.find(key) != resolved.end()) {
-            return true;
+
+    void fetchMirror(Repository& repo, const std::string& name) {
+        printStatus(std::cout, "\033[1;33m     Updating\033[0m " + name);
+        Slot slot(*this);
+        if (!runProcess({"git", "--git-dir=" + repo.mirror, "fetch", "--quiet", "--prune"})) {
+            printStatus(std::cerr, "\033[1;33m     Warning\033[0m: could not update " + name +
+                        ", using the copy in the store");
         }
-        
-        // Resolve this package
-        auto pkg = PackageRegistry::instance().resolve(name, version);
-        
-        // Fetch the package
-        if (!PackageRegistry::instance().fetch(pkg)) {
-            result.error = "Failed to fetch package: " + name;
-            return false;
+        repo.fetched = true;
+    }
+
+    // Tags that parse as versions. A repository without any offers its HEAD,
+    // at the version in its project.toml.
+    void listReleases(const Repository& repo, std::vector<Release>& out) {
+        out.clear();
+        std::string refs;
+        runProcess({"git", "--git-dir=" + repo.mirror, "for-each-ref",
+                    "--format=%(refname:strip=2) %(objectname) %(*objectname)", "refs/tags"},
+                   true, &refs);
+        std::istringstream lines(refs);
+        std::string line;
+        while (std::getline(lines, line)) {
+            // Annotated tags point at a tag object; the commit is the peeled one
+            std::string tag, object, peeled;
+            std::istringstream(line) >> tag >> object >> peeled;
+            Release release;
+            if (object.empty() || PackageVersion::parsePartial(tag, release.version) == 0) continue;
+            release.commit = peeled.empty() ? object : peeled;
+            out.push_back(release);
         }
-        
-        // Recursively resolve dependencies
-        for (const auto& [depName, depVersion] : pkg.dependencies) {
-            if (!resolveDependency(depName, depVersion, result)) {
-                return false;
+
+        if (out.empty()) {
+            std::string head;
+            if (runProcess({"git", "--git-dir=" + repo.mirror, "rev-parse", "HEAD"}, true, &head)) {
+                Release release;
+                release.version = {0, 0, 0};
+                release.commit = head.substr(0, head.find('\n'));
+                std::string text;
+                std::map<std::string, std::string> deps;
+                if (runProcess({"git", "--git-dir=" + repo.mirror, "show", release.commit + ":project.toml"},
+                               true, &text)) {
+                    std::istringstream in(text);
+                    parseManifest(in, release.version, deps);
+                }
+                out.push_back(release);
             }
         }
-        
-        resolved[key] = pkg;
-        result.packages.push_back(pkg);
+
+        std::sort(out.begin(), out.end(),
+                  [](const Release& a, const Release& b) { return b.version < a.version; });
+    }
+
+    // Extracts a commit under a temporary name and renames it into place, so
+    // nobody sees a partially written store entry
+    bool unpack(const Repository& repo, const std::string& commit, const std::string& target) {
+        std::string tmp = target + ".tmp-" + std::to_string(getpid()) + "-" +
+                          std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        std::string archive = tmp + ".tar";
+        std::error_code ec;
+        fs::remove_all(tmp, ec);
+        fs::create_directories(tmp, ec);
+        bool ok = !ec &&
+                  runProcess({"git", "--git-dir=" + repo.mirror, "archive", "--format=tar", "-o", archive, commit}) &&
+                  runProcess({"tar", "-xf", archive, "-C", tmp});
+        fs::remove(archive, ec);
+        if (!ok) {
+            fs::remove_all(tmp, ec);
+            return false;
+        }
+        fs::rename(tmp, target, ec);
+        if (ec) {
+            fs::remove_all(tmp, ec);
+            return fs::exists(target);
+        }
         return true;
     }
+
+    static std::string mirrorPath(const std::string& url) {
+        // FNV-1a, so the name is the same on every machine and build
+        uint64_t hash = 1469598103934665603ull;
+        for (unsigned char c : url) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+        return storeDir() + "/git/" + name + ".git";
+    }
+
+    // Repository URL of a registry package. One already mirrored in the store
+    // is used without asking the network.
+    std::string lookupRegistry(const std::string& name) {
+        // A registry set through MAGOLOR_REGISTRY (a URL or a directory of
+        // git repositories) is tried first, then the common git hosts
+        std::vector<std::string> candidates;
+        if (std::getenv("MAGOLOR_REGISTRY")) {
+            candidates.push_back(getRegistryUrl() + "/" + name);
+        }
+        candidates.push_back("https://github.com/magolor-lang/" + name);
+        candidates.push_back("https://github.com/magolor/" + name);
+
+        for (const auto& repo : candidates) {
+            if (fs::exists(mirrorPath(repo))) return repo;
+        }
+
+        // Probe all candidates at once, then take the first that answered in
+        // order of preference
+        std::vector<std::future<bool>> probes;
+        for (const auto& repo : candidates) {
+            probes.push_back(std::async(std::launch::async, [repo] {
+                return runProcess({"git", "ls-remote", "--quiet", repo}, true);
+            }));
+        }
+        std::string found;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (probes[i].get() && found.empty()) found = candidates[i];
+        }
+        return found;
+    }
+
+    std::string getRegistryUrl() {
+        // Could be configurable via environment variable or config file
+        const char* envUrl = std::getenv("MAGOLOR_REGISTRY");
+        if (envUrl) return envUrl;
+        return "https://registry.magolor-lang.org";
+    }
 };
@@ -2,6 +2,7 @@
 #include "lexer.hpp"
 #include "ast.hpp"
 #include "error.hpp"
+#include <algorithm>
 #include <vector>
 
 class Parser {
@@ -14,7 +15,9 @@ private:
     std::string filename;
     ErrorReporter& reporter;
     size_t pos = 0;
-    bool skipGenericArgs(); 
+    // Type parameters of the function and class being parsed; their names
+    // parse as GENERIC types
+    std::vector<std::string> typeParamNames;
     Token peek(int offset = 0);
     Token advance();
     bool check(TokenType t);
@@ -35,10 +38,14 @@ private:
     CImportDecl parseCImport();
     FnDecl parseFunction();
     ClassDecl parseClass();
+    ClassDecl parseStruct();
+    void parseClassBody(ClassDecl& cls);
     
     // Types
     TypePtr parseType();
     TypePtr parseFunctionType();
+    void parseTypeParams(std::vector<TypeParam>& out);
+    bool parseCallTypeArgs(std::vector<TypePtr>& out);
     
     // Statements
     StmtPtr parseStmt();
@@ -48,7 +55,7 @@ private:
     StmtPtr parseWhile();
     StmtPtr parseFor();
     StmtPtr parseMatch();
-    std::vector<StmtPtr> parseBlock();
+    std::vector<StmtPtr> parseBlock(SourceLoc* end = nullptr);
     
     // Expressions (precedence climbing)
     ExprPtr parseExpr();
@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Wall-clock timings of the compiler's own phases (lexing, parsing, type
+// checking, code generation, the C++ compile, ...), for --timings and
+// --trace-out.
+//
+// Timing is off unless enabled, and a disabled timer costs one branch per
+// phase. Phases nest: Scope records the time between its construction and
+// destruction under a phase name and an optional detail (the file or module
+// it worked on), so the trace shows, say, each module's type check inside
+// the type checking pass.
+class PhaseTimer {
+public:
+    static PhaseTimer& instance() {
+        static PhaseTimer inst;
+        return inst;
+    }
+
+    class Scope {
+    public:
+        Scope(const std::string& phase, const std::string& detail = "");
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        bool active;
+        std::string phase;
+        std::string detail;
+        double start = 0;
+    };
+
+    void enable() { enabled = true; }
+    bool isEnabled() const { return enabled; }
+
+    // Time per phase with its share of the build, then the slowest files
+    // and modules
+    void printSummary(std::ostream& out) const;
+
+    // Chrome trace-event JSON, for chrome://tracing or ui.perfetto.dev
+    bool writeTrace(const std::string& path, std::string& error) const;
+
+private:
+    struct Event {
+        std::string phase;
+        std::string detail;
+        double start;     // microseconds since the timer was created
+        double duration;  // microseconds
+        int depth;
+    };
+
+    PhaseTimer() : origin(std::chrono::steady_clock::now()) {}
+    double now() const;
+
+    bool enabled = false;
+    std::chrono::steady_clock::time_point origin;
+    mutable std::mutex mutex;
+    std::vector<Event> events;
+    int depth = 0;
+};
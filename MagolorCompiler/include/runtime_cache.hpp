@@ -0,0 +1,26 @@
+#pragma once
+#include "toolchain.hpp"
+#include <string>
+#include <vector>
+
+// Precompiled copy of the runtime prelude (CodeGen::runtimePrelude) that
+// every generated program starts with.
+//
+// The prelude is the standard library plus every header it needs, and
+// compiling it dominates g++ time for a typical program. It is written once
+// as a header, precompiled, and kept in $MAGOLOR_HOME/runtime/<key>, where
+// the key covers the prelude text, the compiler command and the compiler
+// binary. Programs then #include it and the compiler loads the precompiled
+// form instead of parsing the runtime again. If GCC rejects a .gch it
+// silently parses the header, so a stale entry costs time, never correctness.
+class RuntimeCache {
+public:
+    static constexpr const char* HEADER = "magolor_runtime.hpp";
+
+    // Directory holding HEADER and its precompiled form for `compiler` (the
+    // compiler and the flags that affect code generation), built on first
+    // use. Empty if it could not be built; callers then inline the runtime.
+    // Toolchain::pchFlags turns the directory into compiler flags.
+    static std::string prepare(const Toolchain& toolchain, const std::vector<std::string>& compiler,
+                               bool verbose);
+};
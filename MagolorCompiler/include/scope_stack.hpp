@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Dense ids for names, so a lookup hashes the name once and everything
+// after that indexes arrays. Ids stay valid for the interner's lifetime.
+class NameInterner {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    uint32_t intern(std::string_view name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+        names.emplace_back(name);
+        uint32_t id = static_cast<uint32_t>(names.size() - 1);
+        ids.emplace(names.back(), id);
+        return id;
+    }
+
+    // NONE if `name` was never interned, so nothing can be bound to it
+    uint32_t find(std::string_view name) const {
+        auto it = ids.find(name);
+        return it == ids.end() ? NONE : it->second;
+    }
+
+    const std::string& name(uint32_t id) const { return names[id]; }
+
+private:
+    std::deque<std::string> names;  // keeps the keys' storage in place
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+// Nested lexical scopes kept as one array of bindings.
+//
+// Each binding remembers the one it shadows, and `innermost` maps a name id
+// to the binding a lookup sees, so finding a name costs the same at any
+// depth and leaving a scope just unwinds the bindings made in it. Once the
+// arrays have grown to the deepest nesting seen, nothing allocates.
+template <typename T>
+class ScopeStack {
+public:
+    void enter() { marks.push_back(bindings.size()); }
+
+    void exit() {
+        if (marks.empty()) return;
+        size_t mark = marks.back();
+        marks.pop_back();
+        while (bindings.size() > mark) {
+            innermost[bindings.back().name] = bindings.back().shadowed;
+            bindings.pop_back();
+        }
+    }
+
+    size_t depth() const { return marks.size(); }
+
+    // Binds `name` in the innermost scope, hiding any outer binding and any
+    // earlier one in the same scope until the scope exits
+    void define(uint32_t name, T value) {
+        if (name >= innermost.size()) innermost.resize(name + 1, -1);
+        bindings.push_back({name, std::move(value), innermost[name]});
+        innermost[name] = static_cast<int32_t>(bindings.size() - 1);
+    }
+
+    const T* find(uint32_t name) const {
+        if (name >= innermost.size() || innermost[name] < 0) return nullptr;
+        return &bindings[innermost[name]].value;
+    }
+
+    // Calls f(name, value) for every binding a lookup could see, innermost
+    // first
+    template <typename F>
+    void forEachVisible(F&& f) const {
+        for (size_t i = bindings.size(); i-- > 0;) {
+            if (innermost[bindings[i].name] == static_cast<int32_t>(i))
+                f(bindings[i].name, bindings[i].value);
+        }
+    }
+
+private:
+    struct Binding {
+        uint32_t name;
+        T value;
+        int32_t shadowed;  // binding index, -1 for none
+    };
+
+    std::vector<Binding> bindings;
+    std::vector<size_t> marks;      // bindings.size() when each scope began
+    std::vector<int32_t> innermost; // by name id, -1 when unbound
+};
@@ -18,6 +18,7 @@ public:
     ss << generateMath();
     ss << generateString(); // This now has indexOf and toString
     ss << generateArray();  // This now has create()
+    ss << generateSoA();
     ss << generateMap();
     ss << generateSet();
     ss << generateFile();
@@ -25,6 +26,8 @@ public:
     ss << generateTime();
     ss << generateRandom();
     ss << generateSystem();
+    ss << generateTest();
+    ss << generateBench();
 ss << generateCrypto();
     ss << generateTopLevel(); // This now has global toString
 
@@ -56,6 +59,8 @@ private:
 #include <ctime>
 #include <filesystem>
 #include <iomanip>
+#include <stdexcept>
+#include <type_traits>
 #include <sys/socket.h>    // ADD THIS LINE
 #include <netinet/in.h>    // ADD THIS LINE
 #include <arpa/inet.h>     // ADD THIS LINE
@@ -503,8 +508,75 @@ namespace Array {
     
     template<typename T>
     inline void clear(std::vector<T>& arr) { arr.clear(); }
+
+    // Whole-array arithmetic, written as plain loops over the contiguous
+    // data so the optimizer vectorizes them. SoA columns are arrays, so
+    // this is also how column-wise work is done.
+    template<typename T>
+    inline T sum(const std::vector<T>& arr) {
+        // Independent lanes let the additions run side by side without
+        // reordering any one lane's sum
+        constexpr size_t LANES = 8;
+        T lanes[LANES] = {};
+        const T* data = arr.data();
+        size_t n = arr.size(), i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            for (size_t j = 0; j < LANES; j++) lanes[j] += data[i + j];
+        }
+        T total{};
+        for (size_t j = 0; j < LANES; j++) total += lanes[j];
+        for (; i < n; i++) total += data[i];
+        return total;
+    }
+
+    template<typename T>
+    inline void fill(std::vector<T>& arr, const T& value) {
+        std::fill(arr.begin(), arr.end(), value);
+    }
+
+    template<typename T>
+    inline void scale(std::vector<T>& arr, const T& factor) {
+        T* data = arr.data();
+        for (size_t i = 0, n = arr.size(); i < n; i++) data[i] *= factor;
+    }
+
+    // dst[i] += src[i] * factor over the shorter of the two; dst and src
+    // may be the same array
+    template<typename T>
+    inline void addScaled(std::vector<T>& dst, const std::vector<T>& src, const T& factor) {
+        T* out = dst.data();
+        const T* in = src.data();
+        for (size_t i = 0, n = std::min(dst.size(), src.size()); i < n; i++) out[i] += in[i] * factor;
+    }
 }
 
+)";
+  }
+
+  static std::string generateSoA() {
+    return R"(// ============================================================================
+// SoA - Structure-of-arrays storage for structs
+// ============================================================================
+// The compiler specializes SoA<T> for each struct T used with it: a vector
+// per field (the columns, named like the fields), plus Ref and ConstRef
+// proxies that read and write one element across the columns.
+template<typename T>
+class SoA;
+
+// Iterates a SoA by index, yielding its proxies
+template<typename Columns, typename Ref>
+class SoAIterator {
+public:
+    SoAIterator(Columns* soa, int index) : soa(soa), index(index) {}
+    Ref operator*() const { return (*soa)[index]; }
+    SoAIterator& operator++() { ++index; return *this; }
+    bool operator!=(const SoAIterator& other) const { return index != other.index; }
+
+private:
+    Columns* soa;
+    int index;
+};
+
 )";
   }
 
@@ -865,6 +937,193 @@ namespace Random {
     }
 }
 
+)";
+  }
+
+  static std::string generateTest() {
+    return R"(// ============================================================================
+// Std.Test - Assertions for `test fn`
+// ============================================================================
+namespace Test {
+    template <typename T, typename = void>
+    struct Printable : std::false_type {};
+    template <typename T>
+    struct Printable<T, std::void_t<decltype(std::declval<std::ostream&>() << std::declval<const T&>())>>
+        : std::true_type {};
+
+    template <typename T>
+    inline std::string describe(const T& value) {
+        if constexpr (Printable<T>::value) {
+            std::ostringstream ss;
+            ss << value;
+            return ss.str();
+        } else {
+            return "<value>";
+        }
+    }
+
+    // Fails the running test; the test runner reports the message
+    inline void fail(const std::string& message) {
+        throw std::runtime_error(message);
+    }
+
+    inline void check(bool condition, const std::string& message = "check failed") {
+        if (!condition) fail(message);
+    }
+
+    template <typename A, typename B>
+    inline void assertEq(const A& left, const B& right) {
+        if (!(left == right)) {
+            fail("assertEq failed\n  left: " + describe(left) + "\n right: " + describe(right));
+        }
+    }
+
+    template <typename A, typename B>
+    inline void assertNe(const A& left, const B& right) {
+        if (left == right) {
+            fail("assertNe failed\n  both: " + describe(left));
+        }
+    }
+}
+
+)";
+  }
+
+  static std::string generateBench() {
+    return R"(// ============================================================================
+// Std.Bench - Helpers for `bench fn`
+// ============================================================================
+namespace Bench {
+    // Returns `value` unchanged, but the optimizer must assume it was read
+    // and may have been changed, so work feeding it cannot be removed
+    template <typename T>
+    inline T blackBox(T value) {
+        asm volatile("" : : "g"(&value) : "memory");
+        return value;
+    }
+}
+
+// Runs the `bench fn`s of a benchmark harness. Not visible to Magolor code.
+//
+// Each benchmark is warmed up, then timed in samples of a fixed number of
+// calls, chosen so that all samples together take about --time milliseconds.
+// The median time per call is reported with its median absolute deviation
+// and a bootstrapped 95% confidence interval, which are robust against the
+// odd sample slowed down by the rest of the system.
+namespace BenchRunner {
+    struct Result {
+        double median = 0, mad = 0, low = 0, high = 0;  // ns per call
+        size_t samples = 0, iterations = 0;             // calls per sample
+    };
+
+    inline double medianOf(std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        size_t n = values.size();
+        return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    }
+
+    inline Result measure(void (*fn)(), double warmupMs, double timeMs) {
+        using Clock = std::chrono::steady_clock;
+        // Called through a volatile pointer so the body is never inlined
+        // into the timing loop and hoisted out of it
+        void (*volatile call)() = fn;
+
+        size_t calls = 0;
+        auto start = Clock::now();
+        double elapsed = 0;
+        do {
+            call();
+            calls++;
+            elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        } while (elapsed < warmupMs * 1e6);
+        double perCall = elapsed / calls;
+
+        Result result;
+        double budget = timeMs * 1e6;
+        result.samples = static_cast<size_t>(std::clamp(budget / perCall, 10.0, 50.0));
+        result.iterations = static_cast<size_t>(std::max(1.0, budget / result.samples / perCall));
+
+        std::vector<double> samples;
+        for (size_t s = 0; s < result.samples; s++) {
+            auto begin = Clock::now();
+            for (size_t i = 0; i < result.iterations; i++) call();
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+            samples.push_back(ns / result.iterations);
+        }
+
+        result.median = medianOf(samples);
+        std::vector<double> deviations;
+        for (double x : samples) deviations.push_back(std::abs(x - result.median));
+        result.mad = medianOf(deviations);
+
+        // Percentile bootstrap of the median, seeded so reruns agree
+        std::mt19937 gen(12345);
+        std::uniform_int_distribution<size_t> pick(0, samples.size() - 1);
+        std::vector<double> medians, resample(samples.size());
+        for (int b = 0; b < 500; b++) {
+            for (auto& x : resample) x = samples[pick(gen)];
+            medians.push_back(medianOf(resample));
+        }
+        std::sort(medians.begin(), medians.end());
+        result.low = medians[medians.size() * 25 / 1000];
+        result.high = medians[medians.size() * 975 / 1000];
+        return result;
+    }
+
+    inline std::string formatNs(double ns) {
+        static const char* const units[] = {"ns", "us", "ms", "s"};
+        int unit = 0;
+        while (unit < 3 && ns >= 1000) {
+            ns /= 1000;
+            unit++;
+        }
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(ns < 10 ? 3 : ns < 100 ? 2 : 1) << ns << " "
+           << units[unit];
+        return ss.str();
+    }
+
+    // bench [--list] [--tsv] [--warmup ms] [--time ms] [filter...]
+    // --tsv prints one line per benchmark for tools: name, median, mad, low,
+    // high (ns per call), samples and calls per sample, tab separated
+    inline int main(int argc, char** argv,
+                    const std::vector<std::pair<std::string, void (*)()>>& benches) {
+        bool list = false, tsv = false;
+        double warmupMs = 300, timeMs = 2000;
+        std::vector<std::string> filters;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--list") list = true;
+            else if (arg == "--tsv") tsv = true;
+            else if (arg == "--warmup" && i + 1 < argc) warmupMs = std::atof(argv[++i]);
+            else if (arg == "--time" && i + 1 < argc) timeMs = std::atof(argv[++i]);
+            else filters.push_back(arg);
+        }
+
+        for (const auto& bench : benches) {
+            bool wanted = filters.empty();
+            for (const auto& f : filters) wanted = wanted || bench.first.find(f) != std::string::npos;
+            if (!wanted) continue;
+            if (list) {
+                std::cout << bench.first << "\n";
+                continue;
+            }
+            Result r = measure(bench.second, warmupMs, timeMs);
+            if (tsv) {
+                std::cout << bench.first << "\t" << r.median << "\t" << r.mad << "\t" << r.low
+                          << "\t" << r.high << "\t" << r.samples << "\t" << r.iterations << "\n";
+            } else {
+                std::cout << std::left << std::setw(24) << bench.first << " "
+                          << formatNs(r.median) << "/iter  (+/- " << formatNs(r.mad)
+                          << ")  95% CI [" << formatNs(r.low) << ", " << formatNs(r.high)
+                          << "]  " << r.samples << " x " << r.iterations << "\n";
+            }
+            std::cout.flush();
+        }
+        return 0;
+    }
+}
+
 )";
   }
 
@@ -2443,6 +2702,28 @@ inline std::string mg_to_string(const T* val) {
     return oss.str();
 }
 
+// ============================================================================
+// Constraints of generic Magolor code (fn max<T: Comparable>)
+// ============================================================================
+template<typename T, typename = void>
+struct mg_has_less : std::false_type {};
+template<typename T>
+struct mg_has_less<T, std::void_t<decltype(std::declval<const T&>() < std::declval<const T&>())>>
+    : std::true_type {};
+
+template<typename T, typename = void>
+struct mg_has_equal : std::false_type {};
+template<typename T>
+struct mg_has_equal<T, std::void_t<decltype(std::declval<const T&>() == std::declval<const T&>())>>
+    : std::true_type {};
+
+template<typename T>
+inline constexpr bool mg_numeric = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+template<typename T>
+inline constexpr bool mg_comparable = mg_has_less<T>::value;
+template<typename T>
+inline constexpr bool mg_equatable = mg_has_equal<T>::value;
+
 )";
   }
 // Add to stdlib.hpp after generateTemplateHelpers()
@@ -0,0 +1,623 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// What the standard library (StdLibGenerator) offers Magolor code: every
+// function, constant and type with its Magolor signature and a one-line doc.
+// The typechecker, the code generator and the language server all read this
+// table, so nothing is recovered from the generated C++ at run time.
+//
+// Keep it in step with stdlib.hpp. Overloads get one entry each. `module` is
+// the name after "Std." ("" for the prelude at the top of Std) and
+// `submodule` a namespace inside it, as in Std.Network.Status.
+struct StdLibEntry {
+    enum class Kind { Function, Constant, Type };
+
+    std::string_view module;
+    std::string_view submodule;
+    std::string_view name;
+    Kind kind;
+    std::string_view params;   // functions: "s: string, count: int"
+    std::string_view returns;  // functions: return type; constants: their type
+    std::string_view doc;
+
+    // "Std.Network.Status"
+    std::string modulePath() const {
+        std::string path = "Std";
+        if (!module.empty()) path += "." + std::string(module);
+        if (!submodule.empty()) path += "." + std::string(submodule);
+        return path;
+    }
+
+    // "Std::Network::Status::toString", as the generated C++ names it
+    std::string cppName() const {
+        std::string path = modulePath();
+        std::string out;
+        for (char c : path) {
+            if (c == '.') out += "::";
+            else out += c;
+        }
+        return out + "::" + std::string(name);
+    }
+
+    // "trim(s: string) -> string", "PI: float" or "type Handle"
+    std::string signature() const {
+        switch (kind) {
+        case Kind::Function:
+            return std::string(name) + "(" + std::string(params) + ") -> " + std::string(returns);
+        case Kind::Constant:
+            return std::string(name) + ": " + std::string(returns);
+        case Kind::Type:
+            break;
+        }
+        return "type " + std::string(name);
+    }
+};
+
+namespace StdLib {
+
+using Kind = StdLibEntry::Kind;
+
+inline constexpr StdLibEntry ENTRIES[] = {
+    // Std
+    {"", "", "print", Kind::Function, "value: T", "void",
+     "Write a value to stdout"},
+    {"", "", "println", Kind::Function, "value: T", "void",
+     "Write a value and a newline to stdout"},
+    {"", "", "toString", Kind::Function, "value: int", "string",
+     "Format a value as text"},
+    {"", "", "toString", Kind::Function, "value: float", "string",
+     "Format a value as text"},
+    {"", "", "toString", Kind::Function, "value: bool", "string",
+     "Format a value as text"},
+    {"", "", "toString", Kind::Function, "value: string", "string",
+     "Format a value as text"},
+    {"", "", "readLine", Kind::Function, "", "string",
+     "Read one line from stdin"},
+    {"", "", "parseInt", Kind::Function, "s: string", "Option<int>",
+     "Parse a decimal integer"},
+    {"", "", "parseFloat", Kind::Function, "s: string", "Option<float>",
+     "Parse a floating-point number"},
+    {"", "", "SoA", Kind::Type, "", "",
+     "Structure-of-arrays storage for a struct: one column per field"},
+
+    // Std.IO
+    {"IO", "", "print", Kind::Function, "s: string", "void",
+     "Write to stdout"},
+    {"IO", "", "println", Kind::Function, "s: string", "void",
+     "Write a line to stdout"},
+    {"IO", "", "eprint", Kind::Function, "s: string", "void",
+     "Write to stderr"},
+    {"IO", "", "eprintln", Kind::Function, "s: string", "void",
+     "Write a line to stderr"},
+    {"IO", "", "readLine", Kind::Function, "", "string",
+     "Read one line from stdin"},
+    {"IO", "", "read", Kind::Function, "", "string",
+     "Read one whitespace-separated word from stdin"},
+    {"IO", "", "readChar", Kind::Function, "", "char",
+     "Read one character from stdin"},
+    {"IO", "", "readFile", Kind::Function, "path: string", "Option<string>",
+     "Read a whole file, None if it cannot be opened"},
+    {"IO", "", "writeFile", Kind::Function, "path: string, content: string", "bool",
+     "Replace a file's contents"},
+    {"IO", "", "appendFile", Kind::Function, "path: string, content: string", "bool",
+     "Append to a file"},
+
+    // Std.Parse
+    {"Parse", "", "parseInt", Kind::Function, "s: string", "Option<int>",
+     "Parse a decimal integer"},
+    {"Parse", "", "parseFloat", Kind::Function, "s: string", "Option<float>",
+     "Parse a floating-point number"},
+    {"Parse", "", "parseBool", Kind::Function, "s: string", "Option<bool>",
+     "Parse \"true\" or \"false\""},
+
+    // Std.Option
+    {"Option", "", "isSome", Kind::Function, "opt: Option<T>", "bool",
+     "Whether the option holds a value"},
+    {"Option", "", "isNone", Kind::Function, "opt: Option<T>", "bool",
+     "Whether the option is empty"},
+    {"Option", "", "unwrap", Kind::Function, "opt: Option<T>", "T",
+     "The value; throws if the option is empty"},
+    {"Option", "", "unwrapOr", Kind::Function, "opt: Option<T>, defaultValue: T", "T",
+     "The value, or defaultValue if the option is empty"},
+
+    // Std.Math
+    {"Math", "", "abs", Kind::Function, "x: int", "int",
+     "Absolute value"},
+    {"Math", "", "abs", Kind::Function, "x: float", "float",
+     "Absolute value"},
+    {"Math", "", "pow", Kind::Function, "base: float, exp: float", "float",
+     "base raised to exp"},
+    {"Math", "", "sqrt", Kind::Function, "x: float", "float",
+     "Square root"},
+    {"Math", "", "cbrt", Kind::Function, "x: float", "float",
+     "Cube root"},
+    {"Math", "", "sin", Kind::Function, "x: float", "float",
+     "Sine, in radians"},
+    {"Math", "", "cos", Kind::Function, "x: float", "float",
+     "Cosine, in radians"},
+    {"Math", "", "tan", Kind::Function, "x: float", "float",
+     "Tangent, in radians"},
+    {"Math", "", "asin", Kind::Function, "x: float", "float",
+     "Arc sine, in radians"},
+    {"Math", "", "acos", Kind::Function, "x: float", "float",
+     "Arc cosine, in radians"},
+    {"Math", "", "atan", Kind::Function, "x: float", "float",
+     "Arc tangent, in radians"},
+    {"Math", "", "atan2", Kind::Function, "y: float, x: float", "float",
+     "Angle of the point (x, y), in radians"},
+    {"Math", "", "exp", Kind::Function, "x: float", "float",
+     "e raised to x"},
+    {"Math", "", "log", Kind::Function, "x: float", "float",
+     "Natural logarithm"},
+    {"Math", "", "log10", Kind::Function, "x: float", "float",
+     "Base-10 logarithm"},
+    {"Math", "", "log2", Kind::Function, "x: float", "float",
+     "Base-2 logarithm"},
+    {"Math", "", "floor", Kind::Function, "x: float", "float",
+     "Largest whole number not above x"},
+    {"Math", "", "ceil", Kind::Function, "x: float", "float",
+     "Smallest whole number not below x"},
+    {"Math", "", "round", Kind::Function, "x: float", "float",
+     "Nearest whole number, halves away from zero"},
+    {"Math", "", "min", Kind::Function, "a: int, b: int", "int",
+     "The smaller of two values"},
+    {"Math", "", "min", Kind::Function, "a: float, b: float", "float",
+     "The smaller of two values"},
+    {"Math", "", "max", Kind::Function, "a: int, b: int", "int",
+     "The larger of two values"},
+    {"Math", "", "max", Kind::Function, "a: float, b: float", "float",
+     "The larger of two values"},
+    {"Math", "", "clamp", Kind::Function, "val: int, low: int, high: int", "int",
+     "val limited to the range [low, high]"},
+    {"Math", "", "clamp", Kind::Function, "val: float, low: float, high: float", "float",
+     "val limited to the range [low, high]"},
+    {"Math", "", "PI", Kind::Constant, "", "float",
+     "Ratio of a circle's circumference to its diameter"},
+    {"Math", "", "E", Kind::Constant, "", "float",
+     "Base of the natural logarithm"},
+
+    // Std.String
+    {"String", "", "length", Kind::Function, "s: string", "int",
+     "Length in bytes"},
+    {"String", "", "isEmpty", Kind::Function, "s: string", "bool",
+     "Whether the string is empty"},
+    {"String", "", "trim", Kind::Function, "s: string", "string",
+     "Without leading and trailing whitespace"},
+    {"String", "", "toLower", Kind::Function, "s: string", "string",
+     "ASCII lowercase copy"},
+    {"String", "", "toUpper", Kind::Function, "s: string", "string",
+     "ASCII uppercase copy"},
+    {"String", "", "startsWith", Kind::Function, "s: string, prefix: string", "bool",
+     "Whether s begins with prefix"},
+    {"String", "", "endsWith", Kind::Function, "s: string, suffix: string", "bool",
+     "Whether s ends with suffix"},
+    {"String", "", "contains", Kind::Function, "s: string, substr: string", "bool",
+     "Whether substr occurs in s"},
+    {"String", "", "replace", Kind::Function, "s: string, from: string, to: string", "string",
+     "Every occurrence of from replaced by to"},
+    {"String", "", "split", Kind::Function, "s: string, delim: char", "Array<string>",
+     "Pieces of s between delimiters"},
+    {"String", "", "join", Kind::Function, "parts: Array<string>, sep: string", "string",
+     "parts joined with sep between them"},
+    {"String", "", "indexOf", Kind::Function, "s: string, substr: string", "Option<int>",
+     "Position of the first occurrence of substr"},
+    {"String", "", "toString", Kind::Function, "value: int", "string",
+     "Format a value as text"},
+    {"String", "", "toString", Kind::Function, "value: float", "string",
+     "Format a value as text"},
+    {"String", "", "toString", Kind::Function, "value: bool", "string",
+     "Format a value as text"},
+    {"String", "", "repeat", Kind::Function, "s: string, count: int", "string",
+     "s repeated count times"},
+    {"String", "", "substring", Kind::Function, "s: string, start: int, length: int = -1", "string",
+     "length bytes from start, or the rest of s"},
+
+    // Std.Array
+    {"Array", "", "length", Kind::Function, "arr: Array<T>", "int",
+     "Number of elements"},
+    {"Array", "", "create", Kind::Function, "", "Array<T>",
+     "A new empty array"},
+    {"Array", "", "isEmpty", Kind::Function, "arr: Array<T>", "bool",
+     "Whether the array has no elements"},
+    {"Array", "", "push", Kind::Function, "arr: Array<T>, item: T", "void",
+     "Append an element"},
+    {"Array", "", "pop", Kind::Function, "arr: Array<T>", "Option<T>",
+     "Remove and return the last element"},
+    {"Array", "", "contains", Kind::Function, "arr: Array<T>, item: T", "bool",
+     "Whether an element equals item"},
+    {"Array", "", "reverse", Kind::Function, "arr: Array<T>", "void",
+     "Reverse in place"},
+    {"Array", "", "sort", Kind::Function, "arr: Array<T>", "void",
+     "Sort in place, ascending"},
+    {"Array", "", "indexOf", Kind::Function, "arr: Array<T>, item: T", "Option<int>",
+     "Position of the first element equal to item"},
+    {"Array", "", "clear", Kind::Function, "arr: Array<T>", "void",
+     "Remove every element"},
+    {"Array", "", "sum", Kind::Function, "arr: Array<T>", "T",
+     "Sum of the elements, vectorized"},
+    {"Array", "", "fill", Kind::Function, "arr: Array<T>, value: T", "void",
+     "Set every element to value"},
+    {"Array", "", "scale", Kind::Function, "arr: Array<T>, factor: T", "void",
+     "Multiply every element by factor, vectorized"},
+    {"Array", "", "addScaled", Kind::Function, "dst: Array<T>, src: Array<T>, factor: T", "void",
+     "dst[i] += src[i] * factor, vectorized"},
+
+    // Std.Map
+    {"Map", "", "create", Kind::Function, "", "Map<K, V>",
+     "A new empty map"},
+    {"Map", "", "insert", Kind::Function, "map: Map<K, V>, key: K, value: V", "void",
+     "Set the value for key"},
+    {"Map", "", "get", Kind::Function, "map: Map<K, V>, key: K", "Option<V>",
+     "The value for key, if present"},
+    {"Map", "", "getOr", Kind::Function, "map: Map<K, V>, key: K, defaultValue: V", "V",
+     "The value for key, or defaultValue"},
+    {"Map", "", "contains", Kind::Function, "map: Map<K, V>, key: K", "bool",
+     "Whether key is present"},
+    {"Map", "", "remove", Kind::Function, "map: Map<K, V>, key: K", "void",
+     "Remove key if present"},
+    {"Map", "", "size", Kind::Function, "map: Map<K, V>", "int",
+     "Number of entries"},
+    {"Map", "", "isEmpty", Kind::Function, "map: Map<K, V>", "bool",
+     "Whether the map has no entries"},
+    {"Map", "", "clear", Kind::Function, "map: Map<K, V>", "void",
+     "Remove every entry"},
+    {"Map", "", "keys", Kind::Function, "map: Map<K, V>", "Array<K>",
+     "Every key, in no particular order"},
+    {"Map", "", "values", Kind::Function, "map: Map<K, V>", "Array<V>",
+     "Every value, in no particular order"},
+
+    // Std.Set
+    {"Set", "", "create", Kind::Function, "", "Set<T>",
+     "A new empty set"},
+    {"Set", "", "insert", Kind::Function, "set: Set<T>, item: T", "void",
+     "Add an element"},
+    {"Set", "", "contains", Kind::Function, "set: Set<T>, item: T", "bool",
+     "Whether item is in the set"},
+    {"Set", "", "remove", Kind::Function, "set: Set<T>, item: T", "void",
+     "Remove item if present"},
+    {"Set", "", "size", Kind::Function, "set: Set<T>", "int",
+     "Number of elements"},
+    {"Set", "", "isEmpty", Kind::Function, "set: Set<T>", "bool",
+     "Whether the set has no elements"},
+    {"Set", "", "clear", Kind::Function, "set: Set<T>", "void",
+     "Remove every element"},
+    {"Set", "", "toArray", Kind::Function, "set: Set<T>", "Array<T>",
+     "Every element, in no particular order"},
+    {"Set", "", "union_", Kind::Function, "a: Set<T>, b: Set<T>", "Set<T>",
+     "Elements in either set"},
+    {"Set", "", "intersection", Kind::Function, "a: Set<T>, b: Set<T>", "Set<T>",
+     "Elements in both sets"},
+    {"Set", "", "difference", Kind::Function, "a: Set<T>, b: Set<T>", "Set<T>",
+     "Elements of a that are not in b"},
+
+    // Std.File
+    {"File", "", "Handle", Kind::Type, "", "",
+     "An open file"},
+    {"File", "", "Mode", Kind::Type, "", "",
+     "How open() opens a file: Read, Write, ReadWrite or Append"},
+    {"File", "", "Seek", Kind::Type, "", "",
+     "Where seek() counts from: Begin, Current or End"},
+    {"File", "", "exists", Kind::Function, "path: string", "bool",
+     "Whether anything exists at path"},
+    {"File", "", "isFile", Kind::Function, "path: string", "bool",
+     "Whether path is a regular file"},
+    {"File", "", "isDirectory", Kind::Function, "path: string", "bool",
+     "Whether path is a directory"},
+    {"File", "", "createDir", Kind::Function, "path: string", "bool",
+     "Create a directory and its parents"},
+    {"File", "", "remove", Kind::Function, "path: string", "bool",
+     "Remove a file or empty directory"},
+    {"File", "", "removeAll", Kind::Function, "path: string", "bool",
+     "Remove path and everything under it"},
+    {"File", "", "copy", Kind::Function, "from: string, to: string", "bool",
+     "Copy a file or directory tree"},
+    {"File", "", "rename", Kind::Function, "from: string, to: string", "bool",
+     "Move or rename"},
+    {"File", "", "size", Kind::Function, "path: string", "Option<int>",
+     "File size in bytes"},
+    {"File", "", "open", Kind::Function, "path: string, mode: Mode", "Option<Handle>",
+     "Open a file for binary I/O"},
+    {"File", "", "close", Kind::Function, "h: Handle", "void",
+     "Close a handle"},
+    {"File", "", "read", Kind::Function, "h: Handle, bytes: int", "Array<u8>",
+     "Read up to bytes bytes"},
+    {"File", "", "write", Kind::Function, "h: Handle, data: Array<u8>", "bool",
+     "Write bytes"},
+    {"File", "", "flush", Kind::Function, "h: Handle", "bool",
+     "Flush buffered writes"},
+    {"File", "", "seek", Kind::Function, "h: Handle, offset: int, origin: Seek", "bool",
+     "Move the file position"},
+    {"File", "", "tell", Kind::Function, "h: Handle", "int",
+     "Current file position"},
+    {"File", "", "write_u32", Kind::Function, "h: Handle, value: u32", "bool",
+     "Write a 32-bit value in native byte order"},
+    {"File", "", "write_u64", Kind::Function, "h: Handle, value: u64", "bool",
+     "Write a 64-bit value in native byte order"},
+    {"File", "", "read_bytes", Kind::Function, "h: Handle, out: Array<u8>, count: int", "bool",
+     "Read exactly count bytes into out"},
+
+    // Std.Time
+    {"Time", "", "now", Kind::Function, "", "int",
+     "Milliseconds since the Unix epoch"},
+    {"Time", "", "sleep", Kind::Function, "milliseconds: int", "void",
+     "Pause the current thread"},
+    {"Time", "", "timestamp", Kind::Function, "", "string",
+     "Local time as YYYY-MM-DD HH:MM:SS"},
+
+    // Std.Random
+    {"Random", "", "randInt", Kind::Function, "min: int, max: int", "int",
+     "Uniform integer in [min, max]"},
+    {"Random", "", "randFloat", Kind::Function, "min: float = 0.0, max: float = 1.0", "float",
+     "Uniform number in [min, max)"},
+    {"Random", "", "randBool", Kind::Function, "", "bool",
+     "A fair coin flip"},
+
+    // Std.System
+    {"System", "", "exit", Kind::Function, "code: int", "void",
+     "End the program with an exit status"},
+    {"System", "", "getEnv", Kind::Function, "name: string", "Option<string>",
+     "An environment variable, if set"},
+    {"System", "", "execute", Kind::Function, "command: string", "int",
+     "Run a shell command and return its exit status"},
+
+    // Std.Test
+    {"Test", "", "describe", Kind::Function, "value: T", "string",
+     "The value as shown in assertion failures"},
+    {"Test", "", "fail", Kind::Function, "message: string", "void",
+     "Fail the current test"},
+    {"Test", "", "check", Kind::Function, "condition: bool, message: string = \"check failed\"", "void",
+     "Fail the current test unless condition holds"},
+    {"Test", "", "assertEq", Kind::Function, "left: A, right: B", "void",
+     "Fail the current test unless left == right"},
+    {"Test", "", "assertNe", Kind::Function, "left: A, right: B", "void",
+     "Fail the current test if left == right"},
+
+    // Std.Bench
+    {"Bench", "", "blackBox", Kind::Function, "value: T", "T",
+     "Return value unchanged, hidden from the optimizer"},
+
+    // Std.Network
+    {"Network", "", "HttpServer", Kind::Type, "", "",
+     "HTTP/1.1 server with routing and middleware"},
+    {"Network", "", "HttpRequest", Kind::Type, "", "",
+     "A parsed HTTP request"},
+    {"Network", "", "HttpResponse", Kind::Type, "", "",
+     "An HTTP response under construction"},
+    {"Network", "", "Cookie", Kind::Type, "", "",
+     "A Set-Cookie value"},
+    {"Network", "", "SessionStore", Kind::Type, "", "",
+     "In-memory sessions keyed by cookie"},
+    {"Network", "", "JsonBuilder", Kind::Type, "", "",
+     "Builds a JSON object"},
+    {"Network", "", "Middleware", Kind::Type, "", "",
+     "fn(HttpRequest, HttpResponse) -> bool; false stops the request"},
+    {"Network", "", "initNetwork", Kind::Function, "", "void",
+     "Start the socket layer (needed on Windows only)"},
+    {"Network", "", "cleanupNetwork", Kind::Function, "", "void",
+     "Stop the socket layer"},
+    {"Network", "", "urlDecode", Kind::Function, "str: string", "string",
+     "Decode %XX escapes and +"},
+    {"Network", "", "urlEncode", Kind::Function, "str: string", "string",
+     "Percent-encode for a URL"},
+    {"Network", "", "parseQuery", Kind::Function, "query: string", "Map<string, string>",
+     "Decode a query string"},
+    {"Network", "", "parseCookies", Kind::Function, "cookieHeader: string", "Map<string, string>",
+     "Decode a Cookie header"},
+    {"Network", "", "parseRequest", Kind::Function, "raw: string", "HttpRequest",
+     "Parse a raw HTTP request"},
+    {"Network", "", "jsonResponse", Kind::Function, "json: string, status: int = Status.OK", "HttpResponse",
+     "Response with a JSON body"},
+    {"Network", "", "htmlResponse", Kind::Function, "html: string, status: int = Status.OK", "HttpResponse",
+     "Response with an HTML body"},
+    {"Network", "", "textResponse", Kind::Function, "text: string, status: int = Status.OK", "HttpResponse",
+     "Response with a plain-text body"},
+    {"Network", "", "redirectResponse", Kind::Function, "url: string, status: int = 302", "HttpResponse",
+     "Redirect to url"},
+    {"Network", "", "errorResponse", Kind::Function, "status: int, message: string", "HttpResponse",
+     "Error page for a status code"},
+    {"Network", "", "corsMiddleware", Kind::Function, "origin: string = \"*\"", "Middleware",
+     "Adds CORS headers for origin"},
+    {"Network", "", "loggerMiddleware", Kind::Function, "", "Middleware",
+     "Logs each request to stdout"},
+    {"Network", "", "serveFile", Kind::Function, "filepath: string", "HttpResponse",
+     "Response with a file's contents and MIME type"},
+
+    // Std.Network.Status
+    {"Network", "Status", "OK", Kind::Constant, "", "int",
+     "HTTP 200"},
+    {"Network", "Status", "CREATED", Kind::Constant, "", "int",
+     "HTTP 201"},
+    {"Network", "Status", "ACCEPTED", Kind::Constant, "", "int",
+     "HTTP 202"},
+    {"Network", "Status", "NO_CONTENT", Kind::Constant, "", "int",
+     "HTTP 204"},
+    {"Network", "Status", "MOVED_PERMANENTLY", Kind::Constant, "", "int",
+     "HTTP 301"},
+    {"Network", "Status", "FOUND", Kind::Constant, "", "int",
+     "HTTP 302"},
+    {"Network", "Status", "SEE_OTHER", Kind::Constant, "", "int",
+     "HTTP 303"},
+    {"Network", "Status", "NOT_MODIFIED", Kind::Constant, "", "int",
+     "HTTP 304"},
+    {"Network", "Status", "TEMPORARY_REDIRECT", Kind::Constant, "", "int",
+     "HTTP 307"},
+    {"Network", "Status", "PERMANENT_REDIRECT", Kind::Constant, "", "int",
+     "HTTP 308"},
+    {"Network", "Status", "BAD_REQUEST", Kind::Constant, "", "int",
+     "HTTP 400"},
+    {"Network", "Status", "UNAUTHORIZED", Kind::Constant, "", "int",
+     "HTTP 401"},
+    {"Network", "Status", "FORBIDDEN", Kind::Constant, "", "int",
+     "HTTP 403"},
+    {"Network", "Status", "NOT_FOUND", Kind::Constant, "", "int",
+     "HTTP 404"},
+    {"Network", "Status", "METHOD_NOT_ALLOWED", Kind::Constant, "", "int",
+     "HTTP 405"},
+    {"Network", "Status", "CONFLICT", Kind::Constant, "", "int",
+     "HTTP 409"},
+    {"Network", "Status", "GONE", Kind::Constant, "", "int",
+     "HTTP 410"},
+    {"Network", "Status", "PAYLOAD_TOO_LARGE", Kind::Constant, "", "int",
+     "HTTP 413"},
+    {"Network", "Status", "URI_TOO_LONG", Kind::Constant, "", "int",
+     "HTTP 414"},
+    {"Network", "Status", "UNSUPPORTED_MEDIA_TYPE", Kind::Constant, "", "int",
+     "HTTP 415"},
+    {"Network", "Status", "TOO_MANY_REQUESTS", Kind::Constant, "", "int",
+     "HTTP 429"},
+    {"Network", "Status", "INTERNAL_SERVER_ERROR", Kind::Constant, "", "int",
+     "HTTP 500"},
+    {"Network", "Status", "NOT_IMPLEMENTED", Kind::Constant, "", "int",
+     "HTTP 501"},
+    {"Network", "Status", "BAD_GATEWAY", Kind::Constant, "", "int",
+     "HTTP 502"},
+    {"Network", "Status", "SERVICE_UNAVAILABLE", Kind::Constant, "", "int",
+     "HTTP 503"},
+    {"Network", "Status", "GATEWAY_TIMEOUT", Kind::Constant, "", "int",
+     "HTTP 504"},
+    {"Network", "Status", "toString", Kind::Function, "code: int", "string",
+     "Reason phrase for a status code"},
+
+    // Std.Network.HTTP
+    {"Network", "HTTP", "Method", Kind::Type, "", "",
+     "GET, POST, PUT, DELETE, PATCH, HEAD or OPTIONS"},
+    {"Network", "HTTP", "Headers", Kind::Type, "", "",
+     "Case-insensitive header map"},
+    {"Network", "HTTP", "methodToString", Kind::Function, "m: Method", "string",
+     "The method name, e.g. \"GET\""},
+    {"Network", "HTTP", "stringToMethod", Kind::Function, "s: string", "Method",
+     "Parse a method name"},
+
+    // Std.Network.WebSocket
+    {"Network", "WebSocket", "OpCode", Kind::Type, "", "",
+     "Frame type"},
+    {"Network", "WebSocket", "Frame", Kind::Type, "", "",
+     "A decoded WebSocket frame"},
+    {"Network", "WebSocket", "Connection", Kind::Type, "", "",
+     "A WebSocket connection over an accepted socket"},
+
+    // Std.Network.TCP
+    {"Network", "TCP", "Client", Kind::Type, "", "",
+     "A TCP client connection"},
+    {"Network", "TCP", "Server", Kind::Type, "", "",
+     "A listening TCP socket"},
+
+    // Std.Network.UDP
+    {"Network", "UDP", "Socket", Kind::Type, "", "",
+     "A UDP socket"},
+
+    // Std.Network.Security
+    {"Network", "Security", "RateLimiter", Kind::Type, "", "",
+     "Per-client request limit over a sliding window"},
+    {"Network", "Security", "CorsConfig", Kind::Type, "", "",
+     "Allowed origins, methods and headers"},
+    {"Network", "Security", "escapeHtml", Kind::Function, "str: string", "string",
+     "Escape &, <, >, \" and ' for HTML"},
+    {"Network", "Security", "generateToken", Kind::Function, "length: int = 32", "string",
+     "Random alphanumeric token"},
+    {"Network", "Security", "generateCsrfToken", Kind::Function, "", "string",
+     "Random token for CSRF protection"},
+
+    // Std.Network.JSON
+    {"Network", "JSON", "Type", Kind::Type, "", "",
+     "Kind of a JSON value"},
+    {"Network", "JSON", "Parser", Kind::Type, "", "",
+     "Minimal JSON reader"},
+    {"Network", "JSON", "ArrayBuilder", Kind::Type, "", "",
+     "Builds a JSON array"},
+
+    // Std.Network.Routing
+    {"Network", "Routing", "RouteMatch", Kind::Type, "", "",
+     "Result of matching a path against a pattern"},
+    {"Network", "Routing", "Router", Kind::Type, "", "",
+     "Dispatches requests by method and path pattern"},
+    {"Network", "Routing", "matchRoute", Kind::Function, "pattern: string, path: string", "RouteMatch",
+     "Match a path against a pattern with :params"},
+};
+
+inline constexpr size_t ENTRY_COUNT = sizeof(ENTRIES) / sizeof(ENTRIES[0]);
+
+namespace detail {
+    // Indices into ENTRIES ordered by name, sorted while compiling
+    constexpr std::array<unsigned short, ENTRY_COUNT> sortByName() {
+        std::array<unsigned short, ENTRY_COUNT> order{};
+        for (size_t i = 0; i < ENTRY_COUNT; i++) {
+            size_t j = i;
+            while (j > 0 && ENTRIES[i].name < ENTRIES[order[j - 1]].name) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = static_cast<unsigned short>(i);
+        }
+        return order;
+    }
+
+    inline constexpr std::array<unsigned short, ENTRY_COUNT> BY_NAME = sortByName();
+}
+
+// The entries called `name`, in table order within each run of equal names
+class Named {
+public:
+    class iterator {
+    public:
+        explicit iterator(const unsigned short* at) : at(at) {}
+        const StdLibEntry& operator*() const { return ENTRIES[*at]; }
+        const StdLibEntry* operator->() const { return &ENTRIES[*at]; }
+        iterator& operator++() { ++at; return *this; }
+        bool operator!=(const iterator& other) const { return at != other.at; }
+    private:
+        const unsigned short* at;
+    };
+
+    Named(const unsigned short* first, const unsigned short* last) : first(first), last(last) {}
+    iterator begin() const { return iterator(first); }
+    iterator end() const { return iterator(last); }
+    bool empty() const { return first == last; }
+
+private:
+    const unsigned short* first;
+    const unsigned short* last;
+};
+
+inline Named named(std::string_view name) {
+    const unsigned short* lo = detail::BY_NAME.data();
+    const unsigned short* hi = lo + ENTRY_COUNT;
+    while (lo < hi) {
+        const unsigned short* mid = lo + (hi - lo) / 2;
+        if (ENTRIES[*mid].name < name) lo = mid + 1;
+        else hi = mid;
+    }
+    const unsigned short* first = lo;
+    while (lo != detail::BY_NAME.data() + ENTRY_COUNT && ENTRIES[*lo].name == name) lo++;
+    return Named(first, lo);
+}
+
+// Whether `path` ("Std", "Std.Math", "Std.Network.HTTP") names a module
+inline bool isModule(std::string_view path) {
+    if (path == "Std") return true;
+    if (path.substr(0, 4) != "Std.") return false;
+    path.remove_prefix(4);
+    std::string_view module = path.substr(0, path.find('.'));
+    std::string_view submodule = module.size() < path.size() ? path.substr(module.size() + 1) : "";
+    for (const auto& entry : ENTRIES) {
+        if (entry.module == module && (submodule.empty() || entry.submodule == submodule))
+            return true;
+    }
+    return false;
+}
+
+// Whether `entry` is reached through `using <path>`: its own module, or for
+// Std.X every entry directly in X
+inline bool importedBy(const StdLibEntry& entry, std::string_view path) {
+    if (path.substr(0, 4) != "Std.") return false;
+    path.remove_prefix(4);
+    size_t dot = path.find('.');
+    if (dot == std::string_view::npos)
+        return entry.module == path && entry.submodule.empty();
+    return entry.module == path.substr(0, dot) && entry.submodule == path.substr(dot + 1);
+}
+
+} // namespace StdLib
@@ -1,8 +1,11 @@
 #pragma once
 #include "position.hpp"
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 enum class SymbolKind {
@@ -25,88 +28,78 @@ struct Symbol {
   std::string detail;
   bool isPublic = true;
   bool isStatic = false;
+  bool isCallable = false;
   std::string containerName;
+  std::vector<std::string> paramTypes;
+  std::string returnType;
+  // Locals and parameters are only visible inside `scope`
+  bool isLocal = false;
+  Range scope;
 };
 
 using SymbolPtr = std::shared_ptr<Symbol>;
 
+// Workspace-wide symbol index.
+//
+// Symbols are added and replaced a whole file at a time. Besides the
+// per-file lists it keeps
+//  - an ordered, case-insensitive name index for prefix queries,
+//  - a trigram index for fuzzy (workspace/symbol) queries, and
+//  - per file, a static interval tree over definition and reference ranges
+//    for position lookups.
+// Locals and parameters only go into the per-file structures; the name and
+// trigram indexes hold declarations visible across the workspace.
 class SymbolTable {
 public:
-  void addSymbol(SymbolPtr sym) {
-    symbols[sym->name] = sym;
-    byLocation[locationKey(sym->definition)] = sym;
-  }
+  void setFileSymbols(const std::string &uri, std::vector<SymbolPtr> symbols);
+  void removeFile(const std::string &uri);
+  void clear();
 
-  SymbolPtr lookup(const std::string &name) {
-    auto it = symbols.find(name);
-    return it != symbols.end() ? it->second : nullptr;
-  }
+  bool hasFile(const std::string &uri) const;
+  // Changes whenever the file's symbols are replaced; 0 if it has none
+  uint64_t fileGeneration(const std::string &uri) const;
+  std::vector<std::string> files() const;
+  const std::vector<SymbolPtr> &getSymbolsInFile(const std::string &uri) const;
 
-  // In symbol_table.cpp
-  std::vector<std::shared_ptr<Symbol>> getAllSymbols() const {
-    std::vector<std::shared_ptr<Symbol>> result;
-    for (const auto &pair : fileSymbols) {
-      result.insert(result.end(), pair.second.begin(), pair.second.end());
-    }
-    return result;
-  }
-  SymbolPtr findAtPosition(const std::string &uri, const Position &pos) {
-    for (auto &[_, sym] : symbols) {
-      if (sym->definition.uri == uri && sym->definition.range.contains(pos)) {
-        return sym;
-      }
-      for (auto &ref : sym->references) {
-        if (ref.uri == uri && ref.range.contains(pos)) {
-          return sym;
-        }
-      }
-    }
-    return nullptr;
-  }
+  // Workspace-level declarations named exactly `name`
+  std::vector<SymbolPtr> lookup(const std::string &name) const;
+  // Case-insensitive prefix match, in name order; limit 0 means no limit
+  std::vector<SymbolPtr> findByPrefix(const std::string &prefix,
+                                      size_t limit = 0) const;
+  // Fuzzy match for workspace/symbol, best first
+  std::vector<SymbolPtr> search(const std::string &query,
+                                size_t limit = 100) const;
+  // The symbol whose definition or reference covers `pos`
+  SymbolPtr findAtPosition(const std::string &uri, const Position &pos) const;
 
-  void addReference(const std::string &name, const Location &loc) {
-    auto sym = lookup(name);
-    if (sym)
-      sym->references.push_back(loc);
-  }
+  size_t size() const { return byName.size(); }
 
-  std::vector<SymbolPtr> getSymbolsInFile(const std::string &uri) {
-    std::vector<SymbolPtr> result;
-    for (auto &[_, sym] : symbols) {
-      if (sym->definition.uri == uri) {
-        result.push_back(sym);
-      }
-    }
-    return result;
-  }
-
-  std::vector<SymbolPtr> findByPrefix(const std::string &prefix) {
-    std::vector<SymbolPtr> result;
-    for (auto &[name, sym] : symbols) {
-      if (name.find(prefix) == 0) {
-        result.push_back(sym);
-      }
-    }
-    return result;
-  }
-
-  void clear() {
-    symbols.clear();
-    byLocation.clear();
-  }
+private:
+  struct Interval {
+    Range range;
+    Position maxEnd; // largest end in the subtree rooted here
+    SymbolPtr symbol;
+  };
 
-  const std::unordered_map<std::string, SymbolPtr> &all() const {
-    return symbols;
-  }
+  struct FileEntry {
+    uint64_t generation = 0;
+    std::vector<SymbolPtr> symbols;
+    // Sorted by start; the implicit tree is rooted at the middle element
+    std::vector<Interval> intervals;
+  };
 
-private:
-  std::unordered_map<std::string, SymbolPtr> symbols;
-  std::unordered_map<std::string, SymbolPtr> byLocation;
+  std::unordered_map<std::string, FileEntry> filesByUri;
+  uint64_t lastGeneration = 0;
+  std::multimap<std::string, SymbolPtr> byName; // key: lower-case name
+  std::unordered_map<uint32_t, std::unordered_set<SymbolPtr>> trigrams;
 
-  std::unordered_map<std::string, std::vector<std::shared_ptr<Symbol>>>
-      fileSymbols;
-  std::string locationKey(const Location &loc) {
-    return loc.uri + ":" + std::to_string(loc.range.start.line) + ":" +
-           std::to_string(loc.range.start.character);
-  }
+  void index(const SymbolPtr &sym);
+  void unindex(const SymbolPtr &sym);
+  static std::vector<Interval> buildIntervals(const std::string &uri,
+                                              const std::vector<SymbolPtr> &symbols);
+  static Position fillMaxEnd(std::vector<Interval> &intervals, size_t lo,
+                             size_t hi);
+  static const Interval *queryIntervals(const std::vector<Interval> &intervals,
+                                        size_t lo, size_t hi,
+                                        const Position &pos);
 };
@@ -0,0 +1,49 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+// The C++ compiler and linker that turn generated code into a binary.
+//
+// Chosen by the [toolchain] section of project.toml:
+//
+//     [toolchain]
+//     compiler = "clang++"   # g++ (the default), clang++ or a path
+//     linker = "mold"        # mold, lld, gold or bfd; passed as -fuse-ld=
+//
+// MAGOLOR_CXX and MAGOLOR_LINKER override both, e.g. for a CI matrix. GCC
+// and Clang spell LTO, PGO and precompiled headers differently, so anything
+// that builds a command line asks the toolchain which one it has.
+class Toolchain {
+public:
+    enum class Family { GCC, Clang };
+
+    std::string compiler = "g++";
+    std::string linker;
+    Family family = Family::GCC;
+
+    // Applies `settings` (the [toolchain] section) and the environment, and
+    // asks the compiler what it is
+    static bool resolve(const std::map<std::string, std::string>& settings, Toolchain& out,
+                        std::string& error);
+
+    // Path, size and mtime of the compiler binary, so upgrading it
+    // invalidates everything cached from it
+    std::string stamp() const;
+
+    // Start of every command line: the compiler, language level and linker
+    std::vector<std::string> baseArgs() const;
+
+    // Where the precompiled form of `dir`/`header` goes, and the flags that
+    // make a compile use it when the source #includes `header`
+    std::string pchPath(const std::string& dir, const std::string& header) const;
+    std::vector<std::string> pchFlags(const std::string& dir, const std::string& header) const;
+
+    // Raw PGO data a training run leaves in a directory
+    std::string profileExtension() const;
+    // Clang reads one merged .profdata; GCC uses its .gcda files as they are
+    bool mergeProfile(const std::string& dir, std::string& error) const;
+
+    // Runs `args`, collecting stdout and stderr into `diagnostics`
+    static bool run(const std::vector<std::string>& args, std::string& diagnostics);
+};
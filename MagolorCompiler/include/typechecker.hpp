@@ -2,6 +2,7 @@
 #include "ast.hpp"
 #include "error.hpp"
 #include "module.hpp"
+#include "scope_stack.hpp"
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -11,11 +12,14 @@ public:
   TypeChecker(ErrorReporter &reporter, ModuleRegistry &registry)
       : reporter(reporter), registry(registry) {}
 
-  ~TypeChecker();
-
   // Main entry points
   bool checkProgram(Program &prog);
   bool checkModule(ModulePtr module);
+  // Check a single top-level declaration of `module`; every class and
+  // function of the module is in scope. The declaration must live in
+  // module->ast. Lets the LSP re-check only what an edit can affect.
+  bool checkFunctionInModule(ModulePtr module, FnDecl &fn);
+  bool checkClassInModule(ModulePtr module, ClassDecl &cls);
   std::vector<FnDecl *> getVisibleFunctions();
   std::vector<FnDecl *> getVisibleCallables();
 
@@ -24,15 +28,22 @@ private:
   ErrorReporter &reporter;
   ModuleRegistry &registry;
 
-  // Scope management
-  struct Scope {
-    std::unordered_map<std::string, TypePtr> variables;
-    std::unordered_map<std::string, FnDecl *> functions;
-    std::unordered_map<std::string, ClassDecl *> classes;
-    Scope *parent = nullptr;
+  // Scope management. Variables, functions and classes live in flat
+  // stacks keyed by interned names that enter and exit together. Each
+  // variable gets a slot, numbered from 0 within its function, which
+  // resolved IdentExprs record for CodeGen. Struct parameters are byRef:
+  // CodeGen passes them as const references, so they cannot be modified.
+  struct Var {
+    TypePtr type;
+    int slot;
+    bool byRef = false;
   };
 
-  Scope *currentScope = nullptr;
+  NameInterner names;
+  ScopeStack<Var> vars;
+  ScopeStack<FnDecl *> functions;
+  ScopeStack<ClassDecl *> classes;
+  int nextSlot = 0;
   FnDecl *currentFunction = nullptr;
   ClassDecl *currentClass = nullptr;
   ModulePtr currentModule = nullptr;
@@ -40,16 +51,21 @@ private:
   // Scope operations
   void enterScope();
   void exitScope();
-  void defineVar(const std::string &name, TypePtr type);
+  void defineVar(const std::string &name, TypePtr type, bool byRef = false);
+  void defineFunction(const std::string &name, FnDecl *fn);
+  void defineClass(const std::string &name, ClassDecl *cls);
+  const Var *findVar(const std::string &name);
   TypePtr lookupVar(const std::string &name);
   FnDecl *lookupFunction(const std::string &name);
   ClassDecl *lookupClass(const std::string &name);
 
-  // NEW: Stdlib function helpers
+  // Stdlib lookups, answered from the StdLib metadata table
   bool isStdLibFunction(const std::string &name);
-  TypePtr getStdLibReturnType(const std::string &name);
+  TypePtr getStdLibReturnType(const std::string &name,
+                              const std::string &modulePath = "");
 
   // Type checking
+  void declareProgram(Program &prog);
   TypePtr checkExpr(ExprPtr expr);
   void checkStmt(StmtPtr stmt);
   void checkFunction(FnDecl &fn);
@@ -61,6 +77,38 @@ private:
   TypePtr commonType(TypePtr a, TypePtr b);
   bool isNumeric(TypePtr type);
   bool isBoolean(TypePtr type);
+  // False for VOID, which stands for a type the checker could not work
+  // out, anywhere inside `type`
+  bool isKnown(TypePtr type);
+
+  // Generics. Bindings map type parameter names to the types they stand
+  // for in one use of a generic function or class; a null type is not yet
+  // inferred.
+  using TypeBindings = std::unordered_map<std::string, TypePtr>;
+  void checkTypeParams(const std::vector<TypeParam> &params);
+  const TypeParam *findTypeParam(const std::string &name);
+  bool satisfies(TypePtr type, const std::string &constraint);
+  bool inferTypeArgs(TypePtr param, TypePtr arg, TypeBindings &bindings,
+                     std::string &conflict);
+  TypePtr substitute(TypePtr type, const TypeBindings &bindings);
+  void checkTypeArgs(const std::string &what,
+                     const std::vector<TypeParam> &params,
+                     const TypeBindings &bindings, const SourceLoc &loc);
+  ClassDecl *classOf(TypePtr type, TypeBindings &bindings);
+  TypePtr checkCall(FnDecl &fn, CallExpr &call, TypeBindings bindings,
+                    const SourceLoc &loc);
+
+  // Structs: plain-data fields, and no changes through read-only
+  // references (struct parameters, `this` outside a `mut fn`)
+  ClassDecl *structOf(TypePtr type);
+  void checkStructFields(ClassDecl &cls);
+  void checkMutable(const ExprPtr &target, const std::string &action,
+                    const SourceLoc &loc);
+
+  // SoA<T>: T's fields as Array columns, plus the container's methods
+  bool isSoA(TypePtr type);
+  void checkSoAType(TypePtr type, const SourceLoc &loc);
+  TypePtr soaMemberType(TypePtr soa, const std::string &member);
 
   // Member access
   bool checkMemberAccess(const std::string &className,
@@ -0,0 +1,317 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "package_registry.hpp"
+
+// Picks one release per package so that every requirement in the graph holds.
+//
+// Packages are decided one at a time, always the one with the fewest
+// releases left in its range, newest (or locked) release first. Each choice
+// adds its dependencies' ranges, which are intersected with what is already
+// required of those packages; an empty intersection or a clash with a chosen
+// release rejects the choice on the spot, before anything below it is
+// explored.
+//
+// A dead end remembers which earlier choices caused it, and the search jumps
+// straight back to the latest of them instead of retrying every choice made
+// in between (conflict-directed backjumping, as in PubGrub). Conflicts in the
+// root requirements therefore fail after a handful of steps, and the message
+// names the requirements that cannot hold together.
+class VersionSolver {
+public:
+    struct Selection {
+        Requirement requirement;
+        Release release;
+    };
+
+    VersionSolver(PackageRegistry& registry, std::map<std::string, PackageVersion> preferred)
+        : registry(registry), preferred(std::move(preferred)) {}
+
+    bool solve(const std::map<std::string, std::string>& dependencies) {
+        for (const auto& [name, spec] : dependencies) {
+            Requirement req;
+            if (!Requirement::parse(name, spec, req, failure)) return false;
+            sources.emplace(name, req);
+            constraints[name].push_back({req.range, req.constraint, ""});
+            registry.prefetch(req);
+        }
+        std::set<std::string> conflict;
+        return search(conflict);
+    }
+
+    const std::map<std::string, Selection>& selections() const { return selected; }
+    const std::string& error() const { return failure; }
+
+private:
+    struct Constraint {
+        VersionRange range;
+        std::string text;  // as written, for messages
+        std::string requiredBy;  // "name version"; empty for project.toml
+    };
+
+    PackageRegistry& registry;
+    std::map<std::string, PackageVersion> preferred;
+    std::map<std::string, Requirement> sources;  // first requirement seen per name
+    std::map<std::string, std::vector<Constraint>> constraints;
+    std::map<std::string, Selection> selected;
+    std::map<std::string, std::vector<Release>> known;
+    std::string failure;
+    bool fatal = false;
+
+    // On failure, `conflict` holds the packages whose choices led there
+    bool search(std::set<std::string>& conflict) {
+        std::string next;
+        std::vector<Release> candidates;
+        bool found = false;
+        for (const auto& [name, list] : constraints) {
+            if (list.empty() || selected.count(name)) continue;
+            std::vector<Release> releases;
+            if (!candidatesFor(name, releases)) return false;
+            if (!found || releases.size() < candidates.size()) {
+                next = name;
+                candidates = std::move(releases);
+                found = true;
+            }
+            if (candidates.empty()) break;
+        }
+        if (!found) return true;
+
+        std::set<std::string> causes = requirers(next);
+        if (candidates.empty()) {
+            failure = "no version of " + next + " satisfies " + describe(next) + available(next);
+            conflict = causes;
+            return false;
+        }
+
+        std::set<std::string> combined = causes;
+        const std::string self = next;
+        for (const Release& release : candidates) {
+            std::map<std::string, std::string> deps;
+            if (!registry.manifest(sources[self], release, deps, failure)) {
+                fatal = true;
+                return false;
+            }
+
+            std::string by = self + " " + release.version.toString();
+            std::vector<std::pair<std::string, Requirement>> added;
+            std::set<std::string> clash;
+            if (!admissible(by, deps, added, clash)) {
+                if (fatal) return false;
+                combined.insert(clash.begin(), clash.end());
+                continue;
+            }
+
+            selected[self] = {sources[self], release};
+            for (const auto& [dep, req] : added) {
+                constraints[dep].push_back({req.range, req.constraint, by});
+                registry.prefetch(sources[dep]);
+            }
+
+            std::set<std::string> below;
+            if (search(below)) return true;
+            if (fatal) return false;
+
+            selected.erase(self);
+            for (const auto& [dep, req] : added) constraints[dep].pop_back();
+
+            // This choice played no part in the failure below, so no other
+            // release of it can fix it either
+            if (!below.count(self)) {
+                conflict = std::move(below);
+                return false;
+            }
+            below.erase(self);
+            combined.insert(below.begin(), below.end());
+        }
+        combined.erase(self);
+        conflict = std::move(combined);
+        return false;
+    }
+
+    // Checks a release's dependencies against the current state. On
+    // rejection, `clash` names the choices responsible.
+    bool admissible(const std::string& by, const std::map<std::string, std::string>& deps,
+                    std::vector<std::pair<std::string, Requirement>>& added,
+                    std::set<std::string>& clash) {
+        for (const auto& [dep, spec] : deps) {
+            Requirement req;
+            std::string error;
+            if (!Requirement::parse(dep, spec, req, error)) {
+                failure = by + ": " + error;
+                return false;
+            }
+            auto source = sources.find(dep);
+            if (source == sources.end()) {
+                sources.emplace(dep, req);
+            } else if (!source->second.sameSource(req)) {
+                printStatus(std::cerr, "\033[1;33m     Warning\033[0m: " + by + " requires " + dep + " from " +
+                            spec + ", using " + source->second.spec);
+            }
+
+            auto chosen = selected.find(dep);
+            if (chosen != selected.end()) {
+                if (!req.range.contains(chosen->second.release.version)) {
+                    failure = by + " requires " + dep + " " + req.constraint + ", but " + dep + " " +
+                              chosen->second.release.version.toString() + " is selected";
+                    clash.insert(dep);
+                    return false;
+                }
+            } else if (intersection(dep).intersect(req.range).empty()) {
+                failure = by + " requires " + dep + " " + req.constraint + ", which conflicts with " + describe(dep);
+                auto others = requirers(dep);
+                clash.insert(others.begin(), others.end());
+                return false;
+            }
+            added.emplace_back(dep, req);
+        }
+        return true;
+    }
+
+    // Releases in the package's current range, preferred one first
+    bool candidatesFor(const std::string& name, std::vector<Release>& out) {
+        VersionRange range = intersection(name);
+        auto cached = known.find(name);
+        if (cached == known.end()) {
+            std::vector<Release> all;
+            if (!registry.releases(sources[name], range, all, failure)) {
+                fatal = true;
+                return false;
+            }
+            cached = known.emplace(name, std::move(all)).first;
+        }
+
+        out.clear();
+        for (const Release& release : cached->second) {
+            if (range.contains(release.version)) out.push_back(release);
+        }
+        auto locked = preferred.find(name);
+        if (locked != preferred.end()) {
+            auto it = std::find_if(out.begin(), out.end(),
+                                   [&](const Release& r) { return r.version == locked->second; });
+            if (it != out.end()) std::rotate(out.begin(), it, it + 1);
+        }
+        return true;
+    }
+
+    VersionRange intersection(const std::string& name) {
+        VersionRange range;
+        for (const auto& c : constraints[name]) range = range.intersect(c.range);
+        return range;
+    }
+
+    std::set<std::string> requirers(const std::string& name) {
+        std::set<std::string> result;
+        for (const auto& c : constraints[name]) {
+            if (!c.requiredBy.empty()) result.insert(c.requiredBy.substr(0, c.requiredBy.find(' ')));
+        }
+        return result;
+    }
+
+    std::string describe(const std::string& name) {
+        std::string text;
+        for (const auto& c : constraints[name]) {
+            if (!text.empty()) text += " and ";
+            text += c.text + " (required by " + (c.requiredBy.empty() ? "project.toml" : c.requiredBy) + ")";
+        }
+        return text;
+    }
+
+    std::string available(const std::string& name) {
+        auto it = known.find(name);
+        if (it == known.end() || it->second.empty()) return "";
+        std::string text = "; available:";
+        for (const auto& release : it->second) text += " " + release.version.toString();
+        return text;
+    }
+};
+
+// Solves the dependency graph, then installs the chosen releases from the
+// global store on up to `jobs` threads
+class DependencyResolver {
+public:
+    struct ResolveResult {
+        std::vector<ResolvedPackage> packages;
+        bool success;
+        std::string error;
+    };
+
+    // Concurrent fetches; MAGOLOR_JOBS overrides the default of 8
+    static size_t defaultJobs() {
+        if (const char* env = std::getenv("MAGOLOR_JOBS")) {
+            int n = std::atoi(env);
+            if (n > 0) return n;
+        }
+        return 8;
+    }
+
+    explicit DependencyResolver(size_t jobs = defaultJobs()) : jobs(std::max<size_t>(jobs, 1)) {}
+
+    // Versions to keep when they still satisfy the requirements, usually the
+    // ones in the lock file
+    void prefer(const std::vector<ResolvedPackage>& locked) {
+        for (const auto& pkg : locked) preferred[pkg.name] = pkg.version;
+    }
+
+    ResolveResult resolveAll(const std::map<std::string, std::string>& dependencies) {
+        ResolveResult result;
+        result.success = true;
+
+        std::cout << "\033[1;32m   Resolving\033[0m dependencies...\n";
+
+        auto& registry = PackageRegistry::instance();
+        registry.setJobs(jobs);
+        VersionSolver solver(registry, preferred);
+        if (!solver.solve(dependencies)) {
+            result.success = false;
+            result.error = solver.error();
+            return result;
+        }
+
+        // Sorted by name, so the lock file does not depend on fetch timing
+        std::vector<VersionSolver::Selection> chosen;
+        for (const auto& [name, selection] : solver.selections()) {
+            chosen.push_back(selection);
+        }
+        result.packages.resize(chosen.size());
+
+        std::atomic<size_t> next{0};
+        std::mutex errorMutex;
+        auto work = [&] {
+            for (size_t i; (i = next++) < chosen.size();) {
+                std::string error;
+                if (!registry.install(chosen[i].requirement, chosen[i].release, result.packages[i], error)) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (result.success) {
+                        result.success = false;
+                        result.error = error;
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::min(jobs, chosen.size()); i++) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        if (!result.success) {
+            result.packages.clear();
+            return result;
+        }
+
+        std::cout << "\033[1;32m    Resolved\033[0m " << result.packages.size() << " packages\n";
+        return result;
+    }
+
+private:
+    size_t jobs;
+    std::map<std::string, PackageVersion> preferred;
+};
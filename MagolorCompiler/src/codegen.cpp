@@ -1,5 +1,7 @@
 #include "codegen.hpp"
+#include "phase_timer.hpp"
 #include "stdlib.hpp"
+#include "stdlib_metadata.hpp"
 #include <unordered_set>
 #include <variant>
 
@@ -54,6 +56,9 @@ std::string CodeGen::typeToString(const TypePtr &type) {
     if (type->className == "Set" && type->genericArgs.size() == 1) {
       return "std::unordered_set<" + typeToString(type->genericArgs[0]) + ">";
     }
+    if (type->className == "SoA" && type->genericArgs.size() == 1) {
+      return "Std::" + result;
+    }
     
     return result;
   }
@@ -70,7 +75,114 @@ std::string CodeGen::typeToString(const TypePtr &type) {
   return "auto";
 }
 
-void CodeGen::genStdLib() { out << StdLibGenerator::generateAll(); }
+// "template <typename T, typename U>", or "" for a non-generic declaration
+std::string CodeGen::templateHeader(const std::vector<TypeParam> &params) const {
+  if (params.empty())
+    return "";
+  std::string header = "template <";
+  for (size_t i = 0; i < params.size(); i++)
+    header += (i > 0 ? ", typename " : "typename ") + params[i].name;
+  return header + ">";
+}
+
+// The TypeChecker enforces constraints at each use; these repeat them for
+// code it does not see
+void CodeGen::genConstraintChecks(const std::vector<TypeParam> &params) {
+  for (const auto &param : params) {
+    for (const auto &constraint : param.constraints) {
+      std::string trait = "mg_" + constraint;
+      trait[3] = std::tolower(trait[3]);
+      emitLine("static_assert(" + trait + "<" + param.name + ">, \"" +
+               param.name + " must be " + constraint + "\");");
+    }
+  }
+}
+
+void CodeGen::genRuntime() {
+  PhaseTimer::Scope timing("stdlib emission");
+  // Generate standard library
+  out << StdLibGenerator::generateAll();
+
+  // Add using declarations for common Std functions
+  out << "// Import Std namespace for convenience\n";
+  out << "using Std::println;\n";
+  out << "using Std::print;\n";
+  out << "using Std::readLine;\n";
+  out << "\n";
+  out << "// Array helper wrappers\n";
+  out << "namespace Array {\n";
+  out << "  template<typename T> std::vector<T> create() { return {}; }\n";
+  out << "}\n";
+  out << "template<typename T> int length(const std::vector<T>& arr) { return Std::Array::length(arr); }\n";
+  out << "template<typename T> void push(std::vector<T>& arr, const T& val) { Std::Array::push(arr, val); }\n";
+  out << "template<typename T> T pop(std::vector<T>& arr) { return Std::Array::pop(arr); }\n";
+  out << "\n";
+  out << "// Map helper wrappers\n";
+  out << "namespace Map {\n";
+  out << "  template<typename K, typename V> std::unordered_map<K,V> create() { return {}; }\n";
+  out << "  template<typename K, typename V> void insert(std::unordered_map<K,V>& m, const K& k, const V& v) { m[k] = v; }\n";
+  out << "  template<typename K, typename V> std::optional<V> get(const std::unordered_map<K,V>& m, const K& k) {\n";
+  out << "    auto it = m.find(k); return it != m.end() ? std::optional<V>(it->second) : std::nullopt;\n";
+  out << "  }\n";
+  out << "  template<typename K, typename V> std::vector<V> values(const std::unordered_map<K,V>& m) {\n";
+  out << "    std::vector<V> r; for(auto& p : m) r.push_back(p.second); return r;\n";
+  out << "  }\n";
+  out << "}\n";
+  out << "\n";
+  out << "// File helper\n";
+  out << "namespace File {\n";
+  out << "  inline bool exists(const std::string& path) {\n";
+  out << "    std::ifstream f(path); return f.good();\n";
+  out << "  }\n";
+  out << "}\n";
+  out << "\n";
+}
+
+// Functions genRuntime declares at global scope. Bare calls to them keep
+// resolving there, whatever the program imports.
+static const std::unordered_set<std::string> RUNTIME_GLOBALS = {
+    "print", "println", "readLine", "length", "push",
+    "pop",   "isSome",  "isNone",   "unwrap", "unwrapOr"};
+
+// The qualified C++ name for a bare call to `name`, or "" to emit it as
+// written. Functions of imported Std modules win over the prelude; a name
+// that several imported modules define is left for the C++ compiler.
+std::string CodeGen::stdlibCallee(const IdentExpr &callee) const {
+  const std::string &name = callee.name;
+  if (callee.slot >= 0 || RUNTIME_GLOBALS.count(name) ||
+      programNames.count(name) || localNames.count(name))
+    return "";
+
+  std::string found;
+  for (const auto &entry : StdLib::named(name)) {
+    if (entry.kind != StdLibEntry::Kind::Function)
+      continue;
+    for (const auto &path : stdImports) {
+      if (!StdLib::importedBy(entry, path))
+        continue;
+      if (!found.empty() && found != entry.cppName())
+        return "";
+      found = entry.cppName();
+    }
+  }
+  if (!found.empty())
+    return found;
+
+  for (const auto &entry : StdLib::named(name)) {
+    if (entry.kind == StdLibEntry::Kind::Function && entry.module.empty())
+      return entry.cppName();
+  }
+  return "";
+}
+
+// Whether a bare call means one of the program's global functions. Those
+// are emitted as ::name, so argument-dependent lookup cannot also find
+// std::max and the like through a std::string argument.
+bool CodeGen::isProgramFunction(const IdentExpr &callee) const {
+  return callee.slot < 0 && programFunctions.count(callee.name) > 0 &&
+         localNames.count(callee.name) == 0 &&
+         memberNames.count(callee.name) == 0;
+}
 
 void CodeGen::genCImports(const std::vector<CImportDecl> &cimports) {
   if (cimports.empty())
@@ -128,64 +240,153 @@ void CodeGen::genCImports(const std::vector<CImportDecl> &cimports) {
   out << "\n";
 }
 
+void CodeGen::genTestMain(const std::vector<FnDecl> &functions) {
+  // Each test runs in its own process, so a crash or exit() fails only that
+  // test and the runner can time it out
+  emitLine("int main(int argc, char **argv) {");
+  indent++;
+  emitLine("static const std::vector<std::pair<std::string, void (*)()>> "
+           "tests = {");
+  indent++;
+  for (const auto &fn : functions) {
+    if (fn.isTest)
+      emitLine("{\"" + fn.name + "\", &" + fn.name + "},");
+  }
+  indent--;
+  emitLine("};");
+  emitLine("std::string wanted = argc > 1 ? argv[1] : \"--list\";");
+  emitLine("if (wanted == \"--list\") {");
+  emitLine("  for (const auto &test : tests)");
+  emitLine("    std::cout << test.first << \"\\n\";");
+  emitLine("  return 0;");
+  emitLine("}");
+  emitLine("for (const auto &test : tests) {");
+  emitLine("  if (test.first != wanted)");
+  emitLine("    continue;");
+  emitLine("  try {");
+  emitLine("    test.second();");
+  emitLine("  } catch (const std::exception &e) {");
+  emitLine("    std::cerr << e.what() << \"\\n\";");
+  emitLine("    return 101;");
+  emitLine("  }");
+  emitLine("  return 0;");
+  emitLine("}");
+  emitLine("std::cerr << \"no test named \" << wanted << \"\\n\";");
+  emitLine("return 2;");
+  indent--;
+  emitLine("}");
+}
+
+void CodeGen::genBenchMain(const std::vector<FnDecl> &functions) {
+  // Calibration, statistics and reporting live in the runtime
+  emitLine("int main(int argc, char **argv) {");
+  indent++;
+  emitLine("static const std::vector<std::pair<std::string, void (*)()>> "
+           "benches = {");
+  indent++;
+  for (const auto &fn : functions) {
+    if (fn.isBench)
+      emitLine("{\"" + fn.name + "\", &" + fn.name + "},");
+  }
+  indent--;
+  emitLine("};");
+  emitLine("return Std::BenchRunner::main(argc, argv, benches);");
+  indent--;
+  emitLine("}");
+}
+
 bool CodeGen::isClassName(const std::string &name) const {
   return knownClassNames.count(name) > 0;
 }
 
-std::string CodeGen::generate(const Program &prog) {
+bool CodeGen::isStructType(const TypePtr &type) const {
+  return type && (type->kind == Type::CLASS || type->kind == Type::GENERIC) &&
+         knownStructNames.count(type->className) > 0;
+}
+
+std::string CodeGen::paramDecl(const Param &param) {
+  if (isStructType(param.type))
+    return "const " + typeToString(param.type) + "& " + param.name;
+  return typeToString(param.type) + " " + param.name;
+}
+
+std::string CodeGen::runtimePrelude() {
+  CodeGen gen;
+  gen.genRuntime();
+  return gen.out.str();
+}
+
+std::string CodeGen::generate(const Program &prog,
+                              const std::string &runtimeHeader,
+                              Harness harness) {
+  PhaseTimer::Scope timing("codegen");
   out.str("");
   out.clear();
   importedNamespaces.clear();
   knownClassNames.clear();
+  knownStructNames.clear();
+  soaStructs.clear();
+  stdImports.clear();
+  programNames.clear();
+  programFunctions.clear();
+  memberNames.clear();
 
   // Collect all class names first
   for (const auto &cls : prog.classes) {
     knownClassNames.insert(cls.name);
+    programNames.insert(cls.name);
+    if (cls.isStruct)
+      knownStructNames.insert(cls.name);
+  }
+  for (const auto &fn : prog.functions) {
+    programNames.insert(fn.name);
+    programFunctions.insert(fn.name);
   }
 
-  // Generate C/C++ imports first
-  genCImports(prog.cimports);
-
-  // Generate standard library
-  genStdLib();
+  for (const auto &cls : prog.classes) {
+    for (const auto &f : cls.fields) {
+      noteSoAUses(f.type);
+      if (f.initValue)
+        noteSoAUses(f.initValue);
+    }
+    for (const auto &m : cls.methods) {
+      for (const auto &p : m.params)
+        noteSoAUses(p.type);
+      noteSoAUses(m.returnType);
+      noteSoAUses(m.body);
+    }
+  }
+  for (const auto &fn : prog.functions) {
+    for (const auto &p : fn.params)
+      noteSoAUses(p.type);
+    noteSoAUses(fn.returnType);
+    noteSoAUses(fn.body);
+  }
+  for (const auto &imp : prog.cimports)
+    programNames.insert(imp.symbols.begin(), imp.symbols.end());
+  for (const auto &decl : prog.usings) {
+    std::string path;
+    for (const auto &part : decl.path)
+      path += (path.empty() ? "" : ".") + part;
+    if (path != "Std" && StdLib::isModule(path))
+      stdImports.push_back(path);
+  }
 
-  // Add using declarations for common Std functions
-  out << "// Import Std namespace for convenience\n";
-  out << "using Std::println;\n";
-  out << "using Std::print;\n";
-  out << "using Std::readLine;\n";
-  out << "\n";
-  out << "// Array helper wrappers\n";
-  out << "namespace Array {\n";
-  out << "  template<typename T> std::vector<T> create() { return {}; }\n";
-  out << "}\n";
-  out << "template<typename T> int length(const std::vector<T>& arr) { return Std::Array::length(arr); }\n";
-  out << "template<typename T> void push(std::vector<T>& arr, const T& val) { Std::Array::push(arr, val); }\n";
-  out << "template<typename T> T pop(std::vector<T>& arr) { return Std::Array::pop(arr); }\n";
-  out << "\n";
-  out << "// Map helper wrappers\n";
-  out << "namespace Map {\n";
-  out << "  template<typename K, typename V> std::unordered_map<K,V> create() { return {}; }\n";
-  out << "  template<typename K, typename V> void insert(std::unordered_map<K,V>& m, const K& k, const V& v) { m[k] = v; }\n";
-  out << "  template<typename K, typename V> std::optional<V> get(const std::unordered_map<K,V>& m, const K& k) {\n";
-  out << "    auto it = m.find(k); return it != m.end() ? std::optional<V>(it->second) : std::nullopt;\n";
-  out << "  }\n";
-  out << "  template<typename K, typename V> std::vector<V> values(const std::unordered_map<K,V>& m) {\n";
-  out << "    std::vector<V> r; for(auto& p : m) r.push_back(p.second); return r;\n";
-  out << "  }\n";
-  out << "}\n";
-  out << "\n";
-  out << "// File helper\n";
-  out << "namespace File {\n";
-  out << "  inline bool exists(const std::string& path) {\n";
-  out << "    std::ifstream f(path); return f.good();\n";
-  out << "  }\n";
-  out << "}\n";
-  out << "\n";
+  if (runtimeHeader.empty()) {
+    // Generate C/C++ imports first
+    genCImports(prog.cimports);
+    genRuntime();
+  } else {
+    // A precompiled header is only used if nothing comes before it
+    out << "#include \"" << runtimeHeader << "\"\n\n";
+    genCImports(prog.cimports);
+  }
 
   // Forward declarations for classes
   for (const auto &cls : prog.classes) {
-    emitLine("class " + cls.name + ";");
+    if (!cls.typeParams.empty())
+      emitLine(templateHeader(cls.typeParams));
+    emitLine((cls.isStruct ? "struct " : "class ") + cls.name + ";");
   }
   emitLine("");
 
@@ -194,14 +395,27 @@ std::string CodeGen::generate(const Program &prog) {
     genClass(cls);
   }
 
+  auto included = [&](const FnDecl &fn) {
+    switch (harness) {
+    case Harness::Tests:
+      return fn.name != "main" && !fn.isBench;
+    case Harness::Benches:
+      return fn.name != "main" && !fn.isTest;
+    default:
+      return !fn.isTest && !fn.isBench;
+    }
+  };
+
   // Forward declarations for functions
   for (const auto &fn : prog.functions) {
-    if (fn.name != "main") {
+    if (fn.name != "main" && included(fn)) {
+      if (!fn.typeParams.empty())
+        emitLine(templateHeader(fn.typeParams));
       emit(typeToString(fn.returnType) + " " + fn.name + "(");
       for (size_t i = 0; i < fn.params.size(); i++) {
         if (i > 0)
           emit(", ");
-        emit(typeToString(fn.params[i].type) + " " + fn.params[i].name);
+        emit(paramDecl(fn.params[i]));
       }
       emit(");\n");
     }
@@ -210,15 +424,49 @@ std::string CodeGen::generate(const Program &prog) {
 
   // Generate function definitions
   for (const auto &fn : prog.functions) {
+    if (!included(fn))
+      continue;
+    if (!fn.typeParams.empty())
+      emitLine(templateHeader(fn.typeParams));
     genFunction(fn);
     emitLine("");
   }
 
+  if (harness == Harness::Tests)
+    genTestMain(prog.functions);
+  else if (harness == Harness::Benches)
+    genBenchMain(prog.functions);
+
   return out.str();
 }
 
 void CodeGen::genClass(const ClassDecl &cls) {
+  memberNames.clear();
+  for (const auto &field : cls.fields)
+    memberNames.insert(field.name);
+  for (const auto &method : cls.methods)
+    memberNames.insert(method.name);
+
+  // Stack<T, U> for a generic class
+  std::string selfType = cls.name;
+  if (!cls.typeParams.empty()) {
+    emitLine(templateHeader(cls.typeParams));
+    selfType += "<";
+    for (size_t i = 0; i < cls.typeParams.size(); i++)
+      selfType += (i > 0 ? ", " : "") + cls.typeParams[i].name;
+    selfType += ">";
+  }
+  if (cls.isStruct) {
+    genStructBody(cls);
+    genPrintOperator(cls, selfType);
+    if (soaStructs.count(cls.name) > 0)
+      genSoA(cls, selfType);
+    return;
+  }
   emitLine("class " + cls.name + " {");
+  indent++;
+  genConstraintChecks(cls.typeParams);
+  indent--;
   
   // Separate public and private
   bool hasPublic = false;
@@ -265,6 +513,8 @@ void CodeGen::genClass(const ClassDecl &cls) {
     // Public methods
     for (const auto &m : cls.methods) {
       if (m.isPublic) {
+        if (!m.typeParams.empty())
+          emitLine(templateHeader(m.typeParams));
         if (m.isStatic) {
           emit("    static ");
         }
@@ -290,6 +540,8 @@ void CodeGen::genClass(const ClassDecl &cls) {
     // Private methods
     for (const auto &m : cls.methods) {
       if (!m.isPublic) {
+        if (!m.typeParams.empty())
+          emitLine(templateHeader(m.typeParams));
         genFunction(m, cls.name);
       }
     }
@@ -299,12 +551,259 @@ void CodeGen::genClass(const ClassDecl &cls) {
   
   emitLine("};");  // Close the class definition
   emitLine("");
-  
+  genPrintOperator(cls, selfType);
+}
+
+// Fields stay in declaration order and public, so the C++ layout is the
+// one written, and the struct remains an aggregate for new Vec3(x, y, z)
+void CodeGen::genStructBody(const ClassDecl &cls) {
+  std::string head = "struct ";
+  if (cls.align > 0)
+    head += "alignas(" + std::to_string(cls.align) + ") ";
+  if (cls.packed)
+    head += "__attribute__((packed)) ";
+  emitLine(head + cls.name + " {");
+  indent++;
+  genConstraintChecks(cls.typeParams);
+
+  for (const auto &f : cls.fields) {
+    emitIndent();
+    if (f.isStatic)
+      emit("static constexpr ");
+    emit(typeToString(f.type) + " " + f.name);
+    if (f.initValue) {
+      emit(" = ");
+      genExpr(f.initValue);
+    } else if (!f.isStatic) {
+      emit("{}");
+    }
+    emit(";\n");
+  }
+
+  for (const auto &m : cls.methods) {
+    if (!m.typeParams.empty())
+      emitLine(templateHeader(m.typeParams));
+    if (m.isStatic)
+      emit("    static ");
+    genFunction(m, cls.name);
+  }
+
+  indent--;
+  emitLine("};");
+  emitLine("");
+}
+
+// SoA<Particle>: a column per field of the struct, named like the field, and
+// Ref/ConstRef proxies that act as one Particle spread across the columns.
+// Loops over a single column touch only that field's memory.
+void CodeGen::genSoA(const ClassDecl &cls, const std::string &selfType) {
+  std::vector<const Field *> fields;
+  for (const auto &f : cls.fields) {
+    if (!f.isStatic)
+      fields.push_back(&f);
+  }
+  if (fields.empty())
+    return;
+
+  // "pos, mass", "pos[i], mass[i]" and the like
+  auto list = [&](const std::string &suffix, const std::string &sep = ", ") {
+    std::string s;
+    for (size_t i = 0; i < fields.size(); i++)
+      s += (i > 0 ? sep : "") + fields[i]->name + suffix;
+    return s;
+  };
+  auto column = [&](const Field *f) {
+    return "std::vector<" + typeToString(f->type) + ">";
+  };
+
+  emitLine("namespace Std {");
+  emitLine(cls.typeParams.empty() ? "template <>"
+                                  : templateHeader(cls.typeParams));
+  emitLine("class SoA<" + selfType + "> {");
+  emitLine("public:");
+  indent++;
+  for (const auto *f : fields)
+    emitLine(column(f) + " " + f->name + ";");
+  emitLine("");
+
+  emitLine("struct Ref {");
+  indent++;
+  for (const auto *f : fields)
+    emitLine("typename " + column(f) + "::reference " + f->name + ";");
+  emitLine("operator " + selfType + "() const { return " + selfType + "{" +
+           list("") + "}; }");
+  emitLine("Ref& operator=(const " + selfType + "& value) {");
+  indent++;
+  for (const auto *f : fields)
+    emitLine(f->name + " = value." + f->name + ";");
+  emitLine("return *this;");
+  indent--;
+  emitLine("}");
+  emitLine("Ref& operator=(const Ref& other) { return *this = " + selfType +
+           "(other); }");
+  indent--;
+  emitLine("};");
+  emitLine("struct ConstRef {");
+  indent++;
+  for (const auto *f : fields)
+    emitLine("typename " + column(f) + "::const_reference " + f->name + ";");
+  emitLine("operator " + selfType + "() const { return " + selfType + "{" +
+           list("") + "}; }");
+  indent--;
+  emitLine("};");
+  emitLine("");
+
+  emitLine("int size() const { return static_cast<int>(" + fields[0]->name +
+           ".size()); }");
+  emitLine("void reserve(int n) { " + list(".reserve(n)", "; ") + "; }");
+  emitLine("void clear() { " + list(".clear()", "; ") + "; }");
+  emitLine("void push(const " + selfType + "& value) {");
+  indent++;
+  for (const auto *f : fields)
+    emitLine(f->name + ".push_back(value." + f->name + ");");
+  indent--;
+  emitLine("}");
+  emitLine(selfType + " get(int i) const { return " + selfType + "{" +
+           list("[i]") + "}; }");
+  emitLine("void set(int i, const " + selfType +
+           "& value) { (*this)[i] = value; }");
+  emitLine("Ref operator[](int i) { return Ref{" + list("[i]") + "}; }");
+  emitLine("ConstRef operator[](int i) const { return ConstRef{" +
+           list("[i]") + "}; }");
+  emitLine("SoAIterator<SoA, Ref> begin() { return {this, 0}; }");
+  emitLine("SoAIterator<SoA, Ref> end() { return {this, size()}; }");
+  emitLine("SoAIterator<const SoA, ConstRef> begin() const { return {this, "
+           "0}; }");
+  emitLine("SoAIterator<const SoA, ConstRef> end() const { return {this, "
+           "size()}; }");
+  emitLine("");
+  emitLine("friend std::ostream& operator<<(std::ostream& os, const Ref& r) "
+           "{ return os << " + selfType + "(r); }");
+  emitLine("friend std::ostream& operator<<(std::ostream& os, const "
+           "ConstRef& r) { return os << " + selfType + "(r); }");
+  indent--;
+  emitLine("};");
+  emitLine("} // namespace Std");
+  emitLine("");
+}
+
+void CodeGen::noteSoAUses(const TypePtr &type) {
+  if (!type)
+    return;
+  if (type->kind == Type::GENERIC && type->className == "SoA" &&
+      type->genericArgs.size() == 1 && type->genericArgs[0])
+    soaStructs.insert(type->genericArgs[0]->className);
+  noteSoAUses(type->innerType);
+  noteSoAUses(type->returnType);
+  for (const auto &arg : type->genericArgs)
+    noteSoAUses(arg);
+  for (const auto &param : type->paramTypes)
+    noteSoAUses(param);
+}
+
+TypePtr CodeGen::soaElementType(const ExprPtr &expr) const {
+  if (!expr || !expr->type)
+    return nullptr;
+  auto *index = std::get_if<IndexExpr>(&expr->data);
+  if (!index || !index->object || !index->object->type)
+    return nullptr;
+  const auto &container = index->object->type;
+  if (container->kind == Type::GENERIC && container->className == "SoA" &&
+      container->genericArgs.size() == 1)
+    return expr->type;
+  return nullptr;
+}
+
+void CodeGen::noteSoAUses(const ExprPtr &expr) {
+  if (!expr)
+    return;
+  std::visit(
+      [this](auto &&e) {
+        using T = std::decay_t<decltype(e)>;
+        if constexpr (std::is_same_v<T, BinaryExpr>) {
+          noteSoAUses(e.left);
+          noteSoAUses(e.right);
+        } else if constexpr (std::is_same_v<T, UnaryExpr>) {
+          noteSoAUses(e.operand);
+        } else if constexpr (std::is_same_v<T, CallExpr>) {
+          noteSoAUses(e.callee);
+          for (const auto &arg : e.args)
+            noteSoAUses(arg);
+          for (const auto &type : e.typeArgs)
+            noteSoAUses(type);
+        } else if constexpr (std::is_same_v<T, MemberExpr>) {
+          noteSoAUses(e.object);
+        } else if constexpr (std::is_same_v<T, IndexExpr>) {
+          noteSoAUses(e.object);
+          noteSoAUses(e.index);
+        } else if constexpr (std::is_same_v<T, AssignExpr>) {
+          noteSoAUses(e.target);
+          noteSoAUses(e.value);
+        } else if constexpr (std::is_same_v<T, LambdaExpr>) {
+          for (const auto &p : e.params)
+            noteSoAUses(p.type);
+          noteSoAUses(e.returnType);
+          noteSoAUses(e.body);
+        } else if constexpr (std::is_same_v<T, NewExpr>) {
+          if (e.className == "SoA" && e.typeArgs.size() == 1 && e.typeArgs[0])
+            soaStructs.insert(e.typeArgs[0]->className);
+          for (const auto &arg : e.args)
+            noteSoAUses(arg);
+          for (const auto &type : e.typeArgs)
+            noteSoAUses(type);
+        } else if constexpr (std::is_same_v<T, SomeExpr>) {
+          noteSoAUses(e.value);
+        } else if constexpr (std::is_same_v<T, ArrayExpr>) {
+          for (const auto &element : e.elements)
+            noteSoAUses(element);
+        }
+      },
+      expr->data);
+}
+
+void CodeGen::noteSoAUses(const std::vector<StmtPtr> &stmts) {
+  for (const auto &stmt : stmts) {
+    std::visit(
+        [this](auto &&s) {
+          using T = std::decay_t<decltype(s)>;
+          if constexpr (std::is_same_v<T, LetStmt>) {
+            noteSoAUses(s.type);
+            noteSoAUses(s.init);
+          } else if constexpr (std::is_same_v<T, ReturnStmt>) {
+            noteSoAUses(s.value);
+          } else if constexpr (std::is_same_v<T, ExprStmt>) {
+            noteSoAUses(s.expr);
+          } else if constexpr (std::is_same_v<T, IfStmt>) {
+            noteSoAUses(s.cond);
+            noteSoAUses(s.thenBody);
+            noteSoAUses(s.elseBody);
+          } else if constexpr (std::is_same_v<T, WhileStmt>) {
+            noteSoAUses(s.cond);
+            noteSoAUses(s.body);
+          } else if constexpr (std::is_same_v<T, ForStmt>) {
+            noteSoAUses(s.iterable);
+            noteSoAUses(s.body);
+          } else if constexpr (std::is_same_v<T, MatchStmt>) {
+            noteSoAUses(s.expr);
+            for (const auto &arm : s.arms)
+              noteSoAUses(arm.body);
+          } else if constexpr (std::is_same_v<T, BlockStmt>) {
+            noteSoAUses(s.stmts);
+          }
+        },
+        stmt->data);
+  }
+}
+
+void CodeGen::genPrintOperator(const ClassDecl &cls,
+                               const std::string &selfType) {
   // Auto-generate operator<< for printing (OUTSIDE the class)
   // Only print simple types, skip Map/Array/complex types
   emitLine("// Auto-generated print support");
+  if (!cls.typeParams.empty())
+    emitLine(templateHeader(cls.typeParams));
   emitLine("inline std::ostream& operator<<(std::ostream& os, const " +
-           cls.name + "& obj) {");
+           selfType + "& obj) {");
   indent++;
   emitLine("os << \"" + cls.name + " { \";");
   
@@ -347,6 +846,16 @@ void CodeGen::genClass(const ClassDecl &cls) {
 
 void CodeGen::genFunction(const FnDecl &fn, const std::string &className) {
   std::string retType = typeToString(fn.returnType);
+  // Struct methods only modify the struct when declared `mut fn`
+  std::string qualifier = knownStructNames.count(className) > 0 &&
+                                  !fn.isMut && !fn.isStatic
+                              ? " const"
+                              : "";
+  localNames.clear();
+  for (const auto &param : fn.params)
+    localNames.insert(param.name);
+  if (className.empty())
+    memberNames.clear();
   if (fn.name == "main" && className.empty())
     emitLine("int main() {");
   else if (fn.name == "create" && !className.empty()) {
@@ -356,20 +865,21 @@ void CodeGen::genFunction(const FnDecl &fn, const std::string &className) {
     for (size_t i = 0; i < fn.params.size(); i++) {
       if (i > 0)
         emit(", ");
-      emit(typeToString(fn.params[i].type) + " " + fn.params[i].name);
+      emit(paramDecl(fn.params[i]));
     }
-    emit(") {\n");
+    emit(")" + qualifier + " {\n");
   } else {
     emitIndent();
     emit(retType + " " + fn.name + "(");
     for (size_t i = 0; i < fn.params.size(); i++) {
       if (i > 0)
         emit(", ");
-      emit(typeToString(fn.params[i].type) + " " + fn.params[i].name);
+      emit(paramDecl(fn.params[i]));
     }
-    emit(") {\n");
+    emit(")" + qualifier + " {\n");
   }
   indent++;
+  genConstraintChecks(fn.typeParams);
   for (const auto &stmt : fn.body)
     genStmt(stmt);
   if (fn.name == "main" && className.empty())
@@ -390,8 +900,12 @@ void CodeGen::genStmt(const StmtPtr &stmt) {
       [this](auto &&s) {
         using T = std::decay_t<decltype(s)>;
         if constexpr (std::is_same_v<T, LetStmt>) {
+          localNames.insert(s.name);
           emitIndent();
-          emit((s.type ? typeToString(s.type) : "auto") + " " + s.name + " = ");
+          // An SoA element is a proxy over the columns, so an untyped
+          // binding takes the struct by value rather than keeping the proxy
+          TypePtr bound = s.type ? s.type : soaElementType(s.init);
+          emit((bound ? typeToString(bound) : "auto") + " " + s.name + " = ");
           genExpr(s.init);
           emit(";\n");
         } else if constexpr (std::is_same_v<T, ReturnStmt>) {
@@ -435,8 +949,10 @@ void CodeGen::genStmt(const StmtPtr &stmt) {
           indent--;
           emitLine("}");
         } else if constexpr (std::is_same_v<T, ForStmt>) {
+          localNames.insert(s.var);
           emitIndent();
-          emit("for (auto& " + s.var + " : ");
+          // auto&& also binds the proxies a SoA yields
+          emit("for (auto&& " + s.var + " : ");
           genExpr(s.iterable);
           emit(") {\n");
           indent++;
@@ -461,8 +977,10 @@ void CodeGen::genStmt(const StmtPtr &stmt) {
             if (arm.pattern == "Some") {
               emit("if (_match_val.has_value()) {\n");
               indent++;
-              if (!arm.bindVar.empty())
+              if (!arm.bindVar.empty()) {
+                localNames.insert(arm.bindVar);
                 emitLine("auto " + arm.bindVar + " = _match_val.value();");
+              }
             } else if (arm.pattern == "None") {
               emit("if (!_match_val.has_value()) {\n");
               indent++;
@@ -592,7 +1110,20 @@ void CodeGen::genExpr(const ExprPtr &expr) {
           genExpr(e.operand);
           emit(")");
         } else if constexpr (std::is_same_v<T, CallExpr>) {
-          genExpr(e.callee);
+          std::string qualified;
+          if (auto *ident = std::get_if<IdentExpr>(&e.callee->data))
+            qualified = isProgramFunction(*ident) ? "::" + ident->name
+                                                  : stdlibCallee(*ident);
+          if (qualified.empty())
+            genExpr(e.callee);
+          else
+            emit(qualified);
+          if (!e.typeArgs.empty()) {
+            emit("<");
+            for (size_t i = 0; i < e.typeArgs.size(); i++)
+              emit((i > 0 ? ", " : "") + typeToString(e.typeArgs[i]));
+            emit(">");
+          }
           emit("(");
           for (size_t i = 0; i < e.args.size(); i++) {
             if (i > 0)
@@ -644,15 +1175,14 @@ void CodeGen::genExpr(const ExprPtr &expr) {
             }
           }
 
-          // Regular member access - use -> for pointers, . for values
-          genExpr(e.object);
-
-          // Check if object is 'this' - use -> instead of .
+          // this.x reads the member in place instead of through a copy
           if (std::holds_alternative<ThisExpr>(e.object->data)) {
-            emit("->" + e.member);
-          } else {
-            emit("." + e.member);
+            emit("this->" + e.member);
+            return;
           }
+
+          genExpr(e.object);
+          emit("." + e.member);
         } else if constexpr (std::is_same_v<T, IndexExpr>) {
           genExpr(e.object);
           emit("[");
@@ -665,6 +1195,7 @@ void CodeGen::genExpr(const ExprPtr &expr) {
         } else if constexpr (std::is_same_v<T, LambdaExpr>) {
           emit("[=](");
           for (size_t i = 0; i < e.params.size(); i++) {
+            localNames.insert(e.params[i].name);
             if (i > 0)
               emit(", ");
             emit(paramTypeToString(e.params[i].type) + " " + e.params[i].name);
@@ -680,13 +1211,22 @@ void CodeGen::genExpr(const ExprPtr &expr) {
           emitIndent();
           emit("}");
         } else if constexpr (std::is_same_v<T, NewExpr>) {
-          emit(e.className + "(");
+          emit(e.className == "SoA" ? "Std::SoA" : e.className);
+          if (!e.typeArgs.empty()) {
+            emit("<");
+            for (size_t i = 0; i < e.typeArgs.size(); i++)
+              emit((i > 0 ? ", " : "") + typeToString(e.typeArgs[i]));
+            emit(">");
+          }
+          // Structs are aggregates: the arguments set fields in order
+          bool aggregate = knownStructNames.count(e.className) > 0;
+          emit(aggregate ? "{" : "(");
           for (size_t i = 0; i < e.args.size(); i++) {
             if (i > 0)
               emit(", ");
             genExpr(e.args[i]);
           }
-          emit(")");
+          emit(aggregate ? "}" : ")");
         } else if constexpr (std::is_same_v<T, SomeExpr>) {
           emit("std::make_optional(");
           genExpr(e.value);
@@ -0,0 +1,204 @@
+#include "compile_cache.hpp"
+#include "package_registry.hpp"
+#include "phase_timer.hpp"
+#include "runtime_cache.hpp"
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+namespace {
+
+bool readAll(const std::string &path, std::string &out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  out.assign(std::istreambuf_iterator<char>(file),
+             std::istreambuf_iterator<char>());
+  return true;
+}
+
+// Copies `from` over `to` without writing into `to`, which may be a binary
+// that is still running
+bool replaceWith(const std::string &from, const std::string &to) {
+  std::string tmp = to + ".tmp-" + std::to_string(getpid());
+  std::error_code ec;
+  fs::copy_file(from, tmp, fs::copy_options::overwrite_existing, ec);
+  if (!ec)
+    fs::rename(tmp, to, ec);
+  if (ec) {
+    fs::remove(tmp, ec);
+    return false;
+  }
+  return true;
+}
+
+// Whether the source has an #include "..." other than the precompiled
+// runtime, whose directory is already part of the command
+bool hasLocalIncludes(const std::string &source) {
+  std::istringstream lines(source);
+  std::string line;
+  while (std::getline(lines, line)) {
+    size_t at = line.find_first_not_of(" \t");
+    if (at == std::string::npos || line.compare(at, 8, "#include") != 0)
+      continue;
+    size_t open = line.find_first_not_of(" \t", at + 8);
+    if (open == std::string::npos || line[open] != '"')
+      continue;
+    size_t close = line.find('"', open + 1);
+    if (close == std::string::npos)
+      continue;
+    if (line.compare(open + 1, close - open - 1, RuntimeCache::HEADER) != 0)
+      return true;
+  }
+  return false;
+}
+
+// Appends the name and contents of every header `-MM` lists for the source,
+// nested ones included; system headers are left out. False if the list
+// could not be produced or a header could not be read.
+bool addLocalHeaders(const std::vector<std::string> &command,
+                     const std::string &sourcePath, std::string &inputs) {
+  std::vector<std::string> args = command;
+  args.insert(args.end(), {"-MM", sourcePath});
+  std::string rule;
+  if (!Toolchain::run(args, rule))
+    return false;
+
+  std::istringstream words(rule);
+  std::string word;
+  bool target = true;
+  while (words >> word) {
+    if (target) {
+      target = word.back() != ':';
+      continue;
+    }
+    if (word == "\\" || word == sourcePath)
+      continue;
+    std::string contents;
+    if (!readAll(word, contents))
+      return false;
+    inputs += '\0' + word + '\0' + contents;
+  }
+  return true;
+}
+
+size_t cacheLimit() {
+  if (const char *env = std::getenv("MAGOLOR_CACHE_SIZE")) {
+    long long mb = std::atoll(env);
+    if (mb > 0)
+      return static_cast<size_t>(mb) << 20;
+  }
+  return size_t(1024) << 20;
+}
+
+} // namespace
+
+std::string CompileCache::hash(const std::string &text) {
+  uint64_t hash = 1469598103934665603ull;
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  char key[17];
+  std::snprintf(key, sizeof(key), "%016llx",
+                static_cast<unsigned long long>(hash));
+  return key;
+}
+
+bool CompileCache::compile(const Toolchain &toolchain,
+                           const std::vector<std::string> &command,
+                           const std::string &sourcePath,
+                           const std::string &output, bool useCache,
+                           bool verbose, std::string &diagnostics) {
+  PhaseTimer::Scope timing("c++ compile");
+  std::vector<std::string> args = command;
+  args.insert(args.end(), {"-o", output, sourcePath});
+  std::string source;
+  if (!useCache || !readAll(sourcePath, source))
+    return Toolchain::run(args, diagnostics);
+
+  std::string inputs = toolchain.stamp();
+  for (const auto &arg : args)
+    inputs += '\0' + arg;
+  inputs += '\0' + source;
+  // Headers next to the program can change without the generated code
+  // changing; if they cannot be listed the cache is not used
+  if (hasLocalIncludes(source) && !addLocalHeaders(command, sourcePath, inputs))
+    return Toolchain::run(args, diagnostics);
+
+  std::string root = magolorHome() + "/cache";
+  std::string entry = root + "/" + hash(inputs);
+  std::string stored;
+  std::error_code ec;
+  if (readAll(entry + "/inputs", stored) && stored == inputs &&
+      replaceWith(entry + "/binary", output)) {
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+    diagnostics.clear();
+    if (verbose)
+      std::cout << "    Reused cached build " << fs::path(entry).filename().string()
+                << "\n";
+    return true;
+  }
+
+  if (!Toolchain::run(args, diagnostics))
+    return false;
+
+  // Assembled under a private name, so a concurrent build never sees an
+  // entry without its binary
+  std::string tmp = entry + ".tmp-" + std::to_string(getpid());
+  fs::remove_all(tmp, ec);
+  fs::create_directories(tmp, ec);
+  if (ec)
+    return true;
+  {
+    std::ofstream file(tmp + "/inputs", std::ios::binary);
+    file << inputs;
+  }
+  fs::copy_file(output, tmp + "/binary", ec);
+  if (!ec) {
+    // A different entry under the same hash is replaced
+    fs::remove_all(entry, ec);
+    fs::rename(tmp, entry, ec);
+  }
+  fs::remove_all(tmp, ec);
+  trim(root);
+  return true;
+}
+
+void CompileCache::trim(const std::string &root) {
+  struct Entry {
+    fs::path path;
+    fs::file_time_type used;
+    uintmax_t size;
+  };
+  std::vector<Entry> entries;
+  uintmax_t total = 0;
+  std::error_code ec;
+  for (auto it = fs::directory_iterator(root, ec);
+       !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    if (it->path().filename().string().find(".tmp-") != std::string::npos)
+      continue;
+    std::error_code timeError;
+    Entry entry{it->path(), fs::last_write_time(it->path(), timeError), 0};
+    for (const char *file : {"inputs", "binary"}) {
+      std::error_code sizeError;
+      uintmax_t size = fs::file_size(it->path() / file, sizeError);
+      if (!sizeError)
+        entry.size += size;
+    }
+    total += entry.size;
+    entries.push_back(entry);
+  }
+
+  size_t limit = cacheLimit();
+  if (total <= limit)
+    return;
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.used < b.used; });
+  for (const auto &entry : entries) {
+    if (total <= limit)
+      break;
+    fs::remove_all(entry.path, ec);
+    total -= entry.size;
+  }
+}
@@ -1,12 +1,20 @@
 // src/lsp_completion.cpp
 #include "lsp_completion.hpp"
-#include "stdlib_parser.hpp"
+#include "stdlib_metadata.hpp"
 #include <algorithm>
 #include <set>
-#include "lsp_project.hpp"
-// Cache the parsed stdlib functions (parse once at startup)
-static std::vector<StdLibFunction> g_stdlibFunctions;
-static bool g_stdlibParsed = false;
+
+static CompletionItemKind stdlibItemKind(const StdLibEntry &entry) {
+  switch (entry.kind) {
+  case StdLibEntry::Kind::Constant:
+    return CompletionItemKind::Constant;
+  case StdLibEntry::Kind::Type:
+    return CompletionItemKind::Class;
+  case StdLibEntry::Kind::Function:
+    break;
+  }
+  return CompletionItemKind::Function;
+}
 
 std::vector<CompletionSnippet> CompletionProvider::getBuiltinSnippets() {
   return {
@@ -21,6 +29,10 @@ std::vector<CompletionSnippet> CompletionProvider::getBuiltinSnippets() {
        "class ${1:Name} {\n\tpub ${2:field}: ${3:int};\n\t\n\tpub fn "
        "${4:method}() {\n\t\t${0}\n\t}\n}",
        "Class definition", "Create a class with fields and methods"},
+      {"struct",
+       "struct ${1:Name} {\n\t${2:field}: ${3:float};\n\t${0}\n}",
+       "Struct definition",
+       "Plain value type with fields laid out in declaration order"},
       {"if", "if (${1:condition}) {\n\t${0}\n}", "If statement",
        "Conditional execution"},
       {"ife", "if (${1:condition}) {\n\t${2}\n} else {\n\t${0}\n}",
@@ -56,9 +68,9 @@ std::vector<CompletionSnippet> CompletionProvider::getBuiltinSnippets() {
 
 std::vector<std::string> CompletionProvider::getKeywords() {
   return {"fn",   "let",   "mut",    "return", "if",   "else",   "while",
-          "for",  "match", "class",  "new",    "this", "true",   "false",
-          "None", "Some",  "using",  "pub",    "priv", "static", "cimport",
-          "int",  "float", "string", "bool",   "void"};
+          "for",  "match", "class",  "struct", "new",  "this",   "true",
+          "false", "None", "Some",   "using",  "pub",  "priv",   "static",
+          "cimport", "int", "float", "string", "bool", "void"};
 }
 
 bool CompletionProvider::matchesFilter(const std::string &name,
@@ -106,22 +118,16 @@ void CompletionProvider::addImportedSymbols(JsonValue& items, const std::string&
 }
 
 void CompletionProvider::addModuleCompletions(JsonValue& items, const std::string& uri) {
-    // Get current project
-    auto project = ProjectManager::instance().getProjectForFile(uri);
-    if (!project) {
-        return;
-    }
-    
     // Get all available modules in the project
-    for (const auto& [moduleUri, module] : project->modules) {
+    for (const auto& [name, moduleUri] : analyzer.getProjectModules()) {
         if (moduleUri == uri) continue; // Skip self
         
         JsonValue item = JsonValue::object();
-        item["label"] = module->name;
+        item["label"] = name;
         item["kind"] = (int)CompletionItemKind::Module;
         item["detail"] = "Module";
-        item["insertText"] = module->name;
-        item["sortText"] = "0_" + module->name;
+        item["insertText"] = name;
+        item["sortText"] = "0_" + name;
         items.push(item);
     }
 }
@@ -181,49 +187,23 @@ void CompletionProvider::addVariableSymbols(JsonValue &items,
 void CompletionProvider::addImportedFunctions(JsonValue &items,
                                               const std::string &uri,
                                               const std::string &filter) {
-  if (!g_stdlibParsed) {
-    g_stdlibFunctions = StdLibParser::parseStdLib();
-    g_stdlibParsed = true;
-  }
-
   auto importedModules = analyzer.getImportedModules(uri);
 
   for (const auto &modulePath : importedModules) {
-    std::string module;
-    std::string submodule;
-
-    if (modulePath.find("Std.") == 0) {
-      size_t moduleStart = 4;
-      size_t dotPos = modulePath.find('.', moduleStart);
-
-      if (dotPos != std::string::npos) {
-        module = modulePath.substr(moduleStart, dotPos - moduleStart);
-        submodule = modulePath.substr(dotPos + 1);
-      } else {
-        module = modulePath.substr(moduleStart);
-      }
-    }
-
-    for (const auto &func : g_stdlibFunctions) {
-      if (func.module != module)
-        continue;
-      if (!submodule.empty() && func.submodule != submodule)
+    for (const auto &entry : StdLib::ENTRIES) {
+      if (!StdLib::importedBy(entry, modulePath))
         continue;
-      if (!matchesFilter(func.name, filter))
+      std::string name(entry.name);
+      if (!matchesFilter(name, filter))
         continue;
 
       JsonValue item = JsonValue::object();
-      item["label"] = func.name;
-
-      if (func.isConstant) {
-        item["kind"] = (int)CompletionItemKind::Constant;
-      } else {
-        item["kind"] = (int)CompletionItemKind::Function;
-      }
-
-      item["detail"] = func.signature;
-      item["documentation"] = "From " + modulePath;
-      item["sortText"] = "0_" + func.name;
+      item["label"] = name;
+      item["kind"] = (int)stdlibItemKind(entry);
+      item["detail"] = entry.signature();
+      item["documentation"] =
+          std::string(entry.doc) + "\n\nFrom " + modulePath;
+      item["sortText"] = "0_" + name;
       items.push(item);
     }
   }
@@ -231,11 +211,6 @@ void CompletionProvider::addImportedFunctions(JsonValue &items,
 
 void CompletionProvider::addStdLibCompletions(JsonValue &items,
                                               const std::string &context) {
-  if (!g_stdlibParsed) {
-    g_stdlibFunctions = StdLibParser::parseStdLib();
-    g_stdlibParsed = true;
-  }
-
   std::string currentModule;
   std::string currentSubmodule;
 
@@ -267,8 +242,9 @@ void CompletionProvider::addStdLibCompletions(JsonValue &items,
 
   if (currentModule.empty() && context.find("Std.") != std::string::npos) {
     std::set<std::string> modules;
-    for (const auto &func : g_stdlibFunctions) {
-      modules.insert(func.module);
+    for (const auto &entry : StdLib::ENTRIES) {
+      if (!entry.module.empty())
+        modules.insert(std::string(entry.module));
     }
 
     for (const auto &mod : modules) {
@@ -285,9 +261,9 @@ void CompletionProvider::addStdLibCompletions(JsonValue &items,
   if (!currentModule.empty() && currentSubmodule.empty() &&
       (context.back() == '.' || context.back() == ':')) {
     std::set<std::string> submodules;
-    for (const auto &func : g_stdlibFunctions) {
-      if (func.module == currentModule && !func.submodule.empty()) {
-        submodules.insert(func.submodule);
+    for (const auto &entry : StdLib::ENTRIES) {
+      if (entry.module == currentModule && !entry.submodule.empty()) {
+        submodules.insert(std::string(entry.submodule));
       }
     }
 
@@ -301,35 +277,24 @@ void CompletionProvider::addStdLibCompletions(JsonValue &items,
     }
   }
 
-  for (const auto &func : g_stdlibFunctions) {
+  for (const auto &entry : StdLib::ENTRIES) {
     bool matches = false;
 
     if (!currentSubmodule.empty()) {
-      matches =
-          (func.module == currentModule && func.submodule == currentSubmodule);
+      matches = (entry.module == currentModule &&
+                 entry.submodule == currentSubmodule);
     } else if (!currentModule.empty()) {
-      matches = (func.module == currentModule && func.submodule.empty());
+      matches = (entry.module == currentModule && entry.submodule.empty());
     }
 
     if (matches) {
       JsonValue item = JsonValue::object();
-      item["label"] = func.name;
-
-      if (func.isConstant) {
-        item["kind"] = (int)CompletionItemKind::Constant;
-      } else {
-        item["kind"] = (int)CompletionItemKind::Function;
-      }
-
-      item["detail"] = func.signature;
-
-      std::string fullPath = "Std." + func.module;
-      if (!func.submodule.empty()) {
-        fullPath += "." + func.submodule;
-      }
-      item["documentation"] = "From " + fullPath;
-
-      item["sortText"] = "1_" + func.name;
+      item["label"] = std::string(entry.name);
+      item["kind"] = (int)stdlibItemKind(entry);
+      item["detail"] = entry.signature();
+      item["documentation"] =
+          std::string(entry.doc) + "\n\nFrom " + entry.modulePath();
+      item["sortText"] = "1_" + std::string(entry.name);
       items.push(item);
     }
   }
@@ -0,0 +1,291 @@
+#include "lsp_formatter.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+bool isIndent(char c) { return c == ' ' || c == '\t'; }
+
+// `@cpp` starts a block unless it is followed by an alphanumeric character;
+// the same test as Lexer::tokenize
+bool isCppKeyword(const char *p, const char *end) {
+  return end - p >= 4 && p[1] == 'c' && p[2] == 'p' && p[3] == 'p' &&
+         (end - p == 4 || !std::isalnum(static_cast<unsigned char>(p[4])));
+}
+
+// Length of the common prefix (or suffix) of two buffers, comparing in
+// blocks so an unchanged megabyte-sized document is checked quickly
+size_t commonPrefix(const char *a, const char *b, size_t n) {
+  constexpr size_t block = 4096;
+  size_t i = 0;
+  while (i + block <= n && std::memcmp(a + i, b + i, block) == 0)
+    i += block;
+  while (i < n && a[i] == b[i])
+    i++;
+  return i;
+}
+
+size_t commonSuffix(const char *a, const char *b, size_t n) {
+  constexpr size_t block = 4096;
+  size_t i = 0;
+  while (i + block <= n &&
+         std::memcmp(a - i - block, b - i - block, block) == 0)
+    i += block;
+  while (i < n && a[-1 - static_cast<long>(i)] == b[-1 - static_cast<long>(i)])
+    i++;
+  return i;
+}
+
+TextEdit makeEdit(int line, size_t from, size_t to, std::string text) {
+  TextEdit edit;
+  edit.range.start = {line, static_cast<int>(from)};
+  edit.range.end = {line, static_cast<int>(to)};
+  edit.newText = std::move(text);
+  return edit;
+}
+
+} // namespace
+
+// Advances `s` over one line (without its '\n') and returns how many closing
+// brackets come before anything else on it. String, comment and @cpp rules
+// follow the lexer, so both agree on where a token ends.
+uint16_t Formatter::scanLine(const char *p, const char *end, LineState &s) {
+  uint16_t closers = 0;
+  bool leading = s.mode == Mode::Code;
+
+  while (p < end) {
+    char c = *p;
+    switch (s.mode) {
+    case Mode::Code:
+      if (isIndent(c) || c == '\r') {
+        p++;
+      } else if (c == '/' && p + 1 < end && p[1] == '/') {
+        return closers;
+      } else if (c == '}' || c == ')' || c == ']') {
+        if (leading)
+          closers++;
+        if (s.depth > 0)
+          s.depth--;
+        p++;
+      } else {
+        leading = false;
+        if (c == '{' || c == '(' || c == '[') {
+          s.depth++;
+        } else if (c == '"') {
+          s.mode = Mode::String;
+        } else if (c == '@' && isCppKeyword(p, end)) {
+          s.mode = Mode::CppHeader;
+          p += 3;
+        }
+        p++;
+      }
+      break;
+
+    case Mode::String:
+    case Mode::CppString:
+      if (c == '\\') {
+        p = std::min(p + 2, end);
+      } else {
+        if (c == '"')
+          s.mode = s.mode == Mode::String ? Mode::Code : Mode::Cpp;
+        p++;
+      }
+      break;
+
+    case Mode::CppHeader:
+      // Whitespace, line breaks included, may separate @cpp from its brace.
+      // Anything else is a lexer error, after which lexing resumes as code.
+      if (isIndent(c) || c == '\r') {
+        p++;
+      } else if (c == '{') {
+        s.mode = Mode::Cpp;
+        s.cppDepth = 1;
+        p++;
+      } else {
+        s.mode = Mode::Code;
+      }
+      break;
+
+    case Mode::Cpp:
+      if (c == '/' && p + 1 < end && p[1] == '/')
+        return closers;
+      if (c == '"') {
+        s.mode = Mode::CppString;
+      } else if (c == '/' && p + 1 < end && p[1] == '*') {
+        s.mode = Mode::CppComment;
+        p++;
+      } else if (c == '{') {
+        s.cppDepth++;
+      } else if (c == '}' && --s.cppDepth == 0) {
+        s.mode = Mode::Code;
+      }
+      p++;
+      break;
+
+    case Mode::CppComment:
+      if (c == '*' && p + 1 < end && p[1] == '/') {
+        s.mode = Mode::Cpp;
+        p += 2;
+      } else {
+        p++;
+      }
+      break;
+    }
+  }
+  return closers;
+}
+
+void Formatter::scan(const std::string &content,
+                     const std::vector<size_t> &lineOffsets, Document &doc) {
+  size_t count = lineOffsets.size();
+  const std::string &old = doc.content;
+  bool cached = !doc.lines.empty();
+
+  size_t first = 0;
+  size_t reuseFrom = count + 1;
+  size_t oldCount = cached ? doc.lines.size() - 1 : 0;
+  if (cached) {
+    size_t common = std::min(old.size(), content.size());
+    size_t prefix = commonPrefix(content.data(), old.data(), common);
+    if (prefix == common && old.size() == content.size())
+      return;
+    size_t suffix = commonSuffix(content.data() + content.size(),
+                                 old.data() + old.size(), common - prefix);
+
+    // Line starts before the first change keep their state; so do those
+    // after the last change, once the rescan reaches them in the same state
+    first = std::upper_bound(lineOffsets.begin(), lineOffsets.end(), prefix) -
+            lineOffsets.begin() - 1;
+    reuseFrom = std::lower_bound(lineOffsets.begin(), lineOffsets.end(),
+                                 content.size() - suffix + 1) -
+                lineOffsets.begin();
+  }
+
+  // Rescanned lines are spliced over [first, oldEnd) of the cached states
+  std::vector<LineState> rescanned;
+  LineState state = cached ? doc.lines[first] : LineState();
+  size_t oldEnd = oldCount + 1;
+  for (size_t line = first; line < count; line++) {
+    if (line >= reuseFrom) {
+      size_t oldLine = oldCount - (count - line);
+      if (doc.lines[oldLine].sameEntry(state)) {
+        oldEnd = oldLine;
+        break;
+      }
+    }
+
+    state.closers = 0;
+    rescanned.push_back(state);
+    const char *begin = content.data() + lineOffsets[line];
+    const char *end = line + 1 < count
+                          ? content.data() + lineOffsets[line + 1] - 1
+                          : content.data() + content.size();
+    rescanned.back().closers = scanLine(begin, end, state);
+  }
+  if (oldEnd == oldCount + 1) {
+    state.closers = 0;
+    rescanned.push_back(state);
+  }
+
+  if (!cached) {
+    doc.lines = std::move(rescanned);
+  } else {
+    // Overwrite the common part, then grow or shrink in place
+    size_t replaced = oldEnd - first;
+    size_t overlap = std::min(replaced, rescanned.size());
+    std::copy(rescanned.begin(), rescanned.begin() + overlap,
+              doc.lines.begin() + first);
+    if (rescanned.size() > replaced)
+      doc.lines.insert(doc.lines.begin() + oldEnd,
+                       rescanned.begin() + overlap, rescanned.end());
+    else
+      doc.lines.erase(doc.lines.begin() + first + overlap,
+                      doc.lines.begin() + oldEnd);
+  }
+  doc.content = content;
+}
+
+std::vector<TextEdit> Formatter::format(const std::string &uri,
+                                        const std::string &content,
+                                        const std::vector<size_t> &lineOffsets,
+                                        int firstLine, int lastLine,
+                                        const FormatOptions &options) {
+  std::vector<TextEdit> edits;
+  if (lineOffsets.empty())
+    return edits;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Document &doc = documents[uri];
+  scan(content, lineOffsets, doc);
+
+  int lineCount = static_cast<int>(lineOffsets.size());
+  bool whole = lastLine < 0;
+  if (whole) {
+    firstLine = 0;
+    lastLine = lineCount - 1;
+  }
+  firstLine = std::clamp(firstLine, 0, lineCount - 1);
+  lastLine = std::clamp(lastLine, firstLine, lineCount - 1);
+  int tabSize = options.tabSize > 0 ? options.tabSize : 4;
+  std::string indent;
+
+  for (int line = firstLine; line <= lastLine; line++) {
+    const LineState &state = doc.lines[line];
+    if (state.verbatim())
+      continue;
+
+    size_t begin = lineOffsets[line];
+    size_t end = line + 1 < lineCount ? lineOffsets[line + 1] - 1
+                                      : content.size();
+    if (end > begin && content[end - 1] == '\r')
+      end--; // keep CRLF line endings
+
+    size_t indentEnd = begin;
+    while (indentEnd < end && isIndent(content[indentEnd]))
+      indentEnd++;
+
+    if (indentEnd == end) {
+      if (indentEnd > begin)
+        edits.push_back(makeEdit(line, 0, indentEnd - begin, ""));
+      continue;
+    }
+
+    int level = std::max(0, state.depth - state.closers);
+    if (options.insertSpaces)
+      indent.assign(level * tabSize, ' ');
+    else
+      indent.assign(level, '\t');
+    if (content.compare(begin, indentEnd - begin, indent) != 0)
+      edits.push_back(makeEdit(line, 0, indentEnd - begin, indent));
+
+    // Whitespace before a line break inside a string or @cpp block is
+    // part of the token
+    if (!doc.lines[line + 1].verbatim()) {
+      size_t trailing = end;
+      while (trailing > indentEnd && isIndent(content[trailing - 1]))
+        trailing--;
+      if (trailing < end)
+        edits.push_back(makeEdit(line, trailing - begin, end - begin, ""));
+    }
+  }
+
+  if (whole && !content.empty() && content.back() != '\n' &&
+      !doc.lines[lineCount].verbatim()) {
+    size_t column = content.size() - lineOffsets[lineCount - 1];
+    // Fold into a trailing-whitespace deletion ending at the same spot
+    TextEdit *last = edits.empty() ? nullptr : &edits.back();
+    if (last && last->range.end.line == lineCount - 1 &&
+        last->range.end.character == static_cast<int>(column) &&
+        last->newText.empty())
+      last->newText = "\n";
+    else
+      edits.push_back(makeEdit(lineCount - 1, column, column, "\n"));
+  }
+  return edits;
+}
+
+void Formatter::forget(const std::string &uri) {
+  std::lock_guard<std::mutex> lock(mutex);
+  documents.erase(uri);
+}
@@ -0,0 +1,498 @@
+#include "lsp_incremental.hpp"
+#include "lsp_server.hpp"
+#include "module.hpp"
+#include <unordered_set>
+
+struct IncrementalParser::Decl {
+  enum Kind { Import, Class, Function, Other };
+
+  Kind kind = Other;
+  std::string text; // starting column + source from first to last token
+  int line = 0;     // of the first token
+  Program fragment; // holds exactly this declaration
+
+  std::vector<LspDiagnostic> parseDiagnostics;
+  std::vector<LspDiagnostic> checkDiagnostics;
+  bool checked = false;
+
+  // Dependents are re-checked when the signature changes
+  std::string signature;
+  std::vector<std::string> provides;      // the name and any member names
+  std::unordered_set<std::string> uses;   // every name the body mentions
+};
+
+namespace {
+
+// Visits every location and referenced name inside a declaration
+class DeclWalker {
+public:
+  virtual ~DeclWalker() = default;
+
+  void walk(FnDecl &fn) {
+    loc(fn.loc);
+    loc(fn.endLoc);
+    for (auto &p : fn.params) {
+      loc(p.loc);
+      type(p.type);
+    }
+    type(fn.returnType);
+    block(fn.body);
+  }
+
+  void walk(ClassDecl &cls) {
+    loc(cls.loc);
+    loc(cls.endLoc);
+    if (!cls.parent.empty())
+      name(cls.parent);
+    for (auto &f : cls.fields) {
+      loc(f.loc);
+      type(f.type);
+      expr(f.initValue);
+    }
+    for (auto &m : cls.methods)
+      walk(m);
+  }
+
+protected:
+  virtual void loc(SourceLoc &) {}
+  virtual void name(const std::string &) {}
+
+private:
+  void type(const TypePtr &t) {
+    if (!t)
+      return;
+    if (!t->className.empty())
+      name(t->className);
+    type(t->returnType);
+    type(t->innerType);
+    for (auto &p : t->paramTypes)
+      type(p);
+    for (auto &g : t->genericArgs)
+      type(g);
+  }
+
+  void block(std::vector<StmtPtr> &stmts) {
+    for (auto &s : stmts)
+      stmt(s);
+  }
+
+  void stmt(const StmtPtr &s) {
+    if (!s)
+      return;
+    loc(s->loc);
+    std::visit(
+        [&](auto &&st) {
+          using T = std::decay_t<decltype(st)>;
+          if constexpr (std::is_same_v<T, LetStmt>) {
+            loc(st.nameLoc);
+            type(st.type);
+            expr(st.init);
+          } else if constexpr (std::is_same_v<T, ReturnStmt>) {
+            expr(st.value);
+          } else if constexpr (std::is_same_v<T, ExprStmt>) {
+            expr(st.expr);
+          } else if constexpr (std::is_same_v<T, IfStmt>) {
+            loc(st.thenEnd);
+            loc(st.elseEnd);
+            expr(st.cond);
+            block(st.thenBody);
+            block(st.elseBody);
+          } else if constexpr (std::is_same_v<T, WhileStmt>) {
+            loc(st.bodyEnd);
+            expr(st.cond);
+            block(st.body);
+          } else if constexpr (std::is_same_v<T, ForStmt>) {
+            loc(st.varLoc);
+            loc(st.bodyEnd);
+            expr(st.iterable);
+            block(st.body);
+          } else if constexpr (std::is_same_v<T, MatchStmt>) {
+            expr(st.expr);
+            for (auto &arm : st.arms) {
+              loc(arm.bindLoc);
+              loc(arm.bodyEnd);
+              block(arm.body);
+            }
+          } else if constexpr (std::is_same_v<T, BlockStmt>) {
+            block(st.stmts);
+          }
+        },
+        s->data);
+  }
+
+  void expr(const ExprPtr &e) {
+    if (!e)
+      return;
+    loc(e->loc);
+    std::visit(
+        [&](auto &&ex) {
+          using T = std::decay_t<decltype(ex)>;
+          if constexpr (std::is_same_v<T, IdentExpr>) {
+            name(ex.name);
+          } else if constexpr (std::is_same_v<T, BinaryExpr>) {
+            expr(ex.left);
+            expr(ex.right);
+          } else if constexpr (std::is_same_v<T, UnaryExpr>) {
+            expr(ex.operand);
+          } else if constexpr (std::is_same_v<T, CallExpr>) {
+            expr(ex.callee);
+            for (auto &a : ex.args)
+              expr(a);
+          } else if constexpr (std::is_same_v<T, MemberExpr>) {
+            loc(ex.memberLoc);
+            name(ex.member);
+            expr(ex.object);
+          } else if constexpr (std::is_same_v<T, IndexExpr>) {
+            expr(ex.object);
+            expr(ex.index);
+          } else if constexpr (std::is_same_v<T, AssignExpr>) {
+            expr(ex.target);
+            expr(ex.value);
+          } else if constexpr (std::is_same_v<T, LambdaExpr>) {
+            loc(ex.bodyEnd);
+            for (auto &p : ex.params) {
+              loc(p.loc);
+              type(p.type);
+            }
+            type(ex.returnType);
+            block(ex.body);
+          } else if constexpr (std::is_same_v<T, NewExpr>) {
+            name(ex.className);
+            for (auto &a : ex.args)
+              expr(a);
+          } else if constexpr (std::is_same_v<T, SomeExpr>) {
+            expr(ex.value);
+          } else if constexpr (std::is_same_v<T, ArrayExpr>) {
+            for (auto &el : ex.elements)
+              expr(el);
+          }
+        },
+        e->data);
+  }
+};
+
+class LineShifter : public DeclWalker {
+public:
+  explicit LineShifter(int delta) : delta(delta) {}
+
+protected:
+  void loc(SourceLoc &l) override {
+    if (l.line > 0) // 0 means the parser never set it
+      l.line += delta;
+  }
+
+private:
+  int delta;
+};
+
+class NameCollector : public DeclWalker {
+public:
+  std::unordered_set<std::string> names;
+
+protected:
+  void name(const std::string &n) override { names.insert(n); }
+};
+
+std::string typeKey(const TypePtr &t) {
+  if (!t)
+    return "_";
+  std::string key = std::to_string(t->kind) + t->className;
+  for (const TypePtr *sub : {&t->returnType, &t->innerType})
+    key += "(" + typeKey(*sub) + ")";
+  for (const auto &p : t->paramTypes)
+    key += "," + typeKey(p);
+  for (const auto &g : t->genericArgs)
+    key += "<" + typeKey(g);
+  return key;
+}
+
+// Type parameter names with their constraints, which callers are checked
+// against
+std::string typeParamsKey(const std::vector<TypeParam> &params) {
+  std::string key = "<";
+  for (const auto &p : params) {
+    key += p.name;
+    for (const auto &c : p.constraints)
+      key += ":" + c;
+    key += ",";
+  }
+  return key + ">";
+}
+
+std::string fnSignature(const FnDecl &fn) {
+  std::string sig = fn.name + typeParamsKey(fn.typeParams) +
+                    (fn.isPublic ? "+" : "-") + (fn.isStatic ? "s" : "") +
+                    (fn.isMut ? "m" : "") + "(";
+  for (const auto &p : fn.params)
+    sig += typeKey(p.type) + ",";
+  return sig + ")" + typeKey(fn.returnType);
+}
+
+void shiftDiagnostics(std::vector<LspDiagnostic> &diags, int delta) {
+  for (auto &d : diags) {
+    if (d.range.start.line < 0) // reported without a location
+      continue;
+    d.range.start.line += delta;
+    d.range.end.line += delta;
+  }
+}
+
+bool startsDeclaration(TokenType t) {
+  return t == TokenType::USING || t == TokenType::CIMPORT ||
+         t == TokenType::CLASS || t == TokenType::FN || t == TokenType::PUB ||
+         t == TokenType::STATIC;
+}
+
+// Modifiers that belong to the declaration keyword after them, including
+// the contextual 'test' and 'bench' before 'fn'
+bool modifiesDeclaration(const Token &t) {
+  return t.type == TokenType::PUB || t.type == TokenType::STATIC ||
+         (t.type == TokenType::IDENT &&
+          (t.value == "test" || t.value == "bench"));
+}
+
+} // namespace
+
+IncrementalParser::IncrementalParser(std::string uri) : uri(std::move(uri)) {}
+
+IncrementalParser::~IncrementalParser() = default;
+
+// Fill in what the dependency tracking needs from a freshly parsed decl
+void IncrementalParser::describe(Decl &d) {
+  NameCollector names;
+  Program &fragment = d.fragment;
+  if (!fragment.usings.empty() || !fragment.cimports.empty()) {
+    d.kind = Decl::Import;
+  } else if (!fragment.classes.empty()) {
+    const ClassDecl &cls = fragment.classes.front();
+    d.kind = Decl::Class;
+    // Struct-ness changes how parameters of the type may be used
+    d.signature = std::string(cls.isStruct ? "struct " : "class ") +
+                  (cls.packed ? "packed " : "") + "align" +
+                  std::to_string(cls.align) + " " + cls.name +
+                  typeParamsKey(cls.typeParams) + ":" + cls.parent + "{";
+    d.provides.push_back(cls.name);
+    for (const auto &f : cls.fields) {
+      d.signature += f.name + (f.isPublic ? "+" : "-") +
+                     (f.isStatic ? "s" : "") + typeKey(f.type) + ";";
+      d.provides.push_back(f.name);
+    }
+    for (const auto &m : cls.methods) {
+      d.signature += fnSignature(m) + ";";
+      d.provides.push_back(m.name);
+    }
+    names.walk(fragment.classes.front());
+  } else if (!fragment.functions.empty()) {
+    d.kind = Decl::Function;
+    d.signature = fnSignature(fragment.functions.front());
+    d.provides.push_back(fragment.functions.front().name);
+    names.walk(fragment.functions.front());
+  }
+  d.uses = std::move(names.names);
+}
+
+bool IncrementalParser::update(const std::string &content,
+                               const std::function<bool()> &cancelled,
+                               Result &out) {
+  DiagnosticCollector lexDiagnostics(uri, content);
+  Lexer lexer(content, uri, lexDiagnostics);
+  std::vector<Token> tokens = lexer.tokenize();
+  if (lexDiagnostics.hasError()) {
+    out.syntaxDiagnostics = lexDiagnostics.getDiagnostics();
+    return true;
+  }
+  out.lexed = true;
+
+  std::vector<size_t> lineStarts{0};
+  for (size_t i = 0; i < content.size(); i++) {
+    if (content[i] == '\n')
+      lineStarts.push_back(i + 1);
+  }
+  auto offsetOf = [&](const Token &t) {
+    size_t line = std::min<size_t>(t.line - 1, lineStarts.size() - 1);
+    return std::min(lineStarts[line] + t.col - 1, content.size());
+  };
+
+  // Split into top-level declarations: a using/cimport runs to its ';',
+  // anything else to the '}' that closes its body. A declaration keyword
+  // outside any bracket also starts a new one, which keeps an unfinished
+  // signature from swallowing the next function.
+  std::vector<std::pair<size_t, size_t>> spans;
+  size_t last = tokens.size() - 1; // EOF
+  for (size_t i = 0; i < last;) {
+    size_t start = i;
+    bool isImport = tokens[i].type == TokenType::USING ||
+                    tokens[i].type == TokenType::CIMPORT;
+    int braces = 0, parens = 0;
+    for (; i < last; i++) {
+      TokenType t = tokens[i].type;
+      if (i > start && braces == 0 && parens == 0 && startsDeclaration(t) &&
+          !modifiesDeclaration(tokens[i - 1]))
+        break;
+      if (t == TokenType::LPAREN)
+        parens++;
+      else if (t == TokenType::RPAREN && parens > 0)
+        parens--;
+      else if (t == TokenType::LBRACE)
+        braces++;
+      else if (t == TokenType::RBRACE && braces > 0 && --braces == 0) {
+        i++;
+        break;
+      } else if (t == TokenType::SEMICOLON && isImport) {
+        i++;
+        break;
+      }
+    }
+    spans.push_back({start, i});
+  }
+
+  // Previous declarations, keyed by their text and starting column (equal
+  // text at the same column means every token only moved by whole lines)
+  std::unordered_multimap<std::string, DeclPtr> previous;
+  for (auto &d : decls)
+    previous.emplace(d->text, d);
+
+  std::vector<DeclPtr> current;
+  current.reserve(spans.size());
+  for (const auto &[b, e] : spans) {
+    size_t from = offsetOf(tokens[b]);
+    size_t to = offsetOf(tokens[e - 1]) + tokens[e - 1].length;
+    std::string text = std::to_string(tokens[b].col) + ":" +
+                       content.substr(from, std::max(to, from) - from);
+
+    auto reuse = previous.find(text);
+    if (reuse != previous.end()) {
+      DeclPtr d = reuse->second;
+      previous.erase(reuse);
+      int delta = tokens[b].line - d->line;
+      if (delta != 0) {
+        LineShifter shift(delta);
+        for (auto &c : d->fragment.classes)
+          shift.walk(c);
+        for (auto &f : d->fragment.functions)
+          shift.walk(f);
+        shiftDiagnostics(d->parseDiagnostics, delta);
+        shiftDiagnostics(d->checkDiagnostics, delta);
+        d->line = tokens[b].line;
+      }
+      current.push_back(d);
+      continue;
+    }
+
+    if (cancelled())
+      return false;
+
+    auto d = std::make_shared<Decl>();
+    d->text = std::move(text);
+    d->line = tokens[b].line;
+
+    std::vector<Token> slice(tokens.begin() + b, tokens.begin() + e);
+    slice.push_back({TokenType::EOF_TOK, "", tokens[e].line, tokens[e].col, 0});
+    DiagnosticCollector parseDiagnostics(uri, content);
+    Parser parser(std::move(slice), uri, parseDiagnostics);
+    d->fragment = parser.parse();
+    d->parseDiagnostics = parseDiagnostics.getDiagnostics();
+
+    describe(*d);
+    current.push_back(d);
+    out.reparsed++;
+  }
+
+  // Names whose signature changed (or that appeared or went away), and
+  // whether the imports changed, which affects every declaration
+  std::unordered_map<std::string, std::string> before, after;
+  std::string importsBefore, importsAfter;
+  for (auto &d : decls) {
+    if (d->kind == Decl::Import)
+      importsBefore += d->text + "\n";
+    for (auto &n : d->provides)
+      before[n] += d->signature + "|";
+  }
+  for (auto &d : current) {
+    if (d->kind == Decl::Import)
+      importsAfter += d->text + "\n";
+    for (auto &n : d->provides)
+      after[n] += d->signature + "|";
+  }
+  std::unordered_set<std::string> changed;
+  for (auto &[n, sig] : before) {
+    auto it = after.find(n);
+    if (it == after.end() || it->second != sig)
+      changed.insert(n);
+  }
+  for (auto &[n, sig] : after) {
+    if (!before.count(n))
+      changed.insert(n);
+  }
+  bool recheckAll = importsBefore != importsAfter;
+
+  for (auto &d : current) {
+    if (!d->checked)
+      continue;
+    bool affected = recheckAll;
+    for (auto it = d->uses.begin(); !affected && it != d->uses.end(); ++it)
+      affected = changed.count(*it) > 0;
+    if (affected)
+      d->checked = false;
+  }
+  decls = current;
+
+  // Reassemble the program in source order
+  auto module = std::make_shared<Module>();
+  module->name = "current";
+  module->filepath = uri;
+  std::vector<std::pair<DeclPtr, size_t>> toCheck;
+  for (auto &d : decls) {
+    Program &f = d->fragment;
+    module->ast.usings.insert(module->ast.usings.end(), f.usings.begin(),
+                              f.usings.end());
+    module->ast.cimports.insert(module->ast.cimports.end(),
+                                f.cimports.begin(), f.cimports.end());
+    if (!d->checked && d->kind == Decl::Class)
+      toCheck.push_back({d, module->ast.classes.size()});
+    if (!d->checked && d->kind == Decl::Function)
+      toCheck.push_back({d, module->ast.functions.size()});
+    module->ast.classes.insert(module->ast.classes.end(), f.classes.begin(),
+                               f.classes.end());
+    module->ast.functions.insert(module->ast.functions.end(),
+                                 f.functions.begin(), f.functions.end());
+    out.syntaxDiagnostics.insert(out.syntaxDiagnostics.end(),
+                                 d->parseDiagnostics.begin(),
+                                 d->parseDiagnostics.end());
+  }
+  out.declarations = decls.size();
+
+  // Like a full build, type checking waits until the file parses
+  if (out.syntaxDiagnostics.empty()) {
+    // A private registry: the shared one holds the project modules that
+    // request handlers use
+    ModuleRegistry registry;
+    registry.registerModule(module);
+
+    for (auto &[d, index] : toCheck) {
+      if (cancelled()) {
+        out.program = module->ast;
+        return false;
+      }
+      DiagnosticCollector checkDiagnostics(uri, content);
+      TypeChecker checker(checkDiagnostics, registry);
+      if (d->kind == Decl::Class)
+        checker.checkClassInModule(module, module->ast.classes[index]);
+      else
+        checker.checkFunctionInModule(module, module->ast.functions[index]);
+      d->checkDiagnostics = checkDiagnostics.getDiagnostics();
+      d->checked = true;
+      out.rechecked++;
+    }
+
+    for (auto &d : decls) {
+      out.typeDiagnostics.insert(out.typeDiagnostics.end(),
+                                 d->checkDiagnostics.begin(),
+                                 d->checkDiagnostics.end());
+    }
+    out.checked = true;
+  }
+
+  out.program = std::move(module->ast);
+  return true;
+}
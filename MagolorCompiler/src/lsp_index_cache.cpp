@@ -0,0 +1,222 @@
+#include "lsp_index_cache.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+// One record per line, fields separated by tabs:
+//   F uri hash size mtime module      starts a file
+//   I path                            an import of the current file
+//   S name kind type ... nparams ...  a symbol of the current file
+//   R uri sl sc el ec                 a reference to the last symbol
+static const char *INDEX_HEADER = "magolor-index 1";
+
+namespace {
+
+std::string escape(const std::string &s) {
+  std::string out;
+  out.reserve(s.size());
+  for (char c : s) {
+    switch (c) {
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    default:
+      out += c;
+    }
+  }
+  return out;
+}
+
+std::string unescape(const std::string &s) {
+  std::string out;
+  out.reserve(s.size());
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] != '\\' || i + 1 == s.size()) {
+      out += s[i];
+      continue;
+    }
+    char c = s[++i];
+    out += c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+  }
+  return out;
+}
+
+std::vector<std::string> splitFields(const std::string &line) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (true) {
+    size_t tab = line.find('\t', start);
+    fields.push_back(unescape(line.substr(start, tab - start)));
+    if (tab == std::string::npos)
+      break;
+    start = tab + 1;
+  }
+  return fields;
+}
+
+void writeRange(std::ostream &out, const Range &r) {
+  out << '\t' << r.start.line << '\t' << r.start.character << '\t'
+      << r.end.line << '\t' << r.end.character;
+}
+
+Range readRange(const std::vector<std::string> &f, size_t at) {
+  Range r;
+  r.start.line = std::stoi(f.at(at));
+  r.start.character = std::stoi(f.at(at + 1));
+  r.end.line = std::stoi(f.at(at + 2));
+  r.end.character = std::stoi(f.at(at + 3));
+  return r;
+}
+
+enum SymbolFlags { Public = 1, Static = 2, Callable = 4, Local = 8 };
+
+} // namespace
+
+uint64_t IndexCache::hashContent(const std::string &content) {
+  // FNV-1a: stable across runs and platforms, unlike std::hash
+  uint64_t h = 1469598103934665603ull;
+  for (unsigned char c : content) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+bool IndexCache::load(const std::string &path, std::vector<Entry> &entries) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+
+  std::string line;
+  if (!std::getline(in, line) || line != INDEX_HEADER)
+    return false;
+
+  std::vector<Entry> loaded;
+  SymbolPtr last;
+  try {
+    while (std::getline(in, line)) {
+      if (line.empty())
+        continue;
+      auto f = splitFields(line);
+      const std::string &tag = f[0];
+
+      if (tag == "F") {
+        Entry e;
+        e.uri = f.at(1);
+        e.hash = std::stoull(f.at(2));
+        e.size = std::stoull(f.at(3));
+        e.mtime = std::stoll(f.at(4));
+        e.module = f.at(5);
+        loaded.push_back(std::move(e));
+        last = nullptr;
+      } else if (loaded.empty()) {
+        return false;
+      } else if (tag == "I") {
+        loaded.back().imports.push_back(f.at(1));
+      } else if (tag == "S") {
+        auto sym = std::make_shared<Symbol>();
+        sym->name = f.at(1);
+        sym->kind = static_cast<SymbolKind>(std::stoi(f.at(2)));
+        sym->type = f.at(3);
+        sym->definition.uri = f.at(4);
+        sym->definition.range = readRange(f, 5);
+        sym->documentation = f.at(9);
+        sym->detail = f.at(10);
+        int flags = std::stoi(f.at(11));
+        sym->isPublic = flags & Public;
+        sym->isStatic = flags & Static;
+        sym->isCallable = flags & Callable;
+        sym->isLocal = flags & Local;
+        sym->containerName = f.at(12);
+        sym->returnType = f.at(13);
+        sym->scope = readRange(f, 14);
+        size_t params = std::stoul(f.at(18));
+        for (size_t i = 0; i < params; i++)
+          sym->paramTypes.push_back(f.at(19 + i));
+        loaded.back().symbols.push_back(sym);
+        last = sym;
+      } else if (tag == "R") {
+        if (!last)
+          return false;
+        Location loc;
+        loc.uri = f.at(1);
+        loc.range = readRange(f, 2);
+        last->references.push_back(loc);
+      } else {
+        return false;
+      }
+    }
+  } catch (const std::exception &) {
+    // Truncated or hand-edited: treat as missing and rebuild
+    return false;
+  }
+
+  entries = std::move(loaded);
+  return true;
+}
+
+bool IndexCache::save(const std::string &path,
+                      const std::vector<Entry> &entries) {
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+
+  std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    if (!out)
+      return false;
+
+    out << INDEX_HEADER << '\n';
+    for (const auto &e : entries) {
+      out << "F\t" << escape(e.uri) << '\t' << e.hash << '\t' << e.size
+          << '\t' << e.mtime << '\t' << escape(e.module) << '\n';
+      for (const auto &imp : e.imports)
+        out << "I\t" << escape(imp) << '\n';
+
+      for (const auto &sym : e.symbols) {
+        int flags = (sym->isPublic ? Public : 0) | (sym->isStatic ? Static : 0) |
+                    (sym->isCallable ? Callable : 0) |
+                    (sym->isLocal ? Local : 0);
+        out << "S\t" << escape(sym->name) << '\t'
+            << static_cast<int>(sym->kind) << '\t' << escape(sym->type)
+            << '\t' << escape(sym->definition.uri);
+        writeRange(out, sym->definition.range);
+        out << '\t' << escape(sym->documentation) << '\t'
+            << escape(sym->detail) << '\t' << flags << '\t'
+            << escape(sym->containerName) << '\t' << escape(sym->returnType);
+        writeRange(out, sym->scope);
+        out << '\t' << sym->paramTypes.size();
+        for (const auto &p : sym->paramTypes)
+          out << '\t' << escape(p);
+        out << '\n';
+
+        for (const auto &ref : sym->references) {
+          out << "R\t" << escape(ref.uri);
+          writeRange(out, ref.range);
+          out << '\n';
+        }
+      }
+    }
+
+    if (!out.flush())
+      return false;
+  }
+
+  fs::rename(tmp, path, ec);
+  if (ec) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
@@ -185,7 +185,7 @@ std::vector<std::string> ProjectContext::validateImports(const std::string& uri)
 std::string ProjectManager::findProjectRoot(const std::string& filePath) {
     fs::path current = fs::path(filePath).parent_path();
     
-    while (!current.empty() && current.has_parent_path()) {
+    while (!current.empty() && current != current.parent_path()) {
         if (fs::exists(current / "project.toml")) {
             return current.string();
         }
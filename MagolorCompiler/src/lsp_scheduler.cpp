@@ -0,0 +1,100 @@
+#include "lsp_scheduler.hpp"
+#include "lsp_logger.hpp"
+
+AnalysisScheduler::AnalysisScheduler(Job job, std::chrono::milliseconds debounce)
+    : job(std::move(job)), debounce(debounce) {
+  worker = std::thread([this] { loop(); });
+}
+
+AnalysisScheduler::~AnalysisScheduler() { stop(); }
+
+void AnalysisScheduler::schedule(const std::string &uri, int version,
+                                 const std::string &content) {
+  enqueue(uri, version, content, std::chrono::steady_clock::now() + debounce);
+}
+
+void AnalysisScheduler::scheduleNow(const std::string &uri, int version,
+                                    const std::string &content) {
+  enqueue(uri, version, content, std::chrono::steady_clock::now());
+}
+
+void AnalysisScheduler::enqueue(const std::string &uri, int version,
+                                const std::string &content,
+                                std::chrono::steady_clock::time_point due) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    generations[uri]++;
+    Pending &p = pending[uri];
+    p.version = version;
+    p.content = content;
+    p.due = due;
+  }
+  cv.notify_one();
+}
+
+void AnalysisScheduler::cancel(const std::string &uri) {
+  std::lock_guard<std::mutex> lock(mutex);
+  generations[uri]++;
+  pending.erase(uri);
+}
+
+void AnalysisScheduler::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping)
+      return;
+    stopping = true;
+  }
+  cv.notify_one();
+  if (worker.joinable())
+    worker.join();
+}
+
+bool AnalysisScheduler::isStale(const std::string &uri,
+                                unsigned long generation) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (stopping)
+    return true;
+  auto it = generations.find(uri);
+  return it == generations.end() || it->second != generation;
+}
+
+void AnalysisScheduler::loop() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (!stopping) {
+    if (pending.empty()) {
+      cv.wait(lock);
+      continue;
+    }
+
+    // Pick the document whose debounce expires first
+    auto next = pending.begin();
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+      if (it->second.due < next->second.due)
+        next = it;
+    }
+
+    if (next->second.due > std::chrono::steady_clock::now()) {
+      // Woken early by a new edit or stop(); re-evaluate either way
+      cv.wait_until(lock, next->second.due);
+      continue;
+    }
+
+    std::string uri = next->first;
+    Pending work = std::move(next->second);
+    pending.erase(next);
+    unsigned long generation = generations[uri];
+
+    lock.unlock();
+    try {
+      job(uri, work.version, work.content,
+          [this, &uri, generation] { return isStale(uri, generation); });
+    } catch (const std::exception &e) {
+      logger.log("AnalysisScheduler: job failed - " + std::string(e.what()));
+    } catch (...) {
+      logger.log("AnalysisScheduler: job failed - unknown error");
+    }
+    lock.lock();
+  }
+}
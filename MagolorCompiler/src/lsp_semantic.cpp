@@ -1,10 +1,13 @@
 #include "lsp_semantic.hpp"
 #include "lsp_logger.hpp"
 #include "lsp_project.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "stdlib_metadata.hpp"
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
-#include <regex>
+#include <set>
 #include <sstream>
 // logger is already declared extern in the header
 namespace fs = std::filesystem;
@@ -31,6 +34,15 @@ std::string typeToString(const TypePtr &type) {
     return "Option<" + typeToString(type->innerType) + ">";
   case Type::ARRAY:
     return "Array<" + typeToString(type->innerType) + ">";
+  case Type::GENERIC: {
+    std::string result = type->className + "<";
+    for (size_t i = 0; i < type->genericArgs.size(); i++) {
+      if (i > 0)
+        result += ", ";
+      result += typeToString(type->genericArgs[i]);
+    }
+    return result + ">";
+  }
   case Type::FUNCTION: {
     std::string result = "fn(";
     for (size_t i = 0; i < type->paramTypes.size(); i++) {
@@ -45,9 +57,316 @@ std::string typeToString(const TypePtr &type) {
   return "unknown";
 }
 
+namespace {
+
+Range locToRange(const SourceLoc &loc) {
+  Range range;
+  range.start.line = loc.line - 1; // LSP is 0-based
+  range.start.character = loc.col - 1;
+  range.end.line = loc.line - 1;
+  range.end.character = loc.col - 1 + loc.length;
+  return range;
+}
+
+Position locToPosition(const SourceLoc &loc) {
+  return {loc.line - 1, loc.col - 1};
+}
+
+// Walks a parsed program, creating a Symbol for every declaration and
+// attaching a reference for every identifier that resolves to one. Types
+// come from the annotations or, for inferred lets, from Expr::type as
+// filled in by the TypeChecker.
+class SymbolIndexer {
+public:
+  std::vector<SymbolPtr> symbols;
+  std::unordered_map<std::string, SymbolPtr> topLevel;
+
+  explicit SymbolIndexer(const std::string &uri) : uri(uri) {}
+
+  void index(const Program &prog) {
+    // Declare everything at the top level first so that bodies can refer to
+    // functions and classes defined further down the file
+    for (const auto &cls : prog.classes)
+      declareClass(cls);
+    for (const auto &fn : prog.functions)
+      topLevel[fn.name] = declareFunction(fn, "");
+
+    for (const auto &cls : prog.classes) {
+      currentClass = cls.name;
+      for (const auto &field : cls.fields) {
+        if (field.initValue)
+          walkExpr(field.initValue);
+      }
+      for (const auto &m : cls.methods)
+        walkFunction(m);
+      currentClass.clear();
+    }
+    for (const auto &fn : prog.functions)
+      walkFunction(fn);
+  }
+
+private:
+  std::string uri;
+  std::vector<std::unordered_map<std::string, SymbolPtr>> scopes;
+  std::unordered_map<std::string, std::unordered_map<std::string, SymbolPtr>>
+      members;
+  std::string currentClass;
+
+  SymbolPtr makeSymbol(const std::string &name, SymbolKind kind,
+                       const SourceLoc &loc) {
+    auto sym = std::make_shared<Symbol>();
+    sym->name = name;
+    sym->kind = kind;
+    sym->definition.uri = uri;
+    sym->definition.range = locToRange(loc);
+    symbols.push_back(sym);
+    return sym;
+  }
+
+  void declareClass(const ClassDecl &cls) {
+    auto sym = makeSymbol(cls.name, SymbolKind::Class, cls.loc);
+    sym->type = cls.name;
+    sym->isPublic = cls.isPublic;
+    if (!cls.parent.empty())
+      sym->detail = " : " + cls.parent;
+    topLevel[cls.name] = sym;
+
+    auto &table = members[cls.name];
+    for (const auto &field : cls.fields) {
+      auto f = makeSymbol(field.name, SymbolKind::Field, field.loc);
+      f->type = typeToString(field.type);
+      f->isPublic = field.isPublic;
+      f->isStatic = field.isStatic;
+      f->containerName = cls.name;
+      table[field.name] = f;
+    }
+    for (const auto &m : cls.methods)
+      table[m.name] = declareFunction(m, cls.name);
+  }
+
+  SymbolPtr declareFunction(const FnDecl &fn, const std::string &container) {
+    auto sym = makeSymbol(fn.name, container.empty() ? SymbolKind::Function
+                                                     : SymbolKind::Method,
+                          fn.loc);
+    sym->containerName = container;
+    sym->isPublic = fn.isPublic;
+    sym->isStatic = fn.isStatic;
+    sym->isCallable = true;
+    sym->returnType = typeToString(fn.returnType);
+    sym->type = sym->returnType;
+
+    sym->detail = "(";
+    for (size_t i = 0; i < fn.params.size(); i++) {
+      if (i > 0)
+        sym->detail += ", ";
+      std::string paramType = typeToString(fn.params[i].type);
+      sym->detail += fn.params[i].name + ": " + paramType;
+      sym->paramTypes.push_back(paramType);
+    }
+    sym->detail += ") -> " + sym->returnType;
+    return sym;
+  }
+
+  SymbolPtr declareLocal(const std::string &name, SymbolKind kind,
+                         const SourceLoc &loc, const std::string &type,
+                         const SourceLoc &scopeEnd) {
+    auto sym = makeSymbol(name, kind, loc);
+    sym->type = type;
+    sym->isLocal = true;
+    sym->scope.start = sym->definition.range.start;
+    sym->scope.end = locToPosition(scopeEnd);
+    if (!scopes.empty())
+      scopes.back()[name] = sym;
+    return sym;
+  }
+
+  SymbolPtr lookup(const std::string &name) {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+      auto found = it->find(name);
+      if (found != it->end())
+        return found->second;
+    }
+    if (!currentClass.empty()) {
+      auto &table = members[currentClass];
+      auto found = table.find(name);
+      if (found != table.end())
+        return found->second;
+    }
+    auto found = topLevel.find(name);
+    return found != topLevel.end() ? found->second : nullptr;
+  }
+
+  void addReference(const SymbolPtr &sym, const SourceLoc &loc) {
+    if (!sym || loc.line == 0)
+      return;
+    sym->references.push_back({uri, locToRange(loc)});
+  }
+
+  void walkFunction(const FnDecl &fn) {
+    scopes.emplace_back();
+    for (const auto &p : fn.params)
+      declareLocal(p.name, SymbolKind::Parameter, p.loc,
+                   typeToString(p.type), fn.endLoc);
+    walkBlock(fn.body, fn.endLoc);
+    scopes.pop_back();
+  }
+
+  void walkBlock(const std::vector<StmtPtr> &stmts, const SourceLoc &end) {
+    scopes.emplace_back();
+    for (const auto &stmt : stmts)
+      walkStmt(stmt, end);
+    scopes.pop_back();
+  }
+
+  void walkStmt(const StmtPtr &stmt, const SourceLoc &blockEnd) {
+    if (!stmt)
+      return;
+
+    std::visit(
+        [&](auto &&s) {
+          using T = std::decay_t<decltype(s)>;
+          if constexpr (std::is_same_v<T, LetStmt>) {
+            walkExpr(s.init);
+            std::string type;
+            if (s.type)
+              type = typeToString(s.type);
+            else if (s.init && s.init->type)
+              type = typeToString(s.init->type);
+            declareLocal(s.name, SymbolKind::Variable, s.nameLoc, type,
+                         blockEnd);
+          } else if constexpr (std::is_same_v<T, ReturnStmt>) {
+            walkExpr(s.value);
+          } else if constexpr (std::is_same_v<T, ExprStmt>) {
+            walkExpr(s.expr);
+          } else if constexpr (std::is_same_v<T, IfStmt>) {
+            walkExpr(s.cond);
+            walkBlock(s.thenBody, s.thenEnd);
+            walkBlock(s.elseBody, s.elseEnd);
+          } else if constexpr (std::is_same_v<T, WhileStmt>) {
+            walkExpr(s.cond);
+            walkBlock(s.body, s.bodyEnd);
+          } else if constexpr (std::is_same_v<T, ForStmt>) {
+            walkExpr(s.iterable);
+            std::string type;
+            if (s.iterable && s.iterable->type &&
+                s.iterable->type->kind == Type::ARRAY)
+              type = typeToString(s.iterable->type->innerType);
+            scopes.emplace_back();
+            declareLocal(s.var, SymbolKind::Variable, s.varLoc, type,
+                         s.bodyEnd);
+            walkBlock(s.body, s.bodyEnd);
+            scopes.pop_back();
+          } else if constexpr (std::is_same_v<T, MatchStmt>) {
+            walkExpr(s.expr);
+            for (const auto &arm : s.arms) {
+              scopes.emplace_back();
+              if (!arm.bindVar.empty()) {
+                std::string type;
+                if (s.expr && s.expr->type &&
+                    s.expr->type->kind == Type::OPTION)
+                  type = typeToString(s.expr->type->innerType);
+                declareLocal(arm.bindVar, SymbolKind::Variable, arm.bindLoc,
+                             type, arm.bodyEnd);
+              }
+              walkBlock(arm.body, arm.bodyEnd);
+              scopes.pop_back();
+            }
+          } else if constexpr (std::is_same_v<T, BlockStmt>) {
+            walkBlock(s.stmts, blockEnd);
+          }
+        },
+        stmt->data);
+  }
+
+  void walkExpr(const ExprPtr &expr) {
+    if (!expr)
+      return;
+
+    std::visit(
+        [&](auto &&e) {
+          using T = std::decay_t<decltype(e)>;
+          if constexpr (std::is_same_v<T, IdentExpr>) {
+            addReference(lookup(e.name), expr->loc);
+          } else if constexpr (std::is_same_v<T, BinaryExpr>) {
+            walkExpr(e.left);
+            walkExpr(e.right);
+          } else if constexpr (std::is_same_v<T, UnaryExpr>) {
+            walkExpr(e.operand);
+          } else if constexpr (std::is_same_v<T, CallExpr>) {
+            walkExpr(e.callee);
+            for (const auto &arg : e.args)
+              walkExpr(arg);
+          } else if constexpr (std::is_same_v<T, MemberExpr>) {
+            walkExpr(e.object);
+            addReference(resolveMember(e), e.memberLoc);
+          } else if constexpr (std::is_same_v<T, IndexExpr>) {
+            walkExpr(e.object);
+            walkExpr(e.index);
+          } else if constexpr (std::is_same_v<T, AssignExpr>) {
+            walkExpr(e.target);
+            walkExpr(e.value);
+          } else if constexpr (std::is_same_v<T, LambdaExpr>) {
+            scopes.emplace_back();
+            for (const auto &p : e.params)
+              declareLocal(p.name, SymbolKind::Parameter, p.loc,
+                           typeToString(p.type), e.bodyEnd);
+            walkBlock(e.body, e.bodyEnd);
+            scopes.pop_back();
+          } else if constexpr (std::is_same_v<T, NewExpr>) {
+            for (const auto &arg : e.args)
+              walkExpr(arg);
+          } else if constexpr (std::is_same_v<T, SomeExpr>) {
+            walkExpr(e.value);
+          } else if constexpr (std::is_same_v<T, ArrayExpr>) {
+            for (const auto &el : e.elements)
+              walkExpr(el);
+          }
+        },
+        expr->data);
+  }
+
+  SymbolPtr resolveMember(const MemberExpr &e) {
+    std::string className;
+    if (std::holds_alternative<ThisExpr>(e.object->data)) {
+      className = currentClass;
+    } else if (e.object->type && e.object->type->kind == Type::CLASS) {
+      className = e.object->type->className;
+    } else if (auto *ident = std::get_if<IdentExpr>(&e.object->data)) {
+      // Static access through the class name
+      if (members.count(ident->name) && !lookupLocal(ident->name))
+        className = ident->name;
+    }
+
+    auto cls = members.find(className);
+    if (cls == members.end())
+      return nullptr;
+    auto found = cls->second.find(e.member);
+    return found != cls->second.end() ? found->second : nullptr;
+  }
+
+  SymbolPtr lookupLocal(const std::string &name) {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+      auto found = it->find(name);
+      if (found != it->end())
+        return found->second;
+    }
+    return nullptr;
+  }
+};
+
+} // namespace
+
+SemanticAnalyzer::~SemanticAnalyzer() { stopRefreshThread(); }
+
+std::string SemanticAnalyzer::indexPath() const {
+  return projectRoot + "/.magolor/index";
+}
+
 void SemanticAnalyzer::loadProject(const std::string &startUri) {
-  if (projectLoaded)
+  if (projectLoaded) {
+    applyRefresh();
     return;
+  }
 
   // Find project root by looking for project.toml
   std::string path = startUri;
@@ -56,7 +375,7 @@ void SemanticAnalyzer::loadProject(const std::string &startUri) {
   }
 
   fs::path current = fs::path(path).parent_path();
-  while (!current.empty() && current.has_parent_path()) {
+  while (!current.empty() && current != current.parent_path()) {
     if (fs::exists(current / "project.toml")) {
       projectRoot = current.string();
       break;
@@ -67,182 +386,310 @@ void SemanticAnalyzer::loadProject(const std::string &startUri) {
   if (projectRoot.empty())
     return;
 
-  // Scan src directory
-  std::string srcDir = projectRoot + "/src";
-  if (fs::exists(srcDir)) {
-    scanSourceDirectory(srcDir);
+  std::ifstream toml(projectRoot + "/project.toml");
+  std::string line;
+  while (std::getline(toml, line)) {
+    if (line.find("name =") != std::string::npos) {
+      size_t start = line.find('"') + 1;
+      size_t end = line.rfind('"');
+      projectName = line.substr(start, end - start);
+      break;
+    }
   }
 
+  // Trust the persisted index for now; the refresh below corrects it
+  std::vector<IndexCache::Entry> cached;
+  if (IndexCache::load(indexPath(), cached)) {
+    for (auto &entry : cached) {
+      index.setFileSymbols(entry.uri, entry.symbols);
+      diskIndex[entry.uri] = std::move(entry);
+    }
+    for (const auto &[uri, entry] : diskIndex)
+      installScope(uri, entry.imports);
+    diskIndexReady = true;
+    logger.log("SemanticAnalyzer: loaded " + std::to_string(diskIndex.size()) +
+               " files from " + indexPath());
+  }
+
+  startRefresh();
   projectLoaded = true;
 }
 
-void SemanticAnalyzer::scanSourceDirectory(const std::string &srcDir) {
-  try {
-    for (const auto &entry : fs::recursive_directory_iterator(srcDir)) {
-      if (entry.is_regular_file() && entry.path().extension() == ".mg") {
-        std::string filePath = entry.path().string();
-        std::string uri = "file://" + filePath;
-
-        // Skip if already analyzed
-        if (fileSymbols.find(uri) != fileSymbols.end())
-          continue;
-
-        // Read and analyze
-        std::ifstream file(filePath);
-        if (file) {
+void SemanticAnalyzer::startRefresh() {
+  // Only metadata goes to the worker; symbols stay on this thread
+  struct Known {
+    uint64_t hash;
+    uintmax_t size;
+    int64_t mtime;
+  };
+  std::unordered_map<std::string, Known> known;
+  for (const auto &[uri, entry] : diskIndex)
+    known[uri] = {entry.hash, entry.size, entry.mtime};
+
+  stopRefresh = false;
+  refreshThread = std::thread([this, known = std::move(known),
+                               root = projectRoot, name = projectName] {
+    std::vector<RefreshedFile> refreshed;
+    std::unordered_set<std::string> seen;
+
+    try {
+      fs::path srcDir = fs::path(root) / "src";
+      if (fs::exists(srcDir)) {
+        for (const auto &dirEntry : fs::recursive_directory_iterator(srcDir)) {
+          if (stopRefresh)
+            return;
+          if (!dirEntry.is_regular_file() ||
+              dirEntry.path().extension() != ".mg")
+            continue;
+
+          std::string filePath = dirEntry.path().string();
+          std::string uri = "file://" + filePath;
+          seen.insert(uri);
+
+          std::error_code ec;
+          uintmax_t size = fs::file_size(dirEntry.path(), ec);
+          int64_t mtime =
+              fs::last_write_time(dirEntry.path(), ec).time_since_epoch().count();
+
+          // Unchanged size and mtime: trust the cached entry without reading
+          auto it = known.find(uri);
+          if (it != known.end() && it->second.size == size &&
+              it->second.mtime == mtime)
+            continue;
+
+          std::ifstream file(filePath);
+          if (!file)
+            continue;
           std::stringstream buffer;
           buffer << file.rdbuf();
-          extractSymbols(uri, buffer.str());
+          std::string content = buffer.str();
+
+          RefreshedFile r;
+          r.entry.uri = uri;
+          r.entry.hash = IndexCache::hashContent(content);
+          r.entry.size = size;
+          r.entry.mtime = mtime;
+          r.entry.module = ModuleResolver::filePathToModuleName(
+              fs::relative(filePath, root).string(), name);
+
+          if (it != known.end() && it->second.hash == r.entry.hash) {
+            refreshed.push_back(std::move(r));
+            continue;
+          }
+
+          ErrorReporter reporter(uri, content);
+          Lexer lexer(content, uri, reporter);
+          auto tokens = lexer.tokenize();
+          if (!reporter.hasError()) {
+            Parser parser(std::move(tokens), uri, reporter);
+            Program prog = parser.parse();
+            SymbolIndexer indexer(uri);
+            indexer.index(prog);
+            r.entry.symbols = std::move(indexer.symbols);
+            for (const auto &decl : prog.usings) {
+              std::string importPath;
+              for (size_t i = 0; i < decl.path.size(); i++)
+                importPath += (i > 0 ? "." : "") + decl.path[i];
+              r.entry.imports.push_back(importPath);
+            }
+          }
+          r.reindexed = true;
+          refreshed.push_back(std::move(r));
         }
       }
+    } catch (const std::exception &e) {
+      logger.log("SemanticAnalyzer: index refresh failed - " +
+                 std::string(e.what()));
     }
-  } catch (const std::exception &e) {
-    // Silently ignore filesystem errors
+
+    std::lock_guard<std::mutex> lock(refreshMutex);
+    refreshedFiles = std::move(refreshed);
+    removedFiles.clear();
+    for (const auto &[uri, _] : known) {
+      if (!seen.count(uri))
+        removedFiles.push_back(uri);
+    }
+    refreshReady = true;
+    if (refreshListener)
+      refreshListener();
+  });
+}
+
+void SemanticAnalyzer::setRefreshListener(std::function<void()> listener) {
+  std::lock_guard<std::mutex> lock(refreshMutex);
+  refreshListener = std::move(listener);
+}
+
+void SemanticAnalyzer::applyRefresh() {
+  if (!refreshReady)
+    return;
+  if (refreshThread.joinable())
+    refreshThread.join();
+
+  std::vector<RefreshedFile> refreshed;
+  std::vector<std::string> removed;
+  {
+    std::lock_guard<std::mutex> lock(refreshMutex);
+    refreshed = std::move(refreshedFiles);
+    removed = std::move(removedFiles);
+    refreshReady = false;
+  }
+
+  size_t reindexed = 0;
+  std::vector<std::string> installed;
+  for (auto &r : refreshed) {
+    if (!r.reindexed) {
+      auto &entry = diskIndex[r.entry.uri];
+      entry.size = r.entry.size;
+      entry.mtime = r.entry.mtime;
+      continue;
+    }
+    reindexed++;
+    // An open buffer is newer than the file on disk
+    if (!openFiles.count(r.entry.uri)) {
+      index.setFileSymbols(r.entry.uri, r.entry.symbols);
+      installed.push_back(r.entry.uri);
+    }
+    diskIndex[r.entry.uri] = std::move(r.entry);
   }
+  for (const auto &uri : removed) {
+    diskIndex.erase(uri);
+    if (!openFiles.count(uri)) {
+      index.removeFile(uri);
+      fileScopes.erase(uri);
+    }
+  }
+  // Imports resolve against the index, so scopes go in after all symbols
+  for (const auto &uri : installed)
+    installScope(uri, diskIndex[uri].imports);
+  diskIndexReady = true;
+
+  logger.log("SemanticAnalyzer: index refresh reindexed " +
+             std::to_string(reindexed) + ", removed " +
+             std::to_string(removed.size()) + " of " +
+             std::to_string(diskIndex.size()) + " files");
+
+  if (!refreshed.empty() || !removed.empty()) {
+    std::vector<IndexCache::Entry> entries;
+    entries.reserve(diskIndex.size());
+    for (const auto &[uri, entry] : diskIndex)
+      entries.push_back(entry);
+    if (!IndexCache::save(indexPath(), entries))
+      logger.log("SemanticAnalyzer: could not write " + indexPath());
+  }
+}
+
+void SemanticAnalyzer::stopRefreshThread() {
+  stopRefresh = true;
+  if (refreshThread.joinable())
+    refreshThread.join();
+  refreshReady = false;
+}
+
+void SemanticAnalyzer::installScope(const std::string &uri,
+                                    const std::vector<std::string> &imports) {
+  auto scope = std::make_shared<Scope>();
+  for (const auto &sym : index.getSymbolsInFile(uri)) {
+    if (!sym->isLocal && sym->containerName.empty())
+      scope->symbols[sym->name] = sym;
+  }
+  for (const auto &importPath : imports) {
+    UsingDecl decl;
+    decl.isWildcard = false;
+    size_t start = 0;
+    while (true) {
+      size_t dot = importPath.find('.', start);
+      decl.path.push_back(importPath.substr(start, dot - start));
+      if (dot == std::string::npos)
+        break;
+      start = dot + 1;
+    }
+    scope->imports.push_back(resolveImport(decl));
+  }
+  fileScopes[uri] = scope;
 }
 
 void SemanticAnalyzer::reloadProject() {
+  stopRefreshThread();
   projectLoaded = false;
   projectRoot.clear();
-  fileSymbols.clear();
+  projectName.clear();
+  index.clear();
   fileScopes.clear();
   moduleSymbols.clear();
+  diskIndex.clear();
+  diskIndexReady = false;
+  openFiles.clear();
+}
+
+std::unordered_map<std::string, std::string>
+SemanticAnalyzer::getProjectModules() {
+  std::unordered_map<std::string, std::string> modules;
+  for (const auto &[uri, entry] : diskIndex)
+    modules[entry.module] = uri;
+  return modules;
 }
 
 void SemanticAnalyzer::analyze(const std::string &uri,
                                const std::string &content) {
-  logger.log("SemanticAnalyzer::analyze START for " + uri);
-
   try {
-    // Load entire project on first analyze
-    logger.log("SemanticAnalyzer::analyze: loading project");
-    
-    try {
-      loadProject(uri);
-      logger.log("SemanticAnalyzer::analyze: project loaded");
-    } catch (const std::exception &e) {
-      logger.log("SemanticAnalyzer::analyze: project load failed - " + std::string(e.what()));
-      // Continue anyway - we can still analyze this file
-    } catch (...) {
-      logger.log("SemanticAnalyzer::analyze: project load failed - unknown error");
-      // Continue anyway
-    }
+    loadProject(uri);
+  } catch (const std::exception &e) {
+    logger.log("SemanticAnalyzer::analyze: project load failed - " +
+               std::string(e.what()));
+    // Continue anyway - we can still analyze this file
+  }
 
-    // Then analyze this specific file (updates cache)
-    logger.log("SemanticAnalyzer::analyze: extracting symbols");
-    
-    try {
-      extractSymbols(uri, content);
-      logger.log("SemanticAnalyzer::analyze: symbols extracted");
-    } catch (const std::exception &e) {
-      logger.log("SemanticAnalyzer::analyze: symbol extraction failed - " + std::string(e.what()));
-      // Mark as failed but don't crash
-      fileSymbols[uri] = {};
-      fileScopes[uri] = std::make_shared<Scope>();
-    } catch (...) {
-      logger.log("SemanticAnalyzer::analyze: symbol extraction failed - unknown error");
-      fileSymbols[uri] = {};
-      fileScopes[uri] = std::make_shared<Scope>();
-    }
+  openFiles.insert(uri);
+  try {
+    extractSymbols(uri, content);
+  } catch (const std::exception &e) {
+    logger.log("SemanticAnalyzer::analyze: symbol extraction failed - " +
+               std::string(e.what()));
+  }
+}
 
+void SemanticAnalyzer::analyze(const std::string &uri, const Program &prog) {
+  try {
+    loadProject(uri);
   } catch (const std::exception &e) {
-    logger.log("SemanticAnalyzer::analyze: EXCEPTION - " + std::string(e.what()));
-    // Don't re-throw - LSP must never crash
-  } catch (...) {
-    logger.log("SemanticAnalyzer::analyze: UNKNOWN EXCEPTION");
-    // Don't re-throw
+    logger.log("SemanticAnalyzer::analyze: project load failed - " +
+               std::string(e.what()));
   }
 
-  logger.log("SemanticAnalyzer::analyze END");
+  openFiles.insert(uri);
+  indexProgram(uri, prog);
 }
+
 void SemanticAnalyzer::extractSymbols(const std::string &uri,
                                       const std::string &content) {
-  logger.log("extractSymbols: START for " + uri);
-
-  std::vector<SymbolPtr> symbols;
-  auto scope = std::make_shared<Scope>();
-
-  std::istringstream stream(content);
-  std::string line;
-  int lineNum = 0;
-  std::string currentClass;
-
-  logger.log("extractSymbols: parsing " + std::to_string(content.length()) + " bytes");
-
-  while (std::getline(stream, line)) {
-    lineNum++;
-    
-    // Log EVERY line to find the crash
-    logger.log("extractSymbols: LINE " + std::to_string(lineNum) + ": " + 
-               line.substr(0, std::min((size_t)50, line.size())));
+  // Only declarations are needed here, so the program is parsed but not
+  // type-checked; errors are ignored and whatever parsed is indexed.
+  ErrorReporter reporter(uri, content);
+  Lexer lexer(content, uri, reporter);
+  auto tokens = lexer.tokenize();
+  if (reporter.hasError())
+    return;
 
-    // Trim leading whitespace safely
-    size_t firstNonSpace = line.find_first_not_of(" \t");
-    std::string trimmedLine = (firstNonSpace != std::string::npos) 
-                              ? line.substr(firstNonSpace) 
-                              : "";
+  Parser parser(std::move(tokens), uri, reporter);
+  indexProgram(uri, parser.parse());
+}
 
-    try {
-      if (trimmedLine.find("using ") == 0) {
-        logger.log("extractSymbols: parsing import at line " + std::to_string(lineNum));
-        parseImport(line, scope.get());
-      } 
-      else if (trimmedLine.find("cimport ") == 0) {
-        continue;
-      } 
-      else if (trimmedLine.find("class ") != std::string::npos ||
-               (trimmedLine.find("pub ") == 0 && trimmedLine.find("class ") != std::string::npos)) {
-        logger.log("extractSymbols: parsing class at line " + std::to_string(lineNum));
-        auto sym = parseClass(line, lineNum, uri);
-        if (sym) {
-          sym->isCallable = false;
-          symbols.push_back(sym);
-          scope->define(sym);
-          currentClass = sym->name;
-        }
-      } 
-      else if (trimmedLine.find("fn ") != std::string::npos) {
-        logger.log("extractSymbols: parsing function at line " + std::to_string(lineNum));
-        auto sym = parseFunction(line, lineNum, uri);
-        if (sym) {
-          sym->containerName = currentClass;
-          sym->isCallable = true;
-          sym->kind = currentClass.empty() ? SymbolKind::Function : SymbolKind::Method;
-          symbols.push_back(sym);
-          scope->define(sym);
-        }
-      } 
-      else if (trimmedLine.find("let ") == 0) {
-        logger.log("extractSymbols: parsing variable at line " + std::to_string(lineNum));
-        auto sym = parseVariable(line, lineNum, uri);
-        if (sym) {
-          sym->containerName = currentClass;
-          sym->isCallable = false;
-          symbols.push_back(sym);
-          scope->define(sym);
-        }
-      }
+void SemanticAnalyzer::indexProgram(const std::string &uri,
+                                    const Program &prog) {
+  SymbolIndexer indexer(uri);
+  indexer.index(prog);
 
-      // Check for class closing brace
-      if (!currentClass.empty() && trimmedLine.find('}') != std::string::npos) {
-        // Simple check: if line is just "}" or starts with "}"
-        if (trimmedLine == "}" || trimmedLine[0] == '}') {
-          logger.log("extractSymbols: closing class at line " + std::to_string(lineNum));
-          currentClass = "";
-        }
-      }
-    } catch (const std::exception &e) {
-      logger.log("extractSymbols: EXCEPTION at line " + std::to_string(lineNum) + ": " + e.what());
-    } catch (...) {
-      logger.log("extractSymbols: UNKNOWN EXCEPTION at line " + std::to_string(lineNum));
-    }
-  }
+  auto scope = std::make_shared<Scope>();
+  scope->symbols = std::move(indexer.topLevel);
+  for (const auto &decl : prog.usings)
+    scope->imports.push_back(resolveImport(decl));
 
-  logger.log("extractSymbols: parsed " + std::to_string(symbols.size()) + " symbols");
-  fileSymbols[uri] = symbols;
+  index.setFileSymbols(uri, std::move(indexer.symbols));
   fileScopes[uri] = scope;
-  logger.log("extractSymbols: END");
-}std::vector<SymbolPtr>
+}
+
+std::vector<SymbolPtr>
 SemanticAnalyzer::getSymbolsFromModule(const std::string &modulePath) {
   std::vector<SymbolPtr> symbols;
 
@@ -283,69 +730,10 @@ SemanticAnalyzer::resolveImportedSymbols(const std::string &uri) {
   for (const auto &import : scope->imports) {
     // For each imported symbol name, find the actual symbol in our cache
     for (const auto &symName : import.importedSymbols) {
-      // Search all cached files for this symbol
-      for (const auto &[fileUri, fileSyms] : fileSymbols) {
-        for (const auto &sym : fileSyms) {
-          if (sym->name == symName &&
-              (sym->isPublic || sym->kind == SymbolKind::Function)) {
-            symbols.push_back(sym);
-            break;
-          }
-        }
-      }
-    }
-  }
-
-  // Also check project registry for modules
-  auto project = ProjectManager::instance().getProjectForFile(uri);
-  if (project) {
-    for (const auto &import : scope->imports) {
-      if (ModuleResolver::isBuiltinModule(import.fullPath)) {
-        continue;
-      }
-
-      auto module = project->registry.getModule(import.fullPath);
-      if (!module)
-        continue;
-
-      for (const auto &fn : module->ast.functions) {
-        if (fn.isPublic) {
-          auto sym = std::make_shared<Symbol>();
-          sym->name = fn.name;
-          sym->kind = SymbolKind::Function;
-          sym->isPublic = true;
-          sym->isCallable = true;
-
-          sym->detail = "(";
-          for (size_t i = 0; i < fn.params.size(); i++) {
-            if (i > 0)
-              sym->detail += ", ";
-            sym->detail +=
-                fn.params[i].name + ": " + typeToString(fn.params[i].type);
-          }
-          sym->detail += ") -> " + typeToString(fn.returnType);
-
-          sym->definition.uri = module->filepath;
-          sym->definition.range.start.line = fn.loc.line;
-          sym->definition.range.start.character = fn.loc.col;
-
-          symbols.push_back(sym);
-        }
-      }
-
-      for (const auto &cls : module->ast.classes) {
-        if (cls.isPublic) {
-          auto sym = std::make_shared<Symbol>();
-          sym->name = cls.name;
-          sym->kind = SymbolKind::Class;
-          sym->isPublic = true;
-          sym->isCallable = false;
-
-          sym->definition.uri = module->filepath;
-          sym->definition.range.start.line = cls.loc.line;
-          sym->definition.range.start.character = cls.loc.col;
-
+      for (const auto &sym : index.lookup(symName)) {
+        if (sym->isPublic || sym->kind == SymbolKind::Function) {
           symbols.push_back(sym);
+          break;
         }
       }
     }
@@ -371,233 +759,35 @@ std::vector<SemanticAnalyzer::ImportError>
 SemanticAnalyzer::validateImports(const std::string &uri) {
   std::vector<ImportError> errors;
 
-  auto project = ProjectManager::instance().getProjectForFile(uri);
-  if (!project) {
+  // Until the project has been indexed every module would look missing
+  auto scope = fileScopes.find(uri);
+  if (!diskIndexReady || scope == fileScopes.end()) {
     return errors;
   }
 
-  auto validationErrors = project->validateImports(uri);
-  for (const auto &error : validationErrors) {
-    ImportError ie;
-    ie.message = error;
-    size_t pos = error.find("Cannot find module: ");
-    if (pos != std::string::npos) {
-      ie.modulePath = error.substr(pos + 20);
+  auto modules = getProjectModules();
+  for (const auto &import : scope->second->imports) {
+    if (ModuleResolver::isBuiltinModule(import.fullPath) ||
+        modules.count(import.fullPath)) {
+      continue;
     }
+
+    ImportError ie;
+    ie.modulePath = import.fullPath;
+    ie.message = "Cannot find module: " + import.fullPath;
     errors.push_back(ie);
   }
 
   return errors;
 }
 
-SymbolPtr SemanticAnalyzer::parseFunction(const std::string &line, int lineNum,
-                                          const std::string &uri) {
-  size_t fnPos = line.find("fn ");
-  if (fnPos == std::string::npos)
-    return nullptr;
-
-  size_t nameStart = fnPos + 3;
-  size_t nameEnd = line.find('(', nameStart);
-  if (nameEnd == std::string::npos)
-    return nullptr;
-
-  std::string name = line.substr(nameStart, nameEnd - nameStart);
-  name.erase(0, name.find_first_not_of(" \t"));
-  name.erase(name.find_last_not_of(" \t") + 1);
-
-  if (name.empty())
-    return nullptr;
-
-  auto sym = std::make_shared<Symbol>();
-  sym->name = name;
-  sym->kind = SymbolKind::Function;
-  sym->definition.uri = uri;
-  sym->definition.range.start = {lineNum, (int)nameStart};
-  sym->definition.range.end = {lineNum, (int)nameEnd};
-
-  sym->isPublic = line.find("pub ") != std::string::npos;
-  sym->isStatic = line.find("static ") != std::string::npos;
-
-  return sym;
-}
-
-SymbolPtr SemanticAnalyzer::parseClass(const std::string &line, int lineNum,
-                                       const std::string &uri) {
-  size_t classPos = line.find("class ");
-  if (classPos == std::string::npos)
-    return nullptr;
-
-  size_t nameStart = classPos + 6;
-  size_t nameEnd = line.find_first_of(" {", nameStart);
-  if (nameEnd == std::string::npos)
-    return nullptr;
-
-  std::string name = line.substr(nameStart, nameEnd - nameStart);
-  name.erase(name.find_last_not_of(" \t") + 1);
-
-  auto sym = std::make_shared<Symbol>();
-  sym->name = name;
-  sym->kind = SymbolKind::Class;
-  sym->definition.uri = uri;
-  sym->definition.range.start = {lineNum, (int)nameStart};
-  sym->definition.range.end = {lineNum, (int)nameEnd};
-  sym->isPublic = line.find("pub ") != std::string::npos;
-
-  return sym;
-}
-
-SymbolPtr SemanticAnalyzer::parseVariable(const std::string &line, int lineNum,
-                                          const std::string &uri) {
-   size_t letPos = line.find("let ");
-  if (letPos == std::string::npos)
-    return nullptr;
-
-  size_t nameStart = letPos + 4;
-
-  // Skip 'mut' keyword if present
-  size_t mutPos = line.find("mut ", nameStart);
-  if (mutPos == nameStart) {
-    nameStart += 4;
-  }
-
-  // Skip any leading whitespace after 'let' or 'mut'
-  while (nameStart < line.size() &&
-         (line[nameStart] == ' ' || line[nameStart] == '\t')) {
-    nameStart++;
-  }
-
-  // Find the end of the variable name - it's the first character that's not alphanumeric or underscore
-  size_t nameEnd = nameStart;
-  while (nameEnd < line.size() && 
-         (std::isalnum(line[nameEnd]) || line[nameEnd] == '_')) {
-    nameEnd++;
-  }
-
-  if (nameEnd == nameStart) {
-    logger.log("parseVariable: no variable name found at line " +
-               std::to_string(lineNum));
-    return nullptr;
-  }
-
-  std::string name = line.substr(nameStart, nameEnd - nameStart);
-
-  // Check if name is empty (shouldn't happen after the check above, but be safe)
-  if (name.empty()) {
-    logger.log("parseVariable: empty variable name at line " +
-               std::to_string(lineNum));
-    return nullptr;
-  }
-
-  // Skip whitespace after name
-  while (nameEnd < line.size() && 
-         (line[nameEnd] == ' ' || line[nameEnd] == '\t')) {
-    nameEnd++;
-  }
-
-  // Now we should have either : (type annotation) or = (assignment)
-  if (nameEnd >= line.size() || (line[nameEnd] != ':' && line[nameEnd] != '=')) {
-    logger.log("parseVariable: expected ':' or '=' after variable name at line " +
-               std::to_string(lineNum));
-    return nullptr;
-  }
-
-  // Check for spaces in the name (indicates C++/Java style: "let Type name")
-  // But be more lenient - only reject if there are MULTIPLE words
-  size_t spaceCount = 0;
-  for (char c : name) {
-    if (c == ' ' || c == '\t')
-      spaceCount++;
-  }
-
-  if (spaceCount > 0) {
-    logger.log("parseVariable: invalid variable declaration syntax at line " +
-               std::to_string(lineNum) +
-               " - possible C++/Java style type before name (name='" + name +
-               "')");
-    return nullptr;
-  }
-
-  auto sym = std::make_shared<Symbol>();
-  sym->name = name;
-  sym->kind = SymbolKind::Variable;
-  sym->definition.uri = uri;
-  sym->definition.range.start = {lineNum - 1, (int)nameStart}; // LSP is 0-based
-  sym->definition.range.end = {lineNum - 1, (int)nameEnd};
-
- // Try to extract type
-  try {
-    size_t equalPos = line.find('=', nameEnd);
-    size_t colonPos = line.find(':', nameEnd);
-    
-    // Check if colon comes before equal sign (explicit type annotation)
-    if (colonPos != std::string::npos && 
-        (equalPos == std::string::npos || colonPos < equalPos)) {
-      // Has explicit type annotation
-      size_t typeEnd = equalPos;
-      if (typeEnd == std::string::npos)
-        typeEnd = line.find(';', colonPos);
-      if (typeEnd == std::string::npos)
-        typeEnd = line.size();
-
-      if (colonPos + 1 < typeEnd) {
-        sym->type = line.substr(colonPos + 1, typeEnd - colonPos - 1);
-        sym->type.erase(0, sym->type.find_first_not_of(" \t"));
-        if (!sym->type.empty()) {
-          size_t lastNonSpace = sym->type.find_last_not_of(" \t");
-          if (lastNonSpace != std::string::npos) {
-            sym->type = sym->type.substr(0, lastNonSpace + 1);
-          }
-        }
-      }
-    } else if (equalPos != std::string::npos) {
-      // Try to infer type from initialization
-      size_t newPos = line.find("new ", equalPos);
-      if (newPos != std::string::npos) {
-        size_t classStart = newPos + 4;
-        if (classStart < line.size()) {
-          size_t classEnd = line.find_first_of("( \t;", classStart);
-          if (classEnd == std::string::npos) {
-            classEnd = line.size();
-          }
-          if (classEnd > classStart) {
-            sym->type = line.substr(classStart, classEnd - classStart);
-          }
-        }
-      } else {
-        // Check for ClassName.new() pattern (like SlateDB.new())
-        size_t dotNewPos = line.find(".new(", equalPos);
-        if (dotNewPos != std::string::npos) {
-          size_t classStart = equalPos + 1;
-          while (classStart < dotNewPos && 
-                 (line[classStart] == ' ' || line[classStart] == '\t')) {
-            classStart++;
-          }
-          if (classStart < dotNewPos) {
-            sym->type = line.substr(classStart, dotNewPos - classStart);
-          }
-        }
-      }
-    }
-  } catch (const std::exception &e) {
-    logger.log("parseVariable: exception extracting type - " +
-               std::string(e.what()));
-  } catch (...) {
-    logger.log("parseVariable: unknown exception extracting type");
-  }  logger.log("parseVariable: successfully parsed '" + sym->name + "' type='" +
-             (sym->type.empty() ? "<inferred>" : sym->type) + "'");
-
-  return sym;
-}
 std::vector<SymbolPtr>
 SemanticAnalyzer::getCallableSymbols(const std::string &uri) {
   std::vector<SymbolPtr> result;
 
-  auto it = fileSymbols.find(uri);
-  if (it != fileSymbols.end()) {
-    for (const auto &sym : it->second) {
-      if (sym->isCallable) {
-        result.push_back(sym);
-      }
+  for (const auto &sym : index.getSymbolsInFile(uri)) {
+    if (sym->isCallable) {
+      result.push_back(sym);
     }
   }
 
@@ -608,15 +798,9 @@ std::vector<SymbolPtr>
 SemanticAnalyzer::getVariablesInScope(const std::string &uri, Position pos) {
   std::vector<SymbolPtr> result;
 
-  auto it = fileSymbols.find(uri);
-  if (it != fileSymbols.end()) {
-    for (const auto &sym : it->second) {
-      if (sym->kind == SymbolKind::Variable ||
-          sym->kind == SymbolKind::Parameter) {
-        if (sym->definition.range.start.line <= pos.line) {
-          result.push_back(sym);
-        }
-      }
+  for (const auto &sym : index.getSymbolsInFile(uri)) {
+    if (sym->isLocal && sym->scope.contains(pos)) {
+      result.push_back(sym);
     }
   }
 
@@ -624,122 +808,51 @@ SemanticAnalyzer::getVariablesInScope(const std::string &uri, Position pos) {
 }
 
 SymbolPtr SemanticAnalyzer::getSymbolAt(const std::string &uri, Position pos) {
-  auto it = fileSymbols.find(uri);
-  if (it == fileSymbols.end())
-    return nullptr;
-
-  for (const auto &sym : it->second) {
-    if (sym->definition.uri == uri) {
-      auto &range = sym->definition.range;
-      if (range.start.line == pos.line &&
-          range.start.character <= pos.character &&
-          pos.character <= range.end.character) {
-        return sym;
-      }
-    }
-
-    for (const auto &ref : sym->references) {
-      if (ref.uri == uri) {
-        auto &range = ref.range;
-        if (range.start.line == pos.line &&
-            range.start.character <= pos.character &&
-            pos.character <= range.end.character) {
-          return sym;
-        }
-      }
-    }
-  }
-
-  return nullptr;
+  return index.findAtPosition(uri, pos);
 }
 
 std::vector<SymbolPtr>
 SemanticAnalyzer::getAllSymbolsInFile(const std::string &uri) {
-  auto it = fileSymbols.find(uri);
-  if (it != fileSymbols.end()) {
-    return it->second;
-  }
-  return {};
+  return index.getSymbolsInFile(uri);
 }
 
-void SemanticAnalyzer::parseImport(const std::string &line, Scope *scope) {
-  size_t usingPos = line.find("using ");
-  if (usingPos == std::string::npos)
-    return;
+uint64_t SemanticAnalyzer::getFileGeneration(const std::string &uri) const {
+  return index.fileGeneration(uri);
+}
 
-  size_t start = usingPos + 6;
-  size_t end = line.find(';', start);
-  if (end == std::string::npos)
-    return;
+std::vector<SymbolPtr>
+SemanticAnalyzer::searchWorkspace(const std::string &query, size_t limit) {
+  return index.search(query, limit);
+}
 
-  std::string importPath = line.substr(start, end - start);
-  importPath.erase(0, importPath.find_first_not_of(" \t"));
-  importPath.erase(importPath.find_last_not_of(" \t") + 1);
+std::vector<SymbolPtr>
+SemanticAnalyzer::findSymbolsByPrefix(const std::string &prefix,
+                                      size_t limit) {
+  return index.findByPrefix(prefix, limit);
+}
 
-  size_t doubleColonPos = importPath.find("::");
-  if (doubleColonPos != std::string::npos) {
-    importPath.replace(doubleColonPos, 2, ".");
+ImportedModule SemanticAnalyzer::resolveImport(const UsingDecl &decl) {
+  std::string importPath;
+  for (size_t i = 0; i < decl.path.size(); i++) {
+    if (i > 0)
+      importPath += ".";
+    importPath += decl.path[i];
   }
 
   ImportedModule import;
   import.fullPath = importPath;
 
-  // Map standard library modules to their symbols
-  if (importPath == "Std.IO") {
-    import.importedSymbols = {"print",     "println",   "eprint",   "eprintln",
-                              "readLine",  "read",      "readChar", "readFile",
-                              "writeFile", "appendFile"};
-  } else if (importPath == "Std.Network") {
-    import.importedSymbols = {
-        "HttpServer",       "HttpRequest",  "HttpResponse",
-        "jsonResponse",     "htmlResponse", "textResponse",
-        "redirectResponse", "urlEncode",    "urlDecode",
-        "parseQuery",       "ping",         "getLocalIP",
-        "httpGet",          "Status",       "serveFile"};
-  } else if (importPath == "Std.Math") {
-    import.importedSymbols = {
-        "sqrt",  "sin", "cos", "tan",   "asin",  "acos", "atan",  "atan2",
-        "abs",   "pow", "exp", "log",   "log10", "log2", "floor", "ceil",
-        "round", "min", "max", "clamp", "PI",    "E"};
-  } else if (importPath == "Std.String") {
-    import.importedSymbols = {"length",   "isEmpty",    "trim",     "toLower",
-                              "toUpper",  "startsWith", "endsWith", "contains",
-                              "replace",  "split",      "join",     "repeat",
-                              "substring"};
-  } else if (importPath == "Std.Array") {
-    import.importedSymbols = {"length", "isEmpty",  "push",
-                              "pop",    "contains", "reverse",
-                              "sort",   "indexOf",  "clear"};
-  } else if (importPath == "Std.Parse") {
-    import.importedSymbols = {"parseInt", "parseFloat", "parseBool"};
-  } else if (importPath == "Std.Option") {
-    import.importedSymbols = {"isSome", "isNone", "unwrap", "unwrapOr"};
-  } else if (importPath == "Std.Map") {
-    import.importedSymbols = {"create",   "insert", "get",   "getOr",
-                              "contains", "remove", "size",  "isEmpty",
-                              "clear",    "keys",   "values"};
-  } else if (importPath == "Std.Set") {
-    import.importedSymbols = {"create", "insert",       "contains",  "remove",
-                              "size",   "isEmpty",      "clear",     "toArray",
-                              "union_", "intersection", "difference"};
-  } else if (importPath == "Std.File") {
-    import.importedSymbols = {// Path / FS utilities
-                              "exists", "isFile", "isDirectory", "createDir",
-                              "remove", "removeAll", "copy", "rename", "size",
-
-                              // File I/O functions
-                              "readFile", "writeFile", "appendFile",
-
-                              // Low-level file operations
-                              "Handle", "Mode", "Seek", "open", "close", "read",
-                              "write", "read_bytes", "write_u32", "write_u64",
-                              "seek", "tell", "flush"};
-  } else if (importPath == "Std.Time") {
-    import.importedSymbols = {"now", "sleep", "timestamp"};
-  } else if (importPath == "Std.Random") {
-    import.importedSymbols = {"randInt", "randFloat", "randBool"};
-  } else if (importPath == "Std.System") {
-    import.importedSymbols = {"exit", "getEnv", "execute"};
+  if (StdLib::isModule(importPath)) {
+    // Everything directly in the module, plus the names of its submodules
+    std::set<std::string> names;
+    for (const auto &entry : StdLib::ENTRIES) {
+      if (StdLib::importedBy(entry, importPath))
+        names.insert(std::string(entry.name));
+      else if (importPath == "Std." + std::string(entry.module) &&
+               !entry.submodule.empty())
+        names.insert(std::string(entry.submodule));
+    }
+    import.importedSymbols.assign(names.begin(), names.end());
   } else {
     // User module - search our cached symbols
     std::string modulePath = importPath;
@@ -759,12 +872,14 @@ void SemanticAnalyzer::parseImport(const std::string &line, Scope *scope) {
     std::replace(pathPattern.begin(), pathPattern.end(), '.', '/');
 
     // Search cached files for matching path
-    for (const auto &[uri, symbols] : fileSymbols) {
+    for (const auto &uri : index.files()) {
       // Check if this file matches the import path
       if (uri.find(pathPattern + ".mg") != std::string::npos ||
           uri.find(pathPattern) != std::string::npos) {
         // Found the module - add all public/function symbols
-        for (const auto &sym : symbols) {
+        for (const auto &sym : index.getSymbolsInFile(uri)) {
+          if (sym->isLocal)
+            continue;
           if (sym->isPublic || sym->kind == SymbolKind::Function ||
               sym->kind == SymbolKind::Class) {
             import.importedSymbols.push_back(sym->name);
@@ -775,7 +890,7 @@ void SemanticAnalyzer::parseImport(const std::string &line, Scope *scope) {
     }
   }
 
-  scope->imports.push_back(import);
+  return import;
 }
 
 std::vector<std::string>
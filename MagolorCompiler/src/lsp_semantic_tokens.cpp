@@ -0,0 +1,225 @@
+#include "lsp_semantic_tokens.hpp"
+#include <algorithm>
+
+namespace {
+
+// Indexes into the legend below
+enum TokenType : uint32_t {
+  Namespace,
+  Class,
+  Function,
+  Method,
+  Property,
+  Variable,
+  Parameter,
+};
+
+enum TokenModifier : uint32_t {
+  Declaration = 1 << 0,
+  Static = 1 << 1,
+};
+
+const char *const TOKEN_TYPES[] = {"namespace", "class",    "function",
+                                   "method",    "property", "variable",
+                                   "parameter"};
+const char *const TOKEN_MODIFIERS[] = {"declaration", "static"};
+
+uint32_t tokenType(SymbolKind kind) {
+  switch (kind) {
+  case SymbolKind::Module:
+    return Namespace;
+  case SymbolKind::Class:
+    return Class;
+  case SymbolKind::Function:
+    return Function;
+  case SymbolKind::Method:
+    return Method;
+  case SymbolKind::Field:
+    return Property;
+  case SymbolKind::Parameter:
+    return Parameter;
+  case SymbolKind::Variable:
+    break;
+  }
+  return Variable;
+}
+
+} // namespace
+
+JsonValue SemanticTokensProvider::legend() {
+  JsonValue legend = JsonValue::object();
+  legend["tokenTypes"] = JsonValue::array();
+  for (const char *type : TOKEN_TYPES)
+    legend["tokenTypes"].push(type);
+  legend["tokenModifiers"] = JsonValue::array();
+  for (const char *modifier : TOKEN_MODIFIERS)
+    legend["tokenModifiers"].push(modifier);
+  return legend;
+}
+
+std::vector<SemanticTokensProvider::Token>
+SemanticTokensProvider::collect(const std::string &uri) {
+  std::vector<Token> tokens;
+  auto add = [&](const Range &r, uint32_t type, uint32_t modifiers) {
+    // Identifiers never span lines; anything else is a synthetic range
+    if (r.start.line != r.end.line || r.end.character <= r.start.character)
+      return;
+    tokens.push_back({r.start.line, r.start.character,
+                      r.end.character - r.start.character, type, modifiers});
+  };
+
+  for (const auto &sym : analyzer.getAllSymbolsInFile(uri)) {
+    uint32_t type = tokenType(sym->kind);
+    uint32_t modifiers = sym->isStatic ? uint32_t(Static) : 0;
+    if (sym->definition.uri == uri)
+      add(sym->definition.range, type, modifiers | Declaration);
+    for (const auto &ref : sym->references) {
+      if (ref.uri == uri)
+        add(ref.range, type, modifiers);
+    }
+  }
+
+  // Tokens must not overlap; a declaration wins over a reference recorded
+  // at the same spot
+  std::sort(tokens.begin(), tokens.end(), [](const Token &a, const Token &b) {
+    if (a.line != b.line)
+      return a.line < b.line;
+    if (a.character != b.character)
+      return a.character < b.character;
+    return a.modifiers > b.modifiers;
+  });
+  std::vector<Token> unique;
+  unique.reserve(tokens.size());
+  for (const auto &tok : tokens) {
+    if (!unique.empty() && unique.back().line == tok.line &&
+        unique.back().character + unique.back().length > tok.character)
+      continue;
+    unique.push_back(tok);
+  }
+  return unique;
+}
+
+std::vector<uint32_t>
+SemanticTokensProvider::encode(std::vector<Token>::const_iterator begin,
+                               std::vector<Token>::const_iterator end) {
+  // Each token is [deltaLine, deltaStart, length, type, modifiers], relative
+  // to the previous token
+  std::vector<uint32_t> data;
+  data.reserve((end - begin) * 5);
+  int line = 0;
+  int character = 0;
+  for (auto it = begin; it != end; ++it) {
+    if (it->line != line)
+      character = 0;
+    data.push_back(it->line - line);
+    data.push_back(it->character - character);
+    data.push_back(it->length);
+    data.push_back(it->type);
+    data.push_back(it->modifiers);
+    line = it->line;
+    character = it->character;
+  }
+  return data;
+}
+
+JsonValue SemanticTokensProvider::dataToJson(const std::vector<uint32_t> &data) {
+  JsonValue array = JsonValue::array();
+  auto &elements = array.asArray();
+  elements.reserve(data.size());
+  for (uint32_t value : data)
+    elements.emplace_back(static_cast<int>(value));
+  return array;
+}
+
+SemanticTokensProvider::FileTokens &
+SemanticTokensProvider::refresh(const std::string &uri) {
+  FileTokens &file = files[uri];
+  uint64_t generation = analyzer.getFileGeneration(uri);
+  if (file.generation == generation && !file.resultId.empty())
+    return file;
+
+  file.previousResultId = std::move(file.resultId);
+  file.previousData = std::move(file.data);
+  file.generation = generation;
+  file.tokens = collect(uri);
+  file.data = encode(file.tokens.begin(), file.tokens.end());
+  file.resultId = std::to_string(++lastResultId);
+  return file;
+}
+
+JsonValue SemanticTokensProvider::full(const std::string &uri) {
+  std::lock_guard<std::mutex> lock(mutex);
+  FileTokens &file = refresh(uri);
+
+  JsonValue result = JsonValue::object();
+  result["resultId"] = file.resultId;
+  result["data"] = dataToJson(file.data);
+  return result;
+}
+
+JsonValue SemanticTokensProvider::delta(const std::string &uri,
+                                        const std::string &previousResultId) {
+  std::lock_guard<std::mutex> lock(mutex);
+  FileTokens &file = refresh(uri);
+
+  const std::vector<uint32_t> *previous = nullptr;
+  if (previousResultId == file.resultId)
+    previous = &file.data;
+  else if (previousResultId == file.previousResultId)
+    previous = &file.previousData;
+
+  JsonValue result = JsonValue::object();
+  result["resultId"] = file.resultId;
+  if (!previous) {
+    // Unknown base: send everything, which the client accepts in place of
+    // a delta
+    result["data"] = dataToJson(file.data);
+    return result;
+  }
+
+  // One edit covering everything between the common prefix and suffix
+  const std::vector<uint32_t> &now = file.data;
+  size_t common = std::min(previous->size(), now.size());
+  size_t prefix = std::mismatch(now.begin(), now.begin() + common,
+                                previous->begin())
+                      .first -
+                  now.begin();
+  size_t suffix = std::mismatch(now.rbegin(), now.rbegin() + (common - prefix),
+                                previous->rbegin())
+                      .first -
+                  now.rbegin();
+
+  result["edits"] = JsonValue::array();
+  if (prefix + suffix < previous->size() || prefix + suffix < now.size()) {
+    JsonValue edit = JsonValue::object();
+    edit["start"] = static_cast<int>(prefix);
+    edit["deleteCount"] = static_cast<int>(previous->size() - prefix - suffix);
+    edit["data"] = dataToJson(std::vector<uint32_t>(
+        now.begin() + prefix, now.end() - suffix));
+    result["edits"].push(edit);
+  }
+  return result;
+}
+
+JsonValue SemanticTokensProvider::range(const std::string &uri,
+                                        const Range &range) {
+  std::lock_guard<std::mutex> lock(mutex);
+  FileTokens &file = refresh(uri);
+
+  auto before = [](const Token &tok, const Position &pos) {
+    return tok.line < pos.line ||
+           (tok.line == pos.line && tok.character < pos.character);
+  };
+  auto begin = std::lower_bound(file.tokens.begin(), file.tokens.end(),
+                                range.start, before);
+  auto end = std::lower_bound(begin, file.tokens.end(), range.end, before);
+
+  JsonValue result = JsonValue::object();
+  result["data"] = dataToJson(encode(begin, end));
+  return result;
+}
+
+void SemanticTokensProvider::forget(const std::string &uri) {
+  std::lock_guard<std::mutex> lock(mutex);
+  files.erase(uri);
+}
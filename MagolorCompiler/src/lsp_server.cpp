@@ -8,6 +8,17 @@
 #include <fstream>
 
 LSPLogger logger;
+
+static FormatOptions formatOptions(const JsonValue &params) {
+  FormatOptions options;
+  if (const JsonValue *opts = params.find("options")) {
+    if (const JsonValue *tabSize = opts->find("tabSize"))
+      options.tabSize = tabSize->asInt();
+    if (const JsonValue *spaces = opts->find("insertSpaces"))
+      options.insertSpaces = spaces->asBool();
+  }
+  return options;
+}
 void MagolorLanguageServer::handleMessage(const Message &msg) {
   if (msg.method == "initialize")
     handleInitialize(msg);
@@ -25,40 +36,88 @@ void MagolorLanguageServer::handleMessage(const Message &msg) {
     handleDidClose(msg);
   else if (msg.method == "textDocument/didSave")
     handleDidSave(msg);
-  else if (msg.method == "textDocument/completion")
-    handleCompletion(msg);
+  else if (msg.isRequest()) {
+    transport.respondError(msg.id.value(), -32601, "Method not found");
+  }
+}
+
+bool MagolorLanguageServer::isReadOnlyRequest(const std::string &method) {
+  static const std::unordered_set<std::string> methods = {
+      "textDocument/completion",     "textDocument/hover",
+      "textDocument/formatting",     "textDocument/rangeFormatting",
+      "textDocument/onTypeFormatting", "textDocument/rename",
+      "textDocument/codeAction",     "textDocument/signatureHelp",
+      "textDocument/definition",     "textDocument/references",
+      "textDocument/documentSymbol", "workspace/symbol",
+      "textDocument/semanticTokens/full",
+      "textDocument/semanticTokens/full/delta",
+      "textDocument/semanticTokens/range", "textDocument/inlayHint"};
+  return methods.count(method) > 0;
+}
+
+void MagolorLanguageServer::handleReadOnlyRequest(const Message &msg,
+                                                  const DocumentSnapshot &docs) {
+  if (msg.method == "textDocument/completion")
+    handleCompletion(msg, docs);
   else if (msg.method == "textDocument/hover")
-    handleHover(msg);
+    handleHover(msg, docs);
   else if (msg.method == "textDocument/formatting")
-    handleFormatting(msg);
+    handleFormatting(msg, docs);
   else if (msg.method == "textDocument/rangeFormatting")
-    handleRangeFormatting(msg);
+    handleRangeFormatting(msg, docs);
   else if (msg.method == "textDocument/onTypeFormatting")
-    handleOnTypeFormatting(msg);
+    handleOnTypeFormatting(msg, docs);
   else if (msg.method == "textDocument/rename")
     handleRename(msg);
   else if (msg.method == "textDocument/codeAction")
-    handleCodeAction(msg);
+    handleCodeAction(msg, docs);
   else if (msg.method == "textDocument/signatureHelp")
-    handleSignatureHelp(msg);
+    handleSignatureHelp(msg, docs);
   else if (msg.method == "textDocument/definition")
     handleDefinition(msg);
   else if (msg.method == "textDocument/references")
     handleReferences(msg);
   else if (msg.method == "textDocument/documentSymbol")
     handleDocumentSymbol(msg);
-  else if (msg.isRequest()) {
-    transport.respondError(msg.id.value(), -32601, "Method not found");
+  else if (msg.method == "workspace/symbol")
+    handleWorkspaceSymbol(msg);
+  else if (msg.method.compare(0, 28, "textDocument/semanticTokens/") == 0)
+    handleSemanticTokens(msg);
+  else if (msg.method == "textDocument/inlayHint")
+    handleInlayHint(msg, docs);
+}
+
+void MagolorLanguageServer::runReadOnlyRequest(const Message &msg,
+                                               const DocumentSnapshot &docs) {
+  // It may have been cancelled while queued
+  if (takeCancelled(msg.id.value())) {
+    transport.respondError(msg.id.value(), -32800, "Request cancelled");
+    return;
+  }
+
+  try {
+    std::shared_lock<std::shared_mutex> lock(analyzerMutex);
+    handleReadOnlyRequest(msg, docs);
+  } catch (const std::exception &e) {
+    logger.log("Error handling " + msg.method + ": " + std::string(e.what()));
+    transport.respondError(msg.id.value(), -32603, e.what());
+  } catch (...) {
+    logger.log("Unknown error handling " + msg.method);
+    transport.respondError(msg.id.value(), -32603, "Internal error");
   }
+
+  // A cancel that arrived after the response went out is moot
+  takeCancelled(msg.id.value());
 }
 
-void MagolorLanguageServer::handleSignatureHelp(const Message &msg) {
+void MagolorLanguageServer::handleSignatureHelp(const Message &msg,
+                                                const DocumentSnapshot &docs) {
   std::string uri = msg.params["textDocument"]["uri"].asString();
   Position pos;
   pos.line = msg.params["position"]["line"].asInt();
   pos.character = msg.params["position"]["character"].asInt();
 
-  auto *doc = documents.get(uri);
+  auto doc = docs.get(uri);
   if (!doc) {
     transport.respond(msg.id.value(), JsonValue());
     return;
@@ -128,7 +187,8 @@ void MagolorLanguageServer::handleSignatureHelp(const Message &msg) {
   transport.respond(msg.id.value(), result);
 }
 
-void MagolorLanguageServer::handleCodeAction(const Message &msg) {
+void MagolorLanguageServer::handleCodeAction(const Message &msg,
+                                             const DocumentSnapshot &docs) {
   std::string uri = msg.params["textDocument"]["uri"].asString();
   Range range;
   range.start.line = msg.params["range"]["start"]["line"].asInt();
@@ -138,7 +198,7 @@ void MagolorLanguageServer::handleCodeAction(const Message &msg) {
 
   JsonValue actions = JsonValue::array();
 
-  auto *doc = documents.get(uri);
+  auto doc = docs.get(uri);
   if (!doc) {
     transport.respond(msg.id.value(), actions);
     return;
@@ -211,42 +271,90 @@ void MagolorLanguageServer::handleRename(const Message &msg) {
   transport.respond(msg.id.value(), edit);
 }
 
-void MagolorLanguageServer::handleFormatting(const Message &msg) {
+void MagolorLanguageServer::handleFormatting(const Message &msg,
+                                             const DocumentSnapshot &docs) {
   std::string uri = msg.params["textDocument"]["uri"].asString();
-  auto *doc = documents.get(uri);
+  auto doc = docs.get(uri);
 
   if (!doc) {
     transport.respond(msg.id.value(), JsonValue::array());
     return;
   }
 
-  std::string formatted = formatDocument(doc->content);
+  auto edits = formatter.format(uri, doc->content, doc->lineOffsets, 0, -1,
+                                formatOptions(msg.params));
+  respondWithEdits(msg, edits);
+}
 
-  // Calculate edit to replace entire document
-  JsonValue edit = JsonValue::object();
-  edit["range"] = JsonValue::object();
-  edit["range"]["start"] = JsonValue::object();
-  edit["range"]["start"]["line"] = 0;
-  edit["range"]["start"]["character"] = 0;
-  edit["range"]["end"] = JsonValue::object();
-  edit["range"]["end"]["line"] = (int)doc->lineOffsets.size();
-  edit["range"]["end"]["character"] = 0;
-  edit["newText"] = formatted;
+void MagolorLanguageServer::respondWithEdits(
+    const Message &msg, const std::vector<TextEdit> &edits) {
+  JsonValue result = JsonValue::array();
+  for (const auto &edit : edits) {
+    JsonValue json = JsonValue::object();
+    json["range"] = rangeToJson(edit.range);
+    json["newText"] = edit.newText;
+    result.push(json);
+  }
+  transport.respond(msg.id.value(), result);
+}
+
+void MagolorLanguageServer::readMessages() {
+  while (true) {
+    auto msg = transport.receive();
+
+    std::lock_guard<std::mutex> lock(inboxMutex);
+    if (!msg) {
+      inputClosed = true;
+      inboxReady.notify_one();
+      return;
+    }
+    if (msg->method == "$/cancelRequest") {
+      if (msg->params["id"].type() == JsonValue::Int)
+        cancelledRequests.insert(msg->params["id"].asInt());
+      continue;
+    }
+    inbox.push_back(std::move(*msg));
+    inboxReady.notify_one();
+  }
+}
 
-  JsonValue edits = JsonValue::array();
-  edits.push(edit);
+std::optional<Message> MagolorLanguageServer::nextMessage() {
+  std::unique_lock<std::mutex> lock(inboxMutex);
+  inboxReady.wait(lock, [this] { return !inbox.empty() || inputClosed; });
+  if (inbox.empty())
+    return std::nullopt;
+  Message msg = std::move(inbox.front());
+  inbox.pop_front();
+  return msg;
+}
 
-  transport.respond(msg.id.value(), edits);
+bool MagolorLanguageServer::takeCancelled(int id) {
+  std::lock_guard<std::mutex> lock(inboxMutex);
+  return cancelledRequests.erase(id) > 0;
 }
+
 void MagolorLanguageServer::run() {
   logger.log("LSP run() called");
   running = true;
 
+  // The reader blocks on stdin for the life of the process; it is not
+  // joined because nothing can interrupt a pending read on exit.
+  std::thread(&MagolorLanguageServer::readMessages, this).detach();
+
+  // Merge the background index refresh as soon as it lands instead of on
+  // the next edit; it writes to the index, so it takes the exclusive lock
+  analyzer.setRefreshListener([this] {
+    requestPool.submit([this] {
+      std::unique_lock<std::shared_mutex> lock(analyzerMutex);
+      analyzer.applyRefresh();
+    });
+  });
+
   try {
     while (running) {
       logger.log("Waiting for message...");
 
-      auto msg = transport.receive();
+      auto msg = nextMessage();
       if (!msg) {
         logger.log("No message received - connection closed");
         break;
@@ -254,6 +362,28 @@ void MagolorLanguageServer::run() {
 
       logger.log("Received message: " + msg->method);
 
+      if (msg->isRequest() && takeCancelled(msg->id.value())) {
+        transport.respondError(msg->id.value(), -32800, "Request cancelled");
+        continue;
+      }
+
+      // Read-only requests see the documents as of this point in the
+      // stream, however many edits the main loop applies meanwhile
+      if (msg->isRequest() && isReadOnlyRequest(msg->method)) {
+        requestPool.submit([this, msg = std::move(*msg),
+                            docs = documents.snapshot()] {
+          runReadOnlyRequest(msg, docs);
+        });
+        continue;
+      }
+
+      // Answer shutdown only after everything requested before it
+      if (msg->method == "shutdown")
+        requestPool.wait();
+
+      // Document sync only touches state the main loop owns or that locks
+      // itself; analysis results are merged by the worker, so an edit never
+      // waits behind a slow read-only request
       try {
         handleMessage(*msg);
         logger.log("Message handled successfully");
@@ -264,56 +394,40 @@ void MagolorLanguageServer::run() {
         logger.log("Unknown error handling message");
         // Don't break - continue processing
       }
+
+      // A cancel that arrived after the response went out is moot
+      if (msg->isRequest())
+        takeCancelled(msg->id.value());
     }
   } catch (const std::exception &e) {
     logger.log("Fatal error in run loop: " + std::string(e.what()));
   }
 
+  analyzer.setRefreshListener(nullptr);
+  requestPool.stop();
+  scheduler.stop();
   logger.log("LSP server exiting run loop");
 }
-std::string MagolorLanguageServer::formatDocument(const std::string &content) {
-  // Simple formatter implementation
-  std::stringstream result;
-  std::istringstream input(content);
-  std::string line;
-  int indentLevel = 0;
-
-  while (std::getline(input, line)) {
-    // Trim line
-    size_t start = line.find_first_not_of(" \t");
-    if (start == std::string::npos) {
-      result << "\n";
-      continue;
-    }
-
-    std::string trimmed = line.substr(start);
-
-    // Adjust indent for closing braces
-    if (trimmed[0] == '}') {
-      indentLevel--;
-    }
-
-    // Write indented line
-    for (int i = 0; i < indentLevel; i++) {
-      result << "    ";
-    }
-    result << trimmed << "\n";
+void MagolorLanguageServer::handleInitialize(const Message &msg) {
+  JsonValue caps = JsonValue::object();
 
-    // Adjust indent for opening braces
-    if (trimmed.back() == '{') {
-      indentLevel++;
+  // Columns are byte offsets internally; take UTF-8 positions when the
+  // client offers them, otherwise edits are converted from UTF-16
+  caps["positionEncoding"] = "utf-16";
+  if (const JsonValue *general = msg.params["capabilities"].find("general")) {
+    for (const auto &encoding : (*general)["positionEncodings"].asArray()) {
+      if (encoding.asString() == "utf-8") {
+        caps["positionEncoding"] = "utf-8";
+        documents.useUtf8Positions();
+        break;
+      }
     }
   }
 
-  return result.str();
-}
-void MagolorLanguageServer::handleInitialize(const Message &msg) {
-  JsonValue caps = JsonValue::object();
-
   // Text document sync
   caps["textDocumentSync"] = JsonValue::object();
   caps["textDocumentSync"]["openClose"] = true;
-  caps["textDocumentSync"]["change"] = 1; // Full sync
+  caps["textDocumentSync"]["change"] = 2; // Incremental sync
   caps["textDocumentSync"]["save"] = JsonValue::object();
   caps["textDocumentSync"]["save"]["includeText"] = true;
 
@@ -348,6 +462,21 @@ void MagolorLanguageServer::handleInitialize(const Message &msg) {
   caps["definitionProvider"] = true;
   caps["referencesProvider"] = true;
   caps["documentSymbolProvider"] = true;
+  caps["workspaceSymbolProvider"] = true;
+
+  caps["semanticTokensProvider"] = JsonValue::object();
+  caps["semanticTokensProvider"]["legend"] = SemanticTokensProvider::legend();
+  caps["semanticTokensProvider"]["range"] = true;
+  caps["semanticTokensProvider"]["full"] = JsonValue::object();
+  caps["semanticTokensProvider"]["full"]["delta"] = true;
+  caps["inlayHintProvider"] = true;
+
+  // Tokens come from the last analysis, so ask the client to re-request
+  // them after each one if it can
+  if (const JsonValue *workspace = msg.params["capabilities"].find("workspace")) {
+    if (const JsonValue *tokens = workspace->find("semanticTokens"))
+      semanticTokensRefresh = (*tokens)["refreshSupport"].asBool();
+  }
 
   JsonValue result = JsonValue::object();
   result["capabilities"] = caps;
@@ -388,31 +517,8 @@ void MagolorLanguageServer::handleDidOpen(const Message &msg) {
     documents.open(uri, languageId, version, text);
     logger.log("handleDidOpen: document opened");
 
-    // Analyze and publish diagnostics
-    logger.log("handleDidOpen: starting analysis");
-    try {
-      analyzeAndPublishDiagnostics(uri, text);
-      logger.log("handleDidOpen: analysis complete");
-    } catch (const std::exception& e) {
-      logger.log("handleDidOpen: analysis failed - " + std::string(e.what()));
-      // Publish empty diagnostics so editor doesn't hang
-      publishDiagnostics(uri, {});
-    } catch (...) {
-      logger.log("handleDidOpen: analysis failed - unknown error");
-      publishDiagnostics(uri, {});
-    }
-
-    // Also run semantic analysis
-    logger.log("handleDidOpen: starting semantic analysis");
-    try {
-      analyzer.analyze(uri, text);
-      logger.log("handleDidOpen: semantic analysis complete");
-    } catch (const std::exception& e) {
-      logger.log("handleDidOpen: semantic analysis failed - " + std::string(e.what()));
-      // Don't crash - semantic analysis is optional for basic LSP features
-    } catch (...) {
-      logger.log("handleDidOpen: semantic analysis failed - unknown error");
-    }
+    // Analysis runs on the scheduler thread; nothing to debounce on open
+    scheduler.scheduleNow(uri, version, text);
     
   } catch (const std::exception& e) {
     logger.log("handleDidOpen: ERROR - " + std::string(e.what()));
@@ -433,24 +539,24 @@ void MagolorLanguageServer::handleDidChange(const Message &msg) {
     int version = td["version"].asInt();
 
     auto &changes = msg.params["contentChanges"].asArray();
-    if (!changes.empty()) {
-      std::string text = changes[0]["text"].asString();
-      documents.change(uri, version, text);
-
-      // Analyze and publish diagnostics (wrapped)
-      try {
-        analyzeAndPublishDiagnostics(uri, text);
-      } catch (...) {
-        logger.log("handleDidChange: analysis failed");
-        publishDiagnostics(uri, {});
+    if (!changes.empty() && documents.get(uri)) {
+      // Changes are applied in order; each range refers to the document
+      // as left by the previous change. A change without a range replaces
+      // the whole document.
+      for (const auto &change : changes) {
+        if (change.has("range")) {
+          documents.applyEdit(uri, version, jsonToRange(change["range"]),
+                              change["text"].asString());
+        } else {
+          documents.change(uri, version, change["text"].asString());
+        }
       }
 
-      // Also run semantic analysis (wrapped)
-      try {
-        analyzer.analyze(uri, text);
-      } catch (...) {
-        logger.log("handleDidChange: semantic analysis failed");
-      }
+      // Debounced: a burst of keystrokes yields a single analysis of the
+      // final text, and any run still working on an older version is
+      // cancelled.
+      auto doc = documents.get(uri);
+      scheduler.schedule(uri, doc->version, doc->content);
     }
   } catch (const std::exception& e) {
     logger.log("handleDidChange: ERROR - " + std::string(e.what()));
@@ -466,21 +572,10 @@ void MagolorLanguageServer::handleDidSave(const Message &msg) {
   
   try {
     std::string uri = msg.params["textDocument"]["uri"].asString();
-    auto *doc = documents.get(uri);
+    auto doc = documents.get(uri);
     if (doc) {
-      // Re-analyze on save (wrapped)
-      try {
-        analyzeAndPublishDiagnostics(uri, doc->content);
-      } catch (...) {
-        logger.log("handleDidSave: analysis failed");
-        publishDiagnostics(uri, {});
-      }
-      
-      try {
-        analyzer.analyze(uri, doc->content);
-      } catch (...) {
-        logger.log("handleDidSave: semantic analysis failed");
-      }
+      // Re-analyze on save
+      scheduler.scheduleNow(uri, doc->version, doc->content);
     }
   } catch (const std::exception& e) {
     logger.log("handleDidSave: ERROR - " + std::string(e.what()));
@@ -495,182 +590,113 @@ void MagolorLanguageServer::handleDidClose(const Message &msg) {
   std::string uri = msg.params["textDocument"]["uri"].asString();
 
   // Clear diagnostics on close
+  scheduler.cancel(uri);
+  {
+    std::lock_guard<std::mutex> lock(parsersMutex);
+    parsers.erase(uri);
+  }
   publishDiagnostics(uri, {});
 
+  formatter.forget(uri);
+  semanticTokens.forget(uri);
   documents.close(uri);
 }
 
-void MagolorLanguageServer::analyzeAndPublishDiagnostics(
-    const std::string &uri, const std::string &content) {
-  logger.log("analyzeAndPublishDiagnostics: START for " + uri);
+std::vector<LspDiagnostic> MagolorLanguageServer::collectDiagnostics(
+    const std::string &uri, const std::string &content,
+    const AnalysisScheduler::CancelCheck &cancelled,
+    std::optional<Program> &program) {
+  std::shared_ptr<IncrementalParser> parser;
+  {
+    std::lock_guard<std::mutex> lock(parsersMutex);
+    auto &slot = parsers[uri];
+    if (!slot)
+      slot = std::make_shared<IncrementalParser>(uri);
+    parser = slot;
+  }
 
   std::vector<LspDiagnostic> diagnostics;
+  IncrementalParser::Result result;
+  try {
+    if (!parser->update(content, cancelled, result))
+      return diagnostics;
+  } catch (const std::exception &e) {
+    logger.log("collectDiagnostics: EXCEPTION - " + std::string(e.what()));
+    LspDiagnostic diag;
+    diag.severity = DiagnosticSeverity::Error;
+    diag.message = "Analysis error: " + std::string(e.what());
+    diag.range.start = {0, 0};
+    diag.range.end = {0, 1};
+    diag.source = "magolor";
+    diagnostics.push_back(diag);
+    return diagnostics;
+  }
 
-  // Create diagnostic collector
-  DiagnosticCollector collector(uri, content);
+  logger.log("collectDiagnostics: " + uri + " reparsed " +
+             std::to_string(result.reparsed) + "/" +
+             std::to_string(result.declarations) + ", rechecked " +
+             std::to_string(result.rechecked) + " declarations");
 
-  try {
-    logger.log("analyzeAndPublishDiagnostics: creating lexer");
-    // Phase 1: Lexical analysis
-    Lexer lexer(content, uri, collector);
-    logger.log("analyzeAndPublishDiagnostics: tokenizing");
-    auto tokens = lexer.tokenize();
-    logger.log("analyzeAndPublishDiagnostics: got " +
-               std::to_string(tokens.size()) + " tokens");
-
-    if (collector.hasError()) {
-      logger.log("analyzeAndPublishDiagnostics: lexer has errors");
-      diagnostics = collector.getDiagnostics();
-      publishDiagnostics(uri, diagnostics);
-      return;
-    }
+  if (!result.lexed)
+    return result.syntaxDiagnostics;
 
-    logger.log("analyzeAndPublishDiagnostics: creating parser");
-    // Phase 2: Syntax analysis - WRAPPED IN TRY-CATCH
-    Parser parser(std::move(tokens), uri, collector);
-    logger.log("analyzeAndPublishDiagnostics: parsing");
-
-    Program prog;
-    try {
-      prog = parser.parse();
-      logger.log("analyzeAndPublishDiagnostics: parsed successfully");
-    } catch (const std::exception &e) {
-      logger.log("analyzeAndPublishDiagnostics: parser exception - " +
-                 std::string(e.what()));
-      // Parser threw exception - collect any partial diagnostics
-      diagnostics = collector.getDiagnostics();
-
-      // Add a generic parse error if no specific errors were collected
-      if (diagnostics.empty()) {
-        LspDiagnostic diag;
-        diag.severity = DiagnosticSeverity::Error;
-        diag.message = "Parse error: " + std::string(e.what());
-        diag.range.start = {0, 0};
-        diag.range.end = {0, 1};
-        diag.source = "magolor";
-        diagnostics.push_back(diag);
-      }
+  program = std::move(result.program);
+  if (!result.syntaxDiagnostics.empty())
+    return result.syntaxDiagnostics;
 
-      publishDiagnostics(uri, diagnostics);
-      return;
-    } catch (...) {
-      logger.log("analyzeAndPublishDiagnostics: unknown parser exception");
-
-      diagnostics = collector.getDiagnostics();
-      if (diagnostics.empty()) {
-        LspDiagnostic diag;
-        diag.severity = DiagnosticSeverity::Error;
-        diag.message = "Unknown parse error";
-        diag.range.start = {0, 0};
-        diag.range.end = {0, 1};
-        diag.source = "magolor";
-        diagnostics.push_back(diag);
-      }
+  // Filter out false positives
+  for (const auto &diag : result.typeDiagnostics) {
+    bool skipError = false;
 
-      publishDiagnostics(uri, diagnostics);
-      return;
+    if (diag.message.find("Cannot call non-function") != std::string::npos) {
+      skipError = true;
     }
-
-    if (collector.hasError()) {
-      logger.log("analyzeAndPublishDiagnostics: parser has errors");
-      diagnostics = collector.getDiagnostics();
-      publishDiagnostics(uri, diagnostics);
-      return;
+    if (diag.message.find("string") != std::string::npos &&
+        diag.range.start.line == 3) {
+      skipError = true;
     }
-
-    logger.log("analyzeAndPublishDiagnostics: creating module");
-    // Phase 3: Type checking (if no syntax errors) - WRAPPED IN TRY-CATCH
-    try {
-      ModuleRegistry::instance().clear();
-      auto module = std::make_shared<Module>();
-      module->name = "current";
-      module->filepath = uri;
-      module->ast = prog;
-      ModuleRegistry::instance().registerModule(module);
-      logger.log("analyzeAndPublishDiagnostics: module registered");
-
-      logger.log("analyzeAndPublishDiagnostics: type checking");
-      TypeChecker typeChecker(collector, ModuleRegistry::instance());
-      typeChecker.checkModule(module);
-      logger.log("analyzeAndPublishDiagnostics: type checking complete");
-
-      // Filter out false positives
-      if (collector.hasError()) {
-        logger.log("analyzeAndPublishDiagnostics: type checker has errors");
-        auto allDiags = collector.getDiagnostics();
-        for (const auto &diag : allDiags) {
-          bool skipError = false;
-
-          if (diag.message.find("Cannot call non-function") !=
-              std::string::npos) {
-            skipError = true;
-          }
-          if (diag.message.find("string") != std::string::npos &&
-              diag.range.start.line == 3) {
-            skipError = true;
-          }
-          if (diag.message.find("Undefined variable") != std::string::npos) {
-            if (diag.message.find("Std") != std::string::npos ||
-                diag.message.find("Math") != std::string::npos) {
-              skipError = true;
-            }
-          }
-
-          if (!skipError) {
-            diagnostics.push_back(diag);
-          }
-        }
+    if (diag.message.find("Undefined variable") != std::string::npos) {
+      if (diag.message.find("Std") != std::string::npos ||
+          diag.message.find("Math") != std::string::npos) {
+        skipError = true;
       }
-    } catch (const std::exception &e) {
-      logger.log("analyzeAndPublishDiagnostics: type checker exception - " +
-                 std::string(e.what()));
-      // Type checker threw exception - add diagnostic
-      LspDiagnostic diag;
-      diag.severity = DiagnosticSeverity::Error;
-      diag.message = "Type check error: " + std::string(e.what());
-      diag.range.start = {0, 0};
-      diag.range.end = {0, 1};
-      diag.source = "magolor";
-      diagnostics.push_back(diag);
-    } catch (...) {
-      logger.log(
-          "analyzeAndPublishDiagnostics: unknown type checker exception");
-      LspDiagnostic diag;
-      diag.severity = DiagnosticSeverity::Error;
-      diag.message = "Unknown type check error";
-      diag.range.start = {0, 0};
-      diag.range.end = {0, 1};
-      diag.source = "magolor";
+    }
+
+    if (!skipError) {
       diagnostics.push_back(diag);
     }
+  }
+  return diagnostics;
+}
 
-    logger.log("analyzeAndPublishDiagnostics: checking import errors");
+void MagolorLanguageServer::analyzeAndPublishDiagnostics(
+    const std::string &uri, int version, const std::string &content,
+    const AnalysisScheduler::CancelCheck &cancelled) {
+  std::optional<Program> program;
+  std::vector<LspDiagnostic> diagnostics =
+      collectDiagnostics(uri, content, cancelled, program);
+
+  // Results for a superseded version are dropped rather than published
+  std::unique_lock<std::shared_mutex> lock(analyzerMutex);
+  if (cancelled()) {
+    logger.log("analyzeAndPublishDiagnostics: version " +
+               std::to_string(version) + " superseded");
+    return;
+  }
 
-  } catch (const std::exception &e) {
-    logger.log("analyzeAndPublishDiagnostics: EXCEPTION - " +
-               std::string(e.what()));
-    // Top-level exception - create diagnostic
-    LspDiagnostic diag;
-    diag.severity = DiagnosticSeverity::Error;
-    diag.message = "Analysis error: " + std::string(e.what());
-    diag.range.start = {0, 0};
-    diag.range.end = {0, 1};
-    diag.source = "magolor";
-    diagnostics.push_back(diag);
+  // Index the parsed (and, without syntax errors, type-checked) AST; if the
+  // buffer did not even lex, the analyzer keeps what it had.
+  try {
+    if (program)
+      analyzer.analyze(uri, *program);
+    else
+      analyzer.analyze(uri, content);
   } catch (...) {
-    logger.log("analyzeAndPublishDiagnostics: UNKNOWN EXCEPTION");
-    LspDiagnostic diag;
-    diag.severity = DiagnosticSeverity::Error;
-    diag.message = "Unknown analysis error";
-    diag.range.start = {0, 0};
-    diag.range.end = {0, 1};
-    diag.source = "magolor";
-    diagnostics.push_back(diag);
+    logger.log("analyzeAndPublishDiagnostics: semantic analysis failed");
   }
 
   // Always validate imports (wrapped in try-catch)
   try {
-    logger.log("analyzeAndPublishDiagnostics: validating imports");
     auto importErrors = analyzer.validateImports(uri);
     for (const auto &error : importErrors) {
       LspDiagnostic diag;
@@ -687,13 +713,19 @@ void MagolorLanguageServer::analyzeAndPublishDiagnostics(
 
   logger.log("analyzeAndPublishDiagnostics: publishing " +
              std::to_string(diagnostics.size()) + " diagnostics");
-  publishDiagnostics(uri, diagnostics);
-  logger.log("analyzeAndPublishDiagnostics: END");
+  publishDiagnostics(uri, diagnostics, version);
+
+  if (semanticTokensRefresh)
+    transport.request(++nextRequestId, "workspace/semanticTokens/refresh",
+                      JsonValue());
 }
 void MagolorLanguageServer::publishDiagnostics(
-    const std::string &uri, const std::vector<LspDiagnostic> &diagnostics) {
+    const std::string &uri, const std::vector<LspDiagnostic> &diagnostics,
+    int version) {
   JsonValue params = JsonValue::object();
   params["uri"] = uri;
+  if (version >= 0)
+    params["version"] = version;
   params["diagnostics"] = JsonValue::array();
 
   for (const auto &diag : diagnostics) {
@@ -718,14 +750,15 @@ JsonValue MagolorLanguageServer::diagnosticToJson(const LspDiagnostic &diag) {
   return json;
 }
 
-void MagolorLanguageServer::handleCompletion(const Message &msg) {
+void MagolorLanguageServer::handleCompletion(const Message &msg,
+                                             const DocumentSnapshot &docs) {
   auto &td = msg.params["textDocument"];
   std::string uri = td["uri"].asString();
   Position pos;
   pos.line = msg.params["position"]["line"].asInt();
   pos.character = msg.params["position"]["character"].asInt();
 
-  auto *doc = documents.get(uri);
+  auto doc = docs.get(uri);
   if (!doc) {
     transport.respond(msg.id.value(), JsonValue::array());
     return;
@@ -737,14 +770,15 @@ void MagolorLanguageServer::handleCompletion(const Message &msg) {
   transport.respond(msg.id.value(), items);
 }
 
-void MagolorLanguageServer::handleHover(const Message &msg) {
+void MagolorLanguageServer::handleHover(const Message &msg,
+                                        const DocumentSnapshot &docs) {
   auto &td = msg.params["textDocument"];
   std::string uri = td["uri"].asString();
   Position pos;
   pos.line = msg.params["position"]["line"].asInt();
   pos.character = msg.params["position"]["character"].asInt();
 
-  auto *doc = documents.get(uri);
+  auto doc = docs.get(uri);
   if (!doc) {
     transport.respond(msg.id.value(), JsonValue());
     return;
@@ -768,8 +802,15 @@ void MagolorLanguageServer::handleHover(const Message &msg) {
         md += ": " + sym->type;
       }
       md += "\n";
+    } else if (sym->kind == SymbolKind::Parameter ||
+               sym->kind == SymbolKind::Field) {
+      md += sym->name;
+      if (!sym->type.empty()) {
+        md += ": " + sym->type;
+      }
+      md += "\n";
     } else if (sym->kind == SymbolKind::Class) {
-      md += "class " + sym->name + "\n";
+      md += "class " + sym->name + sym->detail + "\n";
     }
     md += "```";
 
@@ -784,7 +825,8 @@ void MagolorLanguageServer::handleHover(const Message &msg) {
     transport.respond(msg.id.value(), JsonValue());
   }
 }
-void MagolorLanguageServer::handleRangeFormatting(const Message &msg) {
+void MagolorLanguageServer::handleRangeFormatting(const Message &msg,
+                                                  const DocumentSnapshot &docs) {
   std::string uri = msg.params["textDocument"]["uri"].asString();
   Range range;
   range.start.line = msg.params["range"]["start"]["line"].asInt();
@@ -792,73 +834,41 @@ void MagolorLanguageServer::handleRangeFormatting(const Message &msg) {
   range.end.line = msg.params["range"]["end"]["line"].asInt();
   range.end.character = msg.params["range"]["end"]["character"].asInt();
 
-  auto *doc = documents.get(uri);
+  auto doc = docs.get(uri);
   if (!doc) {
     transport.respond(msg.id.value(), JsonValue::array());
     return;
   }
 
-  std::string formatted = formatRange(doc->content, range);
-
-  JsonValue edit = JsonValue::object();
-  edit["range"] = rangeToJson(range);
-  edit["newText"] = formatted;
-
-  JsonValue edits = JsonValue::array();
-  edits.push(edit);
-
-  transport.respond(msg.id.value(), edits);
+  // A selection ending at column 0 does not include that line
+  int lastLine = range.end.line;
+  if (range.end.character == 0 && lastLine > range.start.line)
+    lastLine--;
+  auto edits = formatter.format(uri, doc->content, doc->lineOffsets,
+                                range.start.line, lastLine,
+                                formatOptions(msg.params));
+  respondWithEdits(msg, edits);
 }
 
-void MagolorLanguageServer::handleOnTypeFormatting(const Message &msg) {
+void MagolorLanguageServer::handleOnTypeFormatting(
+    const Message &msg, const DocumentSnapshot &docs) {
   std::string uri = msg.params["textDocument"]["uri"].asString();
   Position pos;
   pos.line = msg.params["position"]["line"].asInt();
   pos.character = msg.params["position"]["character"].asInt();
 
-  auto *doc = documents.get(uri);
+  auto doc = docs.get(uri);
   if (!doc) {
     transport.respond(msg.id.value(), JsonValue::array());
     return;
   }
 
-  // Simple on-type formatting: just return empty for now
-  // Could add auto-indent logic here
-  transport.respond(msg.id.value(), JsonValue::array());
+  // Re-indent the line the trigger character was typed on
+  auto edits = formatter.format(uri, doc->content, doc->lineOffsets, pos.line,
+                                pos.line, formatOptions(msg.params));
+  respondWithEdits(msg, edits);
 }
 
-std::string MagolorLanguageServer::formatRange(const std::string &content,
-                                               Range range) {
-  std::istringstream input(content);
-  std::stringstream result;
-  std::string line;
-  int currentLine = 0;
-  int indentLevel = 0;
-
-  while (std::getline(input, line)) {
-    if (currentLine >= range.start.line && currentLine <= range.end.line) {
-      size_t start = line.find_first_not_of(" \t");
-      if (start == std::string::npos) {
-        result << "\n";
-      } else {
-        std::string trimmed = line.substr(start);
-
-        if (trimmed[0] == '}')
-          indentLevel--;
-
-        for (int i = 0; i < indentLevel; i++)
-          result << "    ";
-        result << trimmed << "\n";
-
-        if (trimmed.back() == '{')
-          indentLevel++;
-      }
-    }
-    currentLine++;
-  }
-
-  return result.str();
-}
 void MagolorLanguageServer::handleDefinition(const Message &msg) {
   auto &td = msg.params["textDocument"];
   std::string uri = td["uri"].asString();
@@ -927,6 +937,107 @@ void MagolorLanguageServer::handleDocumentSymbol(const Message &msg) {
   transport.respond(msg.id.value(), result);
 }
 
+void MagolorLanguageServer::handleWorkspaceSymbol(const Message &msg) {
+  std::string query = msg.params["query"].asString();
+
+  JsonValue result = JsonValue::array();
+  for (auto &sym : analyzer.searchWorkspace(query)) {
+    JsonValue s = JsonValue::object();
+    s["name"] = sym->name;
+    s["kind"] = static_cast<int>(sym->kind);
+    JsonValue loc = JsonValue::object();
+    loc["uri"] = sym->definition.uri;
+    loc["range"] = rangeToJson(sym->definition.range);
+    s["location"] = loc;
+    if (!sym->containerName.empty()) {
+      s["containerName"] = sym->containerName;
+    }
+    result.push(s);
+  }
+
+  transport.respond(msg.id.value(), result);
+}
+
+void MagolorLanguageServer::handleSemanticTokens(const Message &msg) {
+  std::string uri = msg.params["textDocument"]["uri"].asString();
+
+  JsonValue result;
+  if (msg.method == "textDocument/semanticTokens/full")
+    result = semanticTokens.full(uri);
+  else if (msg.method == "textDocument/semanticTokens/full/delta")
+    result = semanticTokens.delta(
+        uri, msg.params["previousResultId"].asString());
+  else
+    result = semanticTokens.range(uri, jsonToRange(msg.params["range"]));
+
+  transport.respond(msg.id.value(), result);
+}
+
+void MagolorLanguageServer::handleInlayHint(const Message &msg,
+                                            const DocumentSnapshot &docs) {
+  std::string uri = msg.params["textDocument"]["uri"].asString();
+  Range range = jsonToRange(msg.params["range"]);
+
+  JsonValue hints = JsonValue::array();
+  auto doc = docs.get(uri);
+  if (!doc) {
+    transport.respond(msg.id.value(), hints);
+    return;
+  }
+
+  // Types of `let` bindings without an annotation, as inferred by the last
+  // type check. The analysis may lag behind the buffer, so a hint is only
+  // shown where the name still sits at its recorded position.
+  for (const auto &sym : analyzer.getAllSymbolsInFile(uri)) {
+    if (sym->kind != SymbolKind::Variable || !sym->isLocal ||
+        sym->type.empty() || sym->type == "void" || sym->type == "unknown")
+      continue;
+    const Range &def = sym->definition.range;
+    if (def.end < range.start || range.end < def.start)
+      continue;
+
+    std::string line = doc->getLine(def.start.line);
+    size_t start = def.start.character;
+    size_t end = def.end.character;
+    if (end > line.size() || line.compare(start, end - start, sym->name) != 0)
+      continue;
+
+    size_t next = line.find_first_not_of(" \t", end);
+    if (next != std::string::npos && line[next] == ':')
+      continue;
+    size_t keyword = line.find_last_not_of(" \t", start == 0 ? 0 : start - 1);
+    std::string before = line.substr(0, keyword == std::string::npos ? 0 : keyword + 1);
+    auto endsWith = [&](const char *word) {
+      size_t n = std::char_traits<char>::length(word);
+      return before.size() >= n &&
+             before.compare(before.size() - n, n, word) == 0 &&
+             (before.size() == n || !std::isalnum(static_cast<unsigned char>(
+                                        before[before.size() - n - 1])));
+    };
+    if (!endsWith("let") && !endsWith("mut"))
+      continue;
+
+    JsonValue hint = JsonValue::object();
+    hint["position"] = JsonValue::object();
+    hint["position"]["line"] = def.end.line;
+    hint["position"]["character"] = def.end.character;
+    hint["label"] = ": " + sym->type;
+    hint["kind"] = 1; // Type
+    hints.push(hint);
+  }
+
+  transport.respond(msg.id.value(), hints);
+}
+
+Range MagolorLanguageServer::jsonToRange(const JsonValue &json) {
+  Range r;
+  r.start.line = json["start"]["line"].asInt();
+  r.start.character = json["start"]["character"].asInt();
+  r.end.line = json["end"]["line"].asInt();
+  r.end.character = json["end"]["character"].asInt();
+  return r;
+}
+
 JsonValue MagolorLanguageServer::rangeToJson(const Range &r) {
   JsonValue json = JsonValue::object();
   json["start"] = JsonValue::object();
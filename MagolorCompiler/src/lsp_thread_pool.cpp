@@ -0,0 +1,71 @@
+#include "lsp_thread_pool.hpp"
+#include "lsp_logger.hpp"
+
+ThreadPool::ThreadPool(size_t threads) {
+  for (size_t i = 0; i < threads; i++)
+    workers.emplace_back([this] { loop(); });
+}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+bool ThreadPool::submit(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping)
+      return false;
+    tasks.push_back(std::move(task));
+  }
+  available.notify_one();
+  return true;
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this] { return tasks.empty() && active == 0; });
+}
+
+void ThreadPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping)
+      return;
+    stopping = true;
+    tasks.clear();
+  }
+  available.notify_all();
+  for (auto &worker : workers) {
+    if (worker.joinable())
+      worker.join();
+  }
+}
+
+void ThreadPool::loop() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    available.wait(lock, [this] { return stopping || !tasks.empty(); });
+    if (stopping)
+      break;
+
+    Task task = std::move(tasks.front());
+    tasks.pop_front();
+    active++;
+
+    lock.unlock();
+    try {
+      task();
+    } catch (const std::exception &e) {
+      logger.log("ThreadPool: task failed - " + std::string(e.what()));
+    } catch (...) {
+      logger.log("ThreadPool: task failed - unknown error");
+    }
+    lock.lock();
+
+    active--;
+    if (tasks.empty() && active == 0)
+      idle.notify_all();
+  }
+
+  // Wake anyone in wait(); nothing further will run
+  idle.notify_all();
+}
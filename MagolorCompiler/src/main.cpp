@@ -1,4 +1,8 @@
+#include "build_profile.hpp"
 #include "codegen.hpp"
+#include "compile_cache.hpp"
+#include "phase_timer.hpp"
+#include "runtime_cache.hpp"
 
 #include "error.hpp"
 #include "lexer.hpp"
@@ -11,6 +15,7 @@
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 namespace fs = std::filesystem;
@@ -46,6 +51,16 @@ void printUsage() {
   std::cout << "\033[1mOPTIONS:\033[0m\n";
   std::cout << "    -o <file>          Specify output file name\n";
   std::cout << "    --verbose          Show detailed compilation steps\n";
+  std::cout << "    -j <n>             Fetch up to n dependencies at once\n";
+  std::cout << "    --update           Ignore the lock file and refresh package mirrors\n";
+  std::cout << "    --release          Build with the release profile\n";
+  std::cout << "    --profile <name>   Build with a [profile.<name>] from project.toml\n";
+  std::cout << "    --pgo-generate     Instrument the build to record a PGO profile\n";
+  std::cout << "    --no-cache         Always run the C++ compiler\n";
+  std::cout << "    --test             Build the test harness (target/<name>-test)\n";
+  std::cout << "    --bench            Build the benchmark harness (target/<name>-bench)\n";
+  std::cout << "    --timings          Print the time spent in each compiler phase\n";
+  std::cout << "    --trace-out <file> Write the phase timings as a Chrome trace\n";
 }
 
 Program compileFile(const std::string &filepath, const std::string &packageName,
@@ -59,7 +74,11 @@ Program compileFile(const std::string &filepath, const std::string &packageName,
 
   // Lex
   Lexer lexer(source, filepath, reporter);
-  auto tokens = lexer.tokenize();
+  std::vector<Token> tokens;
+  {
+    PhaseTimer::Scope timing("lex", filepath);
+    tokens = lexer.tokenize();
+  }
 
   if (reporter.hasError()) {
     reporter.printDiagnostics();
@@ -69,7 +88,11 @@ Program compileFile(const std::string &filepath, const std::string &packageName,
 
   // Parse
   Parser parser(std::move(tokens), filepath, reporter);
-  Program prog = parser.parse();
+  Program prog;
+  {
+    PhaseTimer::Scope timing("parse", filepath);
+    prog = parser.parse();
+  }
 
   if (reporter.hasError()) {
     reporter.printDiagnostics();
@@ -109,8 +132,51 @@ Program mergePrograms(const std::vector<Program> &programs) {
   return merged;
 }
 
-int buildProject(bool verbose = false) {
+// The harness calls each test or bench fn by its plain name, so two with the
+// same name in different files would only surface as a C++ redefinition.
+// Reports each duplicate at its definition with a note on the first one.
+bool checkHarnessNames(const std::vector<Program> &programs,
+                       const std::vector<std::string> &files,
+                       CodeGen::Harness harness) {
+  std::unordered_map<std::string, SourceLocation> seen;
+  bool ok = true;
+  for (size_t i = 0; i < programs.size(); i++) {
+    for (const auto &fn : programs[i].functions) {
+      if (!(harness == CodeGen::Harness::Tests ? fn.isTest : fn.isBench))
+        continue;
+      SourceLocation loc{files[i], fn.loc.line, fn.loc.col, fn.loc.length};
+      auto [first, inserted] = seen.emplace(fn.name, loc);
+      if (inserted)
+        continue;
+      ErrorReporter reporter(files[i], readFile(files[i]));
+      reporter.error(std::string(harness == CodeGen::Harness::Tests ? "test"
+                                                                     : "bench") +
+                         " fn '" + fn.name + "' is defined more than once",
+                     loc, "give each test and bench fn a unique name");
+      reporter.addNote("first defined here", first->second);
+      reporter.printDiagnostics();
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// How build-project compiles, from the command line flags
+struct BuildOptions {
+  std::string profile = "dev";
+  bool pgoGenerate = false;
+  bool useCache = true;
+  // Build target/<name>-test, the harness for `test fn`s in src/ and
+  // tests/, or target/<name>-bench for `bench fn`s in src/ and benches/
+  CodeGen::Harness harness = CodeGen::Harness::None;
+};
+
+int buildProject(bool verbose = false,
+                 const BuildOptions &options = BuildOptions()) {
+  const std::string &profileName = options.profile;
+  auto buildStart = std::chrono::steady_clock::now();
   try {
+    PhaseTimer::Scope buildTiming("build");
     if (!fs::exists("project.toml")) {
       std::cerr << "\033[1;31merror\033[0m: project.toml not found\n";
       std::cerr << "  \033[1;34m= help:\033[0m Initialize a project with 'gear init'\n";
@@ -119,6 +185,36 @@ int buildProject(bool verbose = false) {
 
     Package pkg = PackageManager::loadFromToml("project.toml");
 
+    BuildProfile profile;
+    std::string profileError;
+    auto settings = pkg.profiles.find(profileName);
+    if (settings == pkg.profiles.end() && profileName != "dev" &&
+        profileName != "release") {
+      std::cerr << "\033[1;31merror\033[0m: profile '" << profileName
+                << "' is not defined in project.toml\n";
+      return 1;
+    }
+    if (!BuildProfile::resolve(
+            profileName,
+            settings == pkg.profiles.end() ? std::map<std::string, std::string>()
+                                           : settings->second,
+            profile, profileError)) {
+      std::cerr << "\033[1;31merror\033[0m: " << profileError << "\n";
+      return 1;
+    }
+    Toolchain toolchain;
+    if (!Toolchain::resolve(pkg.toolchain, toolchain, profileError)) {
+      std::cerr << "\033[1;31merror\033[0m: " << profileError << "\n";
+      return 1;
+    }
+    BuildProfile::Pgo pgo = options.pgoGenerate ? BuildProfile::Pgo::Generate
+                                        : profile.pgoMode(toolchain);
+    if (pgo == BuildProfile::Pgo::Use &&
+        !toolchain.mergeProfile(BuildProfile::PGO_DIR, profileError)) {
+      std::cerr << "\033[1;31merror\033[0m: " << profileError << "\n";
+      return 1;
+    }
+
     if (verbose) {
       std::cout << "\033[1;32mBuilding\033[0m " << pkg.name << " v" << pkg.version << "\n";
     }
@@ -129,6 +225,7 @@ int buildProject(bool verbose = false) {
     // Install/load dependencies (if any)
     std::vector<ResolvedPackage> deps;
     if (!pkg.dependencies.empty()) {
+      PhaseTimer::Scope timing("dependencies");
       deps = PackageManager::loadFromLockFile();
       if (deps.empty()) {
         auto result = PackageManager::installDependencies(pkg);
@@ -140,6 +237,19 @@ int buildProject(bool verbose = false) {
       }
     }
 
+    // Test and benchmark files are application sources of their harness only
+    std::string harnessName, harnessDir;
+    if (options.harness == CodeGen::Harness::Tests) {
+      harnessName = "test";
+      harnessDir = "tests";
+    } else if (options.harness == CodeGen::Harness::Benches) {
+      harnessName = "bench";
+      harnessDir = "benches";
+    }
+    if (!harnessDir.empty() && fs::is_directory(harnessDir)) {
+      pkg.sourceDirs.push_back(fs::absolute(harnessDir).string());
+    }
+
     // Collect source files (app + deps)
     auto sourceFiles = PackageManager::collectSourceFiles(pkg, deps);
 
@@ -155,6 +265,7 @@ int buildProject(bool verbose = false) {
 
     // Compile everything once, register modules, but only collect app programs for merging/generation.
     std::vector<Program> appPrograms;
+    std::vector<std::string> appFiles;
     bool hasErrors = false;
 
     for (const auto &file : sourceFiles) {
@@ -178,9 +289,11 @@ int buildProject(bool verbose = false) {
       }
   std::string relPath = file;
   try {
-    fs::path absFile = fs::absolute(file);
-    fs::path absProj = fs::absolute(".");
-    relPath = fs::relative(absFile, absProj).string();
+    // Lexical, not fs::relative: dependencies are symlinks into the package
+    // store, and the module name must come from .magolor/packages/<name>
+    fs::path absFile = fs::absolute(file).lexically_normal();
+    fs::path absProj = fs::absolute(".").lexically_normal();
+    relPath = absFile.lexically_relative(absProj).string();
   } catch (...) {
     relPath = file;
   }
@@ -192,6 +305,7 @@ int buildProject(bool verbose = false) {
       // If this file is an application source (under project's src/), keep it for merging
       if (PackageManager::isAppSource(file, pkg)) {
         appPrograms.push_back(prog);
+        appFiles.push_back(relPath);
       }
     }
 
@@ -216,6 +330,7 @@ int buildProject(bool verbose = false) {
       if (verbose) {
         std::cout << "    Resolving imports for module: " << name << "\n";
       }
+      PhaseTimer::Scope timing("resolve imports", name);
       auto result = importResolver.resolve(module);
       if (!result.success) {
         std::cerr << "\033[1;31merror\033[0m: " << result.error << "\n";
@@ -230,6 +345,7 @@ int buildProject(bool verbose = false) {
 
     NameResolver nameResolver;
     for (const auto &[name, module] : ModuleRegistry::instance().getModules()) {
+      PhaseTimer::Scope timing("resolve names", name);
       auto result = nameResolver.resolve(module);
       if (!result.success) {
         for (const auto &error : result.errors) {
@@ -252,6 +368,7 @@ int buildProject(bool verbose = false) {
       if (verbose) {
         std::cout << "    Type checking module: " << name << "\n";
       }
+      PhaseTimer::Scope timing("type check", name);
       if (!typeChecker.checkModule(module)) {
         typeCheckReporter.printDiagnostics();
         std::cerr << "\033[1;31merror\033[0m: type checking failed\n";
@@ -263,6 +380,12 @@ int buildProject(bool verbose = false) {
       std::cout << "\033[1;32m    Passed\033[0m type checking\n";
     }
 
+    if (options.harness != CodeGen::Harness::None &&
+        !checkHarnessNames(appPrograms, appFiles, options.harness)) {
+      std::cerr << "\033[1;31merror\033[0m: compilation failed\n";
+      return 1;
+    }
+
     // Merge only the application programs (app sources) into the final program
     Program merged = mergePrograms(appPrograms);
 
@@ -270,37 +393,41 @@ int buildProject(bool verbose = false) {
     if (verbose) {
       std::cout << "\033[1;32m   Generating\033[0m C++ code\n";
     }
+    std::vector<std::string> compiler = profile.compilerArgs(toolchain, pgo);
+    std::string runtimeDir = RuntimeCache::prepare(toolchain, compiler, verbose);
     CodeGen codegen;
-    std::string cppCode = codegen.generate(merged);
+    std::string cppCode = codegen.generate(
+        merged, runtimeDir.empty() ? "" : RuntimeCache::HEADER, options.harness);
 
     // Create target directory and write files
     fs::create_directories("target");
 
-    std::string cppPath = "target/" + pkg.name + ".cpp";
-    std::string exePath = "target/" + pkg.name;
+    std::string target =
+        pkg.name + (harnessName.empty() ? "" : "-" + harnessName);
+    std::string cppPath = "target/" + target + ".cpp";
+    std::string exePath = "target/" + target;
 
     writeFile(cppPath, cppCode);
 
-    // Compile with g++
+    // Compile the generated C++
     if (verbose) {
       std::cout << "\033[1;32mCompiling\033[0m C++ code\n";
+      if (pgo == BuildProfile::Pgo::Generate)
+        std::cout << "    Instrumented for profiling\n";
+      else if (pgo == BuildProfile::Pgo::Use)
+        std::cout << "    Using profile from " << BuildProfile::PGO_DIR << "\n";
     }
 
-    std::string compileCmd = "g++ -std=c++17 -O2 -o " + exePath + " " + cppPath + " 2>&1";
-    FILE *pipe = popen(compileCmd.c_str(), "r");
-    if (!pipe) {
-      std::cerr << "\033[1;31merror\033[0m: failed to run g++\n";
-      return 1;
+    if (!runtimeDir.empty()) {
+      auto pch = toolchain.pchFlags(runtimeDir, RuntimeCache::HEADER);
+      compiler.insert(compiler.end(), pch.begin(), pch.end());
     }
-
-    char buffer[128];
+    // Profile data is an input the cache key does not cover
     std::string result;
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-      result += buffer;
-    }
-    int returnCode = pclose(pipe);
-
-    if (returnCode != 0) {
+    if (!CompileCache::compile(toolchain, compiler, cppPath, exePath,
+                               options.useCache &&
+                                   pgo == BuildProfile::Pgo::Off,
+                               verbose, result)) {
       std::cerr << result;
       std::cerr << "\033[1;31merror\033[0m: C++ compilation failed\n";
       return 1;
@@ -309,7 +436,13 @@ int buildProject(bool verbose = false) {
     // Clean up intermediate file
     fs::remove(cppPath);
 
-    std::cout << "\033[1;32m   Finished\033[0m release target(s) in 0.5s\n";
+    std::ostringstream elapsed;
+    elapsed << std::fixed << std::setprecision(2)
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             buildStart)
+                   .count();
+    std::cout << "\033[1;32m   Finished\033[0m " << profile.name
+              << " target(s) in " << elapsed.str() << "s\n";
     std::cout << "    Binary: " << exePath << "\n";
 
     return 0;
@@ -422,11 +555,51 @@ int main(int argc, char *argv[]) {
 
   std::string cmd = argv[1];
   bool verbose = false;
+  size_t jobs = DependencyResolver::defaultJobs();
+  bool update = false;
+  BuildOptions options;
+
+  // Prints --timings and writes --trace-out once the command is done,
+  // however it ends
+  struct TimingReport {
+    bool summary = false;
+    std::string tracePath;
+    ~TimingReport() {
+      if (summary)
+        PhaseTimer::instance().printSummary(std::cout);
+      std::string error;
+      if (!tracePath.empty() &&
+          !PhaseTimer::instance().writeTrace(tracePath, error))
+        std::cerr << "\033[1;31merror\033[0m: " << error << "\n";
+    }
+  } timingReport;
 
   // Check for flags
   for (int i = 2; i < argc; i++) {
     if (std::string(argv[i]) == "--verbose") {
       verbose = true;
+    } else if (std::string(argv[i]) == "--update") {
+      update = true;
+    } else if (std::string(argv[i]) == "-j" && i + 1 < argc) {
+      jobs = std::max(1, std::atoi(argv[++i]));
+    } else if (std::string(argv[i]) == "--release") {
+      options.profile = "release";
+    } else if (std::string(argv[i]) == "--profile" && i + 1 < argc) {
+      options.profile = argv[++i];
+    } else if (std::string(argv[i]) == "--pgo-generate") {
+      options.pgoGenerate = true;
+    } else if (std::string(argv[i]) == "--no-cache") {
+      options.useCache = false;
+    } else if (std::string(argv[i]) == "--test") {
+      options.harness = CodeGen::Harness::Tests;
+    } else if (std::string(argv[i]) == "--bench") {
+      options.harness = CodeGen::Harness::Benches;
+    } else if (std::string(argv[i]) == "--timings") {
+      timingReport.summary = true;
+      PhaseTimer::instance().enable();
+    } else if (std::string(argv[i]) == "--trace-out" && i + 1 < argc) {
+      timingReport.tracePath = argv[++i];
+      PhaseTimer::instance().enable();
     }
   }
 
@@ -453,7 +626,7 @@ int main(int argc, char *argv[]) {
       }
 
       Package pkg = PackageManager::loadFromToml("project.toml");
-      auto result = PackageManager::installDependencies(pkg);
+      auto result = PackageManager::installDependencies(pkg, jobs, update);
 
       if (!result.success) {
         return 1;
@@ -468,7 +641,7 @@ int main(int argc, char *argv[]) {
 
   if (cmd == "build-project" || cmd == "build") {
     if (argc == 2 || fs::exists("project.toml")) {
-      return buildProject(verbose);
+      return buildProject(verbose, options);
     }
   }
 
@@ -492,9 +665,22 @@ int main(int argc, char *argv[]) {
       return 1;
     }
 
-    // Generate C++
+    // Generate C++; emitted code stays self-contained
+    Toolchain toolchain;
+    std::vector<std::string> compiler;
+    std::string runtimeDir;
+    if (cmd != "emit" && cmd != "check") {
+      std::string error;
+      if (!Toolchain::resolve({}, toolchain, error)) {
+        std::cerr << "\033[1;31merror\033[0m: " << error << "\n";
+        return 1;
+      }
+      compiler = BuildProfile::defaults(options.profile).compilerArgs(toolchain);
+      runtimeDir = RuntimeCache::prepare(toolchain, compiler, verbose);
+    }
     CodeGen codegen;
-    std::string cppCode = codegen.generate(prog);
+    std::string cppCode = codegen.generate(
+        prog, runtimeDir.empty() ? "" : RuntimeCache::HEADER);
 
     // Determine output paths
     fs::path srcFsPath(srcPath);
@@ -516,27 +702,19 @@ int main(int argc, char *argv[]) {
     // Write C++ file
     writeFile(cppPath, cppCode);
 
-    // Compile with g++
+    // Compile the generated C++
     if (verbose) {
       std::cout << "\033[1;32mCompiling\033[0m C++ code\n";
     }
 
-    std::string compileCmd =
-        "g++ -std=c++17 -O2 -o " + exePath + " " + cppPath + " 2>&1";
-    FILE *pipe = popen(compileCmd.c_str(), "r");
-    if (!pipe) {
-      std::cerr << "\033[1;31merror\033[0m: failed to run g++\n";
-      return 1;
+    if (!runtimeDir.empty()) {
+      auto pch = toolchain.pchFlags(runtimeDir, RuntimeCache::HEADER);
+      compiler.insert(compiler.end(), pch.begin(), pch.end());
     }
-
-    char buffer[128];
     std::string result;
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-      result += buffer;
-    }
-    int returnCode = pclose(pipe);
-
-    if (returnCode != 0) {
+    if (!CompileCache::compile(toolchain, compiler, cppPath, exePath,
+                               options.useCache,
+                               verbose, result)) {
       std::cerr << result;
       std::cerr << "\033[1;31merror\033[0m: C++ compilation failed\n";
       return 1;
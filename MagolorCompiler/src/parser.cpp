@@ -58,7 +58,8 @@ void Parser::synchronize() {
     }
 
     if (check(TokenType::FN) || check(TokenType::CLASS) ||
-        check(TokenType::USING) || check(TokenType::CIMPORT)) {
+        check(TokenType::USING) || check(TokenType::CIMPORT) ||
+        check(TokenType::AT)) {
       return;
     }
 
@@ -80,8 +81,28 @@ Program Parser::parse() {
         prog.cimports.push_back(parseCImport());
       } else if (check(TokenType::CLASS)) {
         prog.classes.push_back(parseClass());
+      } else if (check(TokenType::AT) ||
+                 (check(TokenType::IDENT) && peek().value == "struct" &&
+                  peek(1).type == TokenType::IDENT)) {
+        // `struct` is only a keyword in front of a top-level declaration
+        ClassDecl cls = parseStruct();
+        if (!cls.name.empty())
+          prog.classes.push_back(std::move(cls));
       } else if (check(TokenType::PUB) || check(TokenType::FN)) {
         prog.functions.push_back(parseFunction());
+      } else if (check(TokenType::IDENT) &&
+                 (peek().value == "test" || peek().value == "bench") &&
+                 peek(1).type == TokenType::FN) {
+        // `test` and `bench` are only keywords in front of a top-level fn
+        Token kindTok = advance();
+        FnDecl fn = parseFunction();
+        fn.isTest = kindTok.value == "test";
+        fn.isBench = kindTok.value == "bench";
+        if (!fn.params.empty() || fn.returnType->kind != Type::VOID)
+          error(std::string(fn.isTest ? "Test" : "Benchmark") +
+                    " functions take no parameters and return nothing",
+                kindTok);
+        prog.functions.push_back(std::move(fn));
       } else {
         error("Unexpected token: " + peek().value, peek());
         synchronize();
@@ -197,6 +218,9 @@ TypePtr Parser::parseType() {
   case TokenType::IDENT:
     type->kind = Type::CLASS;
     type->className = t.value;
+    if (std::find(typeParamNames.begin(), typeParamNames.end(), t.value) !=
+        typeParamNames.end())
+      type->kind = Type::GENERIC;
 
     // NEW: Check for generic arguments
     if (check(TokenType::LT)) {
@@ -234,6 +258,26 @@ TypePtr Parser::parseType() {
   return type;
 }
 
+// <T, U: Numeric, V: Comparable + Equatable>
+void Parser::parseTypeParams(std::vector<TypeParam> &out) {
+  if (!match(TokenType::LT))
+    return;
+  do {
+    Token name = expect(TokenType::IDENT, "Expected type parameter name");
+    TypeParam param;
+    param.name = name.value;
+    param.loc = tokenToLoc(name);
+    if (match(TokenType::COLON)) {
+      do {
+        param.constraints.push_back(
+            expect(TokenType::IDENT, "Expected constraint name").value);
+      } while (match(TokenType::PLUS));
+    }
+    out.push_back(param);
+  } while (match(TokenType::COMMA));
+  expect(TokenType::GT, "Expected '>' after type parameters");
+}
+
 TypePtr Parser::parseFunctionType() {
   expect(TokenType::FN, "Expected 'fn'");
   expect(TokenType::LPAREN, "Expected '('");
@@ -269,6 +313,7 @@ Field Parser::parseField() {
 
   Token nameToken = expect(TokenType::IDENT, "Expected field name");
   field.name = nameToken.value;
+  field.loc = tokenToLoc(nameToken);
 
   expect(TokenType::COLON, "Expected ':' after field name");
   field.type = parseType();
@@ -300,12 +345,18 @@ FnDecl Parser::parseFunction() {
   expect(TokenType::FN, "Expected 'fn'");
   Token nameToken = expect(TokenType::IDENT, "Expected function name");
   fn.name = nameToken.value;
+  fn.loc = tokenToLoc(nameToken);
+  parseTypeParams(fn.typeParams);
+  size_t outerTypeParams = typeParamNames.size();
+  for (const auto &param : fn.typeParams)
+    typeParamNames.push_back(param.name);
   expect(TokenType::LPAREN, "Expected '(' after function name");
 
   if (!check(TokenType::RPAREN)) {
     Param p;
     Token paramName = expect(TokenType::IDENT, "Expected parameter name");
     p.name = paramName.value;
+    p.loc = tokenToLoc(paramName);
     expect(TokenType::COLON, "Expected ':' after parameter name");
     p.type = parseType();
     fn.params.push_back(p);
@@ -314,6 +365,7 @@ FnDecl Parser::parseFunction() {
       Param p2;
       Token paramName2 = expect(TokenType::IDENT, "Expected parameter name");
       p2.name = paramName2.value;
+      p2.loc = tokenToLoc(paramName2);
       expect(TokenType::COLON, "Expected ':' after parameter name");
       p2.type = parseType();
       fn.params.push_back(p2);
@@ -328,25 +380,79 @@ FnDecl Parser::parseFunction() {
     fn.returnType->kind = Type::VOID;
   }
 
-  fn.body = parseBlock();
+  fn.body = parseBlock(&fn.endLoc);
+  typeParamNames.resize(outerTypeParams);
   return fn;
 }
 
 ClassDecl Parser::parseClass() {
   expect(TokenType::CLASS, "Expected 'class'");
   ClassDecl cls;
+  cls.isPublic = false;
+  parseClassBody(cls);
+  return cls;
+}
+
+// [@packed] [@align(N)] struct Name { ... }
+ClassDecl Parser::parseStruct() {
+  ClassDecl cls;
+  cls.isPublic = false;
+  cls.isStruct = true;
+  while (match(TokenType::AT)) {
+    Token attr = expect(TokenType::IDENT, "Expected attribute name after '@'");
+    if (attr.value == "packed") {
+      cls.packed = true;
+    } else if (attr.value == "align") {
+      expect(TokenType::LPAREN, "Expected '(' after @align");
+      Token value = expect(TokenType::INT_LIT, "Expected alignment in bytes");
+      expect(TokenType::RPAREN, "Expected ')' after alignment");
+      cls.align = value.type == TokenType::INT_LIT ? std::stoi(value.value) : 0;
+      if (cls.align <= 0 || (cls.align & (cls.align - 1)) != 0)
+        error("Alignment must be a power of two", value);
+    } else {
+      errorWithHint("Unknown attribute '@" + attr.value + "'", attr,
+                    "structs take @packed and @align(N)");
+    }
+  }
+
+  Token keyword = peek();
+  if (keyword.type != TokenType::IDENT || keyword.value != "struct") {
+    error("Expected 'struct' after attributes", keyword);
+    synchronize();
+    return cls;
+  }
+  advance();
+  parseClassBody(cls);
+  return cls;
+}
+
+// Name, type parameters and members of a class or struct. Struct members
+// are public whether or not they say `pub`, and only their methods may be
+// `mut fn`.
+void Parser::parseClassBody(ClassDecl &cls) {
   Token nameToken = expect(TokenType::IDENT, "Expected class name");
   cls.name = nameToken.value;
+  cls.loc = tokenToLoc(nameToken);
+  parseTypeParams(cls.typeParams);
+  size_t outerTypeParams = typeParamNames.size();
+  for (const auto &param : cls.typeParams)
+    typeParamNames.push_back(param.name);
   expect(TokenType::LBRACE, "Expected '{' after class name");
 
   while (!check(TokenType::RBRACE) && !check(TokenType::EOF_TOK)) {
-    bool isPublic = match(TokenType::PUB);
+    bool isPublic = match(TokenType::PUB) || cls.isStruct;
     bool isStatic = match(TokenType::STATIC);
+    Token mutToken = peek();
+    bool isMut = match(TokenType::MUT);
 
-    if (check(TokenType::FN)) {
+    if (isMut && (!cls.isStruct || isStatic))
+      errorWithHint("Only struct methods can be 'mut fn'", mutToken,
+                    "class methods may always modify their object");
+    if (check(TokenType::FN) || isMut) {
       FnDecl m = parseFunction();
       m.isPublic = isPublic;
       m.isStatic = isStatic;
+      m.isMut = isMut;
       cls.methods.push_back(m);
     } else {
       Field f;
@@ -354,6 +460,7 @@ ClassDecl Parser::parseClass() {
       f.isStatic = isStatic;
       Token fieldName = expect(TokenType::IDENT, "Expected field name");
       f.name = fieldName.value;
+      f.loc = tokenToLoc(fieldName);
       expect(TokenType::COLON, "Expected ':' after field name");
       f.type = parseType();
 
@@ -366,45 +473,50 @@ ClassDecl Parser::parseClass() {
       cls.fields.push_back(f);
     }
   }
-  expect(TokenType::RBRACE, "Expected '}' at end of class");
-  return cls;
+  cls.endLoc = tokenToLoc(expect(TokenType::RBRACE, "Expected '}' at end of class"));
+  typeParamNames.resize(outerTypeParams);
 }
 
-std::vector<StmtPtr> Parser::parseBlock() {
+std::vector<StmtPtr> Parser::parseBlock(SourceLoc *end) {
   expect(TokenType::LBRACE, "Expected '{'");
   std::vector<StmtPtr> stmts;
   while (!check(TokenType::RBRACE) && !check(TokenType::EOF_TOK)) {
     stmts.push_back(parseStmt());
   }
-  expect(TokenType::RBRACE, "Expected '}'");
+  Token close = expect(TokenType::RBRACE, "Expected '}'");
+  if (end)
+    *end = tokenToLoc(close);
   return stmts;
 }
 
 StmtPtr Parser::parseStmt() {
+  SourceLoc start = tokenToLoc(peek());
+  StmtPtr stmt;
   if (check(TokenType::LET))
-    return parseLet();
-  if (check(TokenType::RETURN))
-    return parseReturn();
-  if (check(TokenType::IF))
-    return parseIf();
-  if (check(TokenType::WHILE))
-    return parseWhile();
-  if (check(TokenType::FOR))
-    return parseFor();
-  if (check(TokenType::MATCH))
-    return parseMatch();
-  if (check(TokenType::CPP_BLOCK)) {
-    auto stmt = std::make_shared<Stmt>();
+    stmt = parseLet();
+  else if (check(TokenType::RETURN))
+    stmt = parseReturn();
+  else if (check(TokenType::IF))
+    stmt = parseIf();
+  else if (check(TokenType::WHILE))
+    stmt = parseWhile();
+  else if (check(TokenType::FOR))
+    stmt = parseFor();
+  else if (check(TokenType::MATCH))
+    stmt = parseMatch();
+  else if (check(TokenType::CPP_BLOCK)) {
+    stmt = std::make_shared<Stmt>();
     CppStmt cpp;
     cpp.code = advance().value;
     stmt->data = cpp;
-    return stmt;
+  } else {
+    stmt = std::make_shared<Stmt>();
+    ExprStmt es;
+    es.expr = parseExpr();
+    stmt->data = es;
+    match(TokenType::SEMICOLON);
   }
-  auto stmt = std::make_shared<Stmt>();
-  ExprStmt es;
-  es.expr = parseExpr();
-  stmt->data = es;
-  match(TokenType::SEMICOLON);
+  stmt->loc = start;
   return stmt;
 }
 
@@ -415,6 +527,7 @@ StmtPtr Parser::parseLet() {
   ls.isMut = match(TokenType::MUT);
   Token varName = expect(TokenType::IDENT, "Expected variable name");
   ls.name = varName.value;
+  ls.nameLoc = tokenToLoc(varName);
   if (match(TokenType::COLON))
     ls.type = parseType();
   expect(TokenType::ASSIGN, "Expected '=' in let statement");
@@ -442,12 +555,15 @@ StmtPtr Parser::parseIf() {
   expect(TokenType::LPAREN, "Expected '(' after 'if'");
   is.cond = parseExpr();
   expect(TokenType::RPAREN, "Expected ')' after if condition");
-  is.thenBody = parseBlock();
+  is.thenBody = parseBlock(&is.thenEnd);
   if (match(TokenType::ELSE)) {
     if (check(TokenType::IF)) {
+      SourceLoc start = tokenToLoc(peek());
       is.elseBody.push_back(parseIf());
+      is.elseBody.back()->loc = start;
+      is.elseEnd = tokenToLoc(tokens[pos - 1]);
     } else {
-      is.elseBody = parseBlock();
+      is.elseBody = parseBlock(&is.elseEnd);
     }
   }
   stmt->data = is;
@@ -461,7 +577,7 @@ StmtPtr Parser::parseWhile() {
   expect(TokenType::LPAREN, "Expected '(' after 'while'");
   ws.cond = parseExpr();
   expect(TokenType::RPAREN, "Expected ')' after while condition");
-  ws.body = parseBlock();
+  ws.body = parseBlock(&ws.bodyEnd);
   stmt->data = ws;
   return stmt;
 }
@@ -473,6 +589,7 @@ StmtPtr Parser::parseFor() {
   expect(TokenType::LPAREN, "Expected '(' after 'for'");
   Token varName = expect(TokenType::IDENT, "Expected variable name");
   fs.var = varName.value;
+  fs.varLoc = tokenToLoc(varName);
   Token inToken = expect(TokenType::IDENT, "Expected 'in'");
   if (inToken.value != "in") {
     errorWithHint("Expected 'in' keyword", inToken,
@@ -480,7 +597,7 @@ StmtPtr Parser::parseFor() {
   }
   fs.iterable = parseExpr();
   expect(TokenType::RPAREN, "Expected ')' after for header");
-  fs.body = parseBlock();
+  fs.body = parseBlock(&fs.bodyEnd);
   stmt->data = fs;
   return stmt;
 }
@@ -508,12 +625,13 @@ StmtPtr Parser::parseMatch() {
     if (match(TokenType::LPAREN)) {
       Token bindVar = expect(TokenType::IDENT, "Expected binding variable");
       arm.bindVar = bindVar.value;
+      arm.bindLoc = tokenToLoc(bindVar);
       expect(TokenType::RPAREN, "Expected ')' after binding");
     }
     expect(TokenType::FAT_ARROW, "Expected '=>' in match arm");
 
     if (check(TokenType::LBRACE)) {
-      arm.body = parseBlock();
+      arm.body = parseBlock(&arm.bodyEnd);
     } else if (check(TokenType::RETURN)) {
       advance();
       auto retStmt = std::make_shared<Stmt>();
@@ -526,6 +644,8 @@ StmtPtr Parser::parseMatch() {
     } else {
       arm.body.push_back(parseStmt());
     }
+    if (arm.bodyEnd.line == 0)
+      arm.bodyEnd = tokenToLoc(tokens[pos - 1]);
     match(TokenType::COMMA);
     ms.arms.push_back(arm);
   }
@@ -552,8 +672,9 @@ ExprPtr Parser::parseExpr() {
       return left;
     }
 
-    advance();
+    Token op = advance();
     auto expr = std::make_shared<Expr>();
+    expr->loc = tokenToLoc(op);
     AssignExpr ae;
     ae.target = left;
     ae.value = parseExpr();
@@ -666,59 +787,52 @@ ExprPtr Parser::parseUnary() {
   }
   return parseCall();
 }
-bool Parser::skipGenericArgs() {
+// Explicit type arguments before a call's '(', as in create<int>(). Only
+// taken when every token up to the matching '>' can belong to a type and a
+// '(' follows, so comparisons like `a < b` parse as before.
+bool Parser::parseCallTypeArgs(std::vector<TypePtr> &out) {
   if (!check(TokenType::LT))
     return false;
 
-  // Save position in case this isn't generic args
-  int savedPos = pos;
-  advance(); // consume '<'
-
+  size_t end = pos + 1;
   int depth = 1;
-  bool foundComma = false;
-  bool foundType = false;
-
-  while (depth > 0 && pos < tokens.size()) {
-    TokenType t = peek().type;
-
-    if (t == TokenType::LT) {
+  for (; end < tokens.size() && depth > 0; end++) {
+    switch (tokens[end].type) {
+    case TokenType::LT:
       depth++;
-      advance();
-    } else if (t == TokenType::GT) {
+      break;
+    case TokenType::GT:
       depth--;
-      advance();
-      if (depth == 0) {
-        // Successfully found closing '>'
-        // Must be followed by '(' for method call
-        if (check(TokenType::LPAREN)) {
-          return true;
-        }
-        break;
-      }
-    } else if (t == TokenType::COMMA) {
-      foundComma = true;
-      advance();
-    } else if (t == TokenType::IDENT || t == TokenType::INT ||
-               t == TokenType::FLOAT || t == TokenType::STRING ||
-               t == TokenType::BOOL || t == TokenType::VOID) {
-      foundType = true;
-      advance();
-    } else if (t == TokenType::ASSIGN || t == TokenType::SEMICOLON ||
-               t == TokenType::EOF_TOK) {
-      // Definitely not generic args
       break;
-    } else {
-      // Unexpected token
-      advance();
+    case TokenType::IDENT:
+    case TokenType::INT:
+    case TokenType::FLOAT:
+    case TokenType::STRING:
+    case TokenType::BOOL:
+    case TokenType::VOID:
+    case TokenType::COMMA:
+      break;
+    default:
+      return false;
     }
   }
+  if (depth != 0 || end >= tokens.size() ||
+      tokens[end].type != TokenType::LPAREN)
+    return false;
 
-  // Not generic args, restore position
-  pos = savedPos;
-  return false;
+  advance(); // consume '<'
+  out.push_back(parseType());
+  while (match(TokenType::COMMA))
+    out.push_back(parseType());
+  expect(TokenType::GT, "Expected '>' after type arguments");
+  return true;
 }
+
 ExprPtr Parser::parseCall() {
   auto expr = parsePrimary();
+  std::vector<TypePtr> typeArgs;
+  if (std::holds_alternative<IdentExpr>(expr->data))
+    parseCallTypeArgs(typeArgs);
 
   while (true) {
     if (match(TokenType::LPAREN)) {
@@ -726,6 +840,8 @@ ExprPtr Parser::parseCall() {
       auto callExpr = std::make_shared<Expr>();
       CallExpr ce;
       ce.callee = expr;
+      ce.typeArgs = std::move(typeArgs);
+      typeArgs.clear();
       if (!check(TokenType::RPAREN)) {
         ce.args.push_back(parseExpr());
         while (match(TokenType::COMMA)) {
@@ -743,16 +859,13 @@ ExprPtr Parser::parseCall() {
       MemberExpr me;
       me.object = expr;
       me.member = memberTok.value;
+      me.memberLoc = tokenToLoc(memberTok);
       memberExpr->data = me;
       memberExpr->loc = expr->loc;
       expr = memberExpr;
 
-      // NEW: Check for generic arguments AFTER member access
-      // This handles cases like: Array.create<int>()
-      if (check(TokenType::LT)) {
-        skipGenericArgs();
-        // The '(' will be handled in the next iteration
-      }
+      // Array.create<int>(); the '(' is handled in the next iteration
+      parseCallTypeArgs(typeArgs);
 
     } else if (match(TokenType::LBRACKET)) {
       auto indexExpr = std::make_shared<Expr>();
@@ -771,14 +884,12 @@ ExprPtr Parser::parseCall() {
       MemberExpr me;
       me.object = expr;
       me.member = memberTok.value;
+      me.memberLoc = tokenToLoc(memberTok);
       memberExpr->data = me;
       memberExpr->loc = expr->loc;
       expr = memberExpr;
 
-      // NEW: Check for generic arguments AFTER :: access
-      if (check(TokenType::LT)) {
-        skipGenericArgs();
-      }
+      parseCallTypeArgs(typeArgs);
 
     } else {
       break;
@@ -797,6 +908,7 @@ ExprPtr Parser::parseLambda() {
     Param p;
     Token paramName = expect(TokenType::IDENT, "Expected parameter name");
     p.name = paramName.value;
+    p.loc = tokenToLoc(paramName);
 
     // Type annotation is now OPTIONAL
     if (match(TokenType::COLON)) {
@@ -812,6 +924,7 @@ ExprPtr Parser::parseLambda() {
       Param p2;
       Token paramName2 = expect(TokenType::IDENT, "Expected parameter name");
       p2.name = paramName2.value;
+      p2.loc = tokenToLoc(paramName2);
 
       // Type annotation is now OPTIONAL
       if (match(TokenType::COLON)) {
@@ -828,7 +941,7 @@ ExprPtr Parser::parseLambda() {
   if (match(TokenType::ARROW)) {
     le.returnType = parseType();
   }
-  le.body = parseBlock();
+  le.body = parseBlock(&le.bodyEnd);
   expr->data = le;
   return expr;
 }
@@ -913,6 +1026,13 @@ ExprPtr Parser::parsePrimary() {
     Token tok = tokens[pos - 1];
     Token className =
         expect(TokenType::IDENT, "Expected class name after 'new'");
+    std::vector<TypePtr> typeArgs;
+    if (match(TokenType::LT)) {
+      typeArgs.push_back(parseType());
+      while (match(TokenType::COMMA))
+        typeArgs.push_back(parseType());
+      expect(TokenType::GT, "Expected '>' after type arguments");
+    }
     expect(TokenType::LPAREN, "Expected '(' after class name");
     std::vector<ExprPtr> args;
     if (!check(TokenType::RPAREN)) {
@@ -923,7 +1043,7 @@ ExprPtr Parser::parsePrimary() {
     }
     expect(TokenType::RPAREN, "Expected ')' after constructor arguments");
     auto e = std::make_shared<Expr>();
-    e->data = NewExpr{className.value, args};
+    e->data = NewExpr{className.value, args, typeArgs};
     e->loc = tokenToLoc(tok);
     return e;
   }
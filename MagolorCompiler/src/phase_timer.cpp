@@ -0,0 +1,155 @@
+#include "phase_timer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace {
+
+std::string escapeJson(const std::string &text) {
+  std::string out;
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += static_cast<char>(c);
+    } else if (c < 0x20) {
+      char code[8];
+      std::snprintf(code, sizeof(code), "\\u%04x", c);
+      out += code;
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+  return out;
+}
+
+std::string formatMs(double us) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(us < 10000 ? 2 : 1) << us / 1000
+      << " ms";
+  return out.str();
+}
+
+} // namespace
+
+PhaseTimer::Scope::Scope(const std::string &phase, const std::string &detail)
+    : active(PhaseTimer::instance().enabled) {
+  if (!active)
+    return;
+  this->phase = phase;
+  this->detail = detail;
+  PhaseTimer &timer = PhaseTimer::instance();
+  std::lock_guard<std::mutex> lock(timer.mutex);
+  start = timer.now();
+  timer.depth++;
+}
+
+PhaseTimer::Scope::~Scope() {
+  if (!active)
+    return;
+  PhaseTimer &timer = PhaseTimer::instance();
+  std::lock_guard<std::mutex> lock(timer.mutex);
+  timer.depth--;
+  timer.events.push_back(
+      {phase, detail, start, timer.now() - start, timer.depth});
+}
+
+double PhaseTimer::now() const {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - origin)
+      .count();
+}
+
+void PhaseTimer::printSummary(std::ostream &out) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (events.empty())
+    return;
+
+  // Phases in the order they first started, with nested time counted in
+  // their parent as well, so only top-level phases add up to the total
+  double first = events.front().start, last = 0;
+  struct Total {
+    double start = 0, time = 0;
+    size_t count = 0;
+    int depth = 0;
+  };
+  std::map<std::string, Total> totals;
+  for (const auto &e : events) {
+    first = std::min(first, e.start);
+    last = std::max(last, e.start + e.duration);
+    auto [it, added] = totals.try_emplace(e.phase);
+    if (added || e.start < it->second.start)
+      it->second.start = e.start;
+    if (added || e.depth < it->second.depth)
+      it->second.depth = e.depth;
+    it->second.time += e.duration;
+    it->second.count++;
+  }
+  double wall = std::max(last - first, 1.0);
+  std::vector<std::pair<std::string, Total>> phases(totals.begin(),
+                                                    totals.end());
+  std::sort(phases.begin(), phases.end(), [](const auto &a, const auto &b) {
+    return a.second.start < b.second.start;
+  });
+
+  out << "\n\033[1mTimings\033[0m (" << formatMs(wall) << " total)\n";
+  out << "    " << std::left << std::setw(28) << "phase" << std::right
+      << std::setw(12) << "time" << std::setw(8) << "share" << std::setw(8)
+      << "count" << "\n";
+  for (const auto &[name, total] : phases) {
+    std::ostringstream share;
+    share << std::fixed << std::setprecision(1) << total.time / wall * 100
+          << "%";
+    out << "    " << std::left << std::setw(28)
+        << std::string(2 * total.depth, ' ') + name << std::right
+        << std::setw(12) << formatMs(total.time) << std::setw(8)
+        << share.str() << std::setw(8) << total.count << "\n";
+  }
+
+  // Per-file and per-module costs, where one input dominates
+  std::map<std::string, double> inputs;
+  for (const auto &e : events) {
+    if (!e.detail.empty())
+      inputs[e.detail] += e.duration;
+  }
+  if (inputs.empty())
+    return;
+  std::vector<std::pair<std::string, double>> slowest(inputs.begin(),
+                                                      inputs.end());
+  std::sort(slowest.begin(), slowest.end(),
+            [](const auto &a, const auto &b) { return a.second > b.second; });
+  if (slowest.size() > 10)
+    slowest.resize(10);
+  out << "\n\033[1mSlowest files and modules\033[0m\n";
+  for (const auto &[name, time] : slowest)
+    out << "    " << std::left << std::setw(40) << name << std::right
+        << std::setw(12) << formatMs(time) << "\n";
+}
+
+bool PhaseTimer::writeTrace(const std::string &path,
+                            std::string &error) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::ofstream file(path);
+  if (!file) {
+    error = "cannot write " + path;
+    return false;
+  }
+  file << std::fixed << std::setprecision(1);
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  for (size_t i = 0; i < events.size(); i++) {
+    const auto &e = events[i];
+    file << (i ? "," : "") << "\n  {\"name\": \"" << escapeJson(e.phase)
+         << "\", \"cat\": \"magolor\", \"ph\": \"X\", \"ts\": " << e.start
+         << ", \"dur\": " << e.duration << ", \"pid\": 1, \"tid\": 1";
+    if (!e.detail.empty())
+      file << ", \"args\": {\"detail\": \"" << escapeJson(e.detail) << "\"}";
+    file << "}";
+  }
+  file << "\n]}\n";
+  if (!file.flush()) {
+    error = "cannot write " + path;
+    return false;
+  }
+  return true;
+}
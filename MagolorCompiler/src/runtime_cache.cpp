@@ -0,0 +1,60 @@
+#include "runtime_cache.hpp"
+#include "codegen.hpp"
+#include "compile_cache.hpp"
+#include "package_registry.hpp"
+#include "phase_timer.hpp"
+
+std::string RuntimeCache::prepare(const Toolchain &toolchain,
+                                  const std::vector<std::string> &compiler,
+                                  bool verbose) {
+  PhaseTimer::Scope timing("runtime");
+  if (compiler.empty())
+    return "";
+
+  std::string prelude = CodeGen::runtimePrelude();
+  std::string identity = prelude;
+  for (const auto &arg : compiler)
+    identity += '\0' + arg;
+  identity += '\0' + toolchain.stamp();
+
+  std::string dir = magolorHome() + "/runtime/" + CompileCache::hash(identity);
+  std::string pch = toolchain.pchPath(dir, HEADER);
+  if (fs::exists(pch))
+    return dir;
+
+  std::cout << "\033[1;32m   Compiling\033[0m runtime (cached for later builds)\n";
+
+  // Built under a private name and renamed, so concurrent builds never see
+  // a half-written precompiled header
+  std::string tmp = dir + ".tmp-" + std::to_string(getpid());
+  std::error_code ec;
+  fs::remove_all(tmp, ec);
+  fs::create_directories(tmp, ec);
+  if (ec)
+    return "";
+  {
+    // Guarded, for compilers that load the .pch ahead of the #include
+    std::ofstream header(tmp + "/" + HEADER);
+    header << "#ifndef MAGOLOR_RUNTIME_HPP\n#define MAGOLOR_RUNTIME_HPP\n"
+           << prelude << "\n#endif\n";
+    if (!header.flush())
+      return "";
+  }
+
+  std::vector<std::string> command = compiler;
+  command.insert(command.end(), {"-x", "c++-header", tmp + "/" + HEADER, "-o",
+                                 toolchain.pchPath(tmp, HEADER)});
+  PhaseTimer::Scope compileTiming("precompile runtime");
+  if (!runProcess(command, !verbose)) {
+    fs::remove_all(tmp, ec);
+    return "";
+  }
+
+  fs::rename(tmp, dir, ec);
+  if (ec) {
+    // Another build finished the same entry first
+    fs::remove_all(tmp, ec);
+    return fs::exists(pch) ? dir : "";
+  }
+  return dir;
+}
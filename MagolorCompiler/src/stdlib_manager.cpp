@@ -11,7 +11,7 @@ std::vector<std::string> StdLibManager::getAvailableModules() {
     return {
         "IO", "Parse", "Option", "Math", "String",
         "Array", "Map", "Set", "File", "Time",
-        "Random", "System"
+        "Random", "System", "Test", "Bench"
     };
 }
 
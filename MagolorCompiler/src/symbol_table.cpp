@@ -0,0 +1,264 @@
+#include "symbol_table.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+std::string toLower(const std::string &s) {
+  std::string out(s.size(), '\0');
+  std::transform(s.begin(), s.end(), out.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return out;
+}
+
+// Distinct trigrams of an already lower-cased string
+std::vector<uint32_t> trigramsOf(const std::string &s) {
+  std::vector<uint32_t> out;
+  for (size_t i = 0; i + 3 <= s.size(); i++) {
+    out.push_back((uint32_t)(unsigned char)s[i] << 16 |
+                  (uint32_t)(unsigned char)s[i + 1] << 8 |
+                  (uint32_t)(unsigned char)s[i + 2]);
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+  return out;
+}
+
+bool isSubsequence(const std::string &needle, const std::string &haystack) {
+  size_t i = 0;
+  for (char c : haystack) {
+    if (i < needle.size() && needle[i] == c)
+      i++;
+  }
+  return i == needle.size();
+}
+
+} // namespace
+
+void SymbolTable::setFileSymbols(const std::string &uri,
+                                 std::vector<SymbolPtr> symbols) {
+  removeFile(uri);
+
+  FileEntry &entry = filesByUri[uri];
+  entry.generation = ++lastGeneration;
+  entry.symbols = std::move(symbols);
+  for (const auto &sym : entry.symbols) {
+    if (!sym->isLocal)
+      index(sym);
+  }
+  entry.intervals = buildIntervals(uri, entry.symbols);
+}
+
+void SymbolTable::removeFile(const std::string &uri) {
+  auto it = filesByUri.find(uri);
+  if (it == filesByUri.end())
+    return;
+  for (const auto &sym : it->second.symbols) {
+    if (!sym->isLocal)
+      unindex(sym);
+  }
+  filesByUri.erase(it);
+}
+
+void SymbolTable::clear() {
+  filesByUri.clear();
+  byName.clear();
+  trigrams.clear();
+}
+
+bool SymbolTable::hasFile(const std::string &uri) const {
+  return filesByUri.count(uri) > 0;
+}
+
+uint64_t SymbolTable::fileGeneration(const std::string &uri) const {
+  auto it = filesByUri.find(uri);
+  return it != filesByUri.end() ? it->second.generation : 0;
+}
+
+std::vector<std::string> SymbolTable::files() const {
+  std::vector<std::string> result;
+  result.reserve(filesByUri.size());
+  for (const auto &[uri, _] : filesByUri)
+    result.push_back(uri);
+  return result;
+}
+
+const std::vector<SymbolPtr> &
+SymbolTable::getSymbolsInFile(const std::string &uri) const {
+  static const std::vector<SymbolPtr> empty;
+  auto it = filesByUri.find(uri);
+  return it != filesByUri.end() ? it->second.symbols : empty;
+}
+
+void SymbolTable::index(const SymbolPtr &sym) {
+  std::string key = toLower(sym->name);
+  byName.emplace(key, sym);
+  for (uint32_t t : trigramsOf(key))
+    trigrams[t].insert(sym);
+}
+
+void SymbolTable::unindex(const SymbolPtr &sym) {
+  std::string key = toLower(sym->name);
+  auto [first, last] = byName.equal_range(key);
+  for (auto it = first; it != last; ++it) {
+    if (it->second == sym) {
+      byName.erase(it);
+      break;
+    }
+  }
+  for (uint32_t t : trigramsOf(key)) {
+    auto posting = trigrams.find(t);
+    if (posting == trigrams.end())
+      continue;
+    posting->second.erase(sym);
+    if (posting->second.empty())
+      trigrams.erase(posting);
+  }
+}
+
+std::vector<SymbolPtr> SymbolTable::lookup(const std::string &name) const {
+  std::vector<SymbolPtr> result;
+  auto [first, last] = byName.equal_range(toLower(name));
+  for (auto it = first; it != last; ++it) {
+    if (it->second->name == name)
+      result.push_back(it->second);
+  }
+  return result;
+}
+
+std::vector<SymbolPtr> SymbolTable::findByPrefix(const std::string &prefix,
+                                                 size_t limit) const {
+  std::vector<SymbolPtr> result;
+  std::string key = toLower(prefix);
+  for (auto it = byName.lower_bound(key);
+       it != byName.end() && it->first.compare(0, key.size(), key) == 0;
+       ++it) {
+    result.push_back(it->second);
+    if (limit && result.size() >= limit)
+      break;
+  }
+  return result;
+}
+
+std::vector<SymbolPtr> SymbolTable::search(const std::string &query,
+                                           size_t limit) const {
+  std::string q = toLower(query);
+  std::vector<uint32_t> queryTrigrams = trigramsOf(q);
+
+  // Too short for trigrams: prefix matches are the best we can do cheaply
+  if (queryTrigrams.empty())
+    return findByPrefix(q, limit);
+
+  std::unordered_map<Symbol *, std::pair<SymbolPtr, size_t>> hits;
+  for (uint32_t t : queryTrigrams) {
+    auto posting = trigrams.find(t);
+    if (posting == trigrams.end())
+      continue;
+    for (const auto &sym : posting->second) {
+      auto &hit = hits[sym.get()];
+      hit.first = sym;
+      hit.second++;
+    }
+  }
+
+  // Tolerate a typo or two: half the query's trigrams must be present
+  size_t needed = (queryTrigrams.size() + 1) / 2;
+  std::vector<std::pair<double, SymbolPtr>> ranked;
+  for (auto &[_, hit] : hits) {
+    if (hit.second < needed)
+      continue;
+    std::string name = toLower(hit.first->name);
+    double score = (double)hit.second / queryTrigrams.size();
+    if (name == q)
+      score += 3;
+    else if (name.compare(0, q.size(), q) == 0)
+      score += 2;
+    else if (name.find(q) != std::string::npos)
+      score += 1;
+    else if (isSubsequence(q, name))
+      score += 0.5;
+    // Prefer tighter matches among otherwise equal candidates
+    score -= 0.001 * name.size();
+    ranked.push_back({score, hit.first});
+  }
+
+  std::sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b) {
+    if (a.first != b.first)
+      return a.first > b.first;
+    return a.second->name < b.second->name;
+  });
+  if (limit && ranked.size() > limit)
+    ranked.resize(limit);
+
+  std::vector<SymbolPtr> result;
+  result.reserve(ranked.size());
+  for (auto &[_, sym] : ranked)
+    result.push_back(sym);
+  return result;
+}
+
+SymbolPtr SymbolTable::findAtPosition(const std::string &uri,
+                                      const Position &pos) const {
+  auto it = filesByUri.find(uri);
+  if (it == filesByUri.end())
+    return nullptr;
+  const auto &intervals = it->second.intervals;
+  const Interval *hit = queryIntervals(intervals, 0, intervals.size(), pos);
+  return hit ? hit->symbol : nullptr;
+}
+
+std::vector<SymbolTable::Interval>
+SymbolTable::buildIntervals(const std::string &uri,
+                            const std::vector<SymbolPtr> &symbols) {
+  std::vector<Interval> intervals;
+  for (const auto &sym : symbols) {
+    if (sym->definition.uri == uri)
+      intervals.push_back({sym->definition.range, {}, sym});
+    for (const auto &ref : sym->references) {
+      if (ref.uri == uri)
+        intervals.push_back({ref.range, {}, sym});
+    }
+  }
+  std::sort(intervals.begin(), intervals.end(),
+            [](const Interval &a, const Interval &b) {
+              return a.range.start < b.range.start;
+            });
+  fillMaxEnd(intervals, 0, intervals.size());
+  return intervals;
+}
+
+Position SymbolTable::fillMaxEnd(std::vector<Interval> &intervals, size_t lo,
+                                 size_t hi) {
+  if (lo >= hi)
+    return {-1, -1};
+  size_t mid = lo + (hi - lo) / 2;
+  Position maxEnd = intervals[mid].range.end;
+  Position left = fillMaxEnd(intervals, lo, mid);
+  Position right = fillMaxEnd(intervals, mid + 1, hi);
+  if (maxEnd < left)
+    maxEnd = left;
+  if (maxEnd < right)
+    maxEnd = right;
+  intervals[mid].maxEnd = maxEnd;
+  return maxEnd;
+}
+
+const SymbolTable::Interval *
+SymbolTable::queryIntervals(const std::vector<Interval> &intervals, size_t lo,
+                            size_t hi, const Position &pos) {
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const Interval &node = intervals[mid];
+    // Nothing in this subtree reaches pos
+    if (node.maxEnd < pos)
+      return nullptr;
+    if (const Interval *found = queryIntervals(intervals, lo, mid, pos))
+      return found;
+    if (pos < node.range.start)
+      return nullptr; // everything to the right starts even later
+    if (node.range.contains(pos))
+      return &node;
+    lo = mid + 1;
+  }
+  return nullptr;
+}
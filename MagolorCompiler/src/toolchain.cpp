@@ -0,0 +1,166 @@
+#include "toolchain.hpp"
+#include "phase_timer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <sstream>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+namespace fs = std::filesystem;
+
+bool Toolchain::resolve(const std::map<std::string, std::string> &settings,
+                        Toolchain &out, std::string &error) {
+  PhaseTimer::Scope timing("toolchain");
+  out = Toolchain();
+  for (const auto &[key, value] : settings) {
+    if (key == "compiler") {
+      out.compiler = value;
+    } else if (key == "linker") {
+      out.linker = value;
+    } else {
+      error = "unknown setting '" + key + "' in [toolchain]";
+      return false;
+    }
+  }
+  if (const char *cxx = std::getenv("MAGOLOR_CXX"); cxx && *cxx)
+    out.compiler = cxx;
+  if (const char *ld = std::getenv("MAGOLOR_LINKER"); ld && *ld)
+    out.linker = ld;
+
+  if (out.linker == "default")
+    out.linker.clear();
+  static const char *const LINKERS[] = {"mold", "lld", "gold", "bfd"};
+  if (!out.linker.empty() &&
+      std::find(std::begin(LINKERS), std::end(LINKERS), out.linker) ==
+          std::end(LINKERS)) {
+    error = "unsupported linker '" + out.linker +
+            "' (expected mold, lld, gold or bfd)";
+    return false;
+  }
+
+  std::string version;
+  if (!run({out.compiler, "--version"}, version)) {
+    error = "C++ compiler '" + out.compiler + "' not found";
+    return false;
+  }
+  out.family = version.find("clang") != std::string::npos ? Family::Clang
+                                                           : Family::GCC;
+  return true;
+}
+
+std::string Toolchain::stamp() const {
+  std::vector<std::string> candidates;
+  if (compiler.find('/') != std::string::npos) {
+    candidates.push_back(compiler);
+  } else {
+    const char *path = std::getenv("PATH");
+    std::stringstream dirs(path ? path : "");
+    std::string dir;
+    while (std::getline(dirs, dir, ':'))
+      candidates.push_back((dir.empty() ? "." : dir) + "/" + compiler);
+  }
+  for (const auto &candidate : candidates) {
+    struct stat st;
+    if (access(candidate.c_str(), X_OK) == 0 &&
+        stat(candidate.c_str(), &st) == 0) {
+      return candidate + " " + std::to_string(st.st_size) + " " +
+             std::to_string(st.st_mtim.tv_sec);
+    }
+  }
+  return compiler;
+}
+
+std::vector<std::string> Toolchain::baseArgs() const {
+  std::vector<std::string> args = {compiler, "-std=c++17"};
+  if (!linker.empty())
+    args.push_back("-fuse-ld=" + linker);
+  return args;
+}
+
+std::string Toolchain::pchPath(const std::string &dir,
+                               const std::string &header) const {
+  return dir + "/" + header + (family == Family::Clang ? ".pch" : ".gch");
+}
+
+std::vector<std::string>
+Toolchain::pchFlags(const std::string &dir, const std::string &header) const {
+  // GCC finds header.gch next to the header on its own; Clang has to be
+  // given the file, and the header's include guard skips the #include
+  if (family == Family::Clang)
+    return {"-I" + dir, "-include-pch", pchPath(dir, header)};
+  return {"-I" + dir};
+}
+
+std::string Toolchain::profileExtension() const {
+  return family == Family::Clang ? ".profraw" : ".gcda";
+}
+
+bool Toolchain::mergeProfile(const std::string &dir, std::string &error) const {
+  if (family != Family::Clang)
+    return true;
+
+  std::vector<std::string> args = {"llvm-profdata", "merge", "-o",
+                                   dir + "/default.profdata"};
+  std::error_code ec;
+  for (auto it = fs::directory_iterator(dir, ec);
+       !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    if (it->path().extension() == ".profraw")
+      args.push_back(it->path().string());
+  }
+  std::string output;
+  if (!run(args, output)) {
+    error = "could not merge the PGO profile with llvm-profdata\n" + output;
+    return false;
+  }
+  return true;
+}
+
+bool Toolchain::run(const std::vector<std::string> &args,
+                    std::string &diagnostics) {
+  diagnostics.clear();
+  std::vector<char *> argv;
+  for (const auto &arg : args)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0)
+    return false;
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+
+  pid_t pid;
+  int err =
+      posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(fds[1]);
+
+  char buffer[4096];
+  ssize_t n;
+  while (err == 0 && (n = read(fds[0], buffer, sizeof(buffer))) != 0) {
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    diagnostics.append(buffer, n);
+  }
+  close(fds[0]);
+  if (err != 0)
+    return false;
+
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR)
+      return false;
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
@@ -5,44 +5,26 @@
 // 4. Method calls on objects
 
 #include "typechecker.hpp"
+#include "stdlib_metadata.hpp"
 #include <algorithm>
 #include <sstream>
 
-TypeChecker::~TypeChecker() {
-  while (currentScope) {
-    exitScope();
-  }
-}
-
 void TypeChecker::enterScope() {
-  auto newScope = new Scope();
-  newScope->parent = currentScope;
-  currentScope = newScope;
+  vars.enter();
+  functions.enter();
+  classes.enter();
 }
 
 void TypeChecker::exitScope() {
-  if (!currentScope)
-    return;
-  auto old = currentScope;
-  currentScope = currentScope->parent;
-  delete old;
+  vars.exit();
+  functions.exit();
+  classes.exit();
 }
 
 std::vector<FnDecl *> TypeChecker::getVisibleFunctions() {
   std::vector<FnDecl *> result;
-  std::unordered_set<std::string> seen;
-
-  Scope *scope = currentScope;
-  while (scope) {
-    for (auto &[name, fn] : scope->functions) {
-      if (!seen.count(name)) {
-        result.push_back(fn);
-        seen.insert(name);
-      }
-    }
-    scope = scope->parent;
-  }
-
+  functions.forEachVisible(
+      [&](uint32_t, FnDecl *fn) { result.push_back(fn); });
   return result;
 }
 
@@ -58,168 +40,180 @@ std::vector<FnDecl *> TypeChecker::getVisibleCallables() {
     }
   }
 
-  for (auto &[_, cls] : currentScope->classes) {
+  classes.forEachVisible([&](uint32_t, ClassDecl *cls) {
     for (auto &m : cls->methods) {
       if (m.isStatic && m.isPublic) {
         result.push_back(&m);
       }
     }
-  }
+  });
 
   return result;
 }
 
-void TypeChecker::defineVar(const std::string &name, TypePtr type) {
-  if (currentScope) {
-    currentScope->variables[name] = type;
-  }
+void TypeChecker::defineVar(const std::string &name, TypePtr type,
+                            bool byRef) {
+  vars.define(names.intern(name), Var{std::move(type), nextSlot++, byRef});
+}
+
+void TypeChecker::defineFunction(const std::string &name, FnDecl *fn) {
+  functions.define(names.intern(name), fn);
+}
+
+void TypeChecker::defineClass(const std::string &name, ClassDecl *cls) {
+  classes.define(names.intern(name), cls);
+}
+
+const TypeChecker::Var *TypeChecker::findVar(const std::string &name) {
+  uint32_t id = names.find(name);
+  return id == NameInterner::NONE ? nullptr : vars.find(id);
 }
 
 TypePtr TypeChecker::lookupVar(const std::string &name) {
-  Scope *scope = currentScope;
-  while (scope) {
-    auto it = scope->variables.find(name);
-    if (it != scope->variables.end()) {
-      return it->second;
-    }
-    scope = scope->parent;
-  }
-  return nullptr;
+  const Var *var = findVar(name);
+  return var ? var->type : nullptr;
 }
 
 FnDecl *TypeChecker::lookupFunction(const std::string &name) {
-  Scope *scope = currentScope;
-  while (scope) {
-    auto it = scope->functions.find(name);
-    if (it != scope->functions.end()) {
-      return it->second;
-    }
-    scope = scope->parent;
-  }
-  return nullptr;
+  uint32_t id = names.find(name);
+  FnDecl *const *fn =
+      id == NameInterner::NONE ? nullptr : functions.find(id);
+  return fn ? *fn : nullptr;
 }
 
 ClassDecl *TypeChecker::lookupClass(const std::string &name) {
-  Scope *scope = currentScope;
-  while (scope) {
-    auto it = scope->classes.find(name);
-    if (it != scope->classes.end()) {
-      return it->second;
-    }
-    scope = scope->parent;
-  }
-  return nullptr;
+  uint32_t id = names.find(name);
+  ClassDecl *const *cls = id == NameInterner::NONE ? nullptr : classes.find(id);
+  return cls ? *cls : nullptr;
 }
 
-// NEW: Check if a function name is a built-in Std library function
-bool TypeChecker::isStdLibFunction(const std::string &name) {
-  static const std::unordered_set<std::string> stdFunctions = {
-    // Std.IO
-    "print", "println", "eprint", "eprintln", "readLine", "read", "readChar",
-    // Std.Parse
-    "parseInt", "parseFloat", "parseBool",
-    // Std.Option
-    "isSome", "isNone", "unwrap", "unwrapOr",
-    // Std.String
-    "length", "isEmpty", "trim", "toLower", "toUpper", "startsWith", "endsWith",
-    "contains", "replace", "split", "join", "repeat", "substring", "indexOf",
-    // Std.Array
-    "push", "pop", "reverse", "sort", "clear",
-    // Std.Math
-    "abs", "pow", "sqrt", "sin", "cos", "tan", "min", "max", "floor", "ceil",
-    // Std.File
-    "exists", "isFile", "isDirectory", "createDir", "remove", "readFile", "writeFile",
-    // Top-level helpers
-    "toString"
-  };
-  
-  return stdFunctions.count(name) > 0;
-}
+namespace {
 
-// NEW: Get return type for Std library function
-TypePtr TypeChecker::getStdLibReturnType(const std::string &name) {
+// A Magolor type as written in the stdlib table. Anything the checker cannot
+// name (type parameters, library classes) becomes VOID, which it treats as
+// unknown.
+TypePtr typeFromString(std::string_view text) {
   auto type = std::make_shared<Type>();
-  
-  // Option functions
-  if (name == "isSome" || name == "isNone") {
-    type->kind = Type::BOOL;
-    return type;
-  }
-  
-  if (name == "unwrap" || name == "unwrapOr") {
-    // Return generic type - will be inferred from context
-    type->kind = Type::VOID;
-    return type;
-  }
-  
-  // String functions
-  if (name == "length" || name == "indexOf") {
+  type->kind = Type::VOID;
+  size_t open = text.find('<');
+  std::string_view head = text.substr(0, open);
+  if (open != std::string_view::npos && text.back() == '>' &&
+      (head == "Option" || head == "Array")) {
+    type->kind = head == "Option" ? Type::OPTION : Type::ARRAY;
+    type->innerType =
+        typeFromString(text.substr(open + 1, text.size() - open - 2));
+  } else if (text == "int") {
     type->kind = Type::INT;
-    return type;
-  }
-  
-  if (name == "isEmpty" || name == "startsWith" || name == "endsWith" || 
-      name == "contains" || name == "exists" || name == "isFile" || 
-      name == "isDirectory") {
-    type->kind = Type::BOOL;
-    return type;
-  }
-  
-  if (name == "trim" || name == "toLower" || name == "toUpper" || 
-      name == "replace" || name == "join" || name == "repeat" || 
-      name == "substring" || name == "toString" || name == "readLine") {
+  } else if (text == "float") {
+    type->kind = Type::FLOAT;
+  } else if (text == "string") {
     type->kind = Type::STRING;
-    return type;
+  } else if (text == "bool") {
+    type->kind = Type::BOOL;
   }
-  
-  if (name == "split") {
-    type->kind = Type::ARRAY;
-    auto innerType = std::make_shared<Type>();
-    innerType->kind = Type::STRING;
-    type->innerType = innerType;
-    return type;
+  return type;
+}
+
+const char *const CONSTRAINTS[] = {"Numeric", "Comparable", "Equatable"};
+
+// Members of every SoA<T>, which a field of T cannot share a name with
+const char *const SOA_MEMBERS[] = {"size", "reserve", "clear", "push", "get",
+                                   "set",  "begin",   "end",   "Ref",  "ConstRef"};
+
+// Whether a type parameter declared with `declared` meets `wanted`: every
+// Numeric type is Comparable, and every Comparable one Equatable
+bool implies(const std::string &declared, const std::string &wanted) {
+  return declared == wanted || declared == "Numeric" ||
+         (declared == "Comparable" && wanted == "Equatable");
+}
+
+// "Std.Math" for the expression Std.Math; false unless it is a plain chain
+// of names
+bool dottedName(const ExprPtr &expr, std::string &out) {
+  if (auto *ident = std::get_if<IdentExpr>(&expr->data)) {
+    out = ident->name;
+    return true;
   }
-  
-  if (name == "readFile") {
-    type->kind = Type::OPTION;
-    auto innerType = std::make_shared<Type>();
-    innerType->kind = Type::STRING;
-    type->innerType = innerType;
-    return type;
+  if (auto *member = std::get_if<MemberExpr>(&expr->data)) {
+    if (!dottedName(member->object, out))
+      return false;
+    out += "." + member->member;
+    return true;
   }
-  
-  if (name == "writeFile" || name == "appendFile" || name == "createDir" || name == "remove") {
-    type->kind = Type::BOOL;
-    return type;
+  return false;
+}
+
+} // namespace
+
+// Whether `name` is a function or constant of some Std module
+bool TypeChecker::isStdLibFunction(const std::string &name) {
+  for (const auto &entry : StdLib::named(name)) {
+    if (entry.kind != StdLibEntry::Kind::Type)
+      return true;
   }
-  
-  // Math functions
-  if (name == "abs" || name == "sqrt" || name == "sin" || name == "cos" || 
-      name == "tan" || name == "pow" || name == "floor" || name == "ceil") {
-    type->kind = Type::FLOAT;
-    return type;
+  return false;
+}
+
+// Return type of the stdlib function `name`, or VOID if it is unknown or
+// differs between the overloads that could be meant. A qualified call passes
+// its module ("Std.Math" or "Math"); a bare name prefers the prelude, then
+// the modules this file imports.
+TypePtr TypeChecker::getStdLibReturnType(const std::string &name,
+                                         const std::string &modulePath) {
+  std::vector<const StdLibEntry *> candidates;
+  auto collect = [&](auto accept) {
+    for (const auto &entry : StdLib::named(name)) {
+      if (entry.kind != StdLibEntry::Kind::Type && accept(entry))
+        candidates.push_back(&entry);
+    }
+  };
+
+  if (!modulePath.empty()) {
+    std::string path = modulePath == "Std" || modulePath.rfind("Std.", 0) == 0
+                           ? modulePath
+                           : "Std." + modulePath;
+    collect([&](const StdLibEntry &entry) {
+      return entry.modulePath() == path;
+    });
+  } else {
+    collect([](const StdLibEntry &entry) { return entry.module.empty(); });
+    if (candidates.empty() && currentModule) {
+      for (const auto &usingDecl : currentModule->ast.usings) {
+        std::string path;
+        for (const auto &part : usingDecl.path)
+          path += (path.empty() ? "" : ".") + part;
+        collect([&](const StdLibEntry &entry) {
+          return StdLib::importedBy(entry, path);
+        });
+      }
+    }
+    if (candidates.empty())
+      collect([](const StdLibEntry &) { return true; });
   }
-  
-  if (name == "min" || name == "max") {
-    type->kind = Type::INT;
-    return type;
+
+  TypePtr result;
+  for (const auto *entry : candidates) {
+    TypePtr type = typeFromString(entry->returns);
+    if (result && !typesEqual(result, type))
+      return typeFromString("");
+    result = type;
   }
-  
-  // Default to void for print functions
-  type->kind = Type::VOID;
-  return type;
+  return result ? result : typeFromString("");
 }
 
-bool TypeChecker::checkProgram(Program &prog) {
-  enterScope();
-
+void TypeChecker::declareProgram(Program &prog) {
   for (auto &cls : prog.classes) {
-    currentScope->classes[cls.name] = &cls;
+    defineClass(cls.name, &cls);
   }
 
   for (auto &fn : prog.functions) {
-    currentScope->functions[fn.name] = &fn;
+    defineFunction(fn.name, &fn);
   }
+}
+
+bool TypeChecker::checkProgram(Program &prog) {
+  enterScope();
+  declareProgram(prog);
 
   for (auto &cls : prog.classes) {
     checkClass(cls);
@@ -240,8 +234,31 @@ bool TypeChecker::checkModule(ModulePtr module) {
   return result;
 }
 
+bool TypeChecker::checkFunctionInModule(ModulePtr module, FnDecl &fn) {
+  currentModule = module;
+  enterScope();
+  declareProgram(module->ast);
+  checkFunction(fn);
+  exitScope();
+  currentModule = nullptr;
+  return !reporter.hasError();
+}
+
+bool TypeChecker::checkClassInModule(ModulePtr module, ClassDecl &cls) {
+  currentModule = module;
+  enterScope();
+  declareProgram(module->ast);
+  checkClass(cls);
+  exitScope();
+  currentModule = nullptr;
+  return !reporter.hasError();
+}
+
 void TypeChecker::checkClass(ClassDecl &cls) {
   currentClass = &cls;
+  checkTypeParams(cls.typeParams);
+  if (cls.isStruct)
+    checkStructFields(cls);
 
   for (auto &field : cls.fields) {
     if (field.isStatic && field.initValue) {
@@ -264,6 +281,8 @@ void TypeChecker::checkClass(ClassDecl &cls) {
 
 void TypeChecker::checkFunction(FnDecl &fn) {
   currentFunction = &fn;
+  nextSlot = 0;
+  checkTypeParams(fn.typeParams);
   enterScope();
 
   if (currentClass) {
@@ -274,7 +293,7 @@ void TypeChecker::checkFunction(FnDecl &fn) {
   }
 
   for (const auto &param : fn.params) {
-    defineVar(param.name, param.type);
+    defineVar(param.name, param.type, structOf(param.type) != nullptr);
   }
 
   for (auto &stmt : fn.body) {
@@ -347,6 +366,8 @@ void TypeChecker::checkStmt(StmtPtr stmt) {
           // Relaxed: Accept any iterable type
           if (iterType->kind == Type::ARRAY) {
             defineVar(s.var, iterType->innerType);
+          } else if (isSoA(iterType)) {
+            defineVar(s.var, iterType->genericArgs[0]);
           } else {
             // Assume it's iterable
             auto elemType = std::make_shared<Type>();
@@ -391,10 +412,8 @@ void TypeChecker::checkStmt(StmtPtr stmt) {
 
 bool TypeChecker::isModulePath(ExprPtr expr) {
   if (auto *ident = std::get_if<IdentExpr>(&expr->data)) {
-    // Check for Std or imported modules
-    if (ident->name == "Std" || ident->name == "File" || ident->name == "String" ||
-        ident->name == "Array" || ident->name == "Option" || ident->name == "Parse" ||
-        ident->name == "Math" || ident->name == "IO") {
+    // Std, its modules by their short names, or imported modules
+    if (ident->name == "Std" || StdLib::isModule("Std." + ident->name)) {
       return true;
     }
     
@@ -441,12 +460,15 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
           type->kind = Type::BOOL;
           return type;
         } else if constexpr (std::is_same_v<T, IdentExpr>) {
-          // Check if it's a stdlib function first
-          if (isStdLibFunction(e.name)) {
+          const Var *var = findVar(e.name);
+          e.slot = var ? var->slot : -1;
+
+          // Stdlib names unless the program declares its own
+          if (!var && isStdLibFunction(e.name) && !lookupFunction(e.name)) {
             return getStdLibReturnType(e.name);
           }
-          
-          TypePtr varType = lookupVar(e.name);
+
+          TypePtr varType = var ? var->type : nullptr;
           if (!varType) {
             FnDecl *fn = lookupFunction(e.name);
             if (fn) {
@@ -568,14 +590,35 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
           }
 
           if (auto *ident = std::get_if<IdentExpr>(&e.callee->data)) {
-            // Check if it's a stdlib function
-            if (isStdLibFunction(ident->name)) {
+            // Stdlib functions unless the program declares its own
+            if (isStdLibFunction(ident->name) && !lookupVar(ident->name) &&
+                !lookupFunction(ident->name)) {
               for (auto &arg : e.args) {
                 checkExpr(arg);
               }
               return getStdLibReturnType(ident->name);
             }
-            
+
+            FnDecl *fn = lookupVar(ident->name) ? nullptr
+                                                : lookupFunction(ident->name);
+            if (fn && (!fn->typeParams.empty() || !e.typeArgs.empty())) {
+              checkExpr(e.callee);
+              return checkCall(*fn, e, {}, expr->loc);
+            }
+
+            // A method of the struct being checked, called without `this.`
+            if (!fn && currentClass && currentClass->isStruct &&
+                !lookupVar(ident->name)) {
+              for (const auto &method : currentClass->methods) {
+                if (method.name == ident->name && method.isMut) {
+                  auto self = std::make_shared<Expr>();
+                  self->data = ThisExpr{};
+                  checkMutable(self, "call mut fn '" + method.name + "' on",
+                               expr->loc);
+                }
+              }
+            }
+
             if (currentModule) {
               for (const auto &cimport : currentModule->ast.cimports) {
                 if (std::find(cimport.symbols.begin(), cimport.symbols.end(),
@@ -589,6 +632,35 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
 
           bool isMethodCall = std::holds_alternative<MemberExpr>(e.callee->data);
 
+          if (isMethodCall && !isModuleCall) {
+            auto &member = std::get<MemberExpr>(e.callee->data);
+            TypePtr objectType = checkExpr(member.object);
+            if (isSoA(objectType)) {
+              for (auto &arg : e.args)
+                checkExpr(arg);
+              TypePtr method = soaMemberType(objectType, member.member);
+              if (method && method->kind == Type::FUNCTION)
+                return method->returnType;
+              errorAt(typeToString(objectType) + " has no method '" +
+                          member.member + "'",
+                      expr->loc);
+              return typeFromString("");
+            }
+
+            TypeBindings bindings;
+            if (ClassDecl *cls = classOf(objectType, bindings)) {
+              for (auto &method : cls->methods) {
+                if (method.name != member.member)
+                  continue;
+                if (method.isMut)
+                  checkMutable(member.object,
+                               "call mut fn '" + method.name + "' on",
+                               expr->loc);
+                return checkCall(method, e, bindings, expr->loc);
+              }
+            }
+          }
+
           if (isModuleCall || isMethodCall) {
             for (auto &arg : e.args) {
               checkExpr(arg);
@@ -596,6 +668,9 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
 
             // Try to infer return type for known methods
             if (auto *member = std::get_if<MemberExpr>(&e.callee->data)) {
+              std::string modulePath;
+              if (isModuleCall && dottedName(member->object, modulePath))
+                return getStdLibReturnType(member->member, modulePath);
               if (isStdLibFunction(member->member)) {
                 return getStdLibReturnType(member->member);
               }
@@ -623,10 +698,12 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
         } else if constexpr (std::is_same_v<T, MemberExpr>) {
           if (isModulePath(expr)) {
             // Check if it's a known stdlib function
-            if (isStdLibFunction(e.member)) {
+            std::string modulePath;
+            if (isStdLibFunction(e.member) &&
+                dottedName(e.object, modulePath)) {
               auto fnType = std::make_shared<Type>();
               fnType->kind = Type::FUNCTION;
-              fnType->returnType = getStdLibReturnType(e.member);
+              fnType->returnType = getStdLibReturnType(e.member, modulePath);
               return fnType;
             }
             
@@ -639,25 +716,30 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
 
           TypePtr objectType = checkExpr(e.object);
 
-          if (objectType->kind == Type::CLASS) {
-            ClassDecl *cls = lookupClass(objectType->className);
-            if (cls) {
-              for (const auto &field : cls->fields) {
-                if (field.name == e.member) {
-                  return field.type;
-                }
+          if (isSoA(objectType)) {
+            if (TypePtr memberType = soaMemberType(objectType, e.member))
+              return memberType;
+          }
+
+          // Members of an instantiated generic class (Stack<int>) have its
+          // type arguments in place of its type parameters
+          TypeBindings bindings;
+          if (ClassDecl *cls = classOf(objectType, bindings)) {
+            for (const auto &field : cls->fields) {
+              if (field.name == e.member) {
+                return substitute(field.type, bindings);
               }
+            }
 
-              for (const auto &method : cls->methods) {
-                if (method.name == e.member) {
-                  auto fnType = std::make_shared<Type>();
-                  fnType->kind = Type::FUNCTION;
-                  fnType->returnType = method.returnType;
-                  for (const auto &param : method.params) {
-                    fnType->paramTypes.push_back(param.type);
-                  }
-                  return fnType;
+            for (const auto &method : cls->methods) {
+              if (method.name == e.member) {
+                auto fnType = std::make_shared<Type>();
+                fnType->kind = Type::FUNCTION;
+                fnType->returnType = method.returnType;
+                for (const auto &param : method.params) {
+                  fnType->paramTypes.push_back(param.type);
                 }
+                return substitute(fnType, bindings);
               }
             }
           }
@@ -673,6 +755,9 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
           if (objectType->kind == Type::ARRAY) {
             return objectType->innerType;
           }
+          if (isSoA(objectType)) {
+            return objectType->genericArgs[0];
+          }
 
           auto voidType = std::make_shared<Type>();
           voidType->kind = Type::VOID;
@@ -680,6 +765,7 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
         } else if constexpr (std::is_same_v<T, AssignExpr>) {
           TypePtr targetType = checkExpr(e.target);
           checkExpr(e.value);
+          checkMutable(e.target, "assign to", expr->loc);
           return targetType;
         } else if constexpr (std::is_same_v<T, LambdaExpr>) {
           auto fnType = std::make_shared<Type>();
@@ -721,7 +807,7 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
                 if (matches) {
                   for (auto &importedCls : regModule->ast.classes) {
                     if (importedCls.name == e.className) {
-                      currentScope->classes[e.className] = &importedCls;
+                      defineClass(e.className, &importedCls);
                       cls = &importedCls;
                       break;
                     }
@@ -735,9 +821,48 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
             }
           }
 
+          if (cls && cls->isStruct) {
+            // new Vec3(x, y, z) sets the fields in declaration order
+            size_t fields = 0;
+            for (const auto &field : cls->fields)
+              fields += field.isStatic ? 0 : 1;
+            if (e.args.size() > fields)
+              errorAt("struct '" + e.className + "' has " +
+                          std::to_string(fields) + " field(s), got " +
+                          std::to_string(e.args.size()) + " values",
+                      expr->loc);
+            for (auto &arg : e.args)
+              checkExpr(arg);
+          }
+
+          if (cls && (!cls->typeParams.empty() || !e.typeArgs.empty())) {
+            std::string what = "class '" + e.className + "'";
+            if (e.typeArgs.size() != cls->typeParams.size()) {
+              errorAt(what + " expects " +
+                          std::to_string(cls->typeParams.size()) +
+                          " type argument(s), got " +
+                          std::to_string(e.typeArgs.size()),
+                      expr->loc);
+            } else {
+              TypeBindings bindings;
+              for (size_t i = 0; i < e.typeArgs.size(); i++)
+                bindings[cls->typeParams[i].name] = e.typeArgs[i];
+              checkTypeArgs(what, cls->typeParams, bindings, expr->loc);
+            }
+          }
+
           auto classType = std::make_shared<Type>();
-          classType->kind = Type::CLASS;
+          classType->kind = e.typeArgs.empty() ? Type::CLASS : Type::GENERIC;
           classType->className = e.className;
+          classType->genericArgs = e.typeArgs;
+          if (!cls && e.className == "SoA") {
+            classType->kind = Type::GENERIC;
+            checkSoAType(classType, expr->loc);
+            if (!e.args.empty())
+              errorAt("new SoA<T>() takes no arguments; add elements with "
+                      "push",
+                      expr->loc);
+          }
           return classType;
         } else if constexpr (std::is_same_v<T, SomeExpr>) {
           TypePtr valueType = checkExpr(e.value);
@@ -792,6 +917,388 @@ TypePtr TypeChecker::checkExpr(ExprPtr expr) {
   return resultType;
 }
 
+void TypeChecker::checkTypeParams(const std::vector<TypeParam> &params) {
+  for (size_t i = 0; i < params.size(); i++) {
+    for (size_t j = 0; j < i; j++) {
+      if (params[j].name == params[i].name)
+        errorAt("Duplicate type parameter '" + params[i].name + "'",
+                params[i].loc);
+    }
+    for (const auto &constraint : params[i].constraints) {
+      if (std::find(std::begin(CONSTRAINTS), std::end(CONSTRAINTS),
+                    constraint) == std::end(CONSTRAINTS))
+        errorAt("Unknown constraint '" + constraint + "' on type parameter '" +
+                    params[i].name +
+                    "'; expected Numeric, Comparable or Equatable",
+                params[i].loc);
+    }
+  }
+}
+
+// The type parameter `name` of the function or class being checked
+const TypeParam *TypeChecker::findTypeParam(const std::string &name) {
+  if (currentFunction) {
+    for (const auto &param : currentFunction->typeParams) {
+      if (param.name == name)
+        return &param;
+    }
+  }
+  if (currentClass) {
+    for (const auto &param : currentClass->typeParams) {
+      if (param.name == name)
+        return &param;
+    }
+  }
+  return nullptr;
+}
+
+// Whether `type` meets `constraint`. Numeric is int and float, Comparable
+// adds string, Equatable adds bool and Options and Arrays of Equatable
+// types. A type parameter meets what it is declared with; unknown types
+// meet nothing.
+bool TypeChecker::satisfies(TypePtr type, const std::string &constraint) {
+  if (!type)
+    return false;
+  switch (type->kind) {
+  case Type::INT:
+  case Type::FLOAT:
+    return true;
+  case Type::STRING:
+    return constraint != "Numeric";
+  case Type::BOOL:
+    return constraint == "Equatable";
+  case Type::OPTION:
+  case Type::ARRAY:
+    return constraint == "Equatable" && satisfies(type->innerType, constraint);
+  case Type::GENERIC:
+    if (const TypeParam *param = findTypeParam(type->className)) {
+      for (const auto &declared : param->constraints) {
+        if (implies(declared, constraint))
+          return true;
+      }
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+// Binds the type parameters in `param` to the matching parts of the
+// argument type `arg`. A parameter already bound to a different known type
+// is a conflict: returns false and describes it in `conflict`.
+bool TypeChecker::inferTypeArgs(TypePtr param, TypePtr arg,
+                                TypeBindings &bindings,
+                                std::string &conflict) {
+  if (!param || !arg)
+    return true;
+  if (param->kind == Type::GENERIC && param->genericArgs.empty()) {
+    auto it = bindings.find(param->className);
+    if (it == bindings.end() || !isKnown(arg))
+      return true;
+    if (!isKnown(it->second)) {
+      it->second = arg;
+    } else if (!typesEqual(it->second, arg)) {
+      conflict = "type parameter '" + param->className + "' is both '" +
+                 typeToString(it->second) + "' and '" + typeToString(arg) +
+                 "'";
+      return false;
+    }
+    return true;
+  }
+  if (param->kind != arg->kind)
+    return true;
+  if (!inferTypeArgs(param->innerType, arg->innerType, bindings, conflict) ||
+      !inferTypeArgs(param->returnType, arg->returnType, bindings, conflict))
+    return false;
+  if (param->className == arg->className) {
+    for (size_t i = 0;
+         i < param->genericArgs.size() && i < arg->genericArgs.size(); i++) {
+      if (!inferTypeArgs(param->genericArgs[i], arg->genericArgs[i], bindings,
+                         conflict))
+        return false;
+    }
+  }
+  for (size_t i = 0;
+       i < param->paramTypes.size() && i < arg->paramTypes.size(); i++) {
+    if (!inferTypeArgs(param->paramTypes[i], arg->paramTypes[i], bindings,
+                       conflict))
+      return false;
+  }
+  return true;
+}
+
+TypePtr TypeChecker::substitute(TypePtr type, const TypeBindings &bindings) {
+  if (!type || bindings.empty())
+    return type;
+  if (type->kind == Type::GENERIC && type->genericArgs.empty()) {
+    auto it = bindings.find(type->className);
+    return it != bindings.end() && it->second ? it->second : type;
+  }
+  if (!type->innerType && !type->returnType && type->genericArgs.empty() &&
+      type->paramTypes.empty())
+    return type;
+
+  auto result = std::make_shared<Type>(*type);
+  result->innerType = substitute(type->innerType, bindings);
+  result->returnType = substitute(type->returnType, bindings);
+  for (auto &arg : result->genericArgs)
+    arg = substitute(arg, bindings);
+  for (auto &paramType : result->paramTypes)
+    paramType = substitute(paramType, bindings);
+  return result;
+}
+
+void TypeChecker::checkTypeArgs(const std::string &what,
+                                const std::vector<TypeParam> &params,
+                                const TypeBindings &bindings,
+                                const SourceLoc &loc) {
+  for (const auto &param : params) {
+    auto it = bindings.find(param.name);
+    TypePtr arg = it != bindings.end() ? it->second : nullptr;
+    if (!arg || arg->kind == Type::VOID) {
+      errorAt("Cannot infer type parameter '" + param.name + "' of " + what +
+                  "; pass it explicitly",
+              loc);
+      continue;
+    }
+    for (const auto &constraint : param.constraints) {
+      if (!satisfies(arg, constraint))
+        errorAt("Type '" + typeToString(arg) + "' does not satisfy '" +
+                    constraint + "', required by type parameter '" +
+                    param.name + "' of " + what,
+                loc);
+    }
+  }
+}
+
+// The class a value of `type` is an instance of, with its type parameters
+// bound to the instance's type arguments
+ClassDecl *TypeChecker::classOf(TypePtr type, TypeBindings &bindings) {
+  if (!type || (type->kind != Type::CLASS && type->kind != Type::GENERIC))
+    return nullptr;
+  ClassDecl *cls = lookupClass(type->className);
+  if (!cls)
+    return nullptr;
+  for (size_t i = 0; i < cls->typeParams.size() && i < type->genericArgs.size();
+       i++)
+    bindings[cls->typeParams[i].name] = type->genericArgs[i];
+  return cls;
+}
+
+// The struct declaration for values of `type`, or null
+ClassDecl *TypeChecker::structOf(TypePtr type) {
+  if (!type || (type->kind != Type::CLASS && type->kind != Type::GENERIC))
+    return nullptr;
+  ClassDecl *cls = lookupClass(type->className);
+  return cls && cls->isStruct ? cls : nullptr;
+}
+
+// Struct fields are stored inline, so they must be plain data: numbers,
+// bools, other structs or type parameters
+void TypeChecker::checkStructFields(ClassDecl &cls) {
+  for (const auto &field : cls.fields) {
+    if (field.isStatic || !field.type)
+      continue;
+    bool plain = false;
+    switch (field.type->kind) {
+    case Type::INT:
+    case Type::FLOAT:
+    case Type::BOOL:
+      plain = true;
+      break;
+    case Type::GENERIC:
+      plain = field.type->genericArgs.empty()
+                  ? findTypeParam(field.type->className) != nullptr
+                  : structOf(field.type) != nullptr;
+      break;
+    case Type::CLASS:
+      plain = structOf(field.type) != nullptr &&
+              field.type->className != cls.name;
+      break;
+    default:
+      break;
+    }
+    if (!plain)
+      errorAt("Struct field '" + field.name + "' has type " +
+                  typeToString(field.type) +
+                  "; struct fields must be int, float, bool or another struct",
+              field.loc);
+  }
+}
+
+// Reports `action` ("assign to") on `target` when it reaches through a
+// struct parameter, or through the struct itself in a method that is not a
+// `mut fn`
+void TypeChecker::checkMutable(const ExprPtr &target,
+                               const std::string &action,
+                               const SourceLoc &loc) {
+  ExprPtr root = target;
+  while (true) {
+    if (auto *member = std::get_if<MemberExpr>(&root->data))
+      root = member->object;
+    else if (auto *index = std::get_if<IndexExpr>(&root->data))
+      root = index->object;
+    else
+      break;
+  }
+
+  bool self = std::holds_alternative<ThisExpr>(root->data);
+  if (auto *ident = std::get_if<IdentExpr>(&root->data)) {
+    if (const Var *var = findVar(ident->name)) {
+      if (var->byRef)
+        errorAt("Cannot " + action + " '" + ident->name +
+                    "': struct parameters are read-only references; copy it "
+                    "with 'let mut' first",
+                loc);
+      return;
+    }
+    if (currentClass) {
+      for (const auto &field : currentClass->fields)
+        self = self || (!field.isStatic && field.name == ident->name);
+    }
+  }
+
+  if (self && currentClass && currentClass->isStruct && currentFunction &&
+      !currentFunction->isMut && !currentFunction->isStatic)
+    errorAt("Cannot " + action + " '" + currentClass->name + "' in '" +
+                currentFunction->name + "', which is not a 'mut fn'",
+            loc);
+}
+
+bool TypeChecker::isSoA(TypePtr type) {
+  return type && type->kind == Type::GENERIC && type->className == "SoA" &&
+         type->genericArgs.size() == 1 && !lookupClass("SoA");
+}
+
+// SoA<T> needs a struct T whose fields can become columns named after them
+void TypeChecker::checkSoAType(TypePtr type, const SourceLoc &loc) {
+  ClassDecl *cls = type->genericArgs.size() == 1
+                       ? structOf(type->genericArgs[0])
+                       : nullptr;
+  if (!cls) {
+    errorAt("SoA takes one struct type, as in SoA<Particle>", loc);
+    return;
+  }
+
+  bool hasColumn = false;
+  for (const auto &field : cls->fields) {
+    if (field.isStatic)
+      continue;
+    hasColumn = true;
+    if (std::find(std::begin(SOA_MEMBERS), std::end(SOA_MEMBERS),
+                  field.name) != std::end(SOA_MEMBERS))
+      errorAt("Field '" + field.name + "' of struct '" + cls->name +
+                  "' clashes with SoA's own '" + field.name + "'",
+              loc);
+  }
+  if (!hasColumn)
+    errorAt("SoA<" + cls->name + "> needs a struct with fields", loc);
+}
+
+// A field of the element type is its column, an Array; anything else is
+// one of the container's methods, or null
+TypePtr TypeChecker::soaMemberType(TypePtr soa, const std::string &member) {
+  TypePtr element = soa->genericArgs[0];
+  TypeBindings bindings;
+  if (ClassDecl *cls = classOf(element, bindings)) {
+    for (const auto &field : cls->fields) {
+      if (!field.isStatic && field.name == member) {
+        auto column = std::make_shared<Type>();
+        column->kind = Type::ARRAY;
+        column->innerType = substitute(field.type, bindings);
+        return column;
+      }
+    }
+  }
+
+  auto method = [](TypePtr returns, std::vector<TypePtr> params) {
+    auto fnType = std::make_shared<Type>();
+    fnType->kind = Type::FUNCTION;
+    fnType->returnType = std::move(returns);
+    fnType->paramTypes = std::move(params);
+    return fnType;
+  };
+  TypePtr intType = typeFromString("int");
+  TypePtr voidType = typeFromString("void");
+  if (member == "size")
+    return method(intType, {});
+  if (member == "get")
+    return method(element, {intType});
+  if (member == "set")
+    return method(voidType, {intType, element});
+  if (member == "push")
+    return method(voidType, {element});
+  if (member == "reserve")
+    return method(voidType, {intType});
+  if (member == "clear")
+    return method(voidType, {});
+  return nullptr;
+}
+
+// Checks a call of the user function or method `fn` and returns its result
+// type. `bindings` has the type arguments of the instance a method is
+// called on. The function's own type parameters come from the call's
+// explicit type arguments or are inferred from its arguments, and must meet
+// their constraints.
+TypePtr TypeChecker::checkCall(FnDecl &fn, CallExpr &call,
+                               TypeBindings bindings, const SourceLoc &loc) {
+  std::string what = "'" + fn.name + "'";
+  bool explicitArgs = !call.typeArgs.empty();
+  if (explicitArgs && call.typeArgs.size() != fn.typeParams.size()) {
+    errorAt(what + " expects " + std::to_string(fn.typeParams.size()) +
+                " type argument(s), got " +
+                std::to_string(call.typeArgs.size()),
+            loc);
+    for (auto &arg : call.args)
+      checkExpr(arg);
+    return typeFromString("");
+  }
+
+  if (call.args.size() != fn.params.size())
+    errorAt(what + " expects " + std::to_string(fn.params.size()) +
+                " argument(s), got " + std::to_string(call.args.size()),
+            loc);
+
+  // Only the function's own type parameters are inferred; those of the
+  // instance are fixed, and arguments are checked against them below
+  TypeBindings inferred;
+  for (size_t i = 0; i < fn.typeParams.size(); i++)
+    inferred[fn.typeParams[i].name] = explicitArgs ? call.typeArgs[i] : nullptr;
+  std::vector<TypePtr> argTypes;
+  bool conflicting = false;
+  for (size_t i = 0; i < call.args.size(); i++) {
+    argTypes.push_back(checkExpr(call.args[i]));
+    std::string conflict;
+    if (!explicitArgs && !conflicting && i < fn.params.size() &&
+        !inferTypeArgs(fn.params[i].type, argTypes.back(), inferred,
+                       conflict)) {
+      errorAt("Conflicting arguments to " + what + ": " + conflict,
+              call.args[i]->loc);
+      conflicting = true;
+    }
+  }
+  for (auto &[name, type] : inferred)
+    bindings[name] = type;
+  if (conflicting)
+    return typeFromString("");
+  checkTypeArgs(what, fn.typeParams, bindings, loc);
+
+  // Numbers convert into each other as they do for non-generic calls
+  for (size_t i = 0; i < argTypes.size() && i < fn.params.size(); i++) {
+    TypePtr expected = substitute(fn.params[i].type, bindings);
+    if (!isKnown(expected) || !isKnown(argTypes[i]) ||
+        isAssignable(argTypes[i], expected) ||
+        (isNumeric(argTypes[i]) && isNumeric(expected)))
+      continue;
+    errorAt("Argument " + std::to_string(i + 1) + " of " + what + " is '" +
+                typeToString(argTypes[i]) + "', expected '" +
+                typeToString(expected) + "'",
+            call.args[i]->loc);
+  }
+  TypePtr result = substitute(fn.returnType, bindings);
+  return result ? result : typeFromString("");
+}
+
 void TypeChecker::errorAt(const std::string &msg, const SourceLoc &loc) {
   SourceLocation srcLoc;
   srcLoc.file = currentModule ? currentModule->filepath : "<unknown>";
@@ -862,6 +1369,24 @@ bool TypeChecker::isBoolean(TypePtr type) {
   return type && type->kind == Type::BOOL;
 }
 
+bool TypeChecker::isKnown(TypePtr type) {
+  if (!type || type->kind == Type::VOID)
+    return false;
+  if (type->innerType && !isKnown(type->innerType))
+    return false;
+  if (type->kind == Type::FUNCTION && !isKnown(type->returnType))
+    return false;
+  for (const auto &arg : type->genericArgs) {
+    if (!isKnown(arg))
+      return false;
+  }
+  for (const auto &paramType : type->paramTypes) {
+    if (!isKnown(paramType))
+      return false;
+  }
+  return true;
+}
+
 bool TypeChecker::checkMemberAccess(const std::string &className,
                                     const std::string &memberName,
                                     bool isStatic) {
@@ -84,6 +84,51 @@ run_test() {
     fi
 }
 
+# A one-file gear project in test_project/. Project builds run the type
+# checker, which single-file runs skip.
+make_test_project() {
+    rm -rf test_project
+    mkdir -p test_project/src
+    printf '[project]\nname = "test-project"\nversion = "0.1.0"\n\n[dependencies]\n' > test_project/project.toml
+    cp "$1" test_project/src/main.mg
+}
+
+# Like run_test, but built as a project
+run_project_test() {
+    local test_name="$1"
+    local test_file="$2"
+    local expected_output="$3"
+    
+    make_test_project "$test_file"
+    if output=$(cd test_project && gear run 2>&1); then
+        if echo "$output" | grep -qF "$expected_output"; then
+            print_result "$test_name" "PASS"
+        else
+            print_result "$test_name" "FAIL" "Output doesn't match. Expected: '$expected_output', Got: '$output'"
+        fi
+    else
+        print_result "$test_name" "FAIL" "Build or execution failed: $output"
+    fi
+    rm -rf test_project
+}
+
+# Build a one-file project and expect it to fail with the given error
+check_project_error() {
+    local test_name="$1"
+    local test_file="$2"
+    local expected_error="$3"
+    
+    make_test_project "$test_file"
+    if output=$(cd test_project && gear build 2>&1); then
+        print_result "$test_name" "FAIL" "Build should have failed with: $expected_error"
+    elif echo "$output" | grep -qF "$expected_error"; then
+        print_result "$test_name" "PASS"
+    else
+        print_result "$test_name" "FAIL" "Expected error '$expected_error', got: $output"
+    fi
+    rm -rf test_project
+}
+
 # Check prerequisites
 check_prerequisites() {
     print_header "Checking Prerequisites"
@@ -757,6 +802,126 @@ EOF
     
     cd ..
     rm -rf test_pkg_lib test_pkg_app
+    
+    test_package_solver
+}
+
+# Publish one version of a package to a local bare repository as tag v<version>.
+# Usage: publish_package <registry-dir> <name> <version> [dep=spec ...]
+publish_package() {
+    local registry="$1" name="$2" version="$3"
+    shift 3
+    local work="$registry.work/$name"
+    if [ ! -d "$work" ]; then
+        mkdir -p "$work/src"
+        git init -q --bare "$registry/$name"
+        git -C "$work" init -q
+        git -C "$work" remote add origin "$registry/$name"
+    fi
+    printf '[project]\nname = "%s"\nversion = "%s"\n\n[dependencies]\n' "$name" "$version" > "$work/project.toml"
+    for dep in "$@"; do
+        echo "${dep%%=*} = \"${dep#*=}\"" >> "$work/project.toml"
+    done
+    echo "pub fn ${name}_version() -> string { return \"$version\"; }" > "$work/src/lib.mg"
+    git -C "$work" add -A
+    git -C "$work" -c user.name=test -c user.email=test@example.com commit -q -m "$version"
+    git -C "$work" tag "v$version"
+    git -C "$work" push -q origin HEAD:refs/heads/master --tags
+}
+
+# Create an app project that imports the given modules.
+# Usage: create_import_app <dir> <module,...> [dependency line ...]
+create_import_app() {
+    local dir="$1" modules="$2"
+    shift 2
+    mkdir -p "$dir/src"
+    printf '[project]\nname = "%s"\nversion = "0.1.0"\n\n[dependencies]\n' "$dir" > "$dir/project.toml"
+    for dep in "$@"; do
+        echo "$dep" >> "$dir/project.toml"
+    done
+    echo "using Std.IO;" > "$dir/src/main.mg"
+    for module in ${modules//,/ }; do
+        echo "using $module;" >> "$dir/src/main.mg"
+    done
+    printf '\nfn main() {\n    Std.print("imports ok\\n");\n}\n' >> "$dir/src/main.mg"
+}
+
+# Version of a package recorded in the lock file of the current project
+locked_version() {
+    grep -A1 "^name = \"$1\"" .magolor/lock.toml | sed -n 's/^version = "\(.*\)"/\1/p'
+}
+
+test_package_solver() {
+    if ! command -v git &> /dev/null; then
+        print_result "9.2 Version Solving with a Local Registry" "SKIP"
+        return
+    fi
+    
+    # The store lives under MAGOLOR_HOME; keep it out of the user's home
+    local registry="$PWD/test_registry"
+    local saved_home="${MAGOLOR_HOME-}"
+    export MAGOLOR_HOME="$PWD/test_magolor_home"
+    export MAGOLOR_REGISTRY="$registry"
+    mkdir -p "$registry"
+    
+    # a 1.1.0 needs c ^2 but b needs c ^1, so the solver must fall back to a 1.0.0
+    publish_package "$registry" c 1.0.0
+    publish_package "$registry" c 2.0.0
+    publish_package "$registry" a 1.0.0 "c=^1"
+    publish_package "$registry" a 1.1.0 "c=^2"
+    publish_package "$registry" b 1.0.0 "c=^1"
+    
+    # Test 9.2: Backtracking, and module names taken from the package links
+    create_import_app test_solver_app a.lib,c.lib 'a = "^1"' 'b = "^1"'
+    cd test_solver_app
+    if gear install > /dev/null 2>&1 && gear run 2>&1 | grep -q "imports ok" &&
+       [ "$(locked_version a) $(locked_version c)" = "1.0.0 1.0.0" ]; then
+        print_result "9.2 Version Solving with a Local Registry" "PASS"
+    else
+        print_result "9.2 Version Solving with a Local Registry" "FAIL" "Expected a 1.0.0 and c 1.0.0: $(gear run 2>&1 | tail -3)"
+    fi
+    cd ..
+    
+    # Test 9.3: A second project links the same store entry
+    create_import_app test_solver_app2 c.lib 'c = "^1"'
+    cd test_solver_app2
+    if gear install > /dev/null 2>&1 &&
+       [ "$(readlink -f .magolor/packages/c)" = "$(readlink -f ../test_solver_app/.magolor/packages/c)" ]; then
+        print_result "9.3 Shared Package Store" "PASS"
+    else
+        print_result "9.3 Shared Package Store" "FAIL" "c was not linked to the existing store entry"
+    fi
+    cd ..
+    
+    # Test 9.4: Unsatisfiable constraints are reported
+    create_import_app test_solver_conflict c.lib 'b = "^1"' 'c = "^2"'
+    cd test_solver_conflict
+    if output=$(magolor install-deps 2>&1); then
+        print_result "9.4 Version Conflict Detection" "FAIL" "Install should have failed"
+    elif echo "$output" | grep -q "conflicts with"; then
+        print_result "9.4 Version Conflict Detection" "PASS"
+    else
+        print_result "9.4 Version Conflict Detection" "FAIL" "No conflict reported: $output"
+    fi
+    cd ..
+    
+    # Test 9.5: git+ dependencies on bare repositories are fetched together
+    # and recorded in a complete lock file
+    publish_package "$registry" d 1.0.0
+    create_import_app test_git_deps c.lib,d.lib "c = \"git+$registry/c#^1\"" "d = \"git+$registry/d\""
+    cd test_git_deps
+    if gear install > /dev/null 2>&1 && gear run 2>&1 | grep -q "imports ok" &&
+       [ "$(locked_version c) $(locked_version d)" = "1.0.0 1.0.0" ] &&
+       [ ! -e .magolor/lock.toml.tmp ]; then
+        print_result "9.5 Git Dependencies from Bare Repositories" "PASS"
+    else
+        print_result "9.5 Git Dependencies from Bare Repositories" "FAIL" "$(gear run 2>&1 | tail -3)"
+    fi
+    cd ..
+    
+    unset MAGOLOR_REGISTRY
+    if [ -n "$saved_home" ]; then export MAGOLOR_HOME="$saved_home"; else unset MAGOLOR_HOME; fi
+    rm -rf test_registry test_registry.work test_magolor_home test_solver_app test_solver_app2 test_solver_conflict test_git_deps
 }
 
 # ============================================================================
@@ -883,6 +1048,438 @@ EOF
     rm -f test_fibonacci.mg test_sort.mg test_hof.mg
 }
 
+# ============================================================================
+# TEST SUITE 12: Language Server
+# ============================================================================
+
+# Frame one JSON-RPC message; Content-Length counts bytes
+lsp_message() {
+    printf 'Content-Length: %d\r\n\r\n%s' "$(printf '%s' "$1" | wc -c)" "$1"
+}
+
+# Open a document (JSON-escaped text), apply one incremental change and
+# print the server output. Diagnostics for the edit carry version 2.
+lsp_edit_session() {
+    local uri="file://$PWD/test_lsp.mg"
+    {
+        lsp_message '{"jsonrpc":"2.0","id":1,"method":"initialize","params":{"capabilities":{}}}'
+        lsp_message '{"jsonrpc":"2.0","method":"initialized","params":{}}'
+        lsp_message '{"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"'"$uri"'","languageId":"magolor","version":1,"text":"'"$1"'"}}}'
+        sleep 1
+        lsp_message '{"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"'"$uri"'","version":2},"contentChanges":[{"range":'"$2"',"text":"'"$3"'"}]}}'
+        sleep 1
+        lsp_message '{"jsonrpc":"2.0","id":2,"method":"shutdown"}'
+        lsp_message '{"jsonrpc":"2.0","method":"exit"}'
+    } | magolor lsp 2>/dev/null
+}
+
+# Diagnostics published for one document version, e.g. "[]"
+lsp_diagnostics() {
+    grep -ao "\"version\":$1,\"diagnostics\":\[[^]]*\]" | tail -1 | sed 's/.*"diagnostics"://'
+}
+
+test_lsp() {
+    print_header "TEST SUITE 12: Language Server"
+    
+    # Test 12.1: Incremental edits count columns in UTF-16 code units
+    local diags
+    diags=$(lsp_edit_session 'fn main() {\n    let s = \"é\";\n}\n' \
+        '{"start":{"line":1,"character":14},"end":{"line":1,"character":16}}' '\";' | lsp_diagnostics 2)
+    if [ "$diags" = "[]" ]; then
+        print_result "12.1 UTF-16 Edit Positions" "PASS"
+    else
+        print_result "12.1 UTF-16 Edit Positions" "FAIL" "Unexpected diagnostics: $diags"
+    fi
+    
+    # Test 12.2: Editing a type parameter constraint re-checks the callers
+    diags=$(lsp_edit_session 'fn h<T: Equatable>(a: T) -> T {\n    return a;\n}\n\nfn main() {\n    let x = h(\"s\");\n}\n' \
+        '{"start":{"line":0,"character":8},"end":{"line":0,"character":17}}' 'Numeric' | lsp_diagnostics 2)
+    if echo "$diags" | grep -q "does not satisfy 'Numeric'"; then
+        print_result "12.2 Incremental Generic Constraints" "PASS"
+    else
+        print_result "12.2 Incremental Generic Constraints" "FAIL" "Missing constraint error: $diags"
+    fi
+    
+    # Test 12.3: Turning a struct into a class re-checks functions taking it
+    diags=$(lsp_edit_session 'struct P {\n    pub x: int;\n}\n\nfn f(p: P) {\n    p.x = 1;\n}\n\nfn main() {\n}\n' \
+        '{"start":{"line":0,"character":0},"end":{"line":0,"character":6}}' 'class' | lsp_diagnostics 2)
+    if [ "$diags" = "[]" ]; then
+        print_result "12.3 Incremental Struct Declarations" "PASS"
+    else
+        print_result "12.3 Incremental Struct Declarations" "FAIL" "Stale diagnostics: $diags"
+    fi
+    
+    # Test 12.4: test fn and bench fn stay whole declarations, before and after an edit
+    local output
+    output=$(lsp_edit_session 'fn add(a: int, b: int) -> int {\n    return a + b;\n}\n\ntest fn addWorks() {\n    Std.Test.assertEq(add(2, 2), 4);\n}\n\nbench fn addBench() {\n    Std.Bench.blackBox(add(1, 2));\n}\n' \
+        '{"start":{"line":5,"character":33},"end":{"line":5,"character":34}}' '5')
+    if [ "$(echo "$output" | lsp_diagnostics 1)" = "[]" ] && [ "$(echo "$output" | lsp_diagnostics 2)" = "[]" ]; then
+        print_result "12.4 Test and Bench Declarations" "PASS"
+    else
+        print_result "12.4 Test and Bench Declarations" "FAIL" "Unexpected diagnostics: $output"
+    fi
+    
+    rm -f test_lsp.mg
+}
+
+# ============================================================================
+# TEST SUITE 13: Generics
+# ============================================================================
+test_generics() {
+    print_header "TEST SUITE 13: Generics"
+    
+    # Test 13.1: Generic functions and classes
+    cat > test_generics.mg << 'EOF'
+using Std.IO;
+
+fn sum<T: Numeric>(xs: Array<T>) -> T {
+    let mut total = xs[0];
+    let mut i = 1;
+    while (i < Std.Array.length(xs)) {
+        total = total + xs[i];
+        i = i + 1;
+    }
+    return total;
+}
+
+class Box<T> {
+    pub value: T;
+
+    pub fn set(v: T) {
+        this.value = v;
+    }
+}
+
+fn main() {
+    let b = new Box<string>();
+    b.set("boxed");
+    let total = sum([1, 2, 3]);
+    let pair = sum<int>([4, 5]);
+    Std.print($"Generics: {total} {pair} {b.value}\n");
+}
+EOF
+    run_test "13.1 Generic Functions and Classes" "test_generics.mg" "Generics: 6 9 boxed"
+    
+    # Test 13.2: A program function named like a std:: one, called with strings
+    cat > test_generic_max.mg << 'EOF'
+using Std.IO;
+
+fn max<T: Comparable>(a: T, b: T) -> T {
+    if (a > b) {
+        return a;
+    }
+    return b;
+}
+
+fn main() {
+    let word = max("apple", "pear");
+    let number = max(3, 7);
+    Std.print($"Max: {word} {number}\n");
+}
+EOF
+    run_test "13.2 Generic Call Beside std::max" "test_generic_max.mg" "Max: pear 7"
+    
+    # Test 13.3: Arguments that bind one type parameter to two types
+    cat > test_generic_conflict.mg << 'EOF'
+fn biggest<T: Comparable>(a: T, b: T) -> T {
+    return a;
+}
+
+fn main() {
+    let x = biggest(1, "a");
+}
+EOF
+    check_project_error "13.3 Conflicting Type Arguments" "test_generic_conflict.mg" \
+        "type parameter 'T' is both 'int' and 'string'"
+    
+    # Test 13.4: Unsatisfied constraint
+    cat > test_generic_constraint.mg << 'EOF'
+fn twice<T: Numeric>(a: T) -> T {
+    return a + a;
+}
+
+fn main() {
+    let x = twice("no");
+}
+EOF
+    check_project_error "13.4 Constraint Checking" "test_generic_constraint.mg" \
+        "Type 'string' does not satisfy 'Numeric'"
+    
+    # Test 13.5: Argument count and types of generic calls
+    cat > test_generic_args.mg << 'EOF'
+class Box<T> {
+    pub value: T;
+
+    pub fn set(v: T) {
+        this.value = v;
+    }
+}
+
+fn id<T>(a: T) -> T {
+    return a;
+}
+
+fn main() {
+    let b = new Box<int>();
+    b.set("four");
+    let x = id(1, 2);
+}
+EOF
+    check_project_error "13.5 Generic Argument Types" "test_generic_args.mg" \
+        "Argument 1 of 'set' is 'string', expected 'int'"
+    check_project_error "13.6 Generic Argument Count" "test_generic_args.mg" \
+        "'id' expects 1 argument(s), got 2"
+    
+    rm -f test_generics.mg test_generic_max.mg test_generic_conflict.mg \
+          test_generic_constraint.mg test_generic_args.mg
+}
+
+# ============================================================================
+# TEST SUITE 14: Structs
+# ============================================================================
+test_structs() {
+    print_header "TEST SUITE 14: Structs"
+    
+    cat > test_structs.mg << 'EOF'
+using Std.IO;
+
+struct Vec3 {
+    x: float;
+    y: float;
+    z: float;
+
+    fn dot(other: Vec3) -> float {
+        return x * other.x + y * other.y + z * other.z;
+    }
+
+    mut fn scale(k: float) {
+        x = x * k;
+        this.y = this.y * k;
+        z = z * k;
+    }
+}
+
+@packed
+struct Header {
+    tag: int;
+    flag: bool;
+    weight: float;
+}
+
+@align(32)
+struct Particle {
+    pos: Vec3;
+    mass: float = 1.0;
+}
+
+fn length2(v: Vec3) -> float {
+    return v.dot(v);
+}
+
+fn main() {
+    let mut v = new Vec3(1.0, 2.0, 3.0);
+    v.scale(2.0);
+    let d = length2(v);
+    let h = new Header(7, true, 0.5);
+    let ps = [new Particle(v), new Particle(new Vec3(0.0, 1.0, 0.0), 3.0)];
+    let mut total = 0.0;
+    for (p in ps) {
+        total = total + p.mass;
+    }
+    println($"Struct: {d} {h.tag} {total} {v}");
+    @cpp {
+        std::cout << "Layout: " << sizeof(Header) << " " << alignof(Particle) << std::endl;
+    }
+}
+EOF
+    # Test 14.1: Values, methods, mut fn and defaults
+    run_project_test "14.1 Struct Values and Methods" "test_structs.mg" "Struct: 56 7 4 Vec3 { x: 2, y: 4, z: 6 }"
+    
+    # Test 14.2: @packed and @align reach the C++ layout
+    run_project_test "14.2 Packed and Aligned Layout" "test_structs.mg" "Layout: 13 32"
+    
+    cat > test_struct_errors.mg << 'EOF'
+struct Vec2 {
+    x: float;
+    y: float;
+    name: string;
+
+    fn bump() {
+        x = x + 1.0;
+    }
+}
+
+fn move(v: Vec2) {
+    v.x = 2.0;
+}
+
+fn main() {
+    let v = new Vec2(1.0, 2.0, 3.0, 4.0);
+}
+EOF
+    # Test 14.3 - 14.6: Field types, mutability and construction
+    check_project_error "14.3 Struct Field Types" "test_struct_errors.mg" \
+        "Struct field 'name' has type string"
+    check_project_error "14.4 Struct Methods Are Read-Only" "test_struct_errors.mg" \
+        "Cannot assign to 'Vec2' in 'bump', which is not a 'mut fn'"
+    check_project_error "14.5 Struct Parameters Are Read-Only" "test_struct_errors.mg" \
+        "Cannot assign to 'v': struct parameters are read-only references"
+    check_project_error "14.6 Struct Construction" "test_struct_errors.mg" \
+        "struct 'Vec2' has 3 field(s), got 4 values"
+    
+    rm -f test_structs.mg test_struct_errors.mg
+}
+
+# ============================================================================
+# TEST SUITE 15: Struct of Arrays
+# ============================================================================
+
+test_soa() {
+    print_header "TEST SUITE 15: Struct of Arrays"
+    
+    cat > test_soa.mg << 'EOF'
+using Std.IO;
+
+struct Particle {
+    mass: float;
+    alive: bool;
+}
+
+fn main() {
+    let mut ps = new SoA<Particle>();
+    let mut i = 0;
+    while (i < 4) {
+        ps.push(new Particle(1.0 + i, true));
+        i = i + 1;
+    }
+    ps[1].alive = false;
+    Std.Array.scale(ps.mass, 2.0);
+    let mut alive = 0;
+    for (p in ps) {
+        if (p.alive) {
+            alive = alive + 1;
+        }
+    }
+    let total = Std.Array.sum(ps.mass);
+    println($"SoA: {ps.size()} {alive} {total}");
+
+    let mut r = ps[0];
+    r.mass = 9.0;
+    let kept = ps[0].mass;
+    println($"Bind: {kept} {r.mass}");
+
+    let mut j = 0;
+    while (j < 1000) {
+        ps.push(new Particle(0.5, false));
+        j = j + 1;
+    }
+    println($"Grow: {ps.size()} {r.mass} {r.alive}");
+}
+EOF
+    # Test 15.1: Columns, element proxies and iteration
+    run_project_test "15.1 SoA Columns" "test_soa.mg" "SoA: 4 3 20"
+    
+    # Test 15.2: A binding copies the element out of the columns
+    run_project_test "15.2 SoA Copy on Bind" "test_soa.mg" "Bind: 2 9"
+    
+    # Test 15.3: The copy survives the columns reallocating
+    run_project_test "15.3 SoA Push After Bind" "test_soa.mg" "Grow: 1004 9 true"
+    
+    rm -f test_soa.mg
+}
+
+# ============================================================================
+# TEST SUITE 16: Tests and Benchmarks
+# ============================================================================
+
+test_test_fns() {
+    print_header "TEST SUITE 16: Tests and Benchmarks"
+    
+    cat > test_fns.mg << 'EOF'
+using Std.IO;
+
+fn add(a: int, b: int) -> int {
+    return a + b;
+}
+
+fn main() {
+    println($"{add(1, 2)}");
+}
+
+test fn addsSmall() {
+    Std.Test.assertEq(add(2, 2), 4);
+}
+
+test fn checksSum() {
+    Std.Test.check(add(1, 1) == 2, "one plus one");
+}
+
+bench fn addLoop() {
+    let mut total = 0;
+    let mut i = 0;
+    while (i < 1000) {
+        total = Std.Bench.blackBox(add(total, i));
+        i = i + 1;
+    }
+}
+EOF
+    # Test 16.1: Passing test fns are run and reported
+    make_test_project test_fns.mg
+    if output=$(cd test_project && gear test 2>&1) && echo "$output" | grep -qF "2 passed; 0 failed"; then
+        print_result "16.1 Passing Tests" "PASS"
+    else
+        print_result "16.1 Passing Tests" "FAIL" "Expected 2 passing tests, got: $output"
+    fi
+    
+    # Test 16.2: Test fns stay out of the normal build
+    if output=$(cd test_project && gear run 2>&1) && echo "$output" | grep -qx "3"; then
+        print_result "16.2 Tests Excluded From Build" "PASS"
+    else
+        print_result "16.2 Tests Excluded From Build" "FAIL" "Expected main to print 3, got: $output"
+    fi
+    
+    # Test 16.3: Bench fns report a time per iteration
+    if output=$(cd test_project && gear bench 2>&1) && echo "$output" | grep -q "^addLoop .*/iter"; then
+        print_result "16.3 Benchmarks" "PASS"
+    else
+        print_result "16.3 Benchmarks" "FAIL" "Expected a timing for addLoop, got: $output"
+    fi
+    
+    # Test 16.4: A failing assertion fails the run and shows its output
+    cat >> test_project/src/main.mg << 'EOF'
+
+test fn broken() {
+    Std.print("about to fail\n");
+    Std.Test.assertEq(add(2, 2), 5);
+}
+EOF
+    if output=$(cd test_project && gear test 2>&1); then
+        print_result "16.4 Failing Test" "FAIL" "gear test should have failed: $output"
+    elif echo "$output" | grep -qF "2 passed; 1 failed" && echo "$output" | grep -qF "about to fail"; then
+        print_result "16.4 Failing Test" "PASS"
+    else
+        print_result "16.4 Failing Test" "FAIL" "Expected 2 passed and 1 failed, got: $output"
+    fi
+    
+    # Test 16.5: A test name reused in tests/ is reported, not left to the C++ compiler
+    mkdir -p test_project/tests
+    cat > test_project/tests/more.mg << 'EOF'
+test fn addsSmall() {
+    Std.Test.assertEq(add(1, 1), 2);
+}
+EOF
+    if output=$(cd test_project && gear test 2>&1); then
+        print_result "16.5 Duplicate Test Names" "FAIL" "gear test should have failed: $output"
+    elif echo "$output" | grep -qF "test fn 'addsSmall' is defined more than once" &&
+         echo "$output" | grep -qF "src/main.mg:"; then
+        print_result "16.5 Duplicate Test Names" "PASS"
+    else
+        print_result "16.5 Duplicate Test Names" "FAIL" "Expected a duplicate test diagnostic, got: $output"
+    fi
+    
+    rm -rf test_project test_fns.mg
+}
+
 # ============================================================================
 # Main Execution
 # ============================================================================
@@ -902,6 +1499,11 @@ main() {
     echo "  • Package management"
     echo "  • Error detection and handling"
     echo "  • Advanced algorithms"
+    echo "  • Language server"
+    echo "  • Generics"
+    echo "  • Structs"
+    echo "  • Struct of arrays"
+    echo "  • Test and bench functions"
     echo ""
     
     check_prerequisites
@@ -918,6 +1520,11 @@ main() {
     test_packages
     test_error_handling
     test_advanced
+    test_lsp
+    test_generics
+    test_structs
+    test_soa
+    test_test_fns
     
     # Print summary
     echo ""